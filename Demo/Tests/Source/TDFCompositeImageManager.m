@@ -186,6 +186,24 @@
     XCTAssertTrue([manager2.imageTasks containsObject:task2]);
 }
 
+- (void)testThatFirstManagerInChainThatCanHandleRequestIsUsed {
+    _TDFMockImageManagerForComposite *manager1 = [_TDFMockImageManagerForComposite new];
+    manager1.supportedResource = @"01";
+    _TDFMockImageManagerForComposite *manager2 = [_TDFMockImageManagerForComposite new];
+    manager2.supportedResource = @"02";
+    DFCompositeImageManager *composite = [[DFCompositeImageManager alloc] initWithImageManagers:@[ manager1, manager2 ]];
+    
+    DFImageRequest *request = [DFImageRequest requestWithResource:@"02"];
+    [composite imageTaskForRequest:request completion:nil];
+    XCTAssertEqual(manager2.imageTasks.count, 1);
+    
+    // Managers may decide based on anything in the request, the previous result is not reused
+    manager1.supportedResource = @"02";
+    [composite imageTaskForRequest:request completion:nil];
+    XCTAssertEqual(manager1.imageTasks.count, 1);
+    XCTAssertEqual(manager2.imageTasks.count, 1);
+}
+
 - (void)testThatIfTheRequestCantBeHandledTheExceptionIsThrown {
     _TDFMockImageManagerForComposite *manager = [_TDFMockImageManagerForComposite new];
     manager.supportedResource = @"resourse_01";
@@ -0,0 +1,228 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import "DFImageManagerKit.h"
+#import "TDFTestingKit.h"
+#import <OHHTTPStubs/OHHTTPStubs.h>
+#import <XCTest/XCTest.h>
+
+@interface TDFDiskCache : XCTestCase
+
+@end
+
+@implementation TDFDiskCache {
+    NSString *_path;
+    DFDiskCache *_cache;
+}
+
+- (void)setUp {
+    [super setUp];
+    _path = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    _cache = [[DFDiskCache alloc] initWithPath:_path capacity:1024 * 1024];
+}
+
+- (void)tearDown {
+    [super tearDown];
+    [OHHTTPStubs removeAllStubs];
+    [[NSFileManager defaultManager] removeItemAtPath:_path error:nil];
+}
+
+- (void)_waitForPredicate:(BOOL (^)(void))predicate {
+    [self expectationForPredicate:[NSPredicate predicateWithBlock:^BOOL(id object, NSDictionary *bindings) {
+        return predicate();
+    }] evaluatedWithObject:self handler:nil];
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+}
+
+- (void)testThatDataIsStored {
+    NSData *data = [TDFTesting testImageData];
+    XCTAssertFalse([_cache containsDataForKey:@"key"]);
+    [_cache storeData:data forKey:@"key"];
+    XCTAssertTrue([_cache containsDataForKey:@"key"]);
+    XCTAssertEqualObjects([_cache dataForKey:@"key"], data);
+    XCTAssertEqual(_cache.totalSize, data.length);
+}
+
+- (void)testThatDataIsPersisted {
+    NSData *data = [TDFTesting testImageData];
+    [_cache storeData:data forKey:@"key"];
+    [self _waitForPredicate:^BOOL{ // Wait until the data is written
+        for (NSString *subpath in [[NSFileManager defaultManager] subpathsOfDirectoryAtPath:_path error:nil]) {
+            if (subpath.lastPathComponent.length == 40) {
+                return YES;
+            }
+        }
+        return NO;
+    }];
+    DFDiskCache *cache = [[DFDiskCache alloc] initWithPath:_path capacity:1024 * 1024];
+    [self _waitForPredicate:^BOOL{
+        return [cache containsDataForKey:@"key"];
+    }];
+    XCTAssertEqualObjects([cache dataForKey:@"key"], data);
+    XCTAssertEqual(cache.totalSize, data.length);
+}
+
+- (void)testThatInfoIsPersistedAlongWithData {
+    NSData *data = [TDFTesting testImageData];
+    NSDictionary *info = @{ DFImageInfoValidatorKey : @"\"etag\"" };
+    [_cache storeData:data info:info forKey:@"key"];
+    NSDictionary *pendingInfo;
+    XCTAssertEqualObjects([_cache dataForKey:@"key" info:&pendingInfo], data);
+    XCTAssertEqualObjects(pendingInfo, info);
+    [self _waitForPredicate:^BOOL{ // Wait until the data is written
+        for (NSString *subpath in [[NSFileManager defaultManager] subpathsOfDirectoryAtPath:_path error:nil]) {
+            if (subpath.lastPathComponent.length == 40) {
+                return YES;
+            }
+        }
+        return NO;
+    }];
+    DFDiskCache *cache = [[DFDiskCache alloc] initWithPath:_path capacity:1024 * 1024];
+    [self _waitForPredicate:^BOOL{
+        return [cache containsDataForKey:@"key"];
+    }];
+    NSDictionary *storedInfo;
+    XCTAssertEqualObjects([cache dataForKey:@"key" info:&storedInfo], data);
+    XCTAssertEqualObjects(storedInfo, info);
+    XCTAssertEqual(cache.totalSize, data.length);
+}
+
+- (void)testThatDataIsRemoved {
+    [_cache storeData:[TDFTesting testImageData] forKey:@"key"];
+    [_cache removeDataForKey:@"key"];
+    XCTAssertFalse([_cache containsDataForKey:@"key"]);
+    XCTAssertNil([_cache dataForKey:@"key"]);
+    XCTAssertEqual(_cache.totalSize, 0);
+}
+
+- (void)testThatLeastRecentlyUsedDataIsRemovedWhenCapacityIsExceeded {
+    NSData *data = [NSMutableData dataWithLength:400];
+    _cache.capacity = 1000;
+    [_cache storeData:data forKey:@"key1"];
+    [NSThread sleepForTimeInterval:0.01];
+    [_cache storeData:data forKey:@"key2"];
+    [NSThread sleepForTimeInterval:0.01];
+    [_cache storeData:data forKey:@"key3"];
+    [self _waitForPredicate:^BOOL{
+        return _cache.totalSize <= _cache.capacity;
+    }];
+    XCTAssertFalse([_cache containsDataForKey:@"key1"]);
+    XCTAssertTrue([_cache containsDataForKey:@"key2"]);
+    XCTAssertTrue([_cache containsDataForKey:@"key3"]);
+}
+
+- (void)testThatURLImageFetcherReturnsCachedDataWithoutNetworkRequest {
+    NSData *data = [TDFTesting testImageData];
+    NSURL *URL = [NSURL URLWithString:@"http://test.com/image.jpg"];
+    [_cache storeData:data forKey:URL.absoluteString];
+    DFURLImageFetcher *fetcher = [DFURLImageFetcher new];
+    fetcher.diskCache = _cache;
+    [OHHTTPStubs stubRequestsPassingTest:^BOOL(NSURLRequest *request) {
+        XCTFail(@"Unexpected network request");
+        return NO;
+    } withStubResponse:^OHHTTPStubsResponse *(NSURLRequest *request) {
+        return nil;
+    }];
+    XCTestExpectation *expectation = [self expectationWithDescription:@"fetch_completed"];
+    [fetcher startOperationWithRequest:[DFImageRequest requestWithResource:URL] progressHandler:nil completion:^(NSData *__nullable fetchedData, NSDictionary *__nullable info, NSError *__nullable error) {
+        XCTAssertEqualObjects(fetchedData, data);
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+}
+
+- (void)testThatURLImageFetcherStoresFetchedData {
+    NSData *data = [TDFTesting testImageData];
+    NSURL *URL = [NSURL URLWithString:@"http://test.com/image.jpg"];
+    DFURLImageFetcher *fetcher = [DFURLImageFetcher new];
+    fetcher.diskCache = _cache;
+    [OHHTTPStubs stubRequestsPassingTest:^BOOL(NSURLRequest *request) {
+        return YES;
+    } withStubResponse:^OHHTTPStubsResponse *(NSURLRequest *request) {
+        return [OHHTTPStubsResponse responseWithData:data statusCode:200 headers:nil];
+    }];
+    XCTestExpectation *expectation = [self expectationWithDescription:@"fetch_completed"];
+    [fetcher startOperationWithRequest:[DFImageRequest requestWithResource:URL] progressHandler:nil completion:^(NSData *__nullable fetchedData, NSDictionary *__nullable info, NSError *__nullable error) {
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+    XCTAssertTrue([_cache containsDataForKey:URL.absoluteString]);
+    XCTAssertEqualObjects([_cache dataForKey:URL.absoluteString], data);
+}
+
+- (void)testThatURLImageFetcherReturnsValidatorForCachedData {
+    NSData *data = [TDFTesting testImageData];
+    NSURL *URL = [NSURL URLWithString:@"http://test.com/image.jpg"];
+    DFURLImageFetcher *fetcher = [DFURLImageFetcher new];
+    fetcher.diskCache = _cache;
+    __block NSUInteger requestCount = 0;
+    [OHHTTPStubs stubRequestsPassingTest:^BOOL(NSURLRequest *request) {
+        return YES;
+    } withStubResponse:^OHHTTPStubsResponse *(NSURLRequest *request) {
+        requestCount++;
+        return [OHHTTPStubsResponse responseWithData:data statusCode:200 headers:@{ @"ETag" : @"\"etag\"", @"Cache-Control" : @"max-age=3600" }];
+    }];
+    for (NSUInteger i = 0; i < 2; i++) {
+        XCTestExpectation *expectation = [self expectationWithDescription:@"fetch_completed"];
+        [fetcher startOperationWithRequest:[DFImageRequest requestWithResource:URL] progressHandler:nil completion:^(NSData *__nullable fetchedData, NSDictionary *__nullable info, NSError *__nullable error) {
+            XCTAssertEqualObjects(fetchedData, data);
+            XCTAssertEqualObjects(info[DFImageInfoValidatorKey], @"\"etag\"");
+            XCTAssertEqualObjects(info[DFImageInfoHTTPHeaderFieldsKey][@"Cache-Control"], @"max-age=3600");
+            [expectation fulfill];
+        }];
+        [self waitForExpectationsWithTimeout:3.0 handler:nil];
+    }
+    XCTAssertEqual(requestCount, 1);
+}
+
+- (void)testThatURLImageFetcherDoesntStoreNoStoreResponses {
+    NSURL *URL = [NSURL URLWithString:@"http://test.com/image.jpg"];
+    DFURLImageFetcher *fetcher = [DFURLImageFetcher new];
+    fetcher.diskCache = _cache;
+    [OHHTTPStubs stubRequestsPassingTest:^BOOL(NSURLRequest *request) {
+        return YES;
+    } withStubResponse:^OHHTTPStubsResponse *(NSURLRequest *request) {
+        return [OHHTTPStubsResponse responseWithData:[TDFTesting testImageData] statusCode:200 headers:@{ @"Cache-Control" : @"private, no-store" }];
+    }];
+    XCTestExpectation *expectation = [self expectationWithDescription:@"fetch_completed"];
+    [fetcher startOperationWithRequest:[DFImageRequest requestWithResource:URL] progressHandler:nil completion:^(NSData *__nullable fetchedData, NSDictionary *__nullable info, NSError *__nullable error) {
+        XCTAssertNotNil(fetchedData);
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+    XCTAssertFalse([_cache containsDataForKey:URL.absoluteString]);
+}
+
+- (void)testThatURLImageFetcherRevalidatesStaleCachedData {
+    NSData *data = [TDFTesting testImageData];
+    NSURL *URL = [NSURL URLWithString:@"http://test.com/image.jpg"];
+    DFURLImageFetcher *fetcher = [DFURLImageFetcher new];
+    fetcher.diskCache = _cache;
+    NSMutableArray *requests = [NSMutableArray new];
+    [OHHTTPStubs stubRequestsPassingTest:^BOOL(NSURLRequest *request) {
+        return YES;
+    } withStubResponse:^OHHTTPStubsResponse *(NSURLRequest *request) {
+        @synchronized(requests) {
+            [requests addObject:request];
+        }
+        if ([[request valueForHTTPHeaderField:@"If-None-Match"] isEqualToString:@"\"etag\""]) {
+            return [OHHTTPStubsResponse responseWithData:[NSData data] statusCode:304 headers:@{ @"ETag" : @"\"etag\"" }];
+        }
+        return [OHHTTPStubsResponse responseWithData:data statusCode:200 headers:@{ @"ETag" : @"\"etag\"", @"Cache-Control" : @"max-age=0" }];
+    }];
+    for (NSUInteger i = 0; i < 2; i++) {
+        XCTestExpectation *expectation = [self expectationWithDescription:@"fetch_completed"];
+        [fetcher startOperationWithRequest:[DFImageRequest requestWithResource:URL] progressHandler:nil completion:^(NSData *__nullable fetchedData, NSDictionary *__nullable info, NSError *__nullable error) {
+            XCTAssertNil(error);
+            XCTAssertEqualObjects(fetchedData, data);
+            XCTAssertEqualObjects(info[DFImageInfoValidatorKey], @"\"etag\"");
+            [expectation fulfill];
+        }];
+        [self waitForExpectationsWithTimeout:3.0 handler:nil];
+    }
+    XCTAssertEqual(requests.count, 2); // The stale data is revalidated
+    XCTAssertEqualObjects([requests.lastObject valueForHTTPHeaderField:@"If-None-Match"], @"\"etag\"");
+}
+
+@end
@@ -10,6 +10,13 @@
 #import "DFImageManagerKit.h"
 #import <XCTest/XCTest.h>
 
+static UIImage *TDFImageWithPixelSize(CGSize size) {
+    UIGraphicsBeginImageContextWithOptions(size, YES, 1.0);
+    UIImage *image = UIGraphicsGetImageFromCurrentImageContext();
+    UIGraphicsEndImageContext();
+    return image;
+}
+
 @interface TDFImageCache : XCTestCase
 
 @end
@@ -47,4 +54,161 @@
     XCTAssertNil([_cache cachedImageResponseForKey:@"key"]);
 }
 
+- (void)testThatStaleImageIsReturnedWhenExpiredImagesAreAllowed {
+    UIImage *image = [UIImage new];
+    [_cache storeImageResponse:[[DFCachedImageResponse alloc] initWithImage:image info:nil expirationDate:CFAbsoluteTimeGetCurrent() - 1.0] forKey:@"key"];
+    DFCachedImageResponse *response = [_cache cachedImageResponseForKey:@"key" allowsExpired:YES];
+    XCTAssertEqual(response.image, image);
+    XCTAssertTrue(response.isExpired);
+}
+
+- (void)testThatImageOlderThanMaximumStaleAgeIsntReturned {
+    _cache.maximumStaleAge = 0.5;
+    [_cache storeImageResponse:[[DFCachedImageResponse alloc] initWithImage:[UIImage new] info:nil expirationDate:CFAbsoluteTimeGetCurrent() - 1.0] forKey:@"key"];
+    XCTAssertNil([_cache cachedImageResponseForKey:@"key" allowsExpired:YES]);
+}
+
+#pragma mark - Admission Policy
+
+- (void)_storeFrequentlyUsedAndOneOffImagesInCache:(DFImageCache *)imageCache {
+    DFCachedImageResponse *response = [[DFCachedImageResponse alloc] initWithImage:TDFImageWithPixelSize(CGSizeMake(10, 10)) info:nil expirationDate:CFAbsoluteTimeGetCurrent() + 60.0];
+    imageCache.cache.totalCostLimit = [imageCache costForImageResponse:response] * 10;
+    for (NSInteger i = 0; i < 5; i++) {
+        NSString *key = [NSString stringWithFormat:@"frequent-%li", (long)i];
+        for (NSInteger j = 0; j < 5; j++) {
+            [imageCache cachedImageResponseForKey:key];
+        }
+        [imageCache storeImageResponse:response forKey:key];
+    }
+    for (NSInteger i = 0; i < 100; i++) {
+        NSString *key = [NSString stringWithFormat:@"one-off-%li", (long)i];
+        [imageCache cachedImageResponseForKey:key];
+        [imageCache storeImageResponse:response forKey:key];
+    }
+}
+
+- (void)testThatAdmissionPolicyProtectsFrequentlyUsedImages {
+    DFImageCache *imageCache = [[DFImageCache alloc] initWithCache:[NSCache new]];
+    [self _storeFrequentlyUsedAndOneOffImagesInCache:imageCache];
+    for (NSInteger i = 0; i < 5; i++) {
+        XCTAssertNotNil([imageCache cachedImageResponseForKey:[NSString stringWithFormat:@"frequent-%li", (long)i]]);
+    }
+    XCTAssertGreaterThan(imageCache.statistics.rejectedCount, 0);
+}
+
+- (void)testThatFrequencyHistoryIsKeptWhenCostLimitChanges {
+    DFImageCache *imageCache = [[DFImageCache alloc] initWithCache:[NSCache new]];
+    [self _storeFrequentlyUsedAndOneOffImagesInCache:imageCache];
+    imageCache.cache.totalCostLimit *= 2;
+    DFCachedImageResponse *response = [[DFCachedImageResponse alloc] initWithImage:TDFImageWithPixelSize(CGSizeMake(10, 10)) info:nil expirationDate:CFAbsoluteTimeGetCurrent() + 60.0];
+    for (NSInteger i = 0; i < 100; i++) {
+        NSString *key = [NSString stringWithFormat:@"one-off-after-resize-%li", (long)i];
+        [imageCache cachedImageResponseForKey:key];
+        [imageCache storeImageResponse:response forKey:key];
+    }
+    for (NSInteger i = 0; i < 5; i++) {
+        XCTAssertNotNil([imageCache cachedImageResponseForKey:[NSString stringWithFormat:@"frequent-%li", (long)i]]);
+    }
+}
+
+- (void)testThatPlainLRUCacheEvictsFrequentlyUsedImages {
+    DFImageCache *imageCache = [[DFImageCache alloc] initWithCache:[NSCache new]];
+    imageCache.usesAdmissionPolicy = NO;
+    imageCache.tracksLiveImages = NO; // The test keeps the evicted images alive
+    [self _storeFrequentlyUsedAndOneOffImagesInCache:imageCache];
+    for (NSInteger i = 0; i < 5; i++) {
+        XCTAssertNil([imageCache cachedImageResponseForKey:[NSString stringWithFormat:@"frequent-%li", (long)i]]);
+    }
+    XCTAssertEqual(imageCache.statistics.rejectedCount, 0);
+}
+
+#pragma mark - Trimming
+
+- (void)testThatTrimmingKeepsDisplayedImages {
+    DFImageCache *imageCache = [[DFImageCache alloc] initWithCache:[NSCache new]];
+    imageCache.tracksLiveImages = NO;
+    UIImage *displayedImage = TDFImageWithPixelSize(CGSizeMake(10, 10));
+    UIImage *image = TDFImageWithPixelSize(CGSizeMake(10, 10));
+    [imageCache storeImageResponse:[[DFCachedImageResponse alloc] initWithImage:displayedImage info:nil expirationDate:CFAbsoluteTimeGetCurrent() + 60.0] forKey:@"displayed"];
+    [imageCache storeImageResponse:[[DFCachedImageResponse alloc] initWithImage:image info:nil expirationDate:CFAbsoluteTimeGetCurrent() + 60.0] forKey:@"key"];
+    [DFImageCache beginDisplayingImage:displayedImage];
+    [imageCache trimToCost:0];
+    XCTAssertNotNil([imageCache cachedImageResponseForKey:@"displayed"]);
+    XCTAssertNil([imageCache cachedImageResponseForKey:@"key"]);
+    [DFImageCache endDisplayingImage:displayedImage];
+    XCTAssertFalse([DFImageCache isImageDisplayed:displayedImage]);
+    [imageCache trimToCost:0];
+    XCTAssertNil([imageCache cachedImageResponseForKey:@"displayed"]);
+    XCTAssertEqual(imageCache.totalCost, 0);
+}
+
+- (void)testThatTrimmingToHalfRemovesLeastRecentlyUsedImages {
+    DFImageCache *imageCache = [[DFImageCache alloc] initWithCache:[NSCache new]];
+    imageCache.usesAdmissionPolicy = NO;
+    imageCache.tracksLiveImages = NO;
+    DFCachedImageResponse *response = [[DFCachedImageResponse alloc] initWithImage:TDFImageWithPixelSize(CGSizeMake(10, 10)) info:nil expirationDate:CFAbsoluteTimeGetCurrent() + 60.0];
+    NSUInteger cost = [imageCache costForImageResponse:response];
+    for (NSInteger i = 0; i < 4; i++) {
+        [imageCache storeImageResponse:response forKey:[NSString stringWithFormat:@"key-%li", (long)i]];
+    }
+    XCTAssertEqual(imageCache.totalCost, cost * 4);
+    [imageCache trimToCost:imageCache.totalCost / 2];
+    XCTAssertEqual(imageCache.totalCost, cost * 2);
+    XCTAssertNil([imageCache cachedImageResponseForKey:@"key-0"]);
+    XCTAssertNotNil([imageCache cachedImageResponseForKey:@"key-3"]);
+}
+
+#pragma mark - Live Images
+
+- (void)testThatEvictedImageIsReturnedWhileItIsAlive {
+    DFImageCache *imageCache = [[DFImageCache alloc] initWithCache:[NSCache new]];
+    UIImage *image = TDFImageWithPixelSize(CGSizeMake(10, 10));
+    [imageCache storeImageResponse:[[DFCachedImageResponse alloc] initWithImage:image info:@{ @"key" : @"value" } expirationDate:CFAbsoluteTimeGetCurrent() + 60.0] forKey:@"key"];
+    [imageCache trimToCost:0];
+    XCTAssertEqual(imageCache.totalCost, 0);
+    DFCachedImageResponse *response = [imageCache cachedImageResponseForKey:@"key"];
+    XCTAssertEqual(response.image, image);
+    XCTAssertEqualObjects(response.info[@"key"], @"value");
+    XCTAssertGreaterThan(imageCache.totalCost, 0); // The image was put back into the cache
+    XCTAssertEqual(imageCache.statistics.liveImageHitCount, 1);
+    XCTAssertEqual(imageCache.statistics.hitCount, 1);
+}
+
+- (void)testThatDeallocatedImageIsNotReturned {
+    DFImageCache *imageCache = [[DFImageCache alloc] initWithCache:[NSCache new]];
+    @autoreleasepool {
+        UIImage *image = TDFImageWithPixelSize(CGSizeMake(10, 10));
+        [imageCache storeImageResponse:[[DFCachedImageResponse alloc] initWithImage:image info:nil expirationDate:CFAbsoluteTimeGetCurrent() + 60.0] forKey:@"key"];
+        [imageCache trimToCost:0];
+    }
+    XCTAssertNil([imageCache cachedImageResponseForKey:@"key"]);
+    XCTAssertEqual(imageCache.statistics.liveImageHitCount, 0);
+}
+
+- (void)testThatExpiredLiveImageIsNotReturned {
+    DFImageCache *imageCache = [[DFImageCache alloc] initWithCache:[NSCache new]];
+    UIImage *image = TDFImageWithPixelSize(CGSizeMake(10, 10));
+    [imageCache storeImageResponse:[[DFCachedImageResponse alloc] initWithImage:image info:nil expirationDate:CFAbsoluteTimeGetCurrent() + 0.01] forKey:@"key"];
+    [imageCache trimToCost:0];
+    [NSThread sleepForTimeInterval:0.02];
+    XCTAssertNil([imageCache cachedImageResponseForKey:@"key"]);
+}
+
+#pragma mark - Statistics
+
+- (void)testThatStatisticsCountHitsAndMisses {
+    DFImageCache *imageCache = [[DFImageCache alloc] initWithCache:[NSCache new]];
+    DFCachedImageResponse *response = [[DFCachedImageResponse alloc] initWithImage:TDFImageWithPixelSize(CGSizeMake(10, 10)) info:nil expirationDate:CFAbsoluteTimeGetCurrent() + 60.0];
+    XCTAssertNil([imageCache cachedImageResponseForKey:@"key"]);
+    [imageCache storeImageResponse:response forKey:@"key"];
+    XCTAssertNotNil([imageCache cachedImageResponseForKey:@"key"]);
+    XCTAssertNotNil([imageCache cachedImageResponseForKey:@"key"]);
+    DFImageCacheStatistics *statistics = imageCache.statistics;
+    XCTAssertEqual(statistics.hitCount, 2);
+    XCTAssertEqual(statistics.missCount, 1);
+    XCTAssertEqualWithAccuracy(statistics.hitRatio, 2.0 / 3.0, 0.001);
+    [imageCache resetStatistics];
+    XCTAssertEqual(imageCache.statistics.hitCount, 0);
+}
+
 @end
@@ -7,7 +7,11 @@
 //
 
 #import "DFImageManagerKit.h"
+#import "DFImageManagerKit+GIF.h"
 #import "DFImageManagerKit+WebP.h"
+#import "TDFTestingKit.h"
+#import <ImageIO/ImageIO.h>
+#import <MobileCoreServices/MobileCoreServices.h>
 #import <UIKit/UIKit.h>
 #import <XCTest/XCTest.h>
 
@@ -27,6 +31,244 @@
     XCTAssertEqual(image.size.height, 768);
 }
 
+- (void)testThatWebPIsDecodedIntoNativeFormat {
+    UIImage *image = [[DFWebPImageDecoder new] imageWithData:[self _webpImageData] partial:NO];
+    CGImageRef imageRef = image.CGImage;
+    XCTAssertEqual(CGImageGetBitsPerPixel(imageRef), 32);
+    XCTAssertEqual(CGImageGetBitmapInfo(imageRef) & kCGBitmapByteOrderMask, kCGBitmapByteOrder32Little);
+    XCTAssertEqual(CGImageGetBytesPerRow(imageRef) % 64, 0);
+}
+
+- (void)testThatPartialWebPIsDecodedIncrementally {
+    NSData *data = [self _webpImageData];
+    id<DFIncrementalImageDecoding> decoder = [[DFWebPImageDecoder new] incrementalDecoderForData:data];
+    XCTAssertNotNil(decoder);
+    XCTAssertNil([decoder imageByAppendingData:[data subdataWithRange:NSMakeRange(0, 10)]]);
+    UIImage *image = [decoder imageByAppendingData:[data subdataWithRange:NSMakeRange(10, data.length / 2 - 10)]];
+    XCTAssertNotNil(image);
+    XCTAssertEqual(image.size.width, 768);
+    XCTAssertEqual(image.size.height, 768);
+    image = [decoder imageByAppendingData:[data subdataWithRange:NSMakeRange(data.length / 2, data.length - data.length / 2)]];
+    XCTAssertNotNil(image);
+}
+
+- (void)testThatPartialWebPIsDecoded {
+    NSData *data = [self _webpImageData];
+    XCTAssertNotNil([[DFWebPImageDecoder new] imageWithData:[data subdataWithRange:NSMakeRange(0, data.length / 2)] partial:YES]);
+}
+
+#pragma mark - GIF
+
+- (void)testThatGIFIsDecodedLazily {
+    DFAnimatedImage *image = (id)[[DFAnimatedImageDecoder new] imageWithData:[self _GIFDataWithFrameCount:10 size:CGSizeMake(200, 100)] partial:NO];
+    XCTAssertTrue([image isKindOfClass:[DFAnimatedImage class]]);
+    XCTAssertEqual(image.frameBuffer.frameCount, 10);
+    XCTAssertEqual(image.size.width, 200);
+    XCTAssertEqual(image.size.height, 100);
+    XCTAssertEqualWithAccuracy([image.frameBuffer durationAtIndex:0], 0.05, 0.001);
+    // Frames are decoded in background when requested
+    DFAnimatedImageFrameBuffer *frameBuffer = image.frameBuffer;
+    [self expectationForPredicate:[NSPredicate predicateWithBlock:^BOOL(id object, NSDictionary *bindings) {
+        return [frameBuffer frameAtIndex:1] != nil;
+    }] evaluatedWithObject:self handler:nil];
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+}
+
+- (void)testThatAnimatedImageIsDownsampledToTargetSize {
+    DFAnimatedImage *image = [DFAnimatedImage animatedImageWithData:[self _GIFDataWithFrameCount:10 size:CGSizeMake(200, 100)] maxPixelSize:0];
+    DFAnimatedImageProcessor *processor = [[DFAnimatedImageProcessor alloc] initWithProcessor:[DFImageProcessor new]];
+    DFImageRequest *request = [DFImageRequest requestWithResource:[NSURL URLWithString:@"http://test.com/image.gif"] targetSize:CGSizeMake(50, 50) contentMode:DFImageContentModeAspectFit options:nil];
+    XCTAssertTrue([processor shouldProcessImage:image forRequest:request partial:NO]);
+    DFAnimatedImage *processedImage = (id)[processor processedImage:image forRequest:request partial:NO];
+    XCTAssertTrue([processedImage isKindOfClass:[DFAnimatedImage class]]);
+    XCTAssertEqual(CGImageGetWidth(processedImage.CGImage), 50);
+    XCTAssertEqual(CGImageGetHeight(processedImage.CGImage), 25);
+    XCTAssertEqual(CGImageGetWidth([processedImage.frameBuffer decodeFrameAtIndex:5].CGImage), 50);
+    XCTAssertLessThan([processedImage df_memoryCost], [image df_memoryCost]);
+}
+
+- (void)testThatFrameBufferDecodesUpcomingFramesWithinSizeLimit {
+    DFAnimatedImage *image = [DFAnimatedImage animatedImageWithData:[self _GIFDataWithFrameCount:10 size:CGSizeMake(100, 100)] maxPixelSize:0];
+    DFAnimatedImageFrameBuffer *frameBuffer = image.frameBuffer;
+    NSUInteger frameSize = CGImageGetBytesPerRow(image.CGImage) * CGImageGetHeight(image.CGImage);
+    frameBuffer.bufferSizeLimit = frameSize * 3;
+    XCTAssertEqual(frameBuffer.maximumBufferSize, frameSize * 3);
+    // The window wraps around the last frame
+    for (NSNumber *index in @[@8, @9, @0]) {
+        [self expectationForPredicate:[NSPredicate predicateWithBlock:^BOOL(id object, NSDictionary *bindings) {
+            return [frameBuffer frameAtIndex:index.unsignedIntegerValue] != nil;
+        }] evaluatedWithObject:self handler:nil];
+        [self waitForExpectationsWithTimeout:3.0 handler:nil];
+    }
+}
+
+- (void)testThatFrameBufferKeepsWindowOfEachConsumer {
+    DFAnimatedImage *image = [DFAnimatedImage animatedImageWithData:[self _GIFDataWithFrameCount:10 size:CGSizeMake(100, 100)] maxPixelSize:0];
+    DFAnimatedImageFrameBuffer *frameBuffer = image.frameBuffer;
+    NSUInteger frameSize = CGImageGetBytesPerRow(image.CGImage) * CGImageGetHeight(image.CGImage);
+    frameBuffer.bufferSizeLimit = frameSize * 4;
+    NSObject *consumer1 = [NSObject new];
+    NSObject *consumer2 = [NSObject new];
+    [self expectationForPredicate:[NSPredicate predicateWithBlock:^BOOL(id object, NSDictionary *bindings) {
+        BOOL decoded1 = [frameBuffer frameAtIndex:2 consumer:consumer1] != nil;
+        BOOL decoded2 = [frameBuffer frameAtIndex:7 consumer:consumer2] != nil;
+        return decoded1 && decoded2;
+    }] evaluatedWithObject:self handler:nil];
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+    // Frames of one consumer are not evicted when the other one moves its window
+    XCTAssertNotNil([frameBuffer frameAtIndex:2 consumer:consumer1]);
+    XCTAssertNotNil([frameBuffer frameAtIndex:7 consumer:consumer2]);
+}
+
+- (NSData *)_GIFDataWithFrameCount:(NSUInteger)frameCount size:(CGSize)size {
+    NSMutableData *data = [NSMutableData new];
+    CGImageDestinationRef destination = CGImageDestinationCreateWithData((__bridge CFMutableDataRef)data, kUTTypeGIF, frameCount, NULL);
+    NSDictionary *frameProperties = @{ (id)kCGImagePropertyGIFDictionary : @{ (id)kCGImagePropertyGIFDelayTime : @0.05 } };
+    for (NSUInteger i = 0; i < frameCount; i++) {
+        UIGraphicsBeginImageContextWithOptions(size, YES, 1.0);
+        [[UIColor colorWithHue:(CGFloat)i / frameCount saturation:1.0 brightness:1.0 alpha:1.0] setFill];
+        UIRectFill((CGRect){CGPointZero, size});
+        UIImage *frame = UIGraphicsGetImageFromCurrentImageContext();
+        UIGraphicsEndImageContext();
+        CGImageDestinationAddImage(destination, frame.CGImage, (__bridge CFDictionaryRef)frameProperties);
+    }
+    CGImageDestinationFinalize(destination);
+    CFRelease(destination);
+    return data;
+}
+
+#pragma mark - Embedded Thumbnails
+
+- (void)testThatEmbeddedThumbnailIsUsedForSmallTargetSize {
+    NSData *data = [TDFTesting testJPEGDataWithEmbeddedThumbnailWithSize:CGSizeMake(1600, 1200)];
+    DFImageRequest *request = [DFImageRequest requestWithResource:@"resource" targetSize:CGSizeMake(100, 75) contentMode:DFImageContentModeAspectFit options:nil];
+    UIImage *image = [[DFImageDecoder new] imageWithData:data forRequests:@[request]];
+    XCTAssertNotNil(image);
+    XCTAssertGreaterThanOrEqual(CGImageGetWidth(image.CGImage), 100);
+    XCTAssertLessThan(CGImageGetWidth(image.CGImage), 1600);
+}
+
+- (void)testThatEmbeddedThumbnailIsNotUsedWhenTooSmall {
+    NSData *data = [TDFTesting testJPEGDataWithEmbeddedThumbnailWithSize:CGSizeMake(1600, 1200)];
+    DFImageRequest *request1 = [DFImageRequest requestWithResource:@"resource" targetSize:CGSizeMake(100, 75) contentMode:DFImageContentModeAspectFit options:nil];
+    DFImageRequest *request2 = [DFImageRequest requestWithResource:@"resource" targetSize:CGSizeMake(800, 600) contentMode:DFImageContentModeAspectFit options:nil];
+    UIImage *image = [[DFImageDecoder new] imageWithData:data forRequests:@[request1, request2]];
+    XCTAssertEqual(CGImageGetWidth(image.CGImage), 1600);
+}
+
+- (void)testPerformanceOfDecodingSmallImageFromEmbeddedThumbnail {
+    NSData *data = [TDFTesting testJPEGDataWithEmbeddedThumbnailWithSize:CGSizeMake(3200, 2400)];
+    DFImageRequest *request = [DFImageRequest requestWithResource:@"resource" targetSize:CGSizeMake(100, 75) contentMode:DFImageContentModeAspectFill options:nil];
+    DFImageDecoder *decoder = [DFImageDecoder new];
+    DFImageProcessor *processor = [DFImageProcessor new];
+    [self measureBlock:^{
+        for (NSInteger i = 0; i < 10; i++) {
+            [processor processedImage:[decoder imageWithData:data forRequests:@[request]] forRequest:request partial:NO];
+        }
+    }];
+}
+
+- (void)testPerformanceOfDecodingSmallImageFromFullImage {
+    NSData *data = [TDFTesting testJPEGDataWithEmbeddedThumbnailWithSize:CGSizeMake(3200, 2400)];
+    DFImageRequest *request = [DFImageRequest requestWithResource:@"resource" targetSize:CGSizeMake(100, 75) contentMode:DFImageContentModeAspectFill options:nil];
+    DFImageDecoder *decoder = [DFImageDecoder new];
+    DFImageProcessor *processor = [DFImageProcessor new];
+    [self measureBlock:^{
+        for (NSInteger i = 0; i < 10; i++) {
+            [processor processedImage:[decoder imageWithData:data partial:NO] forRequest:request partial:NO];
+        }
+    }];
+}
+
+#pragma mark - Regions
+
+- (void)testThatRegionsAtLowerResolutionAreDecodedDownsampled {
+    NSData *data = [TDFTesting testJPEGDataWithEmbeddedThumbnailWithSize:CGSizeMake(1600, 1200)];
+    // 256x256 tiles at 0.25 scale cover 1024x1024 pixels of the image each
+    NSArray<DFImageRequest *> *requests = [DFImageRequest tileRequestsWithResource:@"resource" imageSize:CGSizeMake(1600, 1200) tileSize:CGSizeMake(256, 256) scale:0.25 rect:CGRectMake(0, 0, 1600, 1200) options:nil];
+    UIImage *image = [[DFImageDecoder new] imageWithData:data forRequests:requests];
+    XCTAssertEqualWithAccuracy(CGImageGetWidth(image.CGImage), 400, 1);
+    XCTAssertEqualWithAccuracy(CGImageGetHeight(image.CGImage), 300, 1);
+    
+    UIImage *tile = [[DFImageProcessor new] processedImage:image forRequest:requests.firstObject partial:NO];
+    XCTAssertEqualWithAccuracy(CGImageGetWidth(tile.CGImage), 256, 1);
+    XCTAssertEqualWithAccuracy(CGImageGetHeight(tile.CGImage), 256, 1);
+}
+
+- (void)testThatRegionsAtFullResolutionAreDecodedAtFullSize {
+    NSData *data = [TDFTesting testJPEGDataWithEmbeddedThumbnailWithSize:CGSizeMake(1600, 1200)];
+    NSArray<DFImageRequest *> *requests = [DFImageRequest tileRequestsWithResource:@"resource" imageSize:CGSizeMake(1600, 1200) tileSize:CGSizeMake(256, 256) scale:1.0 rect:CGRectMake(0, 0, 512, 512) options:nil];
+    UIImage *image = [[DFImageDecoder new] imageWithData:data forRequests:requests];
+    XCTAssertEqual(CGImageGetWidth(image.CGImage), 1600);
+}
+
+#pragma mark - Header Info
+
+- (UIImage *)_imageWithSize:(CGSize)size {
+    UIGraphicsBeginImageContextWithOptions(size, YES, 1.0);
+    [[UIColor orangeColor] setFill];
+    UIRectFill((CGRect){CGPointZero, size});
+    UIImage *image = UIGraphicsGetImageFromCurrentImageContext();
+    UIGraphicsEndImageContext();
+    return image;
+}
+
+- (void)testThatJPEGHeaderIsParsedFromFirstBytes {
+    NSData *data = UIImageJPEGRepresentation([self _imageWithSize:CGSizeMake(300, 200)], 0.9f);
+    DFImageHeaderInfo *headerInfo = [DFImageHeaderInfo headerInfoWithData:[data subdataWithRange:NSMakeRange(0, 1024)]];
+    XCTAssertEqual(headerInfo.format, DFImageFormatJPEG);
+    XCTAssertEqual(headerInfo.pixelSize.width, 300);
+    XCTAssertEqual(headerInfo.pixelSize.height, 200);
+    XCTAssertFalse(headerInfo.isProgressive);
+    XCTAssertNil([DFImageHeaderInfo headerInfoWithData:[data subdataWithRange:NSMakeRange(0, 20)]]);
+}
+
+- (void)testThatJPEGOrientationIsApplied {
+    NSMutableData *data = [NSMutableData new];
+    CGImageDestinationRef destination = CGImageDestinationCreateWithData((__bridge CFMutableDataRef)data, kUTTypeJPEG, 1, NULL);
+    CGImageDestinationAddImage(destination, [self _imageWithSize:CGSizeMake(300, 200)].CGImage, (__bridge CFDictionaryRef)@{ (id)kCGImagePropertyOrientation : @6 });
+    CGImageDestinationFinalize(destination);
+    CFRelease(destination);
+    DFImageHeaderInfo *headerInfo = [DFImageHeaderInfo headerInfoWithData:data];
+    XCTAssertEqual(headerInfo.orientation, UIImageOrientationRight);
+    XCTAssertEqual(headerInfo.pixelSize.width, 200);
+    XCTAssertEqual(headerInfo.pixelSize.height, 300);
+}
+
+- (void)testThatPNGHeaderIsParsed {
+    NSData *data = UIImagePNGRepresentation([self _imageWithSize:CGSizeMake(300, 200)]);
+    DFImageHeaderInfo *headerInfo = [DFImageHeaderInfo headerInfoWithData:data];
+    XCTAssertEqual(headerInfo.format, DFImageFormatPNG);
+    XCTAssertEqual(headerInfo.pixelSize.width, 300);
+    XCTAssertEqual(headerInfo.pixelSize.height, 200);
+    XCTAssertFalse(headerInfo.isAnimated);
+}
+
+- (void)testThatAnimatedGIFHeaderIsParsed {
+    // Logical screen 200x100 without the global color table, followed by the loop extension
+    const uint8_t bytes[] = { 'G', 'I', 'F', '8', '9', 'a', 0xC8, 0x00, 0x64, 0x00, 0x00, 0x00, 0x00,
+        0x21, 0xFF, 0x0B, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0', 0x03, 0x01, 0x00, 0x00, 0x00 };
+    DFImageHeaderInfo *headerInfo = [DFImageHeaderInfo headerInfoWithData:[NSData dataWithBytes:bytes length:sizeof(bytes)]];
+    XCTAssertEqual(headerInfo.format, DFImageFormatGIF);
+    XCTAssertEqual(headerInfo.pixelSize.width, 200);
+    XCTAssertEqual(headerInfo.pixelSize.height, 100);
+    XCTAssertTrue(headerInfo.isAnimated);
+}
+
+- (void)testThatWebPHeaderIsParsedFromFirstBytes {
+    NSData *data = [[self _webpImageData] subdataWithRange:NSMakeRange(0, 64)];
+    DFImageHeaderInfo *headerInfo = [DFImageHeaderInfo headerInfoWithData:data];
+    XCTAssertEqual(headerInfo.format, DFImageFormatWebP);
+    XCTAssertEqual(headerInfo.pixelSize.width, 768);
+    XCTAssertEqual(headerInfo.pixelSize.height, 768);
+}
+
+- (void)testThatUnknownFormatIsNotParsed {
+    NSData *data = [@"<html><body>Not Found</body></html>" dataUsingEncoding:NSUTF8StringEncoding];
+    XCTAssertEqual([DFImageHeaderInfo formatForData:data], DFImageFormatUnknown);
+    XCTAssertNil([DFImageHeaderInfo headerInfoWithData:data]);
+}
+
 #pragma mark -
 
 - (NSData *)_webpImageData {
@@ -11,6 +11,35 @@
 #import <OHHTTPStubs/OHHTTPStubs.h>
 #import "NSURL+DFPhotosKit.h"
 #import <XCTest/XCTest.h>
+#import <objc/runtime.h>
+#import <stdatomic.h>
+
+
+/*! Records the resources in the order in which their images are decoded.
+ */
+@interface _TDFRecordingImageDecoder : DFImageDecoder
+
+@property (nonnull, nonatomic, readonly) NSMutableArray *resources;
+
+@end
+
+@implementation _TDFRecordingImageDecoder
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _resources = [NSMutableArray new];
+    }
+    return self;
+}
+
+- (UIImage *)imageWithData:(NSData *)data forRequests:(NSArray<DFImageRequest *> *)requests {
+    @synchronized(self) {
+        [_resources addObject:requests.firstObject.resource];
+    }
+    return [super imageWithData:data forRequests:requests];
+}
+
+@end
 
 
 /*! The TDFImageManager is a test suite for DFImageManager class. All tests are designed to test a single module (DFImageManager) without testing other dependencies and/or integration.
@@ -37,6 +66,8 @@
 
 - (void)tearDown {
     [super tearDown];
+    
+    [OHHTTPStubs removeAllStubs];
 }
 
 #pragma mark - Basics
@@ -249,6 +280,88 @@
     [self waitForExpectationsWithTimeout:1.0 handler:nil];
 }
 
+- (void)testThatOrphanedFetchIsReattached {
+    _fetcher.queue.suspended = YES;
+    TDFMockResource *resource = [TDFMockResource resourceWithID:@"ID01"];
+    DFImageTask *task1 = [_manager imageTaskForResource:resource completion:nil];
+    [task1 resume];
+    [task1 cancel];
+
+    // The second task is started within the grace period and is attached to the same fetch
+    XCTestExpectation *expectation = [self expectationWithDescription:@"request"];
+    [[_manager imageTaskForResource:resource completion:^(UIImage *__nullable image, NSError *__nullable error, DFImageResponse *__nullable response, DFImageTask *__nonnull completedTask) {
+        XCTAssertNotNil(image);
+        [expectation fulfill];
+    }] resume];
+    _fetcher.queue.suspended = NO;
+    [self waitForExpectationsWithTimeout:1.0 handler:nil];
+    XCTAssertEqual(_fetcher.createdOperationCount, 1);
+    XCTAssertEqual(_manager.statistics.keptAliveFetchCount, 1);
+    XCTAssertEqual(_manager.statistics.reattachedFetchCount, 1);
+    XCTAssertEqual(_manager.statistics.cancelledFetchCount, 0);
+}
+
+- (void)testThatOrphanedFetchStoresImageInMemoryCache {
+    _cache.enabled = YES;
+    _fetcher.queue.suspended = YES;
+    DFImageTask *task = [_manager imageTaskForResource:[TDFMockResource resourceWithID:@"ID01"] completion:nil];
+    [task resume];
+    [task cancel];
+    _fetcher.queue.suspended = NO; // The fetch finishes within the grace period
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"cache"];
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(0.5 * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        XCTAssertEqual(_cache.responses.count, 1);
+        [expectation fulfill];
+    });
+    [self waitForExpectationsWithTimeout:1.0 handler:nil];
+}
+
+- (void)testThatOrphanedFetchIsKeptWhileImageIsDecoded {
+    _cache.enabled = YES;
+    DFImageManagerConfiguration *conf = [DFImageManagerConfiguration configurationWithFetcher:_fetcher processor:nil cache:_cache];
+    conf.orphanedFetchGracePeriod = 0.0;
+    conf.orphanedFetchProgressThreshold = 2.0f;
+    conf.decodingQueue = [NSOperationQueue new];
+    conf.decodingQueue.suspended = YES;
+    DFImageManager *manager = [[DFImageManager alloc] initWithConfiguration:conf];
+    DFImageTask *task = [manager imageTaskForResource:[TDFMockResource resourceWithID:@"ID01"] completion:nil];
+    [task resume];
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"cache"];
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(0.2 * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        [task cancel]; // The data is received, the decode is pending
+        conf.decodingQueue.suspended = NO;
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(0.3 * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+            XCTAssertEqual(_cache.responses.count, 1);
+            XCTAssertEqual(manager.statistics.cancelledFetchCount, 0);
+            [expectation fulfill];
+        });
+    });
+    [self waitForExpectationsWithTimeout:1.0 handler:nil];
+}
+
+- (void)testThatWastedBytesAreReported {
+    [self _stubSlowImageResponseForHost:@"test.com"];
+    DFImageManagerConfiguration *conf = [DFImageManagerConfiguration configurationWithFetcher:[DFURLImageFetcher new] processor:nil cache:nil];
+    conf.orphanedFetchGracePeriod = 0.0;
+    conf.orphanedFetchProgressThreshold = 2.0f;
+    DFImageManager *manager = [[DFImageManager alloc] initWithConfiguration:conf];
+    DFImageTask *task = [manager imageTaskForResource:[NSURL URLWithString:@"http://test.com/image.jpg"] completion:nil];
+    [task resume];
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"cancel"];
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(0.5 * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        [task cancel]; // The fetch is cancelled halfway through
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(0.2 * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+            XCTAssertEqual(manager.statistics.cancelledFetchCount, 1);
+            XCTAssertGreaterThan(manager.statistics.wastedByteCount, 0);
+            [expectation fulfill];
+        });
+    });
+    [self waitForExpectationsWithTimeout:2.0 handler:nil];
+}
+
 #pragma mark - Operation Reuse
 
 - (void)testThatOperationsAreReused {
@@ -551,6 +664,312 @@
     [self waitForExpectationsWithTimeout:1.0 handler:nil];
 }
 
+#pragma mark - Decoded Image Cache
+
+- (void)_loadResourceWithID:(NSString *)ID targetSize:(CGSize)targetSize manager:(DFImageManager *)manager {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"request"];
+    DFImageRequest *request = [DFImageRequest requestWithResource:[TDFMockResource resourceWithID:ID] targetSize:targetSize contentMode:DFImageContentModeAspectFill options:nil];
+    [[manager imageTaskForRequest:request completion:^(UIImage *__nullable image, NSError *__nullable error, DFImageResponse *__nullable response, DFImageTask *__nonnull completedTask) {
+        XCTAssertNotNil(image);
+        XCTAssertTrue([image tdf_isImageProcessed]);
+        [expectation fulfill];
+    }] resume];
+    [self waitForExpectationsWithTimeout:1.0 handler:nil];
+}
+
+- (void)testThatDecodedImageIsReusedForDifferentTargetSizes {
+    [self _loadResourceWithID:@"ID01" targetSize:CGSizeMake(100.f, 100.f) manager:_manager];
+    [self _loadResourceWithID:@"ID01" targetSize:CGSizeMake(600.f, 600.f) manager:_manager];
+    XCTAssertEqual(_fetcher.createdOperationCount, 1);
+}
+
+- (void)testThatDecodedImageExpires {
+    DFImageManagerConfiguration *conf = [DFImageManagerConfiguration configurationWithFetcher:_fetcher processor:_processor cache:nil];
+    conf.decodedImageCacheMaximumAge = 0.05;
+    DFImageManager *manager = [[DFImageManager alloc] initWithConfiguration:conf];
+    [self _loadResourceWithID:@"ID01" targetSize:CGSizeMake(100.f, 100.f) manager:manager];
+    [NSThread sleepForTimeInterval:0.1];
+    [self _loadResourceWithID:@"ID01" targetSize:CGSizeMake(600.f, 600.f) manager:manager];
+    XCTAssertEqual(_fetcher.createdOperationCount, 2);
+}
+
+- (void)testThatDecodedImageCacheCanBeDisabled {
+    DFImageManagerConfiguration *conf = [DFImageManagerConfiguration configurationWithFetcher:_fetcher processor:_processor cache:nil];
+    conf.decodedImageCacheCostLimit = 0;
+    DFImageManager *manager = [[DFImageManager alloc] initWithConfiguration:conf];
+    [self _loadResourceWithID:@"ID01" targetSize:CGSizeMake(100.f, 100.f) manager:manager];
+    [self _loadResourceWithID:@"ID01" targetSize:CGSizeMake(600.f, 600.f) manager:manager];
+    XCTAssertEqual(_fetcher.createdOperationCount, 2);
+}
+
+#pragma mark - Data Cache
+
+- (void)testThatDataCacheIsUsedBeforeFetching {
+    DFImageManagerConfiguration *conf = [DFImageManagerConfiguration configurationWithFetcher:_fetcher processor:_processor cache:nil];
+    conf.dataCache = [DFImageDataCache new];
+    conf.decodedImageCacheCostLimit = 0;
+    DFImageManager *manager = [[DFImageManager alloc] initWithConfiguration:conf];
+    [self _loadResourceWithID:@"ID01" targetSize:CGSizeMake(100.f, 100.f) manager:manager];
+    [self _loadResourceWithID:@"ID01" targetSize:CGSizeMake(100.f, 100.f) manager:manager];
+    XCTAssertEqual(_fetcher.createdOperationCount, 1);
+    
+    DFImageManagerStatistics *statistics = [manager statistics];
+    XCTAssertEqual([statistics loadCountForSource:DFImageSourceFetcher], 1);
+    XCTAssertEqual([statistics loadCountForSource:DFImageSourceDataCache], 1);
+}
+
+- (void)testThatDataCacheIsIgnoredWhenReloadingIgnoringCache {
+    DFImageManagerConfiguration *conf = [DFImageManagerConfiguration configurationWithFetcher:_fetcher processor:_processor cache:nil];
+    conf.dataCache = [DFImageDataCache new];
+    conf.decodedImageCacheCostLimit = 0;
+    DFImageManager *manager = [[DFImageManager alloc] initWithConfiguration:conf];
+    [self _loadResourceWithID:@"ID01" targetSize:CGSizeMake(100.f, 100.f) manager:manager];
+    
+    DFMutableImageRequestOptions *options = [DFMutableImageRequestOptions new];
+    options.memoryCachePolicy = DFImageRequestCachePolicyReloadIgnoringCache;
+    XCTestExpectation *expectation = [self expectationWithDescription:@"request"];
+    [[manager imageTaskForRequest:[DFImageRequest requestWithResource:[TDFMockResource resourceWithID:@"ID01"] targetSize:CGSizeMake(100.f, 100.f) contentMode:DFImageContentModeAspectFill options:options.options] completion:^(UIImage *__nullable image, NSError *__nullable error, DFImageResponse *__nullable response, DFImageTask *__nonnull completedTask) {
+        [expectation fulfill];
+    }] resume];
+    [self waitForExpectationsWithTimeout:1.0 handler:nil];
+    XCTAssertEqual(_fetcher.createdOperationCount, 2);
+}
+
+#pragma mark - Statistics
+
+- (void)testThatStatisticsSplitLoadsBetweenTiers {
+    _cache.enabled = YES;
+    [self _loadResourceWithID:@"ID01" targetSize:CGSizeMake(100.f, 100.f) manager:_manager];
+    [self _loadResourceWithID:@"ID01" targetSize:CGSizeMake(100.f, 100.f) manager:_manager]; // Memory cache
+    [self _loadResourceWithID:@"ID01" targetSize:CGSizeMake(200.f, 200.f) manager:_manager]; // Decoded image cache
+    
+    DFImageManagerStatistics *statistics = [_manager statistics];
+    XCTAssertEqual(statistics.loadCount, 3);
+    XCTAssertEqual([statistics loadCountForSource:DFImageSourceFetcher], 1);
+    XCTAssertEqual([statistics loadCountForSource:DFImageSourceMemoryCache], 1);
+    XCTAssertEqual([statistics loadCountForSource:DFImageSourceDecodedImageCache], 1);
+    XCTAssertTrue([statistics averageLatencyForSource:DFImageSourceFetcher] > 0.0);
+    
+    [_manager resetStatistics];
+    XCTAssertEqual([_manager statistics].loadCount, 0);
+}
+
+#pragma mark - Negative Cache
+
+/*! Stubs the responses for the given host and returns the counter of the requests that reached the stub.
+ */
+- (NSMutableArray *)_stubHost:(NSString *)host statusCode:(int)statusCode headers:(NSDictionary *)headers {
+    NSMutableArray *requests = [NSMutableArray new];
+    [OHHTTPStubs stubRequestsPassingTest:^BOOL(NSURLRequest *request) {
+        return [request.URL.host isEqualToString:host];
+    } withStubResponse:^OHHTTPStubsResponse *(NSURLRequest *request) {
+        @synchronized(requests) {
+            [requests addObject:request];
+        }
+        return [OHHTTPStubsResponse responseWithData:[NSData data] statusCode:statusCode headers:headers];
+    }];
+    return requests;
+}
+
+- (NSError *)_loadURL:(NSURL *)URL options:(DFImageRequestOptions *)options manager:(DFImageManager *)manager {
+    NSError *__block loadError;
+    XCTestExpectation *expectation = [self expectationWithDescription:URL.absoluteString];
+    [[manager imageTaskForRequest:[DFImageRequest requestWithResource:URL targetSize:DFImageMaximumSize contentMode:DFImageContentModeAspectFill options:options] completion:^(UIImage *__nullable image, NSError *__nullable error, DFImageResponse *__nullable response, DFImageTask *__nonnull completedTask) {
+        XCTAssertNil(image);
+        loadError = error;
+        [expectation fulfill];
+    }] resume];
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+    return loadError;
+}
+
+- (DFImageManager *)_createURLImageManager {
+    DFImageManagerConfiguration *conf = [DFImageManagerConfiguration configurationWithFetcher:[DFURLImageFetcher new] processor:nil cache:nil];
+    return [[DFImageManager alloc] initWithConfiguration:conf];
+}
+
+- (void)testThatMissingResourceFailsFastWithCachedError {
+    NSMutableArray *requests = [self _stubHost:@"test.com" statusCode:404 headers:nil];
+    DFImageManager *manager = [self _createURLImageManager];
+    NSURL *URL = [NSURL URLWithString:@"http://test.com/missing.jpg"];
+    NSError *error = [self _loadURL:URL options:nil manager:manager];
+    XCTAssertEqualObjects(error.domain, DFURLValidationErrorDomain);
+    XCTAssertEqualObjects([self _loadURL:URL options:nil manager:manager], error);
+    XCTAssertEqual(requests.count, 1);
+}
+
+- (void)testThatNegativeCacheIsIgnoredWhenReloadingIgnoringCache {
+    NSMutableArray *requests = [self _stubHost:@"test.com" statusCode:404 headers:nil];
+    DFImageManager *manager = [self _createURLImageManager];
+    NSURL *URL = [NSURL URLWithString:@"http://test.com/missing.jpg"];
+    [self _loadURL:URL options:nil manager:manager];
+    DFMutableImageRequestOptions *options = [DFMutableImageRequestOptions new];
+    options.memoryCachePolicy = DFImageRequestCachePolicyReloadIgnoringCache;
+    [self _loadURL:URL options:options.options manager:manager];
+    XCTAssertEqual(requests.count, 2);
+}
+
+- (void)testThatHostThatKeepsFailingIsBackedOff {
+    NSMutableArray *requests = [self _stubHost:@"down.com" statusCode:503 headers:nil];
+    DFImageManager *manager = [self _createURLImageManager];
+    for (NSInteger i = 0; i < 4; i++) {
+        XCTAssertNotNil([self _loadURL:[NSURL URLWithString:[NSString stringWithFormat:@"http://down.com/image_%li.jpg", (long)i]] options:nil manager:manager]);
+    }
+    XCTAssertEqual(requests.count, 3); // The fourth request fails fast
+}
+
+- (void)testThatHostIsBackedOffForRetryAfterInterval {
+    NSMutableArray *requests = [self _stubHost:@"busy.com" statusCode:429 headers:@{ @"Retry-After" : @"120" }];
+    DFImageManager *manager = [self _createURLImageManager];
+    [self _loadURL:[NSURL URLWithString:@"http://busy.com/image_1.jpg"] options:nil manager:manager];
+    XCTAssertNotNil([self _loadURL:[NSURL URLWithString:@"http://busy.com/image_2.jpg"] options:nil manager:manager]);
+    XCTAssertEqual(requests.count, 1);
+}
+
+- (void)testThatTimeoutsAreCachedOnlyForResource {
+    NSMutableArray *requests = [NSMutableArray new];
+    [OHHTTPStubs stubRequestsPassingTest:^BOOL(NSURLRequest *request) {
+        return [request.URL.host isEqualToString:@"slow.com"];
+    } withStubResponse:^OHHTTPStubsResponse *(NSURLRequest *request) {
+        @synchronized(requests) {
+            [requests addObject:request];
+        }
+        return [OHHTTPStubsResponse responseWithError:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorTimedOut userInfo:nil]];
+    }];
+    DFImageManager *manager = [self _createURLImageManager];
+    for (NSInteger i = 0; i < 4; i++) {
+        XCTAssertNotNil([self _loadURL:[NSURL URLWithString:[NSString stringWithFormat:@"http://slow.com/image_%li.jpg", (long)i]] options:nil manager:manager]);
+    }
+    XCTAssertEqual(requests.count, 4); // The host is not backed off
+    XCTAssertNotNil([self _loadURL:[NSURL URLWithString:@"http://slow.com/image_0.jpg"] options:nil manager:manager]);
+    XCTAssertEqual(requests.count, 4); // The resource that timed out fails fast
+}
+
+- (void)testThatNegativeCacheCanBeDisabled {
+    NSMutableArray *requests = [self _stubHost:@"test.com" statusCode:404 headers:nil];
+    DFImageManagerConfiguration *conf = [DFImageManagerConfiguration configurationWithFetcher:[DFURLImageFetcher new] processor:nil cache:nil];
+    conf.failureCacheCountLimit = 0;
+    DFImageManager *manager = [[DFImageManager alloc] initWithConfiguration:conf];
+    NSURL *URL = [NSURL URLWithString:@"http://test.com/missing.jpg"];
+    [self _loadURL:URL options:nil manager:manager];
+    [self _loadURL:URL options:nil manager:manager];
+    XCTAssertEqual(requests.count, 2);
+}
+
+#pragma mark - Allocations
+
+static atomic_uint_fast64_t _TDFAllocationCount;
+static IMP _TDFOriginalAllocWithZone;
+
+static id _TDFCountingAllocWithZone(id self, SEL _cmd, struct _NSZone *zone) {
+    atomic_fetch_add(&_TDFAllocationCount, 1);
+    return ((id (*)(id, SEL, struct _NSZone *))_TDFOriginalAllocWithZone)(self, _cmd, zone);
+}
+
+/*! Returns the average number of Objective-C objects allocated (on all threads) per request, the requests are executed by a given block which calls the completion when all of them are finished.
+ */
+- (double)_allocationsPerRequestWithCount:(NSUInteger)count block:(void (^)(dispatch_block_t completion))block {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"requests"];
+    Method method = class_getClassMethod([NSObject class], @selector(allocWithZone:));
+    _TDFOriginalAllocWithZone = method_setImplementation(method, (IMP)_TDFCountingAllocWithZone);
+    atomic_store(&_TDFAllocationCount, 0);
+    block(^{ [expectation fulfill]; });
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+    uint64_t allocationCount = atomic_load(&_TDFAllocationCount);
+    method_setImplementation(method, _TDFOriginalAllocWithZone);
+    return (double)allocationCount / count;
+}
+
+- (void)testAllocationsPerRequest {
+    const NSUInteger count = 100;
+    _cache.enabled = YES;
+    NSMutableArray *resources = [NSMutableArray new];
+    for (NSUInteger i = 0; i < count; i++) {
+        [resources addObject:[TDFMockResource resourceWithID:[NSString stringWithFormat:@"%lu", (unsigned long)i]]];
+    }
+
+    double missAllocations = [self _allocationsPerRequestWithCount:count block:^(dispatch_block_t completion) {
+        NSUInteger __block remaining = count;
+        for (TDFMockResource *resource in resources) {
+            [[_manager imageTaskForResource:resource completion:^(UIImage *image, NSError *error, DFImageResponse *response, DFImageTask *task) {
+                if (--remaining == 0) {
+                    completion();
+                }
+            }] resume];
+        }
+    }];
+
+    double hitAllocations = [self _allocationsPerRequestWithCount:count block:^(dispatch_block_t completion) {
+        for (TDFMockResource *resource in resources) {
+            [[_manager imageTaskForResource:resource completion:nil] resume];
+        }
+        completion(); // Memory cache hits are handled synchronously
+    }];
+
+    [_cache removeAllObjects];
+    double cancelAllocations = [self _allocationsPerRequestWithCount:count block:^(dispatch_block_t completion) {
+        NSUInteger __block remaining = count;
+        for (TDFMockResource *resource in resources) {
+            DFImageTask *task = [_manager imageTaskForResource:resource completion:^(UIImage *image, NSError *error, DFImageResponse *response, DFImageTask *task) {
+                if (--remaining == 0) {
+                    completion();
+                }
+            }];
+            [task resume];
+            [task cancel];
+        }
+    }];
+
+    // The bounds leave room for the allocations of the mocks and the system frameworks, they catch the regressions on the hot path
+    XCTAssertLessThanOrEqual(hitAllocations, 16.0); // Request, task and cache key
+    XCTAssertLessThanOrEqual(missAllocations, 150.0);
+    XCTAssertLessThanOrEqual(cancelAllocations, 100.0);
+}
+
+#pragma mark - Header Info
+
+- (void)_stubSlowImageResponseForHost:(NSString *)host {
+    NSData *data = [TDFTesting testImageData];
+    [OHHTTPStubs stubRequestsPassingTest:^BOOL(NSURLRequest *request) {
+        return [request.URL.host isEqualToString:host];
+    } withStubResponse:^OHHTTPStubsResponse *(NSURLRequest *request) {
+        return [[OHHTTPStubsResponse responseWithData:data statusCode:200 headers:nil] requestTime:0.0 responseTime:1.0];
+    }];
+}
+
+- (void)testThatHeaderInfoIsDeliveredBeforeImage {
+    [self _stubSlowImageResponseForHost:@"test.com"];
+    DFImageManager *manager = [self _createURLImageManager];
+    BOOL __block isHeaderInfoReceived = NO;
+    XCTestExpectation *expectation = [self expectationWithDescription:@"request"];
+    DFImageTask *task = [manager imageTaskForResource:[NSURL URLWithString:@"http://test.com/image.jpg"] completion:^(UIImage *__nullable image, NSError *__nullable error, DFImageResponse *__nullable response, DFImageTask *__nonnull completedTask) {
+        XCTAssertNotNil(image);
+        XCTAssertTrue(isHeaderInfoReceived);
+        [expectation fulfill];
+    }];
+    task.headerInfoHandler = ^(DFImageHeaderInfo *headerInfo) {
+        XCTAssertTrue([NSThread isMainThread]);
+        XCTAssertEqual(headerInfo.format, DFImageFormatJPEG);
+        XCTAssertTrue(headerInfo.pixelSize.width > 0 && headerInfo.pixelSize.height > 0);
+        isHeaderInfoReceived = YES;
+    };
+    [task resume];
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+}
+
+- (void)testThatProbeStopsFetchAfterHeader {
+    [self _stubSlowImageResponseForHost:@"test.com"];
+    DFImageManager *manager = [self _createURLImageManager];
+    CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+    XCTestExpectation *expectation = [self expectationWithDescription:@"probe"];
+    [manager probeHeaderInfoForRequest:[DFImageRequest requestWithResource:[NSURL URLWithString:@"http://test.com/image.jpg"]] completion:^(DFImageHeaderInfo *headerInfo, NSError *error) {
+        XCTAssertEqual(headerInfo.format, DFImageFormatJPEG);
+        XCTAssertLessThan(CFAbsoluteTimeGetCurrent() - startTime, 0.9); // Completes before the body is downloaded
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+}
+
 #pragma mark - Priority
 
 - (void)testThatPriorityIsChanged {
@@ -583,6 +1002,194 @@
     [self waitForExpectationsWithTimeout:1.0 handler:nil];
 }
 
+- (nonnull NSOperationQueue *)_suspendedSerialQueue {
+    NSOperationQueue *queue = [NSOperationQueue new];
+    queue.maxConcurrentOperationCount = 1;
+    queue.suspended = YES;
+    return queue;
+}
+
+- (nonnull DFImageManager *)_managerWithDecoder:(nonnull id<DFImageDecoding>)decoder decodingQueue:(nonnull NSOperationQueue *)decodingQueue processingQueue:(nonnull NSOperationQueue *)processingQueue {
+    DFImageManagerConfiguration *configuration = [DFImageManagerConfiguration configurationWithFetcher:_fetcher processor:_processor cache:_cache];
+    configuration.decoder = decoder;
+    configuration.decodingQueue = decodingQueue;
+    configuration.processingQueue = processingQueue;
+    return [[DFImageManager alloc] initWithConfiguration:configuration];
+}
+
+- (void)_waitForOperationCount:(NSUInteger)count inQueue:(nonnull NSOperationQueue *)queue {
+    [self expectationForPredicate:[NSPredicate predicateWithFormat:@"operationCount == %lu", (unsigned long)count] evaluatedWithObject:queue handler:nil];
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+}
+
+- (void)testThatVisibleRequestOvertakesPreheatingWhenDecoding {
+    _TDFRecordingImageDecoder *decoder = [_TDFRecordingImageDecoder new];
+    NSOperationQueue *decodingQueue = [self _suspendedSerialQueue];
+    DFImageManager *manager = [self _managerWithDecoder:decoder decodingQueue:decodingQueue processingQueue:[NSOperationQueue new]];
+    TDFMockResource *visibleResource = [TDFMockResource resourceWithID:@"ID02"];
+    
+    [manager startPreheatingImagesForRequests:@[ [DFImageRequest requestWithResource:[TDFMockResource resourceWithID:@"ID01"]] ]];
+    [self _waitForOperationCount:1 inQueue:decodingQueue];
+    [[manager imageTaskForResource:visibleResource completion:nil] resume];
+    [self _waitForOperationCount:2 inQueue:decodingQueue];
+    
+    decodingQueue.suspended = NO;
+    [self _waitForOperationCount:0 inQueue:decodingQueue];
+    XCTAssertEqualObjects(decoder.resources, (@[ visibleResource, [TDFMockResource resourceWithID:@"ID01"] ]));
+}
+
+- (void)testThatVisibleRequestOvertakesPreheatingWhenProcessing {
+    NSOperationQueue *processingQueue = [self _suspendedSerialQueue];
+    DFImageManager *manager = [self _managerWithDecoder:[DFImageDecoder new] decodingQueue:[NSOperationQueue new] processingQueue:processingQueue];
+    TDFMockResource *visibleResource = [TDFMockResource resourceWithID:@"ID02"];
+    NSMutableArray *resources = [NSMutableArray new];
+    _processor.processingHandler = ^(DFImageRequest *request) {
+        @synchronized(resources) {
+            [resources addObject:request.resource];
+        }
+    };
+    
+    [manager startPreheatingImagesForRequests:@[ [DFImageRequest requestWithResource:[TDFMockResource resourceWithID:@"ID01"]] ]];
+    [self _waitForOperationCount:1 inQueue:processingQueue];
+    [[manager imageTaskForResource:visibleResource completion:nil] resume];
+    [self _waitForOperationCount:2 inQueue:processingQueue];
+    
+    processingQueue.suspended = NO;
+    [self _waitForOperationCount:0 inQueue:processingQueue];
+    XCTAssertEqualObjects(resources, (@[ visibleResource, [TDFMockResource resourceWithID:@"ID01"] ]));
+}
+
+- (void)testThatPriorityChangeIsPropagatedToQueuedProcessing {
+    NSOperationQueue *processingQueue = [self _suspendedSerialQueue];
+    DFImageManager *manager = [self _managerWithDecoder:[DFImageDecoder new] decodingQueue:[NSOperationQueue new] processingQueue:processingQueue];
+    NSMutableArray *resources = [NSMutableArray new];
+    _processor.processingHandler = ^(DFImageRequest *request) {
+        @synchronized(resources) {
+            [resources addObject:request.resource];
+        }
+    };
+    
+    [[manager imageTaskForResource:[TDFMockResource resourceWithID:@"ID01"] completion:nil] resume];
+    [self _waitForOperationCount:1 inQueue:processingQueue];
+    DFImageTask *task = [manager imageTaskForResource:[TDFMockResource resourceWithID:@"ID02"] completion:nil];
+    [task resume];
+    [self _waitForOperationCount:2 inQueue:processingQueue];
+    
+    task.priority = DFImageRequestPriorityHigh;
+    [self expectationForPredicate:[NSPredicate predicateWithFormat:@"ANY operations.queuePriority == %ld", (long)NSOperationQueuePriorityHigh] evaluatedWithObject:processingQueue handler:nil];
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+    processingQueue.suspended = NO;
+    [self _waitForOperationCount:0 inQueue:processingQueue];
+    XCTAssertEqualObjects(resources.firstObject, [TDFMockResource resourceWithID:@"ID02"]);
+}
+
+- (void)testThatLateEquivalentRequestIsDecodedFromFetchedData {
+    _fetcher.data = [TDFTesting testJPEGDataWithEmbeddedThumbnailWithSize:CGSizeMake(1600, 1200)];
+    NSOperationQueue *decodingQueue = [self _suspendedSerialQueue];
+    DFImageManager *manager = [self _managerWithDecoder:[DFImageDecoder new] decodingQueue:decodingQueue processingQueue:[NSOperationQueue new]];
+    
+    XCTestExpectation *thumbnailExpectation = [self expectationWithDescription:@"thumbnail"];
+    [[manager imageTaskForRequest:[DFImageRequest requestWithResource:[TDFMockResource resourceWithID:@"ID01"] targetSize:CGSizeMake(100.f, 75.f) contentMode:DFImageContentModeAspectFit options:nil] completion:^(UIImage *__nullable image, NSError *__nullable error, DFImageResponse *__nullable response, DFImageTask *__nonnull completedTask) {
+        XCTAssertLessThan(CGImageGetWidth(image.CGImage), 1600);
+        [thumbnailExpectation fulfill];
+    }] resume];
+    [self _waitForOperationCount:1 inQueue:decodingQueue];
+    
+    // The request joins the operation that is already decoding the thumbnail for the first request
+    XCTestExpectation *imageExpectation = [self expectationWithDescription:@"image"];
+    [[manager imageTaskForRequest:[DFImageRequest requestWithResource:[TDFMockResource resourceWithID:@"ID01"]] completion:^(UIImage *__nullable image, NSError *__nullable error, DFImageResponse *__nullable response, DFImageTask *__nonnull completedTask) {
+        XCTAssertEqual(CGImageGetWidth(image.CGImage), 1600);
+        [imageExpectation fulfill];
+    }] resume];
+    decodingQueue.suspended = NO;
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+    XCTAssertEqual(_fetcher.createdOperationCount, 1);
+}
+
+- (void)testThatQueuedDecodeOfCancelledTaskIsDropped {
+    _TDFRecordingImageDecoder *decoder = [_TDFRecordingImageDecoder new];
+    NSOperationQueue *decodingQueue = [self _suspendedSerialQueue];
+    DFImageManagerConfiguration *configuration = [DFImageManagerConfiguration configurationWithFetcher:_fetcher processor:_processor cache:nil];
+    configuration.decoder = decoder;
+    configuration.decodingQueue = decodingQueue;
+    DFImageManager *manager = [[DFImageManager alloc] initWithConfiguration:configuration];
+    
+    DFImageTask *task = [manager imageTaskForResource:[TDFMockResource resourceWithID:@"ID01"] completion:nil];
+    [task resume];
+    [self _waitForOperationCount:1 inQueue:decodingQueue];
+    [task cancel]; // There is no memory cache to store the image in, nobody needs it
+    [self expectationForPredicate:[NSPredicate predicateWithFormat:@"ANY operations.cancelled == YES"] evaluatedWithObject:decodingQueue handler:nil];
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+    
+    decodingQueue.suspended = NO;
+    [self _waitForOperationCount:0 inQueue:decodingQueue];
+    XCTAssertEqual(decoder.resources.count, 0);
+}
+
+#pragma mark - Preview
+
+- (void)testThatBlurHashPreviewIsDeliveredBeforeImage {
+    _fetcher.queue.suspended = YES;
+    DFMutableImageRequestOptions *options = [DFMutableImageRequestOptions new];
+    options.allowsPreview = YES;
+    options.previewBlurHash = @"LEHV6nWB2yk8pyo0adR*.7kCMdnj";
+    DFImageRequest *request = [DFImageRequest requestWithResource:[TDFMockResource resourceWithID:@"ID01"] targetSize:DFImageMaximumSize contentMode:DFImageContentModeAspectFill options:options.options];
+    
+    XCTestExpectation *previewExpectation = [self expectationWithDescription:@"preview"];
+    DFImageTask *task = [_manager imageTaskForRequest:request completion:nil];
+    task.progressiveImageHandler = ^(UIImage *image) {
+        XCTAssertTrue([NSThread isMainThread]);
+        XCTAssertEqual(CGImageGetWidth(image.CGImage), 32);
+        [previewExpectation fulfill];
+    };
+    [task resume];
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+    XCTAssertTrue(task.timeToFirstImage > 0.0);
+    XCTAssertEqual(task.state, DFImageTaskStateRunning);
+    
+    NSTimeInterval timeToFirstImage = task.timeToFirstImage;
+    XCTestExpectation *expectation = [self expectationWithDescription:@"image"];
+    task.completionHandler = ^(UIImage *image, NSError *error, DFImageResponse *response, DFImageTask *completedTask) {
+        XCTAssertNotNil(image);
+        [expectation fulfill];
+    };
+    _fetcher.queue.suspended = NO;
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+    XCTAssertEqual(task.timeToFirstImage, timeToFirstImage);
+}
+
+- (void)testThatPreviewResourceIsDeliveredBeforeImage {
+    _cache.enabled = YES;
+    TDFMockResource *previewResource = [TDFMockResource resourceWithID:@"ID02"];
+    XCTestExpectation *cacheExpectation = [self expectationWithDescription:@"cache"];
+    [[_manager imageTaskForResource:previewResource completion:^(UIImage *image, NSError *error, DFImageResponse *response, DFImageTask *task) {
+        [cacheExpectation fulfill];
+    }] resume];
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+    
+    _fetcher.queue.suspended = YES;
+    DFMutableImageRequestOptions *options = [DFMutableImageRequestOptions new];
+    options.allowsPreview = YES;
+    options.previewResource = previewResource;
+    DFImageRequest *request = [DFImageRequest requestWithResource:[TDFMockResource resourceWithID:@"ID01"] targetSize:DFImageMaximumSize contentMode:DFImageContentModeAspectFill options:options.options];
+    
+    BOOL __block isPreviewDelivered = NO;
+    XCTestExpectation *expectation = [self expectationWithDescription:@"image"];
+    DFImageTask *task = [_manager imageTaskForRequest:request completion:^(UIImage *image, NSError *error, DFImageResponse *response, DFImageTask *completedTask) {
+        XCTAssertNotNil(image);
+        XCTAssertTrue(isPreviewDelivered);
+        [expectation fulfill];
+    }];
+    task.progressiveImageHandler = ^(UIImage *image) {
+        XCTAssertFalse(isPreviewDelivered);
+        isPreviewDelivered = YES;
+    };
+    [task resume];
+    XCTAssertTrue(isPreviewDelivered); // Preview is delivered synchronously from the memory cache
+    _fetcher.queue.suspended = NO;
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+}
+
 #pragma mark - Preheating
 
 - (void)testThatPreheatingRequestsHasLowerExecutionPrirorty {
@@ -708,6 +1315,435 @@
     [self waitForExpectationsWithTimeout:1.0 handler:nil];
 }
 
+#pragma mark - Budget
+
+- (void)testThatBudgetLimitsConcurrentRequestsAcrossManagers {
+    DFImageManagerBudget *budget = [DFImageManagerBudget new];
+    budget.maximumConcurrentRequests = 1;
+    
+    TDFMockImageFetcher *fetcher1 = [TDFMockImageFetcher new];
+    fetcher1.queue.suspended = YES;
+    DFImageManagerConfiguration *conf1 = [DFImageManagerConfiguration configurationWithFetcher:fetcher1 processor:nil cache:nil];
+    conf1.budget = budget;
+    DFImageManager *manager1 = [[DFImageManager alloc] initWithConfiguration:conf1];
+    
+    TDFMockImageFetcher *fetcher2 = [TDFMockImageFetcher new];
+    DFImageManagerConfiguration *conf2 = [DFImageManagerConfiguration configurationWithFetcher:fetcher2 processor:nil cache:nil];
+    conf2.budget = budget;
+    DFImageManager *manager2 = [[DFImageManager alloc] initWithConfiguration:conf2];
+    
+    BOOL __block isTask1Completed = NO;
+    XCTestExpectation *expectation1 = [self expectationWithDescription:@"task1"];
+    [[manager1 imageTaskForResource:[TDFMockResource resourceWithID:@"ID01"] completion:^(UIImage *image, NSError *error, DFImageResponse *response, DFImageTask *task) {
+        isTask1Completed = YES;
+        [expectation1 fulfill];
+    }] resume];
+    XCTestExpectation *expectation2 = [self expectationWithDescription:@"task2"];
+    DFImageTask *task2 = [[manager2 imageTaskForResource:[TDFMockResource resourceWithID:@"ID02"] completion:^(UIImage *image, NSError *error, DFImageResponse *response, DFImageTask *task) {
+        XCTAssertNotNil(image);
+        XCTAssertTrue(isTask1Completed);
+        [expectation2 fulfill];
+    }] resume];
+    XCTAssertEqual(budget.executingRequestCount, 1);
+    XCTAssertEqual(fetcher2.createdOperationCount, 0);
+    XCTAssertEqual(task2.state, DFImageTaskStateRunning);
+    
+    fetcher1.queue.suspended = NO;
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+    XCTAssertEqual(fetcher2.createdOperationCount, 1);
+}
+
+- (void)testThatPendingTasksWithHigherPriorityAreStartedFirst {
+    DFImageManagerBudget *budget = [DFImageManagerBudget new];
+    budget.maximumConcurrentRequests = 1;
+    _fetcher.queue.suspended = YES;
+    DFImageManagerConfiguration *conf = [DFImageManagerConfiguration configurationWithFetcher:_fetcher processor:nil cache:nil];
+    conf.budget = budget;
+    DFImageManager *manager = [[DFImageManager alloc] initWithConfiguration:conf];
+    
+    TDFMockResource *resourceFirst = [TDFMockResource resourceWithID:@"ID01"];
+    [[manager imageTaskForResource:resourceFirst completion:nil] resume];
+    
+    TDFMockResource *resourceLow = [TDFMockResource resourceWithID:@"ID02"];
+    TDFMockResource *resourceHigh = [TDFMockResource resourceWithID:@"ID03"];
+    XCTestExpectation *expectation = [self expectationWithDescription:@"low"];
+    DFImageTask *taskLow = [manager imageTaskForResource:resourceLow completion:^(UIImage *image, NSError *error, DFImageResponse *response, DFImageTask *task) {
+        [expectation fulfill];
+    }];
+    taskLow.priority = DFImageRequestPriorityLow;
+    [taskLow resume];
+    DFImageTask *taskHigh = [manager imageTaskForResource:resourceHigh completion:nil];
+    taskHigh.priority = DFImageRequestPriorityHigh;
+    [taskHigh resume];
+    
+    NSMutableArray *startedResources = [NSMutableArray new];
+    id observer = [[NSNotificationCenter defaultCenter] addObserverForName:TDFMockImageFetcherDidStartOperationNotification object:_fetcher queue:nil usingBlock:^(NSNotification *notification) {
+        DFImageRequest *request = notification.userInfo[TDFMockImageFetcherRequestKey];
+        if (request.resource != resourceFirst) {
+            [startedResources addObject:request.resource];
+        }
+    }];
+    _fetcher.queue.suspended = NO;
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+    [[NSNotificationCenter defaultCenter] removeObserver:observer];
+    
+    NSArray *expectedResources = @[ resourceHigh, resourceLow ];
+    XCTAssertEqualObjects(startedResources, expectedResources);
+}
+
+#pragma mark - Prefetch Jobs
+
+- (NSArray *)_prefetchRequestsWithCount:(NSInteger)count {
+    NSMutableArray *requests = [NSMutableArray new];
+    for (NSInteger i = 0; i < count; i++) {
+        [requests addObject:[DFImageRequest requestWithResource:[TDFMockResource resourceWithID:[NSString stringWithFormat:@"ID%02li", (long)i]]]];
+    }
+    return requests;
+}
+
+- (void)testThatPrefetchJobLoadsAllRequests {
+    DFImagePrefetchJob *job = [_manager prefetchJobWithRequests:[self _prefetchRequestsWithCount:5]];
+    job.pausesInLowPowerMode = NO;
+    NSInteger __block progressCallCount = 0;
+    job.progressHandler = ^(DFImagePrefetchJob *job) {
+        XCTAssertTrue([NSThread isMainThread]);
+        progressCallCount++;
+    };
+    XCTestExpectation *expectation = [self expectationWithDescription:@"job"];
+    job.completionHandler = ^(DFImagePrefetchJob *job) {
+        XCTAssertEqual(job.state, DFImagePrefetchJobStateCompleted);
+        XCTAssertEqual(job.completedRequestCount, 5);
+        XCTAssertEqual(job.failedRequestCount, 0);
+        XCTAssertEqual(job.progress.completedUnitCount, 5);
+        XCTAssertEqual(progressCallCount, 5);
+        [expectation fulfill];
+    };
+    [job resume];
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+    XCTAssertEqual(_fetcher.createdOperationCount, 5);
+}
+
+- (void)testThatPrefetchJobYieldsToInteractiveTasks {
+    _fetcher.queue.suspended = YES;
+    XCTestExpectation *taskExpectation = [self expectationWithDescription:@"task"];
+    [[_manager imageTaskForResource:[TDFMockResource resourceWithID:@"interactive"] completion:^(UIImage *image, NSError *error, DFImageResponse *response, DFImageTask *task) {
+        [taskExpectation fulfill];
+    }] resume];
+    
+    DFImagePrefetchJob *job = [_manager prefetchJobWithRequests:[self _prefetchRequestsWithCount:3]];
+    job.pausesInLowPowerMode = NO;
+    XCTestExpectation *jobExpectation = [self expectationWithDescription:@"job"];
+    job.completionHandler = ^(DFImagePrefetchJob *job) {
+        XCTAssertEqual(job.completedRequestCount, 3);
+        [jobExpectation fulfill];
+    };
+    [job resume];
+    XCTAssertEqual(job.state, DFImagePrefetchJobStateRunning);
+    XCTAssertEqual(_fetcher.createdOperationCount, 1); // The job waits for the interactive task
+    
+    _fetcher.queue.suspended = NO;
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+    XCTAssertEqual(_fetcher.createdOperationCount, 4);
+}
+
+- (void)testThatPrefetchJobCanBePausedAndResumed {
+    _fetcher.queue.suspended = YES;
+    DFImagePrefetchJob *job = [_manager prefetchJobWithRequests:[self _prefetchRequestsWithCount:3]];
+    job.pausesInLowPowerMode = NO;
+    job.maximumConcurrentRequests = 1;
+    XCTestExpectation *expectation = [self expectationWithDescription:@"job"];
+    job.completionHandler = ^(DFImagePrefetchJob *job) {
+        XCTAssertEqual(job.state, DFImagePrefetchJobStateCompleted);
+        XCTAssertEqual(job.completedRequestCount, 3);
+        XCTAssertEqual(job.failedRequestCount, 0); // Requests cancelled by pause are restarted
+        [expectation fulfill];
+    };
+    [job resume];
+    XCTAssertEqual(_fetcher.createdOperationCount, 1);
+    [job pause];
+    XCTAssertEqual(job.state, DFImagePrefetchJobStatePaused);
+    
+    _fetcher.queue.suspended = NO;
+    [job resume];
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+}
+
+- (void)testThatPrefetchJobStopsWhenByteCountLimitIsReached {
+    DFImagePrefetchJob *job = [_manager prefetchJobWithRequests:[self _prefetchRequestsWithCount:5]];
+    job.pausesInLowPowerMode = NO;
+    job.maximumConcurrentRequests = 1;
+    job.fetchesDataOnly = YES;
+    job.byteCountLimit = _fetcher.data.length * 2;
+    XCTestExpectation *expectation = [self expectationWithDescription:@"job"];
+    job.completionHandler = ^(DFImagePrefetchJob *job) {
+        XCTAssertEqual(job.state, DFImagePrefetchJobStateCompleted);
+        XCTAssertTrue(job.isByteCountLimitReached);
+        XCTAssertEqual(job.completedRequestCount, 2);
+        XCTAssertEqual(job.fetchedByteCount, (int64_t)_fetcher.data.length * 2);
+        [expectation fulfill];
+    };
+    [job resume];
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+}
+
+- (void)testThatPrefetchJobCountsBytesOfFetchedImages {
+    DFImagePrefetchJob *job = [_manager prefetchJobWithRequests:[self _prefetchRequestsWithCount:2]];
+    job.pausesInLowPowerMode = NO;
+    XCTestExpectation *expectation = [self expectationWithDescription:@"job"];
+    job.completionHandler = ^(DFImagePrefetchJob *job) {
+        XCTAssertEqual(job.completedRequestCount, 2);
+        XCTAssertEqual(job.fetchedByteCount, (int64_t)_fetcher.data.length * 2);
+        [expectation fulfill];
+    };
+    [job resume];
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+}
+
+- (void)testThatPrefetchJobDoesntCountBytesFromCacheOfFetcher {
+    _fetcher.info = @{ DFImageInfoFetchedByteCountKey : @0 }; // The data is read from the disk cache
+    DFImagePrefetchJob *job = [_manager prefetchJobWithRequests:[self _prefetchRequestsWithCount:2]];
+    job.pausesInLowPowerMode = NO;
+    job.fetchesDataOnly = YES;
+    XCTestExpectation *expectation = [self expectationWithDescription:@"job"];
+    job.completionHandler = ^(DFImagePrefetchJob *job) {
+        XCTAssertEqual(job.completedRequestCount, 2);
+        XCTAssertEqual(job.fetchedByteCount, 0);
+        [expectation fulfill];
+    };
+    [job resume];
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+}
+
+- (void)testThatPrefetchJobFetchingDataOnlyDoesntProcessImages {
+    _cache.enabled = YES;
+    DFImagePrefetchJob *job = [_manager prefetchJobWithRequests:[self _prefetchRequestsWithCount:2]];
+    job.pausesInLowPowerMode = NO;
+    job.fetchesDataOnly = YES;
+    XCTestExpectation *expectation = [self expectationWithDescription:@"job"];
+    job.completionHandler = ^(DFImagePrefetchJob *job) {
+        XCTAssertEqual(job.completedRequestCount, 2);
+        [expectation fulfill];
+    };
+    [job resume];
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+    XCTAssertEqual(_fetcher.createdOperationCount, 2);
+    XCTAssertEqual(_cache.responses.count, 0);
+}
+
+- (void)testThatPrefetchJobFetchingDataOnlyReportsFailures {
+    _fetcher.data = nil;
+    _fetcher.error = [NSError errorWithDomain:@"TDFErrorDomain" code:14 userInfo:nil];
+    DFImagePrefetchJob *job = [_manager prefetchJobWithRequests:[self _prefetchRequestsWithCount:2]];
+    job.pausesInLowPowerMode = NO;
+    job.fetchesDataOnly = YES;
+    XCTestExpectation *expectation = [self expectationWithDescription:@"job"];
+    job.completionHandler = ^(DFImagePrefetchJob *job) {
+        XCTAssertEqual(job.completedRequestCount, 0);
+        XCTAssertEqual(job.failedRequestCount, 2);
+        XCTAssertEqual(job.fetchedByteCount, 0);
+        [expectation fulfill];
+    };
+    [job resume];
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+}
+
+- (void)testThatPrefetchJobFetchingDataOnlySharesFetchWithImageTask {
+    _fetcher.queue.suspended = YES;
+    DFImagePrefetchJob *job = [_manager prefetchJobWithRequests:[self _prefetchRequestsWithCount:1]];
+    job.pausesInLowPowerMode = NO;
+    job.fetchesDataOnly = YES;
+    XCTestExpectation *jobExpectation = [self expectationWithDescription:@"job"];
+    job.completionHandler = ^(DFImagePrefetchJob *job) {
+        XCTAssertEqual(job.completedRequestCount, 1);
+        [jobExpectation fulfill];
+    };
+    [job resume];
+    XCTestExpectation *taskExpectation = [self expectationWithDescription:@"task"];
+    [[_manager imageTaskForResource:[TDFMockResource resourceWithID:@"ID00"] completion:^(UIImage *image, NSError *error, DFImageResponse *response, DFImageTask *task) {
+        XCTAssertNotNil(image);
+        [taskExpectation fulfill];
+    }] resume];
+    _fetcher.queue.suspended = NO;
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+    XCTAssertEqual(_fetcher.createdOperationCount, 1);
+}
+
+- (void)testThatPrefetchJobDoesntStoreImagesInMemoryCache {
+    _cache.enabled = YES;
+    DFImagePrefetchJob *job = [_manager prefetchJobWithRequests:[self _prefetchRequestsWithCount:2]];
+    job.pausesInLowPowerMode = NO;
+    XCTestExpectation *expectation = [self expectationWithDescription:@"job"];
+    job.completionHandler = ^(DFImagePrefetchJob *job) {
+        XCTAssertEqual(job.completedRequestCount, 2);
+        [expectation fulfill];
+    };
+    [job resume];
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+    XCTAssertEqual(_cache.responses.count, 0);
+}
+
+- (void)testThatPrefetchJobIsCancelled {
+    _fetcher.queue.suspended = YES;
+    DFImagePrefetchJob *job = [_manager prefetchJobWithRequests:[self _prefetchRequestsWithCount:3]];
+    job.pausesInLowPowerMode = NO;
+    XCTestExpectation *expectation = [self expectationWithDescription:@"job"];
+    job.completionHandler = ^(DFImagePrefetchJob *job) {
+        XCTAssertEqual(job.state, DFImagePrefetchJobStateCancelled);
+        XCTAssertEqual(job.completedRequestCount, 0);
+        [expectation fulfill];
+    };
+    [job resume];
+    [job.progress cancel];
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+}
+
+#pragma mark - Stale-While-Revalidate
+
+/*! Fetches the image into the memory cache and then makes the cached response expired.
+ */
+- (void)_loadExpiredCachedImageForResource:(TDFMockResource *)resource validator:(NSString *)validator {
+    [self _loadExpiredCachedImageForResource:resource info:@{ DFImageInfoValidatorKey : validator }];
+}
+
+- (void)_loadExpiredCachedImageForResource:(TDFMockResource *)resource info:(NSDictionary *)info {
+    _cache.enabled = YES;
+    _fetcher.info = info;
+    XCTestExpectation *expectation = [self expectationWithDescription:@"request"];
+    [[_manager imageTaskForResource:resource completion:^(UIImage *__nullable image, NSError *__nullable error, DFImageResponse *__nullable response, DFImageTask *__nonnull completedTask) {
+        [expectation fulfill];
+    }] resume];
+    [self waitForExpectationsWithTimeout:1.0 handler:nil];
+    for (id key in _cache.responses.allKeys) {
+        DFCachedImageResponse *response = _cache.responses[key];
+        _cache.responses[key] = [[DFCachedImageResponse alloc] initWithImage:response.image info:response.info expirationDate:(CFAbsoluteTimeGetCurrent() - 1.0)];
+    }
+}
+
+- (DFImageRequest *)_staleWhileRevalidateRequestWithResource:(TDFMockResource *)resource {
+    DFMutableImageRequestOptions *options = [DFMutableImageRequestOptions new];
+    options.memoryCachePolicy = DFImageRequestCachePolicyReturnStaleWhileRevalidate;
+    return [DFImageRequest requestWithResource:resource targetSize:DFImageMaximumSize contentMode:DFImageContentModeAspectFill options:options.options];
+}
+
+/*! Waits until the revalidation refreshes the cached response and the manager handles the result on the main thread.
+ */
+- (void)_waitForCachedResponseToBeRefreshed {
+    TDFMockImageCache *cache = _cache;
+    [self expectationForPredicate:[NSPredicate predicateWithBlock:^BOOL(id object, NSDictionary *bindings) {
+        DFCachedImageResponse *response = cache.responses.allValues.firstObject;
+        return response && !response.isExpired;
+    }] evaluatedWithObject:self handler:nil];
+    [self waitForExpectationsWithTimeout:1.0 handler:nil];
+    XCTestExpectation *expectation = [self expectationWithDescription:@"main"];
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(0.05 * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        [expectation fulfill];
+    });
+    [self waitForExpectationsWithTimeout:1.0 handler:nil];
+}
+
+- (void)testThatExpiredImageIsReturnedAsStaleFastResponse {
+    TDFMockResource *resource = [TDFMockResource resourceWithID:@"ID01"];
+    [self _loadExpiredCachedImageForResource:resource validator:@"\"v1\""];
+
+    [self expectationForNotification:TDFMockImageFetcherDidStartOperationNotification object:_fetcher handler:nil];
+    BOOL __block isCompletionHandlerCalled = NO;
+    [[_manager imageTaskForRequest:[self _staleWhileRevalidateRequestWithResource:resource] completion:^(UIImage *__nullable image, NSError *__nullable error, DFImageResponse *__nullable response, DFImageTask *__nonnull completedTask) {
+        XCTAssertNotNil(image);
+        XCTAssertTrue(response.isFastResponse);
+        XCTAssertTrue(response.isStale);
+        isCompletionHandlerCalled = YES;
+    }] resume];
+    XCTAssertTrue(isCompletionHandlerCalled);
+    [self waitForExpectationsWithTimeout:1.0 handler:nil]; // The image is revalidated in background
+}
+
+- (void)testThatRevalidationHandlerIsCalledWhenContentChanges {
+    TDFMockResource *resource = [TDFMockResource resourceWithID:@"ID01"];
+    [self _loadExpiredCachedImageForResource:resource validator:@"\"v1\""];
+    _fetcher.info = @{ DFImageInfoValidatorKey : @"\"v2\"" };
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"revalidation"];
+    DFImageTask *task = [_manager imageTaskForRequest:[self _staleWhileRevalidateRequestWithResource:resource] completion:nil];
+    task.revalidationHandler = ^(UIImage *__nonnull image, DFImageResponse *__nonnull response) {
+        XCTAssertTrue([NSThread isMainThread]);
+        XCTAssertFalse(response.isStale);
+        XCTAssertEqualObjects(response.info[DFImageInfoValidatorKey], @"\"v2\"");
+        [expectation fulfill];
+    };
+    [task resume];
+    [self waitForExpectationsWithTimeout:1.0 handler:nil];
+}
+
+- (void)testThatRevalidationsAreDeduplicated {
+    TDFMockResource *resource = [TDFMockResource resourceWithID:@"ID01"];
+    [self _loadExpiredCachedImageForResource:resource validator:@"\"v1\""];
+    _fetcher.info = @{ DFImageInfoValidatorKey : @"\"v2\"" };
+
+    for (NSInteger i = 0; i < 2; i++) {
+        XCTestExpectation *expectation = [self expectationWithDescription:@"revalidation"];
+        DFImageTask *task = [_manager imageTaskForRequest:[self _staleWhileRevalidateRequestWithResource:resource] completion:nil];
+        task.revalidationHandler = ^(UIImage *__nonnull image, DFImageResponse *__nonnull response) {
+            [expectation fulfill];
+        };
+        [task resume];
+    }
+    [self waitForExpectationsWithTimeout:1.0 handler:nil];
+    XCTAssertEqual(_fetcher.createdOperationCount, 2);
+}
+
+- (void)testThatNotModifiedRevalidationExtendsLifetimeOfStaleImage {
+    TDFMockResource *resource = [TDFMockResource resourceWithID:@"ID01"];
+    [self _loadExpiredCachedImageForResource:resource validator:@"\"v1\""];
+    _fetcher.data = nil;
+    _fetcher.error = [NSError errorWithDomain:DFImageManagerErrorDomain code:DFImageManagerErrorNotModified userInfo:nil];
+
+    DFImageTask *task = [_manager imageTaskForRequest:[self _staleWhileRevalidateRequestWithResource:resource] completion:nil];
+    task.revalidationHandler = ^(UIImage *__nonnull image, DFImageResponse *__nonnull response) {
+        XCTFail(@"The content hasn't changed");
+    };
+    [task resume];
+    [self _waitForCachedResponseToBeRefreshed];
+}
+
+- (void)testThatRevalidationHandlerIsNotCalledWhenValidatorIsTheSame {
+    TDFMockResource *resource = [TDFMockResource resourceWithID:@"ID01"];
+    [self _loadExpiredCachedImageForResource:resource validator:@"\"v1\""];
+
+    DFImageTask *task = [_manager imageTaskForRequest:[self _staleWhileRevalidateRequestWithResource:resource] completion:nil];
+    task.revalidationHandler = ^(UIImage *__nonnull image, DFImageResponse *__nonnull response) {
+        XCTFail(@"The content hasn't changed");
+    };
+    [task resume];
+    [self _waitForCachedResponseToBeRefreshed];
+}
+
+- (void)testThatRevalidationHandlerIsNotCalledWhenThereIsNothingToCompare {
+    TDFMockResource *resource = [TDFMockResource resourceWithID:@"ID01"];
+    [self _loadExpiredCachedImageForResource:resource info:@{}];
+    _fetcher.info = @{ DFImageInfoValidatorKey : @"\"v2\"" };
+
+    DFImageTask *task = [_manager imageTaskForRequest:[self _staleWhileRevalidateRequestWithResource:resource] completion:nil];
+    task.revalidationHandler = ^(UIImage *__nonnull image, DFImageResponse *__nonnull response) {
+        XCTFail(@"The cached response has no validator");
+    };
+    [task resume];
+    [self _waitForCachedResponseToBeRefreshed];
+}
+
+- (void)testThatRevalidationHandlerIsCalledWhenContentLengthChanges {
+    TDFMockResource *resource = [TDFMockResource resourceWithID:@"ID01"];
+    [self _loadExpiredCachedImageForResource:resource info:@{ DFImageInfoHTTPHeaderFieldsKey : @{ @"Last-Modified" : @"Wed, 21 Oct 2015 07:28:00 GMT", @"Content-Length" : @"100" } }];
+    _fetcher.info = @{ DFImageInfoHTTPHeaderFieldsKey : @{ @"Last-Modified" : @"Wed, 21 Oct 2015 07:28:00 GMT", @"Content-Length" : @"200" } };
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"revalidation"];
+    DFImageTask *task = [_manager imageTaskForRequest:[self _staleWhileRevalidateRequestWithResource:resource] completion:nil];
+    task.revalidationHandler = ^(UIImage *__nonnull image, DFImageResponse *__nonnull response) {
+        [expectation fulfill];
+    };
+    [task resume];
+    [self waitForExpectationsWithTimeout:1.0 handler:nil];
+}
+
 #pragma mark - Invalidation
 
 - (void)testThatRequestsFinishWithoutAStrongReferenceToManager {
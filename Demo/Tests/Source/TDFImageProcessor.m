@@ -0,0 +1,159 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import "DFImageManagerKit.h"
+#import <UIKit/UIKit.h>
+#import <XCTest/XCTest.h>
+
+static UIImage *TDFImageWithColorSpace(CGColorSpaceRef colorSpace, CGBitmapInfo bitmapInfo, CGSize size) {
+    CGContextRef context = CGBitmapContextCreate(NULL, (size_t)size.width, (size_t)size.height, 8, 0, colorSpace, bitmapInfo);
+    CGImageRef imageRef = CGBitmapContextCreateImage(context);
+    UIImage *image = [UIImage imageWithCGImage:imageRef];
+    CGImageRelease(imageRef);
+    CGContextRelease(context);
+    return image;
+}
+
+@interface TDFImageProcessor : XCTestCase
+
+@end
+
+@implementation TDFImageProcessor {
+    CGColorSpaceRef _rgb;
+    CGColorSpaceRef _gray;
+}
+
+- (void)setUp {
+    [super setUp];
+    _rgb = CGColorSpaceCreateDeviceRGB();
+    _gray = CGColorSpaceCreateDeviceGray();
+}
+
+- (void)tearDown {
+    CGColorSpaceRelease(_rgb);
+    CGColorSpaceRelease(_gray);
+    [super tearDown];
+}
+
+- (size_t)_bytesPerPixelForDecompressedImage:(UIImage *)image allowsLowPrecision:(BOOL)allowsLowPrecision {
+    UIImage *decompressedImage = [UIImage df_decompressedImage:image scale:1.f allowsLowPrecision:allowsLowPrecision];
+    XCTAssertNotNil(decompressedImage);
+    return CGImageGetBitsPerPixel(decompressedImage.CGImage) / 8;
+}
+
+- (void)testThatImageWithAlphaIsDecompressedIntoPremultipliedBitmap {
+    UIImage *image = TDFImageWithColorSpace(_rgb, kCGImageAlphaPremultipliedLast, CGSizeMake(20, 20));
+    XCTAssertFalse([UIImage df_isOpaqueImage:image]);
+    XCTAssertEqual([self _bytesPerPixelForDecompressedImage:image allowsLowPrecision:YES], 4);
+    UIImage *decompressedImage = [UIImage df_decompressedImage:image scale:1.f];
+    XCTAssertFalse([UIImage df_isOpaqueImage:decompressedImage]);
+}
+
+- (void)testThatOpaqueImageIsDecompressedWithoutAlpha {
+    UIImage *image = TDFImageWithColorSpace(_rgb, kCGImageAlphaNoneSkipLast, CGSizeMake(20, 20));
+    XCTAssertTrue([UIImage df_isOpaqueImage:image]);
+    UIImage *decompressedImage = [UIImage df_decompressedImage:image scale:1.f];
+    XCTAssertTrue([UIImage df_isOpaqueImage:decompressedImage]);
+    XCTAssertEqual([self _bytesPerPixelForDecompressedImage:image allowsLowPrecision:NO], 4);
+}
+
+- (void)testThatOpaqueImageIsDecompressedIntoSixteenBitBitmapWhenLowPrecisionIsAllowed {
+    UIImage *image = TDFImageWithColorSpace(_rgb, kCGImageAlphaNoneSkipLast, CGSizeMake(20, 20));
+    XCTAssertEqual([self _bytesPerPixelForDecompressedImage:image allowsLowPrecision:YES], 2);
+}
+
+- (void)testThatGrayscaleImageIsDecompressedIntoGrayscaleBitmap {
+    UIImage *image = TDFImageWithColorSpace(_gray, kCGImageAlphaNone, CGSizeMake(20, 20));
+    XCTAssertTrue([UIImage df_isGrayscaleImage:image]);
+    XCTAssertEqual([self _bytesPerPixelForDecompressedImage:image allowsLowPrecision:NO], 1);
+    XCTAssertTrue([UIImage df_isGrayscaleImage:[UIImage df_decompressedImage:image scale:1.f]]);
+}
+
+- (void)testThatCompactBitmapsReduceCacheCost {
+    DFImageCache *cache = [[DFImageCache alloc] initWithCache:[NSCache new]];
+    UIImage *image = TDFImageWithColorSpace(_rgb, kCGImageAlphaPremultipliedLast, CGSizeMake(100, 100));
+    UIImage *grayscaleImage = TDFImageWithColorSpace(_gray, kCGImageAlphaNone, CGSizeMake(100, 100));
+    NSUInteger (^cost)(UIImage *) = ^NSUInteger(UIImage *image) {
+        return [cache costForImageResponse:[[DFCachedImageResponse alloc] initWithImage:image info:nil expirationDate:0]];
+    };
+    NSUInteger fullCost = cost([UIImage df_decompressedImage:image scale:1.f]);
+    XCTAssertEqual(fullCost, 100 * 100 * 4);
+    XCTAssertEqual(cost([UIImage df_decompressedImage:grayscaleImage scale:1.f]), fullCost / 4);
+}
+
+- (void)testThatLowPrecisionOptionAffectsProcessingEquivalence {
+    DFImageProcessor *processor = [DFImageProcessor new];
+    NSURL *URL = [NSURL URLWithString:@"http://test.com/image.jpg"];
+    DFMutableImageRequestOptions *builder = [DFMutableImageRequestOptions new];
+    builder.userInfo = @{ DFImageProcessingAllowsLowPrecisionKey : @YES };
+    DFImageRequest *request1 = [DFImageRequest requestWithResource:URL];
+    DFImageRequest *request2 = [DFImageRequest requestWithResource:URL targetSize:DFImageMaximumSize contentMode:DFImageContentModeAspectFill options:builder.options];
+    XCTAssertFalse([processor isProcessingForRequestEquivalent:request1 toRequest:request2]);
+}
+
+- (void)testThatBlurHashIsDecoded {
+    UIImage *image = [UIImage df_imageWithBlurHash:@"LEHV6nWB2yk8pyo0adR*.7kCMdnj" size:CGSizeMake(32.f, 24.f)];
+    XCTAssertNotNil(image);
+    XCTAssertEqual(CGImageGetWidth(image.CGImage), 32);
+    XCTAssertEqual(CGImageGetHeight(image.CGImage), 24);
+    XCTAssertTrue([UIImage df_isOpaqueImage:image]);
+}
+
+- (void)testThatInvalidBlurHashIsRejected {
+    XCTAssertNil([UIImage df_imageWithBlurHash:@"" size:CGSizeMake(32.f, 32.f)]);
+    XCTAssertNil([UIImage df_imageWithBlurHash:@"LEHV6nWB2yk8pyo0adR*.7kCMdn" size:CGSizeMake(32.f, 32.f)]); // Wrong length
+    XCTAssertNil([UIImage df_imageWithBlurHash:@"LEHV6nWB2yk8pyo0adR*.7kCMdn\"" size:CGSizeMake(32.f, 32.f)]); // Invalid character
+}
+
+#pragma mark - Regions
+
+- (void)testThatOnlyRegionIsDrawn {
+    CGContextRef context = CGBitmapContextCreate(NULL, 200, 100, 8, 0, _rgb, kCGImageAlphaNoneSkipLast);
+    CGContextSetRGBFillColor(context, 1.f, 0.f, 0.f, 1.f);
+    CGContextFillRect(context, CGRectMake(0, 0, 100, 100));
+    CGImageRef imageRef = CGBitmapContextCreateImage(context);
+    UIImage *image = [UIImage imageWithCGImage:imageRef];
+    CGImageRelease(imageRef);
+    CGContextRelease(context);
+
+    DFImageRequest *request = [DFImageRequest requestWithResource:@"resource" region:CGRectMake(0.5, 0, 0.5, 1) targetSize:CGSizeMake(50, 50) options:nil];
+    UIImage *processedImage = [[DFImageProcessor new] processedImage:image forRequest:request partial:NO];
+    XCTAssertEqual(CGImageGetWidth(processedImage.CGImage), 50);
+    XCTAssertEqual(CGImageGetHeight(processedImage.CGImage), 50);
+}
+
+- (void)testThatRegionAffectsProcessingEquivalence {
+    DFImageProcessor *processor = [DFImageProcessor new];
+    NSURL *URL = [NSURL URLWithString:@"http://test.com/image.jpg"];
+    DFImageRequest *request1 = [DFImageRequest requestWithResource:URL region:CGRectMake(0, 0, 0.5, 0.5) targetSize:CGSizeMake(256, 256) options:nil];
+    DFImageRequest *request2 = [DFImageRequest requestWithResource:URL region:CGRectMake(0.5, 0, 0.5, 0.5) targetSize:CGSizeMake(256, 256) options:nil];
+    DFImageRequest *request3 = [DFImageRequest requestWithResource:URL region:CGRectMake(0, 0, 0.5, 0.5) targetSize:CGSizeMake(256, 256) options:nil];
+    XCTAssertFalse([processor isProcessingForRequestEquivalent:request1 toRequest:request2]);
+    XCTAssertTrue([processor isProcessingForRequestEquivalent:request1 toRequest:request3]);
+}
+
+#pragma mark - Cancellation
+
+- (void)testThatProcessingIsSkippedWithCancelledToken {
+    UIImage *image = TDFImageWithColorSpace(_rgb, kCGImageAlphaNoneSkipLast, CGSizeMake(200, 200));
+    DFImageRequest *request = [DFImageRequest requestWithResource:@"resource" targetSize:CGSizeMake(50, 50) contentMode:DFImageContentModeAspectFill options:nil];
+    DFImageProcessor *processor = [DFImageProcessor new];
+    DFImageCancellationToken *token = [DFImageCancellationToken new];
+    UIImage *__block processedImage;
+    [token performAsCurrent:^{
+        XCTAssertEqual([DFImageCancellationToken currentToken], token);
+        processedImage = [processor processedImage:image forRequest:request partial:NO];
+    }];
+    XCTAssertNotNil(processedImage);
+    XCTAssertNil([DFImageCancellationToken currentToken]);
+
+    [token cancel];
+    [token performAsCurrent:^{
+        XCTAssertTrue([DFImageCancellationToken isCurrentTokenCancelled]);
+        processedImage = [processor processedImage:image forRequest:request partial:NO];
+    }];
+    XCTAssertNil(processedImage);
+}
+
+@end
@@ -24,4 +24,58 @@
     TDFAssertDefaultOptionsAreValid(request.options);
 }
 
+- (void)testThatRequestsWithoutOptionsShareDefaultOptions {
+    DFImageRequest *request1 = [DFImageRequest requestWithResource:@"Resourse1"];
+    DFImageRequest *request2 = [DFImageRequest requestWithResource:@"Resourse2"];
+    XCTAssertEqual(request1.options, request2.options);
+}
+
+- (void)testThatSharedDefaultOptionsAreUpdatedWhenDefaultsChange {
+    DFMutableImageRequestOptions *defaults = [DFMutableImageRequestOptions defaultOptions];
+    DFImageRequestPriority priority = defaults.priority;
+    defaults.priority = DFImageRequestPriorityHigh;
+    DFImageRequest *request = [DFImageRequest requestWithResource:@"Resourse"];
+    defaults.priority = priority;
+    XCTAssertEqual(request.options.priority, DFImageRequestPriorityHigh);
+    XCTAssertEqual([DFImageRequest requestWithResource:@"Resourse"].options.priority, priority);
+}
+
+- (void)testThatSharedDefaultOptionsAreUpdatedWhenPreviewDefaultsChange {
+    DFMutableImageRequestOptions *defaults = [DFMutableImageRequestOptions defaultOptions];
+    DFImageRequestOptions *options = [DFImageRequest requestWithResource:@"Resourse"].options;
+    defaults.previewBlurHash = @"LEHV6nWB2yk8pyo0adR*.7kCMdnj";
+    DFImageRequest *request = [DFImageRequest requestWithResource:@"Resourse"];
+    defaults.previewBlurHash = nil;
+    XCTAssertNotEqual(request.options, options);
+    XCTAssertEqualObjects(request.options.previewBlurHash, @"LEHV6nWB2yk8pyo0adR*.7kCMdnj");
+    XCTAssertNil([DFImageRequest requestWithResource:@"Resourse"].options.previewBlurHash);
+}
+
+- (void)testThatTileRequestsCoverVisibleRect {
+    // 1000x1000 image, 256x256 tiles at 0.5 scale cover 512x512 pixels of the image each
+    NSArray<DFImageRequest *> *requests = [DFImageRequest tileRequestsWithResource:@"Resource" imageSize:CGSizeMake(1000, 1000) tileSize:CGSizeMake(256, 256) scale:0.5 rect:CGRectMake(0, 0, 1000, 1000) options:nil];
+    XCTAssertEqual(requests.count, 4);
+    XCTAssertTrue(CGRectEqualToRect(requests[0].region, CGRectMake(0, 0, 0.512, 0.512)));
+    XCTAssertTrue(CGSizeEqualToSize(requests[0].targetSize, CGSizeMake(256, 256)));
+    XCTAssertTrue(CGSizeEqualToSize(requests[3].targetSize, CGSizeMake(244, 244)));
+
+    requests = [DFImageRequest tileRequestsWithResource:@"Resource" imageSize:CGSizeMake(1000, 1000) tileSize:CGSizeMake(256, 256) scale:0.5 rect:CGRectMake(600, 0, 100, 100) options:nil];
+    XCTAssertEqual(requests.count, 1);
+    XCTAssertTrue(CGRectIsNull([DFImageRequest requestWithResource:@"Resource"].region));
+}
+
+- (void)testThatTileRequestsKeepAllOptions {
+    DFMutableImageRequestOptions *builder = [DFMutableImageRequestOptions new];
+    builder.allowsPreview = YES;
+    builder.previewResource = @"Preview";
+    builder.previewBlurHash = @"LEHV6nWB2yk8pyo0adR*.7kCMdnj";
+    builder.userInfo = @{ @"key" : @"value" };
+    DFImageRequest *request = [DFImageRequest requestWithResource:@"Resource" region:CGRectMake(0, 0, 0.5, 0.5) targetSize:CGSizeMake(256, 256) options:builder.options];
+    XCTAssertTrue(request.options.allowsPreview);
+    XCTAssertEqualObjects(request.options.previewResource, @"Preview");
+    XCTAssertEqualObjects(request.options.previewBlurHash, @"LEHV6nWB2yk8pyo0adR*.7kCMdnj");
+    XCTAssertEqualObjects(request.options.userInfo[@"key"], @"value");
+    XCTAssertTrue(CGRectEqualToRect(request.region, CGRectMake(0, 0, 0.5, 0.5)));
+}
+
 @end
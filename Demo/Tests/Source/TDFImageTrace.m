@@ -0,0 +1,108 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import "DFImageManagerKit.h"
+#import "TDFTestingKit.h"
+#import <XCTest/XCTest.h>
+
+@interface TDFImageTrace : XCTestCase
+
+@end
+
+@implementation TDFImageTrace {
+    NSURL *_traceURL;
+    DFImageTraceRecorder *_recorder;
+    TDFMockFetcher *_fetcher;
+    DFImageManager *_manager;
+}
+
+- (void)setUp {
+    [super setUp];
+
+    _traceURL = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:[NSUUID UUID].UUIDString]];
+    _recorder = [[DFImageTraceRecorder alloc] initWithFileURL:_traceURL];
+    _fetcher = [TDFMockFetcher new];
+    [_fetcher setResponse:[TDFMockResponse mockWithData:[TDFTesting testImageData]] forResource:@"resource_01"];
+    [_fetcher setResponse:[TDFMockResponse mockWithData:[TDFTesting testImageData2] elapsedTime:0.1] forResource:@"resource_02"];
+    DFImageManagerConfiguration *conf = [DFImageManagerConfiguration configurationWithFetcher:_fetcher processor:[DFImageProcessor new] cache:nil];
+    conf.traceRecorder = _recorder;
+    _manager = [[DFImageManager alloc] initWithConfiguration:conf];
+}
+
+- (void)tearDown {
+    [super tearDown];
+
+    [[NSFileManager defaultManager] removeItemAtURL:_traceURL error:nil];
+}
+
+- (NSData *)_recordTrace {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"request"];
+    DFImageTask *task = [_manager imageTaskForResource:@"resource_01" completion:^(UIImage *image, NSError *error, DFImageResponse *response, DFImageTask *task) {
+        XCTAssertNotNil(image);
+        [expectation fulfill];
+    }];
+    task.priority = DFImageRequestPriorityHigh;
+    [task resume];
+    [_manager startPreheatingImagesForRequests:@[[DFImageRequest requestWithResource:@"resource_02"]]];
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+    [_manager stopPreheatingImagesForAllRequests];
+    [_recorder flush];
+    return [NSData dataWithContentsOfURL:_traceURL];
+}
+
+- (void)testThatRecorderWritesEvents {
+    NSData *data = [self _recordTrace];
+    NSArray<DFImageTraceEvent *> *events = [DFImageTraceEvent eventsWithTraceData:data];
+    XCTAssertNotNil(events);
+    NSArray *types = [events valueForKey:@"type"];
+    XCTAssertEqualObjects(types.firstObject, @(DFImageTraceEventTypeRequest));
+    XCTAssertFalse([types containsObject:@(DFImageTraceEventTypePriority)]);
+    XCTAssertTrue([types containsObject:@(DFImageTraceEventTypeStartPreheating)]);
+    XCTAssertTrue([types containsObject:@(DFImageTraceEventTypeCompletion)]);
+    XCTAssertEqualObjects(types.lastObject, @(DFImageTraceEventTypeStopPreheatingAll));
+
+    NSTimeInterval timestamp = 0.0;
+    DFImageTraceEvent *fetch;
+    for (DFImageTraceEvent *event in events) {
+        XCTAssertTrue(event.timestamp >= timestamp);
+        timestamp = event.timestamp;
+        if (event.type == DFImageTraceEventTypeRequest) {
+            XCTAssertEqualObjects(event.request.resource, @"resource_01");
+            XCTAssertEqual(event.request.options.priority, DFImageRequestPriorityHigh); // Priority of the task is recorded
+        }
+        if (event.type == DFImageTraceEventTypeFetch && [event.request.resource isEqual:@"resource_01"]) {
+            fetch = event;
+        }
+    }
+    XCTAssertNotNil(fetch);
+    XCTAssertEqual(fetch.byteCount, (int64_t)[TDFTesting testImageData].length);
+    XCTAssertTrue(fetch.imageSize.width > 0.f && fetch.imageSize.height > 0.f);
+    XCTAssertFalse(fetch.failed);
+}
+
+- (void)testThatInvalidTraceIsRejected {
+    XCTAssertNil([DFImageTraceEvent eventsWithTraceData:[TDFTesting testImageData]]);
+    XCTAssertNil([[DFImageTraceReplayer alloc] initWithData:[NSData data]]);
+}
+
+- (void)testThatTraceIsReplayed {
+    DFImageTraceReplayer *replayer = [[DFImageTraceReplayer alloc] initWithData:[self _recordTrace]];
+    XCTAssertNotNil(replayer);
+    replayer.speed = 0.0;
+    DFImageManager *manager = [[DFImageManager alloc] initWithConfiguration:[DFImageManagerConfiguration configurationWithFetcher:replayer.fetcher processor:[DFImageProcessor new] cache:[DFImageCache new]]];
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"replay"];
+    [replayer replayWithManager:manager completion:^(DFImageTraceReplayStatistics *statistics) {
+        XCTAssertTrue([NSThread isMainThread]);
+        XCTAssertEqual(statistics.requestCount, 1);
+        XCTAssertEqual(statistics.completedCount, 1);
+        XCTAssertEqual(statistics.failedCount, 0);
+        XCTAssertTrue(statistics.fetchCount >= 1);
+        XCTAssertTrue(statistics.fetchedByteCount >= (int64_t)[TDFTesting testImageData].length);
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+}
+
+@end
@@ -0,0 +1,133 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import "DFImageManagerKit.h"
+#import "TDFTestingKit.h"
+#import <XCTest/XCTest.h>
+
+@interface TDFImageWarmStart : XCTestCase
+
+@end
+
+@implementation TDFImageWarmStart {
+    NSURL *_directoryURL;
+    TDFMockFetcher *_fetcher;
+}
+
+- (void)setUp {
+    [super setUp];
+
+    _directoryURL = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:[NSUUID UUID].UUIDString] isDirectory:YES];
+    _fetcher = [TDFMockFetcher new];
+    for (NSInteger i = 0; i < 10; i++) {
+        // Simulates the network latency
+        [_fetcher setResponse:[TDFMockResponse mockWithData:[TDFTesting testImageData] elapsedTime:0.05] forResource:[NSString stringWithFormat:@"resource_%02li", (long)i]];
+    }
+}
+
+- (void)tearDown {
+    [super tearDown];
+
+    [[NSFileManager defaultManager] removeItemAtURL:_directoryURL error:nil];
+}
+
+- (DFImageManager *)_createManagerWithCountLimit:(NSUInteger)countLimit {
+    DFImageManagerConfiguration *conf = [DFImageManagerConfiguration configurationWithFetcher:_fetcher processor:[DFImageProcessor new] cache:[DFImageCache new]];
+    conf.warmStartDirectoryURL = _directoryURL;
+    conf.warmStartImageCountLimit = countLimit;
+    return [[DFImageManager alloc] initWithConfiguration:conf];
+}
+
+- (void)_loadResources:(NSArray<NSString *> *)resources withManager:(DFImageManager *)manager {
+    for (NSString *resource in resources) {
+        XCTestExpectation *expectation = [self expectationWithDescription:resource];
+        [[manager imageTaskForResource:resource completion:^(UIImage *image, NSError *error, DFImageResponse *response, DFImageTask *task) {
+            XCTAssertNotNil(image);
+            [expectation fulfill];
+        }] resume];
+    }
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+}
+
+- (void)_writeSnapshotWithManager:(DFImageManager *)manager {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"write"];
+    [manager writeWarmStartSnapshotWithCompletion:^(BOOL success) {
+        XCTAssertTrue(success);
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+}
+
+/*! Returns the manager after the snapshot was loaded into its memory cache.
+ */
+- (DFImageManager *)_createWarmManagerWithCountLimit:(NSUInteger)countLimit {
+    DFImageManager *manager = [self _createManagerWithCountLimit:countLimit];
+    XCTestExpectation *expectation = [self expectationWithDescription:@"load"];
+    [manager loadWarmStartSnapshotWithCompletion:^(NSUInteger imageCount) {
+        [expectation fulfill]; // The load started on creation finishes first, the warm start queue is serial
+    }];
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+    return manager;
+}
+
+- (BOOL)_isResourceCached:(NSString *)resource manager:(DFImageManager *)manager {
+    BOOL __block isFastResponse = NO;
+    XCTestExpectation *expectation = [self expectationWithDescription:resource];
+    [[manager imageTaskForResource:resource completion:^(UIImage *image, NSError *error, DFImageResponse *response, DFImageTask *task) {
+        XCTAssertNotNil(image);
+        isFastResponse = response.isFastResponse;
+        [expectation fulfill];
+    }] resume];
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+    return isFastResponse;
+}
+
+- (void)testThatSnapshotIsRestoredIntoMemoryCache {
+    DFImageManager *manager = [self _createManagerWithCountLimit:10];
+    [self _loadResources:@[@"resource_00", @"resource_01"] withManager:manager];
+    [self _writeSnapshotWithManager:manager];
+
+    DFImageManager *warmManager = [self _createWarmManagerWithCountLimit:10];
+    XCTAssertTrue([self _isResourceCached:@"resource_00" manager:warmManager]);
+    XCTAssertTrue([self _isResourceCached:@"resource_01" manager:warmManager]);
+    XCTAssertFalse([self _isResourceCached:@"resource_02" manager:warmManager]);
+}
+
+- (void)testThatSnapshotKeepsMostFrequentlyUsedImages {
+    DFImageManager *manager = [self _createManagerWithCountLimit:1];
+    [self _loadResources:@[@"resource_00", @"resource_01"] withManager:manager];
+    [self _loadResources:@[@"resource_01"] withManager:manager];
+    [self _writeSnapshotWithManager:manager];
+
+    DFImageManager *warmManager = [self _createWarmManagerWithCountLimit:1];
+    XCTAssertTrue([self _isResourceCached:@"resource_01" manager:warmManager]);
+    XCTAssertFalse([self _isResourceCached:@"resource_00" manager:warmManager]);
+}
+
+- (void)testThatMissingSnapshotIsIgnored {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"load"];
+    [[self _createManagerWithCountLimit:10] loadWarmStartSnapshotWithCompletion:^(NSUInteger imageCount) {
+        XCTAssertEqual(imageCount, 0);
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+}
+
+/*! Measures the time it takes to display the first screen of images after the launch when the warm start snapshot is available.
+ */
+- (void)testPerformanceOfFirstScreenWithWarmStart {
+    NSMutableArray *resources = [NSMutableArray new];
+    for (NSInteger i = 0; i < 10; i++) {
+        [resources addObject:[NSString stringWithFormat:@"resource_%02li", (long)i]];
+    }
+    DFImageManager *manager = [self _createManagerWithCountLimit:10];
+    [self _loadResources:resources withManager:manager];
+    [self _writeSnapshotWithManager:manager];
+
+    [self measureBlock:^{
+        [self _loadResources:resources withManager:[self _createWarmManagerWithCountLimit:10]];
+    }];
+}
+
+@end
@@ -21,4 +21,8 @@
 
 @property (nonatomic) NSTimeInterval processingTime;
 
+/*! Called on the processing queue each time the image is processed.
+ */
+@property (nonatomic, copy) void (^processingHandler)(DFImageRequest *request);
+
 @end
@@ -29,6 +29,10 @@ static char *_imageProcessedKey;
 
 - (UIImage *)processedImage:(UIImage *)image forRequest:(DFImageRequest *)request partial:(BOOL)partial {
     objc_setAssociatedObject(image, &_imageProcessedKey, @YES, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    void (^processingHandler)(DFImageRequest *) = self.processingHandler;
+    if (processingHandler) {
+        processingHandler(request);
+    }
     return image;
 }
 
@@ -23,6 +23,10 @@ TDFSystemVersionGreaterThanOrEqualTo(NSString *version) {
 + (UIImage *)testImage2;
 + (NSData *)testImageData2;
 
+/*! Returns the JPEG data of the image with a given size that has an embedded EXIF thumbnail.
+ */
++ (NSData *)testJPEGDataWithEmbeddedThumbnailWithSize:(CGSize)size;
+
 + (void)stubRequestWithURL:(NSURL *)imageURL;
 
 @end
@@ -7,6 +7,8 @@
 //
 
 #import "TDFTesting.h"
+#import <ImageIO/ImageIO.h>
+#import <MobileCoreServices/MobileCoreServices.h>
 #import <OHHTTPStubs.h>
 
 @implementation TDFTesting
@@ -37,6 +39,20 @@
     return [NSData dataWithContentsOfURL:[self _testImageURLForName:@"Image2"]];
 }
 
++ (NSData *)testJPEGDataWithEmbeddedThumbnailWithSize:(CGSize)size {
+    UIGraphicsBeginImageContextWithOptions(size, YES, 1.0);
+    [[UIColor orangeColor] setFill];
+    UIRectFill((CGRect){CGPointZero, size});
+    UIImage *image = UIGraphicsGetImageFromCurrentImageContext();
+    UIGraphicsEndImageContext();
+    NSMutableData *data = [NSMutableData new];
+    CGImageDestinationRef destination = CGImageDestinationCreateWithData((__bridge CFMutableDataRef)data, kUTTypeJPEG, 1, NULL);
+    CGImageDestinationAddImage(destination, image.CGImage, (__bridge CFDictionaryRef)@{ (id)kCGImageDestinationEmbedThumbnail : @YES });
+    CGImageDestinationFinalize(destination);
+    CFRelease(destination);
+    return data;
+}
+
 + (void)stubRequestWithURL:(NSURL *)imageURL {
     UIImage *testImage = [TDFTesting testImage];
     NSData *data = UIImageJPEGRepresentation(testImage, 1.0);
@@ -124,4 +124,183 @@
     [self waitForExpectationsWithTimeout:3.0 handler:nil];
 }
 
+#pragma mark - Resumable Downloads
+
+- (void)testThatInterruptedFetchIsResumedWithRangeRequest {
+    NSData *imageData = [TDFTesting testImageData];
+    NSUInteger partialLength = imageData.length / 2;
+    NSURL *URL = [NSURL URLWithString:@"http://test.com/image.jpg"];
+    [_fetcher.partialDataStore storePartialData:[[DFURLPartialData alloc] initWithData:[imageData subdataWithRange:NSMakeRange(0, partialLength)] validator:@"\"etag\""] forURL:URL];
+    
+    [OHHTTPStubs stubRequestsPassingTest:^BOOL(NSURLRequest *request) {
+        return [request.URL isEqual:URL];
+    } withStubResponse:^OHHTTPStubsResponse *(NSURLRequest *request) {
+        XCTAssertEqualObjects([request valueForHTTPHeaderField:@"Range"], ([NSString stringWithFormat:@"bytes=%lu-", (unsigned long)partialLength]));
+        XCTAssertEqualObjects([request valueForHTTPHeaderField:@"If-Range"], @"\"etag\"");
+        NSDictionary *headers = @{ @"ETag" : @"\"etag\"",
+                                   @"Content-Range" : [NSString stringWithFormat:@"bytes %lu-%lu/%lu", (unsigned long)partialLength, (unsigned long)imageData.length - 1, (unsigned long)imageData.length] };
+        return [OHHTTPStubsResponse responseWithData:[imageData subdataWithRange:NSMakeRange(partialLength, imageData.length - partialLength)] statusCode:206 headers:headers];
+    }];
+    
+    XCTestExpectation *expectation = [self expectationWithDescription:@"fetch_completed"];
+    [_fetcher startOperationWithRequest:[DFImageRequest requestWithResource:URL] progressHandler:nil completion:^(NSData *__nullable data, NSDictionary *__nullable info, NSError *__nullable error) {
+        XCTAssertNil(error);
+        XCTAssertEqualObjects(data, imageData);
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+    XCTAssertNil([_fetcher.partialDataStore partialDataForURL:URL]);
+}
+
+- (void)testThatPartialDataIsDiscardedWhenResourceChanged {
+    NSData *imageData = [TDFTesting testImageData];
+    NSURL *URL = [NSURL URLWithString:@"http://test.com/image.jpg"];
+    [_fetcher.partialDataStore storePartialData:[[DFURLPartialData alloc] initWithData:[imageData subdataWithRange:NSMakeRange(0, 100)] validator:@"\"old\""] forURL:URL];
+    
+    [OHHTTPStubs stubRequestsPassingTest:^BOOL(NSURLRequest *request) {
+        return [request.URL isEqual:URL];
+    } withStubResponse:^OHHTTPStubsResponse *(NSURLRequest *request) {
+        // If-Range doesn't match, server responds with the entire resource
+        return [OHHTTPStubsResponse responseWithData:imageData statusCode:200 headers:@{ @"ETag" : @"\"new\"", @"Accept-Ranges" : @"bytes" }];
+    }];
+    
+    XCTestExpectation *expectation = [self expectationWithDescription:@"fetch_completed"];
+    [_fetcher startOperationWithRequest:[DFImageRequest requestWithResource:URL] progressHandler:nil completion:^(NSData *__nullable data, NSDictionary *__nullable info, NSError *__nullable error) {
+        XCTAssertEqualObjects(data, imageData);
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+}
+
+- (void)testThatFetchIsRestartedWhenContentRangeDoesntMatch {
+    NSData *imageData = [TDFTesting testImageData];
+    NSURL *URL = [NSURL URLWithString:@"http://test.com/image.jpg"];
+    [_fetcher.partialDataStore storePartialData:[[DFURLPartialData alloc] initWithData:[imageData subdataWithRange:NSMakeRange(0, 100)] validator:@"\"etag\""] forURL:URL];
+    
+    NSUInteger __block requestCount = 0;
+    [OHHTTPStubs stubRequestsPassingTest:^BOOL(NSURLRequest *request) {
+        return [request.URL isEqual:URL];
+    } withStubResponse:^OHHTTPStubsResponse *(NSURLRequest *request) {
+        requestCount++;
+        if ([request valueForHTTPHeaderField:@"Range"]) {
+            // Server responds with the range that wasn't requested
+            NSDictionary *headers = @{ @"ETag" : @"\"etag\"", @"Content-Range" : [NSString stringWithFormat:@"bytes 0-99/%lu", (unsigned long)imageData.length] };
+            return [OHHTTPStubsResponse responseWithData:[imageData subdataWithRange:NSMakeRange(0, 100)] statusCode:206 headers:headers];
+        }
+        return [OHHTTPStubsResponse responseWithData:imageData statusCode:200 headers:@{ @"ETag" : @"\"etag\"" }];
+    }];
+    
+    XCTestExpectation *expectation = [self expectationWithDescription:@"fetch_completed"];
+    [_fetcher startOperationWithRequest:[DFImageRequest requestWithResource:URL] progressHandler:nil completion:^(NSData *__nullable data, NSDictionary *__nullable info, NSError *__nullable error) {
+        XCTAssertNil(error);
+        XCTAssertEqualObjects(data, imageData);
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+    XCTAssertEqual(requestCount, 2);
+    XCTAssertNil([_fetcher.partialDataStore partialDataForURL:URL]);
+}
+
+- (void)testThatPartialDataIsStoredWhenFetchIsCancelled {
+    NSData *imageData = [TDFTesting testImageData];
+    NSURL *URL = [NSURL URLWithString:@"http://test.com/image.jpg"];
+    [OHHTTPStubs stubRequestsPassingTest:^BOOL(NSURLRequest *request) {
+        return [request.URL isEqual:URL];
+    } withStubResponse:^OHHTTPStubsResponse *(NSURLRequest *request) {
+        return [[OHHTTPStubsResponse responseWithData:imageData statusCode:200 headers:@{ @"ETag" : @"\"etag\"", @"Accept-Ranges" : @"bytes" }] requestTime:0.0 responseTime:2.0];
+    }];
+    
+    XCTestExpectation *expectation = [self expectationWithDescription:@"fetch_cancelled"];
+    id<DFImageFetchingOperation> __block operation;
+    operation = [_fetcher startOperationWithRequest:[DFImageRequest requestWithResource:URL] progressHandler:^(NSData *__nullable data, int64_t completedUnitCount, int64_t totalUnitCount) {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [operation cancelImageFetching];
+        });
+    } completion:^(NSData *__nullable data, NSDictionary *__nullable info, NSError *__nullable error) {
+        XCTAssertNotNil(error);
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:3.0 handler:nil];
+    
+    DFURLPartialData *partialData = [_fetcher.partialDataStore partialDataForURL:URL];
+    XCTAssertNotNil(partialData);
+    XCTAssertEqualObjects(partialData.validator, @"\"etag\"");
+    XCTAssertTrue(partialData.data.length > 0 && partialData.data.length < imageData.length);
+    XCTAssertEqualObjects(partialData.data, [imageData subdataWithRange:NSMakeRange(0, partialData.data.length)]);
+}
+
+- (void)testThatPartialDataStoreRespectsCostLimit {
+    DFURLPartialDataStore *store = [DFURLPartialDataStore new];
+    store.totalCostLimit = 150;
+    NSMutableData *data = [NSMutableData dataWithLength:100];
+    [store storePartialData:[[DFURLPartialData alloc] initWithData:data validator:@"1"] forURL:[NSURL URLWithString:@"http://test.com/1"]];
+    [store storePartialData:[[DFURLPartialData alloc] initWithData:data validator:@"2"] forURL:[NSURL URLWithString:@"http://test.com/2"]];
+    XCTAssertNil([store partialDataForURL:[NSURL URLWithString:@"http://test.com/1"]]);
+    XCTAssertNotNil([store partialDataForURL:[NSURL URLWithString:@"http://test.com/2"]]);
+    XCTAssertEqual(store.totalCost, 100);
+}
+
+#pragma mark - Early Validation
+
+- (void)_fetchURL:(NSURL *)URL options:(DFImageRequestOptions *)options completion:(void (^)(NSData *data, NSError *error))completion {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"fetch_completed"];
+    DFImageRequest *request = [DFImageRequest requestWithResource:URL targetSize:DFImageMaximumSize contentMode:DFImageContentModeAspectFill options:options];
+    [_fetcher startOperationWithRequest:request progressHandler:nil completion:^(NSData *__nullable data, NSDictionary *__nullable info, NSError *__nullable error) {
+        completion(data, error);
+        [expectation fulfill];
+    }];
+    // The body takes longer to download than the timeout, the fetch only succeeds if it's cancelled early
+    [self waitForExpectationsWithTimeout:1.5 handler:nil];
+}
+
+- (void)testThatErrorResponseIsCancelledBeforeBodyIsDownloaded {
+    [OHHTTPStubs stubRequestsPassingTest:^BOOL(NSURLRequest *request) {
+        return YES;
+    } withStubResponse:^OHHTTPStubsResponse *(NSURLRequest *request) {
+        return [[OHHTTPStubsResponse responseWithData:[NSMutableData dataWithLength:1024 * 1024] statusCode:404 headers:nil] requestTime:0.0 responseTime:3.0];
+    }];
+    [self _fetchURL:[NSURL URLWithString:@"http://test.com/missing.jpg"] options:nil completion:^(NSData *data, NSError *error) {
+        XCTAssertNil(data);
+        XCTAssertEqualObjects(error.domain, DFURLValidationErrorDomain);
+        XCTAssertEqual(error.code, NSURLErrorBadServerResponse);
+    }];
+}
+
+- (void)testThatHTMLResponseIsCancelledBeforeBodyIsDownloaded {
+    [OHHTTPStubs stubRequestsPassingTest:^BOOL(NSURLRequest *request) {
+        return YES;
+    } withStubResponse:^OHHTTPStubsResponse *(NSURLRequest *request) {
+        return [[OHHTTPStubsResponse responseWithData:[NSMutableData dataWithLength:1024 * 1024] statusCode:200 headers:@{ @"Content-Type" : @"text/html; charset=utf-8" }] requestTime:0.0 responseTime:3.0];
+    }];
+    [self _fetchURL:[NSURL URLWithString:@"http://test.com/image.jpg"] options:nil completion:^(NSData *data, NSError *error) {
+        XCTAssertNil(data);
+        XCTAssertEqualObjects(error.domain, DFURLValidationErrorDomain);
+        XCTAssertEqual(error.code, NSURLErrorCannotDecodeContentData);
+    }];
+}
+
+- (void)testThatFetchIsCancelledWhenMaximumByteCountIsExceeded {
+    [OHHTTPStubs stubRequestsPassingTest:^BOOL(NSURLRequest *request) {
+        return YES;
+    } withStubResponse:^OHHTTPStubsResponse *(NSURLRequest *request) {
+        return [[OHHTTPStubsResponse responseWithData:[NSMutableData dataWithLength:1024 * 1024] statusCode:200 headers:nil] requestTime:0.0 responseTime:3.0];
+    }];
+    DFMutableImageRequestOptions *options = [DFMutableImageRequestOptions new];
+    options.userInfo = @{ DFURLMaximumByteCountKey : @(1024) };
+    [self _fetchURL:[NSURL URLWithString:@"http://test.com/large.jpg"] options:options.options completion:^(NSData *data, NSError *error) {
+        XCTAssertNil(data);
+        XCTAssertEqualObjects(error.domain, DFURLValidationErrorDomain);
+        XCTAssertEqual(error.code, NSURLErrorDataLengthExceedsMaximum);
+    }];
+}
+
+- (void)testThatRequestsWithDifferentMaximumByteCountsAreNotFetchEquivalent {
+    NSURL *URL = [NSURL URLWithString:@"http://test.com/image.jpg"];
+    DFMutableImageRequestOptions *options = [DFMutableImageRequestOptions new];
+    options.userInfo = @{ DFURLMaximumByteCountKey : @(1024) };
+    DFImageRequest *request1 = [DFImageRequest requestWithResource:URL targetSize:DFImageMaximumSize contentMode:DFImageContentModeAspectFill options:options.options];
+    DFImageRequest *request2 = [DFImageRequest requestWithResource:URL];
+    XCTAssertFalse([_fetcher isRequestFetchEquivalent:request1 toRequest:request2]);
+}
+
 @end
@@ -12,6 +12,7 @@
 extern NSString *__nonnull const DFAFRequestCachePolicyKey;
 
 @class DFAFImageFetcher;
+@class DFDiskCache;
 
 /*! The DFAFImageFetcherDelegate protocol describes the methods that DFAFImageFetcher objects call on their delegates to customize its behaviour.
  */
@@ -42,6 +43,10 @@ extern NSString *__nonnull const DFAFRequestCachePolicyKey;
  */
 @property (nullable, nonatomic, weak) id<DFAFImageFetcherDelegate> delegate;
 
+/*! The disk cache for fetched data. When the cache contains fresh data for the request (see Cache-Control and Expires header fields) the data is read from the disk without touching the URL loading system. The stale data is revalidated with a conditional request, and is returned if the server responds with 304 Not Modified. Successfully fetched HTTP responses are stored in the cache unless they have Cache-Control: no-store. Default value is nil.
+ */
+@property (nullable, nonatomic) DFDiskCache *diskCache;
+
 /*! A set containing all the supported URL schemes. The default set contains "http", "https", "ftp", "file" and "data" schemes.
  @note The property can be changed in case there are any custom protocols supported by NSURLSession.
  */
@@ -3,6 +3,8 @@
 // Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
 
 #import "DFAFImageFetcher.h"
+#import "DFDiskCache.h"
+#import "DFDiskCacheFetchOperation.h"
 #import "DFImageFetchingOperation.h"
 #import "DFImageManagerDefines.h"
 #import "DFImageRequest.h"
@@ -111,6 +113,18 @@ DF_INIT_UNAVAILABLE_IMPL
 
 - (id<DFImageFetchingOperation>)startOperationWithRequest:(DFImageRequest *)request progressHandler:(DFImageFetchingProgressHandler)progressHandler completion:(DFImageFetchingCompletionHandler)completion {
     NSURLRequest *URLRequest = [self _URLRequestForImageRequest:request];
+    DFDiskCache *diskCache = self.diskCache;
+    NSString *cacheKey = DFDiskCacheKeyForURLRequest(URLRequest);
+    if (diskCache && cacheKey && DFDiskCacheCanReturnDataForURLRequest(URLRequest) && [diskCache containsDataForKey:cacheKey]) {
+        typeof(self) __weak weakSelf = self;
+        return [DFDiskCacheFetchOperation startOperationWithDiskCache:diskCache key:cacheKey requiresFreshData:DFDiskCacheRequiresFreshDataForURLRequest(URLRequest) progressHandler:progressHandler completion:completion fallback:^id<DFImageFetchingOperation>(NSDictionary *staleInfo, DFImageFetchingCompletionHandler fallbackCompletion) {
+            return [weakSelf _startOperationWithURLRequest:DFDiskCacheConditionalURLRequest(URLRequest, staleInfo) progressHandler:progressHandler completion:fallbackCompletion];
+        }];
+    }
+    return [self _startOperationWithURLRequest:URLRequest progressHandler:progressHandler completion:completion];
+}
+
+- (nonnull id<DFImageFetchingOperation>)_startOperationWithURLRequest:(nonnull NSURLRequest *)URLRequest progressHandler:(DFImageFetchingProgressHandler)progressHandler completion:(DFImageFetchingCompletionHandler)completion {
     typeof(self) __weak weakSelf = self;
     NSURLSessionDataTask *__block task = [self.sessionManager dataTaskWithRequest:URLRequest completionHandler:^(NSURLResponse *URLResponse, NSData *result, NSError *error) {
         DFAFImageFetcher *strongSelf = weakSelf;
@@ -118,8 +132,17 @@ DF_INIT_UNAVAILABLE_IMPL
             @synchronized(strongSelf) {
                 [strongSelf->_dataTaskDelegates removeObjectForKey:task];
             }
+            NSString *cacheKey = DFDiskCacheKeyForURLRequest(URLRequest);
+            NSDictionary *info = DFImageInfoForURLResponse(URLResponse);
+            if ([URLResponse isKindOfClass:[NSHTTPURLResponse class]] && ((NSHTTPURLResponse *)URLResponse).statusCode == 304) {
+                result = nil; // The revalidated data hasn't changed
+                error = [NSError errorWithDomain:DFImageManagerErrorDomain code:DFImageManagerErrorNotModified userInfo:nil];
+            }
+            if (result.length && !error && cacheKey && DFDiskCacheCanStoreResponse(URLResponse)) {
+                [strongSelf.diskCache storeData:result info:DFDiskCacheInfoForStoring(info) forKey:cacheKey];
+            }
             if (completion) {
-                completion(result, nil, error);
+                completion(result, info, error);
             }
         }
     }];
@@ -140,6 +163,7 @@ DF_INIT_UNAVAILABLE_IMPL
 
 - (void)removeAllCachedImages {
     [_sessionManager.session.configuration.URLCache removeAllCachedResponses];
+    [_diskCache removeAllData];
 }
 
 - (void)invalidate {
@@ -21,6 +21,10 @@
  */
 @property (nonatomic, readonly) NSTimeInterval expirationDate;
 
+/*! Returns YES if the expiration date of the receiver has passed.
+ */
+@property (nonatomic, readonly, getter=isExpired) BOOL expired;
+
 /*! Initializes the DFCachedImageResponse with the given image, info and expiration date.
  */
 - (nullable instancetype)initWithImage:(nonnull UIImage *)image info:( nullable NSDictionary *)info expirationDate:(NSTimeInterval)expirationDate NS_DESIGNATED_INITIALIZER;
@@ -18,4 +18,8 @@ DF_INIT_UNAVAILABLE_IMPL
     return self;
 }
 
+- (BOOL)isExpired {
+    return _expirationDate <= CFAbsoluteTimeGetCurrent();
+}
+
 @end
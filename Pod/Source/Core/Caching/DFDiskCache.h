@@ -0,0 +1,75 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*! Disk cache for raw image data. Used by DFURLImageFetcher and DFAFImageFetcher instead of NSURLCache.
+ @note Each entry is stored in a separate file. File names are SHA1 hashes of the keys, files are sharded into 256 subdirectories based on the first byte of the hash.
+ @note The cache keeps an in-memory index of the stored entries (sizes and access dates) which is loaded in background when the cache is initialized. Existence checks don't touch the file system.
+ @note Writes are performed asynchronously (write-behind), data that is not yet written is served from memory. When the total size of the entries exceeds the capacity the least recently used entries are removed in background.
+ @note Thread safe.
+ */
+@interface DFDiskCache : NSObject
+
+/*! The path of the cache directory.
+ */
+@property (nonatomic, readonly) NSString *path;
+
+/*! The maximum total size of the cache in bytes.
+ */
+@property (nonatomic) NSUInteger capacity;
+
+/*! Returns the total size of the stored entries in bytes.
+ */
+@property (nonatomic, readonly) NSUInteger totalSize;
+
+/*! Initializes the cache with a given directory path and capacity in bytes.
+ */
+- (instancetype)initWithPath:(NSString *)path capacity:(NSUInteger)capacity NS_DESIGNATED_INITIALIZER;
+
+/*! Initializes the cache with a directory with a given name inside the caches directory.
+ */
+- (instancetype)initWithName:(NSString *)name capacity:(NSUInteger)capacity;
+
+/*! Unavailable initializer, please use designated initializer.
+ */
+- (nullable instancetype)init NS_UNAVAILABLE;
+
+/*! Returns YES if the cache contains data for a given key. Doesn't access the file system.
+ */
+- (BOOL)containsDataForKey:(NSString *)key;
+
+/*! Returns data for a given key. Reads data from the file system, should not be called on the main thread.
+ */
+- (nullable NSData *)dataForKey:(NSString *)key;
+
+/*! Returns data and the info that was stored along with it for a given key. Reads data from the file system, should not be called on the main thread.
+ */
+- (nullable NSData *)dataForKey:(NSString *)key info:(NSDictionary *__nullable *__nullable)info;
+
+/*! Stores data for a given key. The data is written to the file system asynchronously.
+ */
+- (void)storeData:(NSData *)data forKey:(NSString *)key;
+
+/*! Stores data along with the info (e.g. the validator of the response) for a given key. The info must be a property list. The data is written to the file system asynchronously.
+ */
+- (void)storeData:(NSData *)data info:(nullable NSDictionary *)info forKey:(NSString *)key;
+
+/*! Removes data for a given key.
+ */
+- (void)removeDataForKey:(NSString *)key;
+
+/*! Removes all data.
+ */
+- (void)removeAllData;
+
+/*! Removes the least recently used entries until the total size of the cache is less than the capacity. Trimming is performed in background. The cache calls this method automatically when new entries are stored.
+ */
+- (void)trim;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,335 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import "DFDiskCache.h"
+#import "DFImageManagerDefines.h"
+#import <CommonCrypto/CommonDigest.h>
+
+/*! The proportion of the capacity that the cache is trimmed to, leaves some room for the new entries.
+ */
+static const double _kDFDiskCacheTrimRatio = 0.9;
+
+/*! The minimum interval between the updates of the file modification dates that are used to restore the access order.
+ */
+static const NSTimeInterval _kDFDiskCacheAccessDateUpdateInterval = 60.0;
+
+static NSString *_DFDiskCacheFilename(NSString *key) {
+    const char *string = key.UTF8String;
+    unsigned char digest[CC_SHA1_DIGEST_LENGTH];
+    CC_SHA1(string, (CC_LONG)strlen(string), digest);
+    NSMutableString *filename = [NSMutableString stringWithCapacity:CC_SHA1_DIGEST_LENGTH * 2];
+    for (NSUInteger i = 0; i < CC_SHA1_DIGEST_LENGTH; i++) {
+        [filename appendFormat:@"%02x", digest[i]];
+    }
+    return filename;
+}
+
+
+@interface _DFDiskCacheEntry : NSObject
+
+@property (nonatomic) NSUInteger size;
+@property (nonatomic) CFAbsoluteTime accessDate;
+
+@end
+
+@implementation _DFDiskCacheEntry
+
+@end
+
+
+@implementation DFDiskCache {
+    NSMutableDictionary /* filename : _DFDiskCacheEntry */ *_index;
+    NSMutableDictionary /* filename : NSData */ *_pendingWrites;
+    NSMutableDictionary /* filename : NSDictionary */ *_pendingInfos;
+    NSUInteger _totalSize;
+    BOOL _indexLoaded;
+    NSMutableSet /* filename */ *_removedWhileLoadingIndex; // Files enumerated by the index loader might already be removed
+    BOOL _removedAllWhileLoadingIndex;
+    BOOL _trimScheduled;
+    dispatch_queue_t _queue;
+    NSLock *_lock;
+}
+
+DF_INIT_UNAVAILABLE_IMPL
+
+- (instancetype)initWithPath:(NSString *)path capacity:(NSUInteger)capacity {
+    NSParameterAssert(path);
+    if (self = [super init]) {
+        _path = [path copy];
+        _capacity = capacity;
+        _index = [NSMutableDictionary new];
+        _pendingWrites = [NSMutableDictionary new];
+        _pendingInfos = [NSMutableDictionary new];
+        _removedWhileLoadingIndex = [NSMutableSet new];
+        _queue = dispatch_queue_create("DFDiskCache::queue", DISPATCH_QUEUE_SERIAL);
+        _lock = [NSLock new];
+        dispatch_async(_queue, ^{
+            [self _loadIndex];
+        });
+    }
+    return self;
+}
+
+- (instancetype)initWithName:(NSString *)name capacity:(NSUInteger)capacity {
+    NSString *cachesPath = NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES).firstObject;
+    return [self initWithPath:[cachesPath stringByAppendingPathComponent:name] capacity:capacity];
+}
+
+- (void)setCapacity:(NSUInteger)capacity {
+    [_lock lock];
+    _capacity = capacity;
+    [_lock unlock];
+    [self trim];
+}
+
+- (NSUInteger)totalSize {
+    [_lock lock];
+    NSUInteger totalSize = _totalSize;
+    [_lock unlock];
+    return totalSize;
+}
+
+#pragma mark Accessing Data
+
+- (BOOL)containsDataForKey:(NSString *)key {
+    if (!key) {
+        return NO;
+    }
+    NSString *filename = _DFDiskCacheFilename(key);
+    [_lock lock];
+    BOOL contains = _index[filename] != nil;
+    [_lock unlock];
+    return contains;
+}
+
+- (nullable NSData *)dataForKey:(NSString *)key {
+    return [self dataForKey:key info:NULL];
+}
+
+- (nullable NSData *)dataForKey:(NSString *)key info:(NSDictionary *__nullable *__nullable)info {
+    if (!key) {
+        return nil;
+    }
+    NSString *filename = _DFDiskCacheFilename(key);
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    [_lock lock];
+    NSData *data = _pendingWrites[filename];
+    NSDictionary *pendingInfo = _pendingInfos[filename];
+    _DFDiskCacheEntry *entry = _index[filename];
+    BOOL indexLoaded = _indexLoaded;
+    BOOL updatesAccessDate = entry && (now - entry.accessDate > _kDFDiskCacheAccessDateUpdateInterval);
+    entry.accessDate = now;
+    [_lock unlock];
+    if (data) {
+        if (info) {
+            *info = pendingInfo;
+        }
+        return data;
+    }
+    if (!entry && indexLoaded) {
+        return nil;
+    }
+    NSString *path = [self _pathForFilename:filename];
+    data = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedIfSafe error:nil];
+    [_lock lock];
+    if (!data && entry && _index[filename] == entry) { // File was removed externally
+        [self _removeEntryForFilename:filename];
+    } else if (data && !_index[filename]) { // Index is not loaded yet
+        [self _addEntryForFilename:filename size:data.length accessDate:now];
+    }
+    [_lock unlock];
+    if (data && info) {
+        NSData *infoData = [NSData dataWithContentsOfFile:[self _infoPathForFilename:filename]];
+        NSDictionary *storedInfo = infoData ? [NSPropertyListSerialization propertyListWithData:infoData options:NSPropertyListImmutable format:nil error:nil] : nil;
+        *info = [storedInfo isKindOfClass:[NSDictionary class]] ? storedInfo : nil;
+    }
+    if (data && updatesAccessDate) {
+        dispatch_async(_queue, ^{
+            [[NSFileManager defaultManager] setAttributes:@{ NSFileModificationDate : [NSDate dateWithTimeIntervalSinceReferenceDate:now] } ofItemAtPath:path error:nil];
+        });
+    }
+    return data;
+}
+
+- (void)storeData:(NSData *)data forKey:(NSString *)key {
+    [self storeData:data info:nil forKey:key];
+}
+
+- (void)storeData:(NSData *)data info:(nullable NSDictionary *)info forKey:(NSString *)key {
+    if (!data || !key) {
+        return;
+    }
+    data = [data copy];
+    info = [info copy];
+    NSString *filename = _DFDiskCacheFilename(key);
+    [_lock lock];
+    _pendingWrites[filename] = data;
+    _pendingInfos[filename] = info;
+    [self _removeEntryForFilename:filename];
+    [self _addEntryForFilename:filename size:data.length accessDate:CFAbsoluteTimeGetCurrent()];
+    [_lock unlock];
+    dispatch_async(_queue, ^{
+        NSString *path = [self _pathForFilename:filename];
+        [[NSFileManager defaultManager] createDirectoryAtPath:[path stringByDeletingLastPathComponent] withIntermediateDirectories:YES attributes:nil error:nil];
+        // The info is written first, so that the data is never read with the info of the previous entry
+        NSData *infoData = info ? [NSPropertyListSerialization dataWithPropertyList:info format:NSPropertyListBinaryFormat_v1_0 options:0 error:nil] : nil;
+        if (infoData) {
+            [infoData writeToFile:[self _infoPathForFilename:filename] atomically:YES];
+        } else {
+            [[NSFileManager defaultManager] removeItemAtPath:[self _infoPathForFilename:filename] error:nil];
+        }
+        [data writeToFile:path atomically:YES];
+        [_lock lock];
+        if (_pendingWrites[filename] == data) {
+            [_pendingWrites removeObjectForKey:filename];
+            [_pendingInfos removeObjectForKey:filename];
+        }
+        [_lock unlock];
+    });
+    [self trim];
+}
+
+- (void)removeDataForKey:(NSString *)key {
+    if (!key) {
+        return;
+    }
+    NSString *filename = _DFDiskCacheFilename(key);
+    [_lock lock];
+    [_pendingWrites removeObjectForKey:filename];
+    [_pendingInfos removeObjectForKey:filename];
+    [self _removeEntryForFilename:filename];
+    [_lock unlock];
+    dispatch_async(_queue, ^{
+        [self _removeFilesForFilename:filename];
+    });
+}
+
+- (void)removeAllData {
+    [_lock lock];
+    [_pendingWrites removeAllObjects];
+    [_pendingInfos removeAllObjects];
+    [_index removeAllObjects];
+    _totalSize = 0;
+    if (!_indexLoaded) {
+        _removedAllWhileLoadingIndex = YES;
+    }
+    [_lock unlock];
+    dispatch_async(_queue, ^{
+        [[NSFileManager defaultManager] removeItemAtPath:_path error:nil];
+    });
+}
+
+#pragma mark Trimming
+
+- (void)trim {
+    [_lock lock];
+    BOOL needsTrim = _totalSize > _capacity && !_trimScheduled;
+    if (needsTrim) {
+        _trimScheduled = YES;
+    }
+    [_lock unlock];
+    if (needsTrim) {
+        dispatch_async(_queue, ^{
+            [self _trim];
+        });
+    }
+}
+
+- (void)_trim {
+    NSMutableArray *removedFilenames = [NSMutableArray new];
+    [_lock lock];
+    _trimScheduled = NO;
+    if (_totalSize > _capacity) {
+        NSUInteger targetSize = (NSUInteger)(_capacity * _kDFDiskCacheTrimRatio);
+        NSArray *filenames = [_index keysSortedByValueUsingComparator:^NSComparisonResult(_DFDiskCacheEntry *entry1, _DFDiskCacheEntry *entry2) {
+            return entry1.accessDate < entry2.accessDate ? NSOrderedAscending : (entry1.accessDate > entry2.accessDate ? NSOrderedDescending : NSOrderedSame);
+        }];
+        for (NSString *filename in filenames) {
+            if (_totalSize <= targetSize) {
+                break;
+            }
+            [_pendingWrites removeObjectForKey:filename];
+            [_pendingInfos removeObjectForKey:filename];
+            [self _removeEntryForFilename:filename];
+            [removedFilenames addObject:filename];
+        }
+    }
+    [_lock unlock];
+    for (NSString *filename in removedFilenames) {
+        [self _removeFilesForFilename:filename];
+    }
+}
+
+#pragma mark Index
+
+- (void)_loadIndex {
+    NSArray *keys = @[ NSURLIsRegularFileKey, NSURLFileSizeKey, NSURLContentModificationDateKey ];
+    NSDirectoryEnumerator *enumerator = [[NSFileManager defaultManager] enumeratorAtURL:[NSURL fileURLWithPath:_path isDirectory:YES] includingPropertiesForKeys:keys options:NSDirectoryEnumerationSkipsHiddenFiles errorHandler:nil];
+    NSMutableDictionary *index = [NSMutableDictionary new];
+    for (NSURL *fileURL in enumerator) {
+        NSString *filename = fileURL.lastPathComponent;
+        if (filename.length != CC_SHA1_DIGEST_LENGTH * 2) { // Skip shards and temporary files
+            continue;
+        }
+        NSDictionary *values = [fileURL resourceValuesForKeys:keys error:nil];
+        if (![values[NSURLIsRegularFileKey] boolValue]) {
+            continue;
+        }
+        _DFDiskCacheEntry *entry = [_DFDiskCacheEntry new];
+        entry.size = [values[NSURLFileSizeKey] unsignedIntegerValue];
+        entry.accessDate = [values[NSURLContentModificationDateKey] timeIntervalSinceReferenceDate];
+        index[filename] = entry;
+    }
+    [_lock lock];
+    // Entries that were added while the index was loading are more recent, the ones that were removed are not added back
+    if (!_removedAllWhileLoadingIndex) {
+        for (NSString *filename in index) {
+            if (!_index[filename] && ![_removedWhileLoadingIndex containsObject:filename]) {
+                _DFDiskCacheEntry *entry = index[filename];
+                [self _addEntryForFilename:filename size:entry.size accessDate:entry.accessDate];
+            }
+        }
+    }
+    _removedWhileLoadingIndex = nil;
+    _indexLoaded = YES;
+    [_lock unlock];
+    [self trim];
+}
+
+- (void)_addEntryForFilename:(NSString *)filename size:(NSUInteger)size accessDate:(CFAbsoluteTime)accessDate {
+    _DFDiskCacheEntry *entry = [_DFDiskCacheEntry new];
+    entry.size = size;
+    entry.accessDate = accessDate;
+    _index[filename] = entry;
+    _totalSize += size;
+}
+
+- (void)_removeEntryForFilename:(NSString *)filename {
+    if (!_indexLoaded) {
+        [_removedWhileLoadingIndex addObject:filename];
+    }
+    _DFDiskCacheEntry *entry = _index[filename];
+    if (entry) {
+        _totalSize -= entry.size;
+        [_index removeObjectForKey:filename];
+    }
+}
+
+- (NSString *)_pathForFilename:(NSString *)filename {
+    return [[_path stringByAppendingPathComponent:[filename substringToIndex:2]] stringByAppendingPathComponent:filename];
+}
+
+/*! The info is kept in a separate file next to the data, the index skips it because of the extension.
+ */
+- (NSString *)_infoPathForFilename:(NSString *)filename {
+    return [[self _pathForFilename:filename] stringByAppendingPathExtension:@"info"];
+}
+
+- (void)_removeFilesForFilename:(NSString *)filename {
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    [fileManager removeItemAtPath:[self _pathForFilename:filename] error:nil];
+    [fileManager removeItemAtPath:[self _infoPathForFilename:filename] error:nil];
+}
+
+@end
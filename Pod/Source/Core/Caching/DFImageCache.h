@@ -5,7 +5,40 @@
 #import "DFImageCaching.h"
 #import <Foundation/Foundation.h>
 
-/*! Memory cache implementation built on top of NSCache. Adds cached entries expiration, automatic cleanup on memory warnings and more.
+/*! Snapshot of the DFImageCache statistics.
+ */
+@interface DFImageCacheStatistics : NSObject
+
+/*! Number of lookups that returned a cached response.
+ */
+@property (nonatomic, readonly) NSUInteger hitCount;
+
+/*! Number of lookups that didn't return a cached response.
+ */
+@property (nonatomic, readonly) NSUInteger missCount;
+
+/*! Number of responses that were refused by the admission policy.
+ */
+@property (nonatomic, readonly) NSUInteger rejectedCount;
+
+/*! Number of responses that were evicted to make room for the new ones.
+ */
+@property (nonatomic, readonly) NSUInteger evictedCount;
+
+/*! Number of lookups that were served by the images that had been removed from the cache but were still alive (see tracksLiveImages). These lookups are included in the hitCount.
+ */
+@property (nonatomic, readonly) NSUInteger liveImageHitCount;
+
+/*! Returns hitCount / (hitCount + missCount), or 0 if there were no lookups.
+ */
+@property (nonatomic, readonly) double hitRatio;
+
+@end
+
+
+/*! Memory cache implementation built on top of NSCache. Adds cached entries expiration, graded cleanup on memory pressure and more.
+ @note DFImageCache keeps cached entries within the totalCostLimit of the underlying NSCache, evicting the least recently used entries first. When the admission policy is enabled the cache uses W-TinyLFU: new entries are placed into a small admission window and then have to compete with the least recently used entry of the main space based on their access frequency. This protects frequently used images (avatars, icons) from being pushed out by the images that are only displayed once.
+ @note Memory pressure is handled gradually. On DISPATCH_MEMORYPRESSURE_WARN the cache is trimmed to half of its current cost, on DISPATCH_MEMORYPRESSURE_CRITICAL and on memory warnings all entries are removed except for the images that are currently displayed (see beginDisplayingImage:). Expired entries are periodically removed in background.
  */
 @interface DFImageCache : NSObject <DFImageCaching>
 
@@ -13,6 +46,18 @@
  */
 @property (nonnull, nonatomic, readonly) NSCache *cache;
 
+/*! If YES the cache uses frequency-based (W-TinyLFU) admission policy, otherwise it behaves like a plain LRU cache. Default value is YES.
+ */
+@property (nonatomic) BOOL usesAdmissionPolicy;
+
+/*! The amount of time during which the expired entries are kept in the cache so that they can be returned as stale responses (see DFImageRequestCachePolicyReturnStaleWhileRevalidate). Expired entries are still removed first when the cache is trimmed. Default value is 600.0 seconds.
+ */
+@property (atomic) NSTimeInterval maximumStaleAge;
+
+/*! If YES the cache keeps weak references to the images that it stores. When the image is removed from the cache (evicted or trimmed) but is still alive (for example, it's displayed by an image view), the lookup returns the image and puts it back into the cache instead of reporting a miss, so that the same image is never decoded twice. Default value is YES.
+ */
+@property (nonatomic) BOOL tracksLiveImages;
+
 /*! Initializes image cache with an instance of NSCache class.
  */
 - (nonnull instancetype)initWithCache:(nonnull NSCache *)cache NS_DESIGNATED_INITIALIZER;
@@ -21,4 +66,42 @@
  */
 - (NSUInteger)costForImageResponse:(nonnull DFCachedImageResponse *)cachedResponse;
 
+/*! Returns the total cost of the entries stored in the cache.
+ */
+@property (nonatomic, readonly) NSUInteger totalCost;
+
+/*! Removes the least recently used entries until the total cost of the cache is less than or equal to the given cost. Expired entries are removed first. Images that are currently displayed are never removed by trimming, removing them wouldn't free any memory.
+ */
+- (void)trimToCost:(NSUInteger)cost;
+
+/*! Removes all entries that expired more than maximumStaleAge ago.
+ */
+- (void)removeExpiredObjects;
+
+/*! Returns a snapshot of the cache statistics.
+ */
+- (nonnull DFImageCacheStatistics *)statistics;
+
+/*! Resets the cache statistics.
+ */
+- (void)resetStatistics;
+
+@end
+
+
+@interface DFImageCache (DFDisplayedImages)
+
+/*! Marks the image as displayed. Displayed images are kept in the cache when it is trimmed. Calls can be nested, the image is considered displayed until the number of endDisplayingImage: calls matches the number of beginDisplayingImage: calls.
+ @note Images are referenced weakly. DFImageView calls this method automatically.
+ */
++ (void)beginDisplayingImage:(nullable UIImage *)image;
+
+/*! Balances the previous beginDisplayingImage: call.
+ */
++ (void)endDisplayingImage:(nullable UIImage *)image;
+
+/*! Returns YES if the image is currently displayed.
+ */
++ (BOOL)isImageDisplayed:(nullable UIImage *)image;
+
 @end
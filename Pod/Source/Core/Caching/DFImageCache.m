@@ -3,22 +3,191 @@
 // Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
 
 #import "DFCachedImageResponse.h"
+#import "DFFrequencySketch.h"
 #import "DFImageCache.h"
 #import "DFImageManagerDefines.h"
 #import "NSCache+DFImageManager.h"
+#import "UIImage+DFImageUtilities.h"
 
-@implementation DFImageCache
+/*! Average cost of the cached entry, used to estimate the number of entries that fit into the cache when sizing the frequency sketch.
+ */
+static const NSUInteger _kDFImageCacheAverageEntryCost = 128 * 1024;
+
+/*! The proportion of the cost limit used by the admission window.
+ */
+static const double _kDFImageCacheWindowRatio = 0.01;
+
+/*! The proportion of the current cost that is kept on DISPATCH_MEMORYPRESSURE_WARN.
+ */
+static const double _kDFImageCacheMemoryPressureWarnRatio = 0.5;
+
+/*! The interval at which expired entries are removed.
+ */
+static const NSTimeInterval _kDFImageCacheSweepInterval = 30.0;
+
+
+#pragma mark - DFImageCacheStatistics
+
+@interface DFImageCacheStatistics ()
+
+@property (nonatomic) NSUInteger hitCount;
+@property (nonatomic) NSUInteger missCount;
+@property (nonatomic) NSUInteger rejectedCount;
+@property (nonatomic) NSUInteger evictedCount;
+@property (nonatomic) NSUInteger liveImageHitCount;
+
+@end
+
+@implementation DFImageCacheStatistics
+
+- (double)hitRatio {
+    NSUInteger lookupCount = _hitCount + _missCount;
+    return lookupCount > 0 ? (double)_hitCount / (double)lookupCount : 0.0;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@ %p> { hits = %lu, misses = %lu, hit ratio = %.3f, rejected = %lu, evicted = %lu, live image hits = %lu }", [self class], self, (unsigned long)_hitCount, (unsigned long)_missCount, self.hitRatio, (unsigned long)_rejectedCount, (unsigned long)_evictedCount, (unsigned long)_liveImageHitCount];
+}
+
+@end
+
+
+#pragma mark - _DFImageCacheEntry
+
+@interface _DFImageCacheEntry : NSObject
+
+@property (nonnull, nonatomic, readonly) id key;
+@property (nonatomic) NSUInteger cost;
+@property (nonatomic) BOOL inWindow;
+@property (nullable, nonatomic) _DFImageCacheEntry *next;
+@property (nullable, nonatomic, unsafe_unretained) _DFImageCacheEntry *prev;
+
+@end
+
+@implementation _DFImageCacheEntry
+
+- (nonnull instancetype)initWithKey:(nonnull id)key cost:(NSUInteger)cost {
+    if (self = [super init]) {
+        _key = key;
+        _cost = cost;
+    }
+    return self;
+}
+
+@end
+
+
+#pragma mark - _DFImageCacheList
+
+/*! Doubly linked list of cache entries ordered from the most recently used (head) to the least recently used (tail).
+ */
+@interface _DFImageCacheList : NSObject
+
+@property (nullable, nonatomic, readonly) _DFImageCacheEntry *head;
+@property (nullable, nonatomic, unsafe_unretained, readonly) _DFImageCacheEntry *tail;
+@property (nonatomic, readonly) NSUInteger totalCost;
+
+@end
+
+@implementation _DFImageCacheList
+
+- (void)addEntryToHead:(nonnull _DFImageCacheEntry *)entry {
+    entry.next = _head;
+    entry.prev = nil;
+    _head.prev = entry;
+    _head = entry;
+    if (!_tail) {
+        _tail = entry;
+    }
+    _totalCost += entry.cost;
+}
+
+- (void)removeEntry:(nonnull _DFImageCacheEntry *)entry {
+    _DFImageCacheEntry *prev = entry.prev;
+    _DFImageCacheEntry *next = entry.next;
+    if (prev) {
+        prev.next = next;
+    } else {
+        _head = next;
+    }
+    if (next) {
+        next.prev = prev;
+    } else {
+        _tail = prev;
+    }
+    entry.next = nil;
+    entry.prev = nil;
+    _totalCost -= entry.cost;
+}
+
+- (void)removeAllEntries {
+    while (_head) {
+        [self removeEntry:_head];
+    }
+}
+
+@end
+
+
+#pragma mark - _DFImageCacheLiveEntry
+
+/*! The metadata of the live image. Doesn't reference the image so that the image can be deallocated.
+ */
+@interface _DFImageCacheLiveEntry : NSObject
+
+@property (nullable, nonatomic) NSDictionary *info;
+@property (nonatomic) CFAbsoluteTime expirationDate;
+
+@end
+
+@implementation _DFImageCacheLiveEntry
+@end
+
+
+#pragma mark - DFImageCache
+
+@implementation DFImageCache {
+    NSMapTable /* key : UIImage (weak) */ *_liveImages;
+    NSMapTable /* UIImage (weak) : _DFImageCacheLiveEntry */ *_liveEntries;
+    NSMutableDictionary /* key : _DFImageCacheEntry */ *_entries;
+    _DFImageCacheList *_window;
+    _DFImageCacheList *_main;
+    DFFrequencySketch *_sketch;
+    NSUInteger _sketchCostLimit;
+    DFImageCacheStatistics *_statistics;
+    NSLock *_lock;
+    dispatch_source_t _memoryPressureSource;
+    dispatch_source_t _sweepTimer;
+}
 
 - (void)dealloc {
     [[NSNotificationCenter defaultCenter] removeObserver:self];
+    if (_memoryPressureSource) {
+        dispatch_source_cancel(_memoryPressureSource);
+    }
+    if (_sweepTimer) {
+        dispatch_source_cancel(_sweepTimer);
+    }
 }
 
 - (nonnull instancetype)initWithCache:(nonnull NSCache *)cache {
     if (self = [super init]) {
         _cache = cache;
+        _usesAdmissionPolicy = YES;
+        _maximumStaleAge = 600.0;
+        _tracksLiveImages = YES;
+        _liveImages = [NSMapTable strongToWeakObjectsMapTable];
+        _liveEntries = [NSMapTable weakToStrongObjectsMapTable];
+        _entries = [NSMutableDictionary new];
+        _window = [_DFImageCacheList new];
+        _main = [_DFImageCacheList new];
+        _statistics = [DFImageCacheStatistics new];
+        _lock = [NSLock new];
 #if TARGET_OS_IOS && !TARGET_OS_WATCH
-        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(removeAllObjects) name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
+        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(_didReceiveMemoryWarning:) name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
 #endif
+        [self _startObservingMemoryPressure];
+        [self _startSweepingExpiredEntries];
     }
     return self;
 }
@@ -30,30 +199,359 @@
 #pragma mark <DFImageCaching>
 
 - (nullable DFCachedImageResponse *)cachedImageResponseForKey:(nullable id<NSCopying>)key {
+    return [self cachedImageResponseForKey:key allowsExpired:NO];
+}
+
+- (nullable DFCachedImageResponse *)cachedImageResponseForKey:(nullable id<NSCopying>)key allowsExpired:(BOOL)allowsExpired {
+    if (!key) {
+        return nil;
+    }
+    [_lock lock];
+    [[self _frequencySketch] incrementHash:[(id)key hash]];
     DFCachedImageResponse *response = [_cache objectForKey:key];
-    if (response) {
-        if (response.expirationDate > CFAbsoluteTimeGetCurrent()) {
-            return response;
-        } else {
-            [_cache removeObjectForKey:key];
+    BOOL isLiveImage = NO;
+    if (!response && _tracksLiveImages) {
+        response = [self _responseForLiveImageWithKey:key];
+        isLiveImage = response != nil;
+    }
+    if (response && response.isExpired && (!allowsExpired || response.expirationDate + self.maximumStaleAge <= CFAbsoluteTimeGetCurrent())) {
+        [_cache removeObjectForKey:key];
+        [_liveImages removeObjectForKey:key];
+        response = nil;
+        isLiveImage = NO;
+    }
+    if (isLiveImage) { // Promote the image back into the cache
+        [self _storeImageResponse:response forKey:key];
+        _statistics.liveImageHitCount++;
+    }
+    _DFImageCacheEntry *entry = _entries[key];
+    if (entry) {
+        if (response) {
+            _DFImageCacheList *list = [self _listForEntry:entry];
+            [list removeEntry:entry];
+            [list addEntryToHead:entry];
+        } else { // Entry was either expired or evicted by NSCache
+            [self _removeEntry:entry];
         }
     }
-    return nil;
+    if (response) {
+        _statistics.hitCount++;
+    } else {
+        _statistics.missCount++;
+    }
+    [_lock unlock];
+    return response;
 }
 
 - (void)storeImageResponse:(nullable DFCachedImageResponse *)response forKey:(nullable id<NSCopying>)key {
-    if (response && key) {
-        [_cache setObject:response forKey:key cost:[self costForImageResponse:response]];
+    if (!response || !key) {
+        return;
     }
+    [_lock lock];
+    [self _storeImageResponse:response forKey:key];
+    [_lock unlock];
+}
+
+- (void)_storeImageResponse:(nonnull DFCachedImageResponse *)response forKey:(nonnull id<NSCopying>)key {
+    NSUInteger cost = [self costForImageResponse:response];
+    if (_tracksLiveImages) {
+        _DFImageCacheLiveEntry *liveEntry = [_DFImageCacheLiveEntry new];
+        liveEntry.info = response.info;
+        liveEntry.expirationDate = response.expirationDate;
+        [_liveImages setObject:response.image forKey:key];
+        [_liveEntries setObject:liveEntry forKey:response.image];
+    }
+    [_cache setObject:response forKey:key cost:cost];
+    _DFImageCacheEntry *entry = _entries[key];
+    if (entry) {
+        _DFImageCacheList *list = [self _listForEntry:entry];
+        [list removeEntry:entry];
+        entry.cost = cost;
+        [list addEntryToHead:entry];
+    } else {
+        entry = [[_DFImageCacheEntry alloc] initWithKey:key cost:cost];
+        entry.inWindow = YES;
+        _entries[key] = entry;
+        [_window addEntryToHead:entry];
+    }
+    [self _evictEntriesIfNeeded];
+}
+
+/*! Returns the response for the image that was removed from the cache but is still alive.
+ */
+- (nullable DFCachedImageResponse *)_responseForLiveImageWithKey:(nonnull id<NSCopying>)key {
+    UIImage *image = [_liveImages objectForKey:key];
+    _DFImageCacheLiveEntry *liveEntry = image ? [_liveEntries objectForKey:image] : nil;
+    if (!liveEntry) {
+        return nil;
+    }
+    return [[DFCachedImageResponse alloc] initWithImage:image info:liveEntry.info expirationDate:liveEntry.expirationDate];
 }
 
 - (void)removeAllObjects {
+    [_lock lock];
+    [_liveImages removeAllObjects];
+    [_liveEntries removeAllObjects];
     [_cache removeAllObjects];
+    [_entries removeAllObjects];
+    [_window removeAllEntries];
+    [_main removeAllEntries];
+    [_lock unlock];
 }
 
 - (NSUInteger)costForImageResponse:(nonnull DFCachedImageResponse *)cachedResponse {
-    CGImageRef image = cachedResponse.image.CGImage;
-    return (CGImageGetWidth(image) * CGImageGetHeight(image) * CGImageGetBitsPerPixel(image)) / 8;
+    return [cachedResponse.image df_memoryCost];
+}
+
+- (NSUInteger)totalCost {
+    [_lock lock];
+    NSUInteger totalCost = _window.totalCost + _main.totalCost;
+    [_lock unlock];
+    return totalCost;
+}
+
+#pragma mark Trimming
+
+- (void)trimToCost:(NSUInteger)cost {
+    [_lock lock];
+    [self _removeEntriesExpiredBefore:CFAbsoluteTimeGetCurrent()]; // Including the stale entries
+    for (_DFImageCacheList *list in @[_main, _window]) {
+        _DFImageCacheEntry *entry = list.tail;
+        while (entry && _window.totalCost + _main.totalCost > cost) {
+            _DFImageCacheEntry *prev = entry.prev;
+            DFCachedImageResponse *response = [_cache objectForKey:entry.key];
+            if (![DFImageCache isImageDisplayed:response.image]) {
+                [self _evictEntry:entry];
+            }
+            entry = prev;
+        }
+    }
+    [_lock unlock];
+}
+
+- (void)removeExpiredObjects {
+    [_lock lock];
+    [self _removeEntriesExpiredBefore:CFAbsoluteTimeGetCurrent() - self.maximumStaleAge];
+    [self _removeDeallocatedLiveImages];
+    [_lock unlock];
+}
+
+/*! NSMapTable doesn't remove the keys of the deallocated weak values on its own.
+ */
+- (void)_removeDeallocatedLiveImages {
+    for (id key in [[_liveImages keyEnumerator] allObjects]) {
+        if (![_liveImages objectForKey:key]) {
+            [_liveImages removeObjectForKey:key];
+        }
+    }
+}
+
+- (void)_removeEntriesExpiredBefore:(CFAbsoluteTime)date {
+    for (_DFImageCacheEntry *entry in [_entries allValues]) {
+        DFCachedImageResponse *response = [_cache objectForKey:entry.key];
+        if (!response || response.expirationDate <= date) {
+            id key = entry.key;
+            [self _removeEntry:entry];
+            [_cache removeObjectForKey:key];
+        }
+    }
+}
+
+- (void)_didReceiveMemoryWarning:(NSNotification *)notification {
+    [self trimToCost:0];
+}
+
+- (void)_startObservingMemoryPressure {
+    _memoryPressureSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_MEMORYPRESSURE, 0, DISPATCH_MEMORYPRESSURE_WARN | DISPATCH_MEMORYPRESSURE_CRITICAL, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0));
+    if (!_memoryPressureSource) {
+        return;
+    }
+    typeof(self) __weak weakSelf = self;
+    dispatch_source_t source = _memoryPressureSource;
+    dispatch_source_set_event_handler(source, ^{
+        DFImageCache *strongSelf = weakSelf;
+        unsigned long level = dispatch_source_get_data(source);
+        if (level & DISPATCH_MEMORYPRESSURE_CRITICAL) {
+            [strongSelf trimToCost:0];
+        } else if (level & DISPATCH_MEMORYPRESSURE_WARN) {
+            [strongSelf trimToCost:(NSUInteger)(strongSelf.totalCost * _kDFImageCacheMemoryPressureWarnRatio)];
+        }
+    });
+    dispatch_resume(source);
+}
+
+- (void)_startSweepingExpiredEntries {
+    _sweepTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0));
+    if (!_sweepTimer) {
+        return;
+    }
+    uint64_t interval = (uint64_t)(_kDFImageCacheSweepInterval * NSEC_PER_SEC);
+    dispatch_source_set_timer(_sweepTimer, dispatch_time(DISPATCH_TIME_NOW, (int64_t)interval), interval, interval / 10);
+    typeof(self) __weak weakSelf = self;
+    dispatch_source_set_event_handler(_sweepTimer, ^{
+        [weakSelf removeExpiredObjects];
+    });
+    dispatch_resume(_sweepTimer);
+}
+
+#pragma mark Statistics
+
+- (nonnull DFImageCacheStatistics *)statistics {
+    DFImageCacheStatistics *statistics = [DFImageCacheStatistics new];
+    [_lock lock];
+    statistics.hitCount = _statistics.hitCount;
+    statistics.missCount = _statistics.missCount;
+    statistics.rejectedCount = _statistics.rejectedCount;
+    statistics.evictedCount = _statistics.evictedCount;
+    statistics.liveImageHitCount = _statistics.liveImageHitCount;
+    [_lock unlock];
+    return statistics;
+}
+
+- (void)resetStatistics {
+    [_lock lock];
+    _statistics = [DFImageCacheStatistics new];
+    [_lock unlock];
+}
+
+#pragma mark Eviction
+
+- (void)_evictEntriesIfNeeded {
+    NSUInteger costLimit = _cache.totalCostLimit;
+    if (costLimit == 0) { // No limit
+        return;
+    }
+    if (!_usesAdmissionPolicy) {
+        while (_window.totalCost + _main.totalCost > costLimit) {
+            [self _evictEntry:(_main.tail ?: _window.tail)];
+        }
+        return;
+    }
+    NSUInteger windowCostLimit = [self _windowCostLimitForCostLimit:costLimit];
+    NSUInteger mainCostLimit = costLimit - windowCostLimit;
+    while (_window.totalCost > windowCostLimit) {
+        _DFImageCacheEntry *candidate = _window.tail;
+        [_window removeEntry:candidate];
+        candidate.inWindow = NO;
+        [self _admitCandidate:candidate mainCostLimit:mainCostLimit];
+    }
+    while (_main.totalCost > mainCostLimit) {
+        [self _evictEntry:_main.tail];
+    }
+}
+
+/*! Returns the cost limit of the admission window. The window is a fraction of the cost limit, but not less than the cost of a typical entry, otherwise new images skip the window (and the chance to build up frequency there) and are compared with the main space straight away.
+ */
+- (NSUInteger)_windowCostLimitForCostLimit:(NSUInteger)costLimit {
+    NSUInteger count = _entries.count;
+    NSUInteger typicalEntryCost = count ? (_window.totalCost + _main.totalCost) / count : _kDFImageCacheAverageEntryCost;
+    NSUInteger windowCostLimit = MAX((NSUInteger)(costLimit * _kDFImageCacheWindowRatio), typicalEntryCost);
+    return MIN(windowCostLimit, costLimit / 2);
+}
+
+/*! Candidate evicted from the admission window competes with the least recently used entry of the main space. The candidate is only admitted if it was accessed more frequently than the victim.
+ */
+- (void)_admitCandidate:(nonnull _DFImageCacheEntry *)candidate mainCostLimit:(NSUInteger)mainCostLimit {
+    if (_main.totalCost + candidate.cost > mainCostLimit) {
+        _DFImageCacheEntry *victim = _main.tail;
+        DFFrequencySketch *sketch = [self _frequencySketch];
+        if (candidate.cost > mainCostLimit || (victim && [sketch frequencyForHash:[candidate.key hash]] <= [sketch frequencyForHash:[victim.key hash]])) {
+            [_entries removeObjectForKey:candidate.key];
+            [_cache removeObjectForKey:candidate.key];
+            _statistics.rejectedCount++;
+            return;
+        }
+        while (_main.tail && _main.totalCost + candidate.cost > mainCostLimit) {
+            [self _evictEntry:_main.tail];
+        }
+    }
+    [_main addEntryToHead:candidate];
+}
+
+- (void)_evictEntry:(nonnull _DFImageCacheEntry *)entry {
+    id key = entry.key; // Entry might get deallocated once removed
+    [self _removeEntry:entry];
+    [_cache removeObjectForKey:key];
+    _statistics.evictedCount++;
+}
+
+- (void)_removeEntry:(nonnull _DFImageCacheEntry *)entry {
+    [[self _listForEntry:entry] removeEntry:entry];
+    [_entries removeObjectForKey:entry.key];
+}
+
+- (nonnull _DFImageCacheList *)_listForEntry:(nonnull _DFImageCacheEntry *)entry {
+    return entry.inWindow ? _window : _main;
+}
+
+/*! Returns frequency sketch sized for the current cost limit of the underlying NSCache. The sketch is rescaled when the limit changes so that the frequency history is kept.
+ */
+- (nonnull DFFrequencySketch *)_frequencySketch {
+    NSUInteger costLimit = _cache.totalCostLimit;
+    if (!_sketch || _sketchCostLimit != costLimit) {
+        _sketchCostLimit = costLimit;
+        NSUInteger capacity = MAX(costLimit / _kDFImageCacheAverageEntryCost, 512);
+        if (_sketch) {
+            [_sketch resizeToCapacity:capacity];
+        } else {
+            _sketch = [[DFFrequencySketch alloc] initWithCapacity:capacity];
+        }
+    }
+    return _sketch;
+}
+
+@end
+
+
+@implementation DFImageCache (DFDisplayedImages)
+
+static NSMapTable /* UIImage : NSNumber */ *_displayedImages;
+static NSLock *_displayedImagesLock;
+
++ (void)_performWithDisplayedImages:(void (^__nonnull)(NSMapTable *displayedImages))block {
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        _displayedImages = [NSMapTable weakToStrongObjectsMapTable];
+        _displayedImagesLock = [NSLock new];
+    });
+    [_displayedImagesLock lock];
+    block(_displayedImages);
+    [_displayedImagesLock unlock];
+}
+
++ (void)beginDisplayingImage:(nullable UIImage *)image {
+    if (!image) {
+        return;
+    }
+    [self _performWithDisplayedImages:^(NSMapTable *displayedImages) {
+        NSUInteger count = [[displayedImages objectForKey:image] unsignedIntegerValue];
+        [displayedImages setObject:@(count + 1) forKey:image];
+    }];
+}
+
++ (void)endDisplayingImage:(nullable UIImage *)image {
+    if (!image) {
+        return;
+    }
+    [self _performWithDisplayedImages:^(NSMapTable *displayedImages) {
+        NSUInteger count = [[displayedImages objectForKey:image] unsignedIntegerValue];
+        if (count > 1) {
+            [displayedImages setObject:@(count - 1) forKey:image];
+        } else {
+            [displayedImages removeObjectForKey:image];
+        }
+    }];
+}
+
++ (BOOL)isImageDisplayed:(nullable UIImage *)image {
+    if (!image) {
+        return NO;
+    }
+    BOOL __block displayed;
+    [self _performWithDisplayedImages:^(NSMapTable *displayedImages) {
+        displayed = [displayedImages objectForKey:image] != nil;
+    }];
+    return displayed;
 }
 
 @end
@@ -0,0 +1,41 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import <Foundation/Foundation.h>
+
+/*! Memory cache of the encoded image data built on top of NSCache. The encoded data is roughly an order of magnitude smaller than the decoded bitmap, so the data cache can hold many more images than the memory cache of the processed images (DFImageCache). When the image is evicted from the memory cache it can be rebuilt with just a decode, without going through the disk cache or the network.
+ @note The cost of the entries is the length of the data in bytes.
+ @note Thread safe.
+ */
+@interface DFImageDataCache : NSObject
+
+/*! Returns the cache that the DFImageDataCache was initialized with.
+ */
+@property (nonnull, nonatomic, readonly) NSCache *cache;
+
+/*! Initializes data cache with an instance of NSCache class.
+ */
+- (nonnull instancetype)initWithCache:(nonnull NSCache *)cache NS_DESIGNATED_INITIALIZER;
+
+/*! Initializes data cache with a new NSCache instance with a recommended total cost limit (see +recommendedTotalCostLimit).
+ */
+- (nonnull instancetype)init;
+
+/*! Returns the data for a given key along with the info returned by the fetcher when the data was fetched.
+ */
+- (nullable NSData *)dataForKey:(nonnull id<NSCopying>)key info:(NSDictionary *__nullable *__nullable)info;
+
+/*! Stores the data and the info returned by the fetcher for a given key.
+ */
+- (void)storeData:(nonnull NSData *)data info:(nullable NSDictionary *)info forKey:(nonnull id<NSCopying>)key;
+
+/*! Removes all the data from the cache.
+ */
+- (void)removeAllData;
+
+/*! Returns recommended total cost limit in bytes, a fraction of the recommended limit of the memory cache of the processed images.
+ */
++ (NSUInteger)recommendedTotalCostLimit;
+
+@end
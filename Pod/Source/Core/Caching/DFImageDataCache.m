@@ -0,0 +1,61 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import "DFImageDataCache.h"
+#import "NSCache+DFImageManager.h"
+
+@interface _DFImageDataCacheEntry : NSObject
+
+@property (nonnull, nonatomic) NSData *data;
+@property (nullable, nonatomic) NSDictionary *info;
+
+@end
+
+@implementation _DFImageDataCacheEntry
+@end
+
+
+@implementation DFImageDataCache
+
+- (nonnull instancetype)initWithCache:(nonnull NSCache *)cache {
+    NSParameterAssert(cache);
+    if (self = [super init]) {
+        _cache = cache;
+    }
+    return self;
+}
+
+- (nonnull instancetype)init {
+    NSCache *cache = [NSCache new];
+    cache.totalCostLimit = [[self class] recommendedTotalCostLimit];
+    return [self initWithCache:cache];
+}
+
+- (nullable NSData *)dataForKey:(nonnull id<NSCopying>)key info:(NSDictionary *__nullable *__nullable)info {
+    _DFImageDataCacheEntry *entry = [_cache objectForKey:key];
+    if (info) {
+        *info = entry.info;
+    }
+    return entry.data;
+}
+
+- (void)storeData:(nonnull NSData *)data info:(nullable NSDictionary *)info forKey:(nonnull id<NSCopying>)key {
+    if (!data.length) {
+        return;
+    }
+    _DFImageDataCacheEntry *entry = [_DFImageDataCacheEntry new];
+    entry.data = data;
+    entry.info = info;
+    [_cache setObject:entry forKey:key cost:data.length];
+}
+
+- (void)removeAllData {
+    [_cache removeAllObjects];
+}
+
++ (NSUInteger)recommendedTotalCostLimit {
+    return [NSCache df_recommendedTotalCostLimit] / 4;
+}
+
+@end
@@ -9,18 +9,27 @@
 #import "DFImageFetchingOperation.h"
 #import "DFImageCaching.h"
 #import "DFImageProcessing.h"
+#import "DFImagePreviewProviding.h"
 #import "DFImageDecoding.h"
 
 #import "DFImageManager.h"
 #import "DFImageManagerConfiguration.h"
+#import "DFImageManagerBudget.h"
+#import "DFImagePrefetchJob.h"
 #import "DFCompositeImageManager.h"
+#import "DFImageTraceRecorder.h"
+#import "DFImageTraceReplayer.h"
 
 #import "DFImageTask.h"
 #import "DFImageRequest.h"
 #import "DFImageRequestOptions.h"
 #import "DFImageResponse.h"
+#import "DFImageHeaderInfo.h"
+#import "DFImageCancellationToken.h"
 
 #import "DFImageCache.h"
+#import "DFImageDataCache.h"
+#import "DFDiskCache.h"
 #import "DFCachedImageResponse.h"
 #import "NSCache+DFImageManager.h"
 
@@ -30,4 +39,5 @@
 
 #import "DFURLHTTPResponseValidator.h"
 #import "DFURLImageFetcher.h"
+#import "DFURLPartialDataStore.h"
 #import "DFURLResponseValidating.h"
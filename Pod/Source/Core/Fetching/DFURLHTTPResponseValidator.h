@@ -4,7 +4,7 @@
 
 #import "DFURLResponseValidating.h"
 
-/*! The DFURLHTTPResponseValidator performs response validation based on HTTP status code and content type.
+/*! The DFURLHTTPResponseValidator performs response validation based on HTTP status code and content type. The validation only depends on the headers of the response, so the invalid responses are cancelled before their body is downloaded.
  */
 @interface DFURLHTTPResponseValidator : NSObject <DFURLResponseValidating>
 
@@ -18,4 +18,8 @@
  */
 @property (nullable, nonatomic, copy) NSSet<NSString *> *acceptableContentTypes;
 
+/*! The MIME types of the responses that are never images, for example, error pages or captive portal login pages. Default value contains "text/html" and "application/xhtml+xml".
+ */
+@property (nullable, nonatomic, copy) NSSet<NSString *> *unacceptableContentTypes;
+
 @end
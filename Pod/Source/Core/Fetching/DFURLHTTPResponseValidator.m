@@ -9,11 +9,16 @@
 - (nonnull instancetype)init {
     if (self = [super init]) {
         _acceptableStatusCodes = [NSIndexSet indexSetWithIndexesInRange:NSMakeRange(200, 100)];
+        _unacceptableContentTypes = [NSSet setWithObjects:@"text/html", @"application/xhtml+xml", nil];
     }
     return self;
 }
 
 - (BOOL)isValidResponse:(nullable NSHTTPURLResponse *)response data:(nullable NSData *)data error:(NSError * __nullable __autoreleasing * __nullable)error {
+    return [self isValidResponseHeaders:response error:error];
+}
+
+- (BOOL)isValidResponseHeaders:(nullable NSHTTPURLResponse *)response error:(NSError * __nullable __autoreleasing * __nullable)error {
     if (![response isKindOfClass:[NSHTTPURLResponse class]]) {
         return NO;
     }
@@ -23,7 +28,8 @@
         }
         return NO;
     }
-    if (self.acceptableContentTypes != nil && ![self.acceptableContentTypes containsObject:response.MIMEType]) {
+    BOOL isUnacceptableContentType = response.MIMEType && [self.unacceptableContentTypes containsObject:response.MIMEType.lowercaseString];
+    if (isUnacceptableContentType || (self.acceptableContentTypes != nil && ![self.acceptableContentTypes containsObject:response.MIMEType])) {
         if (error != nil) {
             *error = [NSError errorWithDomain:DFURLValidationErrorDomain code:NSURLErrorCannotDecodeContentData userInfo:[self _errorInfoWithResponse:response]];
         }
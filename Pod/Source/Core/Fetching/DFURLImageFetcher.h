@@ -5,7 +5,9 @@
 #import "DFImageFetching.h"
 #import <Foundation/Foundation.h>
 
+@class DFDiskCache;
 @class DFURLImageFetcher;
+@class DFURLPartialDataStore;
 @protocol DFURLResponseValidating;
 
 NS_ASSUME_NONNULL_BEGIN
@@ -15,6 +17,11 @@ NS_ASSUME_NONNULL_BEGIN
  */
 extern NSString *const DFURLRequestCachePolicyKey;
 
+/*! The NSNumber with long long value that specifies the maximum number of bytes that the fetcher is allowed to download for the request. The fetch fails with NSURLErrorDataLengthExceedsMaximum error in DFURLValidationErrorDomain as soon as the Content-Length of the response or the number of received bytes exceeds the limit.
+ @note Should be put into DFImageRequestOptions userInfo dictionary.
+ */
+extern NSString *const DFURLMaximumByteCountKey;
+
 
 /*! Delegate that allows to customize DFURLImageFetcher.
  */
@@ -36,6 +43,9 @@ extern NSString *const DFURLRequestCachePolicyKey;
 
 
 /*! The DFURLImageFetcher provides basic networking using NSURLSession.
+ @note The response is validated (see DFURLResponseValidating) as soon as its headers are received, the responses that fail validation (e.g. error pages) are cancelled without downloading the body.
+ @note When the HTTP fetch is interrupted (cancelled or failed) the received data is kept in the partialDataStore if the response has a validator (ETag or Last-Modified). The next fetch of the same URL resumes the download using Range request.
+ @note The validator of the HTTP response is returned in the info dictionary (DFImageInfoValidatorKey). The freshness and validation header fields are returned too (DFImageInfoHTTPHeaderFieldsKey), and are stored in the disk cache along with the data. Revalidation requests (DFImageRequestRevalidationInfoKey) skip the disk cache and are sent as conditional requests (If-None-Match or If-Modified-Since) when the validator is known, 304 Not Modified response fails with DFImageManagerErrorNotModified error.
  */
 @interface DFURLImageFetcher : NSObject <DFImageFetching, NSURLSessionDelegate, NSURLSessionDataDelegate>
 
@@ -47,6 +57,15 @@ extern NSString *const DFURLRequestCachePolicyKey;
  */
 @property (nonatomic, copy) NSSet<NSString *> *supportedSchemes;
 
+/*! The disk cache for fetched data. When the cache contains fresh data for the request (see Cache-Control and Expires header fields) the data is read from the disk without touching the URL loading system. The stale data is revalidated with a conditional request, and is returned if the server responds with 304 Not Modified. Successfully fetched HTTP responses are stored in the cache unless they have Cache-Control: no-store. Default value is nil.
+ @note Requests with NSURLRequestReloadIgnoringLocalCacheData (and similar) cache policy skip the cache lookup, requests with NSURLRequestReturnCacheDataElseLoad and NSURLRequestReturnCacheDataDontLoad cache policy return the stale data too.
+ */
+@property (nullable, nonatomic) DFDiskCache *diskCache;
+
+/*! The store for partially downloaded data that is used to resume interrupted downloads. Set to nil to disable resumable downloads. Default value is an instance of DFURLPartialDataStore class.
+ */
+@property (nullable, nonatomic) DFURLPartialDataStore *partialDataStore;
+
 /*! The delegate of the receiver.
  */
 @property (nullable, nonatomic, weak) id<DFURLImageFetcherDelegate> delegate;
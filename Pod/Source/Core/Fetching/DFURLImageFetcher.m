@@ -2,13 +2,21 @@
 //
 // Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
 
+#import "DFDiskCache.h"
+#import "DFDiskCacheFetchOperation.h"
 #import "DFImageFetchingOperation.h"
 #import "DFImageRequest.h"
 #import "DFImageRequestOptions.h"
 #import "DFURLHTTPResponseValidator.h"
 #import "DFURLImageFetcher.h"
+#import "DFURLPartialDataStore.h"
 
 NSString *const DFURLRequestCachePolicyKey = @"DFURLRequestCachePolicyKey";
+NSString *const DFURLMaximumByteCountKey = @"DFURLMaximumByteCountKey";
+
+static inline int64_t _DFMaximumByteCountForRequest(DFImageRequest *request) {
+    return [request.options.userInfo[DFURLMaximumByteCountKey] longLongValue];
+}
 
 
 #pragma mark - _DFURLFetcherTaskQueue -
@@ -89,8 +97,11 @@ static inline float _DFSessionTaskPriorityForRequestPriority(DFImageRequestPrior
 
 @interface _DFURLImageFetchOperation : NSObject <DFImageFetchingOperation>
 
-@property (nullable, nonatomic, readonly) NSURLSessionTask *task;
+/*! The task is replaced when the fetcher restarts the request (e.g. without the Range header field).
+ */
+@property (nullable, atomic) NSURLSessionTask *task;
 @property (nullable, nonatomic, readonly) _DFURLFetcherTaskQueue *queue;
+@property (atomic, readonly, getter=isCancelled) BOOL cancelled;
 
 @end
 
@@ -105,11 +116,12 @@ static inline float _DFSessionTaskPriorityForRequestPriority(DFImageRequestPrior
 }
 
 - (void)cancelImageFetching {
-    [_queue cancelTask:_task];
+    _cancelled = YES;
+    [_queue cancelTask:self.task];
 }
 
 - (void)setImageFetchingPriority:(DFImageRequestPriority)priority {
-    _task.priority = _DFSessionTaskPriorityForRequestPriority(priority);
+    self.task.priority = _DFSessionTaskPriorityForRequestPriority(priority);
 }
 
 @end
@@ -123,6 +135,34 @@ static inline float _DFSessionTaskPriorityForRequestPriority(DFImageRequestPrior
 @property (nullable, nonatomic, copy, readonly) DFImageFetchingCompletionHandler completionHandler;
 @property (nonnull, nonatomic, readonly) NSMutableData *data;
 
+/*! Partial data that the task was asked to resume.
+ */
+@property (nullable, nonatomic) DFURLPartialData *resumedData;
+
+/*! The number of bytes that were received by the previous tasks.
+ */
+@property (nonatomic) int64_t resumedLength;
+
+/*! The validator of the response, nil if the download can't be resumed.
+ */
+@property (nullable, nonatomic, copy) NSString *validator;
+
+/*! Maximum number of bytes that the task is allowed to download, 0 if there is no limit.
+ */
+@property (nonatomic) int64_t maximumByteCount;
+
+/*! The error that the task was cancelled with before the response body was downloaded.
+ */
+@property (nullable, nonatomic) NSError *error;
+
+/*! The operation that owns the task, used to replace the task when the request is restarted.
+ */
+@property (nullable, nonatomic, weak) _DFURLImageFetchOperation *operation;
+
+/*! YES if the server responded with the range that wasn't requested, the request is restarted without the Range header field.
+ */
+@property (nonatomic) BOOL needsRestartWithoutRange;
+
 @end
 
 @implementation _DFURLSessionDataTaskHandler
@@ -157,6 +197,7 @@ static inline float _DFSessionTaskPriorityForRequestPriority(DFImageRequestPrior
         _sessionTaskHandlers = [NSMutableDictionary new];
         _taskQueue = [_DFURLFetcherTaskQueue new];
         _supportedSchemes = [NSSet setWithObjects:@"http", @"https", @"ftp", @"file", @"data", nil];
+        _partialDataStore = [DFURLPartialDataStore new];
     }
     return self;
 }
@@ -181,6 +222,12 @@ static inline float _DFSessionTaskPriorityForRequestPriority(DFImageRequestPrior
     if (request1.options.allowsNetworkAccess != request2.options.allowsNetworkAccess) {
         return NO;
     }
+    if ((request1.options.userInfo[DFImageRequestRevalidationInfoKey] != nil) != (request2.options.userInfo[DFImageRequestRevalidationInfoKey] != nil)) {
+        return NO;
+    }
+    if (_DFMaximumByteCountForRequest(request1) != _DFMaximumByteCountForRequest(request2)) {
+        return NO;
+    }
     NSURLRequestCachePolicy defaultCachePolicy = self.session.configuration.requestCachePolicy;
     NSURLRequestCachePolicy requestCachePolicy1 = request1.options.userInfo[DFURLRequestCachePolicyKey] ? [request1.options.userInfo[DFURLRequestCachePolicyKey] unsignedIntegerValue] : defaultCachePolicy;
     NSURLRequestCachePolicy requestCachePolicy2 = request2.options.userInfo[DFURLRequestCachePolicyKey] ? [request2.options.userInfo[DFURLRequestCachePolicyKey] unsignedIntegerValue] : defaultCachePolicy;
@@ -193,14 +240,69 @@ static inline float _DFSessionTaskPriorityForRequestPriority(DFImageRequestPrior
 
 - (id<DFImageFetchingOperation>)startOperationWithRequest:(DFImageRequest *)request progressHandler:(DFImageFetchingProgressHandler)progressHandler completion:(DFImageFetchingCompletionHandler)completion {
     NSURLRequest *URLRequest = [self _URLRequestForImageRequest:request];
+    int64_t maximumByteCount = _DFMaximumByteCountForRequest(request);
+    DFDiskCache *diskCache = self.diskCache;
+    NSString *cacheKey = DFDiskCacheKeyForURLRequest(URLRequest);
+    if (diskCache && cacheKey && DFDiskCacheCanReturnDataForURLRequest(URLRequest) && [diskCache containsDataForKey:cacheKey]) {
+        typeof(self) __weak weakSelf = self;
+        return [DFDiskCacheFetchOperation startOperationWithDiskCache:diskCache key:cacheKey requiresFreshData:DFDiskCacheRequiresFreshDataForURLRequest(URLRequest) progressHandler:progressHandler completion:completion fallback:^id<DFImageFetchingOperation>(NSDictionary *staleInfo, DFImageFetchingCompletionHandler fallbackCompletion) {
+            return [weakSelf _startOperationWithURLRequest:DFDiskCacheConditionalURLRequest(URLRequest, staleInfo) maximumByteCount:maximumByteCount progressHandler:progressHandler completion:fallbackCompletion];
+        }];
+    }
+    return [self _startOperationWithURLRequest:URLRequest maximumByteCount:maximumByteCount progressHandler:progressHandler completion:completion];
+}
+
+- (nonnull id<DFImageFetchingOperation>)_startOperationWithURLRequest:(NSURLRequest *)URLRequest maximumByteCount:(int64_t)maximumByteCount progressHandler:(DFImageFetchingProgressHandler)progressHandler completion:(DFImageFetchingCompletionHandler)completion {
+    DFURLPartialData *partialData;
+    BOOL isConditional = [URLRequest valueForHTTPHeaderField:@"If-None-Match"] || [URLRequest valueForHTTPHeaderField:@"If-Modified-Since"];
+    if ([URLRequest.URL.scheme hasPrefix:@"http"] && URLRequest.cachePolicy != NSURLRequestReturnCacheDataDontLoad && !isConditional) {
+        partialData = [self.partialDataStore removePartialDataForURL:URLRequest.URL];
+    }
+    if (partialData) {
+        NSMutableURLRequest *resumingURLRequest = [URLRequest mutableCopy];
+        [resumingURLRequest setValue:[NSString stringWithFormat:@"bytes=%lu-", (unsigned long)partialData.data.length] forHTTPHeaderField:@"Range"];
+        [resumingURLRequest setValue:partialData.validator forHTTPHeaderField:@"If-Range"];
+        URLRequest = [resumingURLRequest copy];
+    }
     NSURLSessionDataTask *task = [self.session dataTaskWithRequest:URLRequest];
+    _DFURLImageFetchOperation *operation = [[_DFURLImageFetchOperation alloc] initWithTask:task queue:self.taskQueue];
     if (task) {
+        _DFURLSessionDataTaskHandler *handler = [[_DFURLSessionDataTaskHandler alloc] initWithProgressHandler:progressHandler completion:completion];
+        handler.resumedData = partialData;
+        handler.maximumByteCount = maximumByteCount;
+        handler.operation = operation;
         @synchronized(self) {
-            _sessionTaskHandlers[task] = [[_DFURLSessionDataTaskHandler alloc] initWithProgressHandler:progressHandler completion:completion];
+            _sessionTaskHandlers[task] = handler;
         }
     }
     [_taskQueue resumeTask:task];
-    return [[_DFURLImageFetchOperation alloc] initWithTask:task queue:self.taskQueue];
+    return operation;
+}
+
+/*! Starts the request again without the Range and If-Range header fields, the handler and the operation are moved to the new task, so the restart is transparent to the client. Returns NO if the operation was cancelled.
+ @note Must be called inside @synchronized(self).
+ */
+- (BOOL)_restartTask:(nonnull NSURLSessionTask *)task withoutRangeWithHandler:(nonnull _DFURLSessionDataTaskHandler *)handler {
+    _DFURLImageFetchOperation *operation = handler.operation;
+    if (!operation || operation.isCancelled || !task.originalRequest.URL) {
+        return NO;
+    }
+    [self.partialDataStore removePartialDataForURL:task.originalRequest.URL];
+    NSMutableURLRequest *URLRequest = [task.originalRequest mutableCopy];
+    [URLRequest setValue:nil forHTTPHeaderField:@"Range"];
+    [URLRequest setValue:nil forHTTPHeaderField:@"If-Range"];
+    NSURLSessionDataTask *restartedTask = [self.session dataTaskWithRequest:URLRequest];
+    if (!restartedTask) {
+        return NO;
+    }
+    restartedTask.priority = task.priority;
+    handler.needsRestartWithoutRange = NO;
+    handler.validator = nil;
+    [_sessionTaskHandlers removeObjectForKey:task];
+    _sessionTaskHandlers[restartedTask] = handler;
+    operation.task = restartedTask;
+    [_taskQueue resumeTask:restartedTask];
+    return YES;
 }
 
 - (NSURLRequest *)_URLRequestForImageRequest:(DFImageRequest *)imageRequest {
@@ -214,11 +316,20 @@ static inline float _DFSessionTaskPriorityForRequestPriority(DFImageRequestPrior
 - (NSURLRequest *)_defaultURLRequestForImageRequest:(DFImageRequest *)imageRequest {
     NSMutableURLRequest *URLRequest = [[NSMutableURLRequest alloc] initWithURL:(NSURL *)imageRequest.resource];
     DFImageRequestOptions *options = imageRequest.options;
+    NSDictionary *revalidationInfo = options.userInfo[DFImageRequestRevalidationInfoKey];
     if (options.userInfo[DFURLRequestCachePolicyKey]) {
         URLRequest.cachePolicy = [options.userInfo[DFURLRequestCachePolicyKey] unsignedIntegerValue];
+    } else if (revalidationInfo && options.allowsNetworkAccess) {
+        URLRequest.cachePolicy = NSURLRequestReloadIgnoringLocalCacheData;
     } else {
         URLRequest.cachePolicy = options.allowsNetworkAccess ? self.session.configuration.requestCachePolicy : NSURLRequestReturnCacheDataDontLoad;
     }
+    NSString *validator = [revalidationInfo isKindOfClass:[NSDictionary class]] ? revalidationInfo[DFImageInfoValidatorKey] : nil;
+    if (validator && [URLRequest.URL.scheme hasPrefix:@"http"]) {
+        // Entity tags are always quoted, otherwise the validator is the last modification date
+        BOOL isEntityTag = [validator hasPrefix:@"\""] || [validator hasPrefix:@"W/"];
+        [URLRequest setValue:validator forHTTPHeaderField:(isEntityTag ? @"If-None-Match" : @"If-Modified-Since")];
+    }
     return [URLRequest copy];
 }
 
@@ -231,36 +342,174 @@ static inline float _DFSessionTaskPriorityForRequestPriority(DFImageRequestPrior
 
 - (void)removeAllCachedImages {
     [_session.configuration.URLCache removeAllCachedResponses];
+    [_partialDataStore removeAllPartialData];
+    [_diskCache removeAllData];
 }
 
 - (void)invalidate {
     [_session invalidateAndCancel];
 }
 
+#pragma mark Resuming
+
+/*! Returns the value of the header field using case-insensitive comparison of the field names.
+ */
+static NSString *_DFHeaderField(NSHTTPURLResponse *response, NSString *field) {
+    for (NSString *key in response.allHeaderFields) {
+        if ([key caseInsensitiveCompare:field] == NSOrderedSame) {
+            return response.allHeaderFields[key];
+        }
+    }
+    return nil;
+}
+
+/*! Returns the first byte position from the Content-Range header field ("bytes 100-999/1000"), or -1 if the field is missing or malformed.
+ */
+static long long _DFContentRangeStart(NSHTTPURLResponse *response) {
+    NSString *contentRange = _DFHeaderField(response, @"Content-Range");
+    if (!contentRange) {
+        return -1;
+    }
+    NSScanner *scanner = [NSScanner scannerWithString:contentRange];
+    long long start;
+    if ([scanner scanString:@"bytes" intoString:nil] && [scanner scanLongLong:&start]) {
+        return start;
+    }
+    return -1;
+}
+
+/*! Returns the validator that allows to resume the download of the response, nil if the download can't be resumed.
+ */
+static NSString *_DFResumeValidator(NSHTTPURLResponse *response) {
+    NSString *acceptRanges = _DFHeaderField(response, @"Accept-Ranges");
+    BOOL acceptsRanges = response.statusCode == 206 || (response.statusCode == 200 && acceptRanges && [acceptRanges caseInsensitiveCompare:@"bytes"] == NSOrderedSame);
+    if (!acceptsRanges) {
+        return nil;
+    }
+    NSString *ETag = _DFHeaderField(response, @"ETag");
+    // Weak entity tags can't be used in If-Range header field
+    if (ETag.length && ![ETag hasPrefix:@"W/"]) {
+        return ETag;
+    }
+    return _DFHeaderField(response, @"Last-Modified");
+}
+
+#pragma mark Validation
+
+static NSError *_DFDataLengthExceedsMaximumError(NSURLResponse *response) {
+    NSMutableDictionary *userInfo = [NSMutableDictionary new];
+    userInfo[DFURLErrorInfoURLResponseKey] = response;
+    userInfo[NSURLErrorFailingURLErrorKey] = response.URL;
+    return [NSError errorWithDomain:DFURLValidationErrorDomain code:NSURLErrorDataLengthExceedsMaximum userInfo:userInfo];
+}
+
+/*! Validates the response using its headers, before the body is downloaded. Returns nil if the response is valid.
+ */
+- (nullable NSError *)_errorForResponse:(nonnull NSURLResponse *)response dataTask:(nonnull NSURLSessionDataTask *)dataTask handler:(nonnull _DFURLSessionDataTaskHandler *)handler {
+    if ([response isKindOfClass:[NSHTTPURLResponse class]] && ((NSHTTPURLResponse *)response).statusCode == 304) {
+        return nil; // Revalidated image hasn't changed
+    }
+    NSError *error;
+    id<DFURLResponseValidating> validator = [self _responseValidatorForURLRequest:dataTask.currentRequest];
+    if ([validator respondsToSelector:@selector(isValidResponseHeaders:error:)] && ![validator isValidResponseHeaders:response error:&error]) {
+        return error ?: [NSError errorWithDomain:DFURLValidationErrorDomain code:NSURLErrorBadServerResponse userInfo:nil];
+    }
+    if (handler.maximumByteCount > 0 && response.expectedContentLength > handler.maximumByteCount - handler.resumedLength) {
+        return _DFDataLengthExceedsMaximumError(response);
+    }
+    return nil;
+}
+
 #pragma mark <NSURLSessionDataTaskDelegate>
 
+- (void)URLSession:(NSURLSession *)session dataTask:(NSURLSessionDataTask *)dataTask didReceiveResponse:(NSURLResponse *)response completionHandler:(void (^)(NSURLSessionResponseDisposition))completionHandler {
+    NSURLSessionResponseDisposition disposition = NSURLSessionResponseAllow;
+    @synchronized(self) {
+        _DFURLSessionDataTaskHandler *handler = _sessionTaskHandlers[dataTask];
+        if ([response isKindOfClass:[NSHTTPURLResponse class]]) {
+            NSHTTPURLResponse *HTTPResponse = (NSHTTPURLResponse *)response;
+            NSData *resumedData = handler.resumedData.data;
+            handler.resumedData = nil;
+            if (HTTPResponse.statusCode == 206) {
+                if (resumedData && _DFContentRangeStart(HTTPResponse) == (long long)resumedData.length) {
+                    [handler.data appendData:resumedData];
+                    handler.resumedLength = (int64_t)resumedData.length;
+                    if (handler.progressHandler) {
+                        int64_t expectedLength = response.expectedContentLength;
+                        handler.progressHandler(resumedData, handler.resumedLength, (expectedLength >= 0 ? expectedLength + handler.resumedLength : -1));
+                    }
+                } else { // Server responded with the range that wasn't requested, the partial data can't be used
+                    handler.needsRestartWithoutRange = YES;
+                    disposition = NSURLSessionResponseCancel;
+                }
+            }
+            handler.validator = _DFResumeValidator(HTTPResponse);
+        }
+        if (handler.needsRestartWithoutRange) {
+            handler.validator = nil;
+        }
+        if (disposition == NSURLSessionResponseAllow && handler) {
+            handler.error = [self _errorForResponse:response dataTask:dataTask handler:handler];
+            if (handler.error) { // Don't download the error page, or the image that is too large
+                handler.validator = nil;
+                disposition = NSURLSessionResponseCancel;
+            }
+        }
+    }
+    completionHandler(disposition);
+}
+
 - (void)URLSession:(NSURLSession *)session dataTask:(NSURLSessionDataTask *)dataTask didReceiveData:(NSData *)data {
     @synchronized(self) {
         _DFURLSessionDataTaskHandler *handler = _sessionTaskHandlers[dataTask];
         if (handler.progressHandler) {
-            handler.progressHandler(data, dataTask.countOfBytesReceived, dataTask.countOfBytesExpectedToReceive);
+            int64_t expectedLength = dataTask.countOfBytesExpectedToReceive;
+            handler.progressHandler(data, dataTask.countOfBytesReceived + handler.resumedLength, (expectedLength >= 0 ? expectedLength + handler.resumedLength : expectedLength));
         }
         [handler.data appendData:data];
+        if (handler.maximumByteCount > 0 && (int64_t)handler.data.length > handler.maximumByteCount && !handler.error) {
+            // The server didn't report the content length or reported the wrong one
+            handler.error = _DFDataLengthExceedsMaximumError(dataTask.response);
+            handler.validator = nil;
+            [dataTask cancel];
+        }
     }
 }
 
 - (void)URLSession:(NSURLSession *)session task:(NSURLSessionTask *)task didCompleteWithError:(NSError *)error {
     @synchronized(self) {
         _DFURLSessionDataTaskHandler *handler = _sessionTaskHandlers[task];
-        NSData *data = handler.data;
-        if (data) {
+        if (handler.needsRestartWithoutRange && [self _restartTask:task withoutRangeWithHandler:handler]) {
+            return;
+        }
+        if (error && handler.validator && handler.data.length && task.originalRequest.URL) {
+            DFURLPartialData *partialData = [[DFURLPartialData alloc] initWithData:handler.data validator:handler.validator];
+            [self.partialDataStore storePartialData:partialData forURL:task.originalRequest.URL];
+        }
+        if (handler.error) {
+            error = handler.error;
+        }
+        NSData *data = handler.error ? nil : handler.data;
+        NSDictionary *info = DFImageInfoForURLResponse(task.response);
+        if ([task.response isKindOfClass:[NSHTTPURLResponse class]]) {
+            NSHTTPURLResponse *HTTPResponse = (NSHTTPURLResponse *)task.response;
+            if (!error && HTTPResponse.statusCode == 304) {
+                data = nil;
+                error = [NSError errorWithDomain:DFImageManagerErrorDomain code:DFImageManagerErrorNotModified userInfo:nil];
+            }
+        }
+        if (!error) { // Error responses often have no body
             id<DFURLResponseValidating> validator = [self _responseValidatorForURLRequest:task.currentRequest];
             if (validator && ![validator isValidResponse:task.response data:data error:&error]) {
                 data = nil;
             }
         }
+        NSString *cacheKey = DFDiskCacheKeyForURLRequest(task.originalRequest);
+        if (data.length && !error && cacheKey && DFDiskCacheCanStoreResponse(task.response)) {
+            [self.diskCache storeData:data info:DFDiskCacheInfoForStoring(info) forKey:cacheKey];
+        }
         if (handler.completionHandler) {
-            handler.completionHandler(data, nil, error);
+            handler.completionHandler(data, info, error);
         }
         [_sessionTaskHandlers removeObjectForKey:task];
     }
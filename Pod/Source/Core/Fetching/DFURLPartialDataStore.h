@@ -0,0 +1,64 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*! Partially downloaded data of the resource along with the validator (ETag or Last-Modified) that identifies the representation of the resource that the data belongs to.
+ */
+@interface DFURLPartialData : NSObject
+
+/*! The first bytes of the resource.
+ */
+@property (nonatomic, readonly) NSData *data;
+
+/*! The entity tag or the last modification date of the resource. Sent in If-Range header field when the download is resumed.
+ */
+@property (nonatomic, readonly) NSString *validator;
+
+/*! Initializes partial data with the first bytes of the resource and the resource validator.
+ */
+- (instancetype)initWithData:(NSData *)data validator:(NSString *)validator NS_DESIGNATED_INITIALIZER;
+
+/*! Unavailable initializer, please use designated initializer.
+ */
+- (nullable instancetype)init NS_UNAVAILABLE;
+
+@end
+
+
+/*! Bounded in-memory store for partially downloaded data. DFURLImageFetcher stores the data received by the interrupted fetches and resumes them later using Range requests.
+ @note Partial data is keyed by URL. The validator is sent in If-Range header field so that the download is resumed only if the resource hasn't changed, otherwise server responds with the entire resource.
+ @note Thread safe.
+ */
+@interface DFURLPartialDataStore : NSObject
+
+/*! The maximum total size of the stored data in bytes. The least recently stored data is removed first when the limit is exceeded. Default value is 16 Mb.
+ */
+@property (nonatomic) NSUInteger totalCostLimit;
+
+/*! Returns the total size of the stored data in bytes.
+ */
+@property (nonatomic, readonly) NSUInteger totalCost;
+
+/*! Stores partial data for a given URL replacing the existing data.
+ */
+- (void)storePartialData:(DFURLPartialData *)partialData forURL:(NSURL *)URL;
+
+/*! Returns partial data for a given URL.
+ */
+- (nullable DFURLPartialData *)partialDataForURL:(NSURL *)URL;
+
+/*! Removes and returns partial data for a given URL.
+ */
+- (nullable DFURLPartialData *)removePartialDataForURL:(NSURL *)URL;
+
+/*! Removes all partial data.
+ */
+- (void)removeAllPartialData;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,104 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import "DFImageManagerDefines.h"
+#import "DFURLPartialDataStore.h"
+
+@implementation DFURLPartialData
+
+DF_INIT_UNAVAILABLE_IMPL
+
+- (instancetype)initWithData:(NSData *)data validator:(NSString *)validator {
+    if (self = [super init]) {
+        _data = [data copy];
+        _validator = [validator copy];
+    }
+    return self;
+}
+
+@end
+
+
+@implementation DFURLPartialDataStore {
+    NSMutableDictionary /* NSURL : DFURLPartialData */ *_entries;
+    NSMutableOrderedSet /* NSURL */ *_URLs; // Ordered from the least recently stored
+    NSUInteger _totalCost;
+    NSLock *_lock;
+}
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _entries = [NSMutableDictionary new];
+        _URLs = [NSMutableOrderedSet new];
+        _lock = [NSLock new];
+        _totalCostLimit = 1024 * 1024 * 16;
+    }
+    return self;
+}
+
+- (void)setTotalCostLimit:(NSUInteger)totalCostLimit {
+    [_lock lock];
+    _totalCostLimit = totalCostLimit;
+    [self _trim];
+    [_lock unlock];
+}
+
+- (NSUInteger)totalCost {
+    [_lock lock];
+    NSUInteger totalCost = _totalCost;
+    [_lock unlock];
+    return totalCost;
+}
+
+- (void)storePartialData:(DFURLPartialData *)partialData forURL:(NSURL *)URL {
+    [_lock lock];
+    [self _removePartialDataForURL:URL];
+    if (partialData.data.length <= _totalCostLimit) {
+        _entries[URL] = partialData;
+        [_URLs addObject:URL];
+        _totalCost += partialData.data.length;
+        [self _trim];
+    }
+    [_lock unlock];
+}
+
+- (nullable DFURLPartialData *)partialDataForURL:(NSURL *)URL {
+    [_lock lock];
+    DFURLPartialData *partialData = _entries[URL];
+    [_lock unlock];
+    return partialData;
+}
+
+- (nullable DFURLPartialData *)removePartialDataForURL:(NSURL *)URL {
+    [_lock lock];
+    DFURLPartialData *partialData = [self _removePartialDataForURL:URL];
+    [_lock unlock];
+    return partialData;
+}
+
+- (void)removeAllPartialData {
+    [_lock lock];
+    [_entries removeAllObjects];
+    [_URLs removeAllObjects];
+    _totalCost = 0;
+    [_lock unlock];
+}
+
+- (nullable DFURLPartialData *)_removePartialDataForURL:(NSURL *)URL {
+    DFURLPartialData *partialData = _entries[URL];
+    if (partialData) {
+        [_entries removeObjectForKey:URL];
+        [_URLs removeObject:URL];
+        _totalCost -= partialData.data.length;
+    }
+    return partialData;
+}
+
+- (void)_trim {
+    while (_totalCost > _totalCostLimit && _URLs.count) {
+        [self _removePartialDataForURL:_URLs.firstObject];
+    }
+}
+
+@end
@@ -22,6 +22,12 @@ static NSString *const DFURLErrorInfoURLResponseKey = @"DFURLErrorInfoURLRespons
  */
 - (BOOL)isValidResponse:(nullable NSURLResponse *)response data:(nullable NSData *)data error:(NSError **)error;
 
+@optional
+
+/*! Validates the response as soon as its headers are received, before the data is downloaded. The responses that fail validation are cancelled.
+ */
+- (BOOL)isValidResponseHeaders:(nullable NSURLResponse *)response error:(NSError **)error;
+
 @end
 
 NS_ASSUME_NONNULL_END
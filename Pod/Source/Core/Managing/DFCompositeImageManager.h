@@ -8,6 +8,7 @@
 /*! The DFCompositeImageManager is a dynamic dispatcher that constructs a tree of responsibility from multiple image managers and dynamically dispatch requests between them. 
  @note Each image manager defines which image requests it can handle. The DFCompositeImageManager dispatches image requests starting with the first image manager in a chain. If the image manager can't handle the request it is passes to the next image manager in the chain and so on.
  @note The DFCompositeImageManager also conforms to DFImageManaging protocol so that individual managers and compositions can be treated uniformly.
+ @note The composed image managers don't share resources unless they are created with configurations that share the budget, the decoding and processing queues and the memory cache (see DFImageManagerBudget).
  */
 @interface DFCompositeImageManager : NSObject <DFImageManaging>
 
@@ -5,16 +5,6 @@
 #import "DFCompositeImageManager.h"
 #import "DFImageRequest.h"
 
-#define DFManagerForRequest(request) ({ \
-    id<DFImageManaging> __df_outManager; \
-    for (id<DFImageManaging> __df_manager in _managers) { \
-        if ([__df_manager canHandleRequest:request]) { \
-            __df_outManager = __df_manager; \
-            break; \
-        } \
-    } \
-    __df_outManager; })
-
 @implementation DFCompositeImageManager {
     NSMutableArray<id<DFImageManaging>> *_managers;
 }
@@ -38,10 +28,21 @@
     [_managers removeObject:imageManager];
 }
 
+/*! Returns the first image manager in the chain that can handle the request.
+ */
+- (nullable id<DFImageManaging>)_managerForRequest:(nonnull DFImageRequest *)request {
+    for (id<DFImageManaging> manager in _managers) {
+        if ([manager canHandleRequest:request]) {
+            return manager;
+        }
+    }
+    return nil;
+}
+
 #pragma mark <DFImageManaging>
 
 - (BOOL)canHandleRequest:(nonnull DFImageRequest *)request {
-    return DFManagerForRequest(request) != nil;
+    return [self _managerForRequest:request] != nil;
 }
 
 - (nonnull DFImageTask *)imageTaskForResource:(nonnull id)resource completion:(nullable DFImageTaskCompletion)completion {
@@ -49,7 +50,7 @@
 }
 
 - (nonnull DFImageTask *)imageTaskForRequest:(nonnull DFImageRequest *)request completion:(nullable DFImageTaskCompletion)completion {
-    id<DFImageManaging> manager = DFManagerForRequest(request);
+    id<DFImageManaging> manager = [self _managerForRequest:request];
     if (!manager) {
         [NSException raise:NSInvalidArgumentException format:@"There are no managers that can handle the request %@", request];
     }
@@ -98,7 +99,7 @@
     NSMapTable *table = [NSMapTable strongToStrongObjectsMapTable];
     for (DFImageRequest *request in inputRequests) {
         if (![manager canHandleRequest:request]) {
-            manager = DFManagerForRequest(request);
+            manager = [self _managerForRequest:request];
             if (!manager) {
                 [NSException raise:NSInvalidArgumentException format:@"There are no managers that can handle the request %@", request];
             }
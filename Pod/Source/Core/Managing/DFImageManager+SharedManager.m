@@ -3,9 +3,12 @@
 // Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
 
 #import "DFCompositeImageManager.h"
+#import "DFDiskCache.h"
 #import "DFImageCache.h"
+#import "DFImageDataCache.h"
 #import "DFImageDecoder.h"
 #import "DFImageManager.h"
+#import "DFImageManagerBudget.h"
 #import "DFImageManagerConfiguration.h"
 #import "DFImageProcessor.h"
 #import "DFURLImageFetcher.h"
@@ -63,16 +66,24 @@ static OSSpinLock _lock = OS_SPINLOCK_INIT;
     [managers addObject:({
         AFHTTPSessionManager *sessionManager = [[AFHTTPSessionManager alloc] initWithSessionConfiguration:[self _defaultSessionConfiguration]];
         sessionManager.responseSerializer = [AFHTTPResponseSerializer new];
-        conf.fetcher = [[DFAFImageFetcher alloc] initWithSessionManager:sessionManager];
+        DFAFImageFetcher *fetcher = [[DFAFImageFetcher alloc] initWithSessionManager:sessionManager];
+        fetcher.diskCache = [self _defaultDiskCache];
+        conf.fetcher = fetcher;
+        conf.warmStartDirectoryURL = [self _defaultWarmStartDirectoryURL];
         [[DFImageManager alloc] initWithConfiguration:conf];
     })];
 #else
     [managers addObject:({
-        conf.fetcher = [[DFURLImageFetcher alloc] initWithSessionConfiguration:[self _defaultSessionConfiguration]];
+        DFURLImageFetcher *fetcher = [[DFURLImageFetcher alloc] initWithSessionConfiguration:[self _defaultSessionConfiguration]];
+        fetcher.diskCache = [self _defaultDiskCache];
+        conf.fetcher = fetcher;
+        conf.warmStartDirectoryURL = [self _defaultWarmStartDirectoryURL];
         [[DFImageManager alloc] initWithConfiguration:conf];
     })];
 #endif
 
+    conf.warmStartDirectoryURL = nil; // Managers must not share the snapshot
+
 #if DF_SUBSPEC_PHOTOSKIT_ENABLED
     [managers addObject:({
         conf.fetcher = [DFPhotosKitImageFetcher new];
@@ -107,13 +118,46 @@ static OSSpinLock _lock = OS_SPINLOCK_INIT;
         processor;
     });
     
+    // Image managers created with the same configuration share the cache, the queues and the budget
     conf.cache = [DFImageCache new];
+    conf.dataCache = [DFImageDataCache new];
+    conf.budget = [DFImageManagerBudget new];
     return conf;
 }
 
++ (DFDiskCache *)_defaultDiskCache {
+    [self _removeLegacyURLCache];
+    return [[DFDiskCache alloc] initWithName:@"com.github.kean.DFImageManager.DiskCache" capacity:1024 * 1024 * 200];
+}
+
+/*! Removes the NSURLCache that was used by the previous versions, its data is never read by the DFDiskCache. NSURLCache keeps the disk path relative to the caches directory (or to the bundle identifier directory in the caches on OS X).
+ */
++ (void)_removeLegacyURLCache {
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0), ^{
+            NSString *const diskPath = @"com.github.kean.default_image_cache";
+            NSString *cachesPath = NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES).firstObject;
+            NSString *bundleIdentifier = [NSBundle mainBundle].bundleIdentifier;
+            NSMutableArray *paths = [NSMutableArray arrayWithObject:[cachesPath stringByAppendingPathComponent:diskPath]];
+            if (bundleIdentifier) {
+                [paths addObject:[[cachesPath stringByAppendingPathComponent:bundleIdentifier] stringByAppendingPathComponent:diskPath]];
+            }
+            for (NSString *path in paths) {
+                [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+            }
+        });
+    });
+}
+
++ (NSURL *)_defaultWarmStartDirectoryURL {
+    NSURL *cachesURL = [[NSFileManager defaultManager] URLsForDirectory:NSCachesDirectory inDomains:NSUserDomainMask].firstObject;
+    return [cachesURL URLByAppendingPathComponent:@"com.github.kean.DFImageManager.WarmStart" isDirectory:YES];
+}
+
 + (NSURLSessionConfiguration *)_defaultSessionConfiguration {
     NSURLSessionConfiguration *conf = [NSURLSessionConfiguration defaultSessionConfiguration];
-    conf.URLCache = [[NSURLCache alloc] initWithMemoryCapacity:0 diskCapacity:1024 * 1024 * 200 diskPath:@"com.github.kean.default_image_cache"];
+    conf.URLCache = nil; // Image data is cached by DFDiskCache
 #if DF_SUBSPEC_WEBP_ENABLED
     conf.HTTPAdditionalHeaders = @{ @"Accept" : @"image/webp,image/*;q=0.8" };
 #else
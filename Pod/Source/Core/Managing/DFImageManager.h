@@ -2,10 +2,48 @@
 //
 // Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
 
+#import "DFImageManagerDefines.h"
 #import "DFImageManaging.h"
 #import <Foundation/Foundation.h>
 
+@class DFImageHeaderInfo;
 @class DFImageManagerConfiguration;
+@class DFImagePrefetchJob;
+@protocol DFImageFetchingOperation;
+
+/*! Snapshot of the DFImageManager statistics: the number of images loaded from each tier (memory cache, decoded image cache, data cache, fetcher) and the average latency of the loads.
+ */
+@interface DFImageManagerStatistics : NSObject
+
+/*! Total number of images loaded from all the tiers.
+ */
+@property (nonatomic, readonly) NSUInteger loadCount;
+
+/*! Returns the number of images loaded from a given tier.
+ */
+- (NSUInteger)loadCountForSource:(DFImageSource)source;
+
+/*! Returns the average time it took to load the image from a given tier, or 0 if there were no loads. The latency is measured from the moment the image manager starts loading the image (the time the task spends waiting for the free slot in the budget is not included).
+ */
+- (NSTimeInterval)averageLatencyForSource:(DFImageSource)source;
+
+/*! The number of fetches that were cancelled because all of their tasks were cancelled.
+ */
+@property (nonatomic, readonly) NSUInteger cancelledFetchCount;
+
+/*! The number of bytes received by the cancelled fetches (see cancelledFetchCount).
+ */
+@property (nonatomic, readonly) int64_t wastedByteCount;
+
+/*! The number of fetches that kept running after all of their tasks were cancelled (see orphanedFetchProgressThreshold property of DFImageManagerConfiguration).
+ */
+@property (nonatomic, readonly) NSUInteger keptAliveFetchCount;
+
+/*! The number of times the task was attached to the fetch that was kept alive.
+ */
+@property (nonatomic, readonly) NSUInteger reattachedFetchCount;
+
+@end
 
 /*! The DFImageManager manages execution of image tasks by delegating the actual job to the objects conforming to DFImageFetching, DFImageCaching, DFImageDecoding, and DFImageProcessing protocols.
  
@@ -27,6 +65,31 @@
  */
 - (nullable instancetype)init NS_UNAVAILABLE;
 
+/*! Creates a job that prefetches images for a large number of requests in background (see DFImagePrefetchJob). After you create the job, you must start it by calling its resume method.
+ */
+- (nonnull DFImagePrefetchJob *)prefetchJobWithRequests:(nonnull NSArray<DFImageRequest *> *)requests;
+
+/*! Fetches the beginning of the image data and parses the header of the image (see DFImageHeaderInfo). The fetch is cancelled as soon as the header is parsed. The completion handler is called on the main thread, the header info is nil if the data is not a supported image.
+ @note Use the returned operation to cancel probing, the completion handler is not called after the operation is cancelled.
+ */
+- (nonnull id<DFImageFetchingOperation>)probeHeaderInfoForRequest:(nonnull DFImageRequest *)request completion:(void (^__nonnull)(DFImageHeaderInfo *__nullable headerInfo, NSError *__nullable error))completion;
+
+/*! Writes the images for the most frequently and recently used requests that are still in the memory cache to the warm start snapshot (see warmStartDirectoryURL property of DFImageManagerConfiguration). Called automatically (in a background task) when the application enters background. The completion handler is called on the main thread.
+ */
+- (void)writeWarmStartSnapshotWithCompletion:(void (^__nullable)(BOOL success))completion;
+
+/*! Asynchronously loads the images from the warm start snapshot into the memory cache, the most valuable images are loaded first. Called automatically when the image manager is created. The completion handler is called on the main thread with the number of images that were put into the memory cache.
+ */
+- (void)loadWarmStartSnapshotWithCompletion:(void (^__nullable)(NSUInteger imageCount))completion;
+
+/*! Returns a snapshot of the image manager statistics.
+ */
+- (nonnull DFImageManagerStatistics *)statistics;
+
+/*! Resets the image manager statistics.
+ */
+- (void)resetStatistics;
+
 @end
 
 
@@ -4,15 +4,102 @@
 
 #import "DFCachedImageResponse.h"
 #import "DFImageCaching.h"
+#import "DFImageDataCache.h"
 #import "DFImageFetching.h"
+#import "DFImageFetchingOperation.h"
+#import "DFImageHeaderInfo.h"
 #import "DFImageManager.h"
+#import "DFImageManagerBudget.h"
 #import "DFImageManagerConfiguration.h"
 #import "DFImageManagerDefines.h"
 #import "DFImageManagerLoader.h"
+#import "DFImagePrefetchJobManaging.h"
+#import "DFImagePreviewProviding.h"
 #import "DFImageRequest.h"
 #import "DFImageRequestOptions.h"
 #import "DFImageResponse.h"
 #import "DFImageTask.h"
+#import "DFImageTraceRecorder.h"
+#import "DFImageWarmStartSnapshot.h"
+#import "UIImage+DFImageUtilities.h"
+#import <QuartzCore/QuartzCore.h>
+
+#pragma mark - DFImageManagerStatistics
+
+static const NSUInteger _DFImageSourceCount = DFImageSourceFetcher + 1;
+
+@implementation DFImageManagerStatistics {
+    @public
+    NSUInteger _loadCounts[_DFImageSourceCount];
+    NSTimeInterval _totalLatencies[_DFImageSourceCount];
+    NSUInteger _cancelledFetchCount;
+    int64_t _wastedByteCount;
+    NSUInteger _keptAliveFetchCount;
+    NSUInteger _reattachedFetchCount;
+}
+
+- (void)_recordLoadFromSource:(DFImageSource)source latency:(NSTimeInterval)latency {
+    if (source < _DFImageSourceCount) {
+        _loadCounts[source]++;
+        _totalLatencies[source] += MAX(latency, 0.0);
+    }
+}
+
+- (void)_recordOrphanedFetchEvent:(DFImageLoaderOrphanedFetchEvent)event byteCount:(int64_t)byteCount {
+    switch (event) {
+        case DFImageLoaderOrphanedFetchEventCancelled:
+            _cancelledFetchCount++;
+            _wastedByteCount += MAX(byteCount, 0);
+            break;
+        case DFImageLoaderOrphanedFetchEventKeptAlive: _keptAliveFetchCount++; break;
+        case DFImageLoaderOrphanedFetchEventReattached: _reattachedFetchCount++; break;
+    }
+}
+
+- (NSUInteger)loadCount {
+    NSUInteger loadCount = 0;
+    for (NSUInteger i = 0; i < _DFImageSourceCount; i++) {
+        loadCount += _loadCounts[i];
+    }
+    return loadCount;
+}
+
+- (NSUInteger)loadCountForSource:(DFImageSource)source {
+    return source < _DFImageSourceCount ? _loadCounts[source] : 0;
+}
+
+- (NSTimeInterval)averageLatencyForSource:(DFImageSource)source {
+    NSUInteger loadCount = [self loadCountForSource:source];
+    return loadCount > 0 ? _totalLatencies[source] / loadCount : 0.0;
+}
+
+- (NSUInteger)cancelledFetchCount {
+    return _cancelledFetchCount;
+}
+
+- (int64_t)wastedByteCount {
+    return _wastedByteCount;
+}
+
+- (NSUInteger)keptAliveFetchCount {
+    return _keptAliveFetchCount;
+}
+
+- (NSUInteger)reattachedFetchCount {
+    return _reattachedFetchCount;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@ %p> { memory cache = %lu (%.4fs), decoded image cache = %lu (%.4fs), data cache = %lu (%.4fs), fetcher = %lu (%.4fs), cancelled fetches = %lu (%lli bytes wasted), kept alive fetches = %lu, reattached fetches = %lu }", [self class], self,
+            (unsigned long)_loadCounts[DFImageSourceMemoryCache], [self averageLatencyForSource:DFImageSourceMemoryCache],
+            (unsigned long)_loadCounts[DFImageSourceDecodedImageCache], [self averageLatencyForSource:DFImageSourceDecodedImageCache],
+            (unsigned long)_loadCounts[DFImageSourceDataCache], [self averageLatencyForSource:DFImageSourceDataCache],
+            (unsigned long)_loadCounts[DFImageSourceFetcher], [self averageLatencyForSource:DFImageSourceFetcher],
+            (unsigned long)_cancelledFetchCount, _wastedByteCount, (unsigned long)_keptAliveFetchCount, (unsigned long)_reattachedFetchCount];
+}
+
+@end
+
 
 #pragma mark - _DFImageTask
 
@@ -34,20 +121,52 @@
 @property (nullable, atomic) NSProgress *internalProgress;
 @property (nullable, atomic) UIImage *image;
 @property (nullable, atomic) NSError *error;
-@property (nullable, atomic) DFImageResponse *response;
+@property (nullable, nonatomic) id<NSCopying> cacheKey;
 @property (nonatomic) NSInteger tag;
 @property (nonatomic) BOOL preheating;
+@property (nonatomic) BOOL prefetching;
+@property (nonatomic) BOOL fetchingDataOnly;
+@property (nonatomic) BOOL revalidating;
+@property (nonatomic) CFTimeInterval resumeTime;
+@property (atomic) NSTimeInterval timeToFirstImage;
+@property (nullable, nonatomic) _DFImageTask *previewTask;
+
+/*! The response is created lazily, when it is first accessed.
+ */
+- (void)setResponseWithInfo:(nullable NSDictionary *)info isFastResponse:(BOOL)isFastResponse isStale:(BOOL)isStale fetchedByteCount:(int64_t)fetchedByteCount;
 
 @end
 
-@implementation _DFImageTask
+/*! Returns the shared response for the loads that have no info, DFImageResponse is immutable.
+ */
+static DFImageResponse *_DFSharedImageResponse(BOOL isFastResponse, BOOL isStale) {
+    static DFImageResponse *responses[2][2];
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        for (NSInteger fast = 0; fast < 2; fast++) {
+            for (NSInteger stale = 0; stale < 2; stale++) {
+                responses[fast][stale] = [[DFImageResponse alloc] initWithInfo:nil isFastResponse:fast isStale:stale];
+            }
+        }
+    });
+    return responses[isFastResponse ? 1 : 0][isStale ? 1 : 0];
+}
+
+@implementation _DFImageTask {
+    DFImageResponse *_response;
+    NSDictionary *_responseInfo;
+    BOOL _hasResponse;
+    BOOL _isFastResponse;
+    BOOL _isStaleResponse;
+    int64_t _fetchedByteCount;
+}
 
 @synthesize completionHandler = _completionHandler;
 @synthesize request = _request;
 @synthesize priority = _priority;
 @synthesize error = _error;
-@synthesize response = _response;
 @synthesize state = _state;
+@synthesize timeToFirstImage = _timeToFirstImage;
 
 - (instancetype)initWithManager:(nonnull id<_DFImageTaskManaging>)manager request:(nonnull DFImageRequest *)request completionHandler:(nullable DFImageTaskCompletion)completionHandler {
     if (self = [super init]) {
@@ -79,6 +198,27 @@
     return [self.manager progressForManagedTask:self];
 }
 
+- (void)setResponseWithInfo:(nullable NSDictionary *)info isFastResponse:(BOOL)isFastResponse isStale:(BOOL)isStale fetchedByteCount:(int64_t)fetchedByteCount {
+    @synchronized(self) {
+        _response = nil;
+        _responseInfo = info;
+        _hasResponse = YES;
+        _isFastResponse = isFastResponse;
+        _isStaleResponse = isStale;
+        _fetchedByteCount = fetchedByteCount;
+    }
+}
+
+- (nullable DFImageResponse *)response {
+    @synchronized(self) {
+        if (!_response && _hasResponse) {
+            _response = (_responseInfo || _fetchedByteCount) ? [[DFImageResponse alloc] initWithInfo:_responseInfo isFastResponse:_isFastResponse isStale:_isStaleResponse fetchedByteCount:_fetchedByteCount] : _DFSharedImageResponse(_isFastResponse, _isStaleResponse);
+            _responseInfo = nil;
+        }
+        return _response;
+    }
+}
+
 - (BOOL)isValidNextState:(DFImageTaskState)nextState {
     switch (self.state) {
         case DFImageTaskStateSuspended:
@@ -94,22 +234,134 @@
 @end
 
 
+#pragma mark - _DFImageHeaderProbe
+
+/*! Accumulates the fetched data until the image header can be parsed, then cancels the fetch.
+ */
+@interface _DFImageHeaderProbe : NSObject <DFImageFetchingOperation>
+
+@property (nullable, nonatomic) id<DFImageFetchingOperation> operation;
+
+@end
+
+@implementation _DFImageHeaderProbe {
+    NSMutableData *_data;
+    void (^_completion)(DFImageHeaderInfo *, NSError *);
+}
+
+- (nonnull instancetype)initWithCompletion:(void (^__nonnull)(DFImageHeaderInfo *__nullable, NSError *__nullable))completion {
+    if (self = [super init]) {
+        _data = [NSMutableData new];
+        _completion = [completion copy];
+    }
+    return self;
+}
+
+- (void)setOperation:(nullable id<DFImageFetchingOperation>)operation {
+    BOOL isFinished;
+    @synchronized(self) {
+        _operation = operation;
+        isFinished = _completion == nil;
+    }
+    if (isFinished) { // The header was parsed before the fetcher returned the operation
+        [operation cancelImageFetching];
+    }
+}
+
+- (void)appendData:(nullable NSData *)data {
+    DFImageHeaderInfo *headerInfo;
+    @synchronized(self) {
+        if (!_completion || !data.length) {
+            return;
+        }
+        [_data appendData:data];
+        headerInfo = [DFImageHeaderInfo headerInfoWithData:_data];
+        BOOL isUnknownFormat = _data.length >= 12 && [DFImageHeaderInfo formatForData:_data] == DFImageFormatUnknown;
+        if (!headerInfo && !isUnknownFormat) {
+            return;
+        }
+    }
+    [self _finishWithHeaderInfo:headerInfo error:nil];
+    [self.operation cancelImageFetching];
+}
+
+- (void)didCompleteWithData:(nullable NSData *)data error:(nullable NSError *)error {
+    DFImageHeaderInfo *headerInfo;
+    @synchronized(self) {
+        if (!_completion) {
+            return;
+        }
+        // The fetcher might not report the progress (e.g. when reading from the disk cache)
+        headerInfo = [DFImageHeaderInfo headerInfoWithData:(data.length ? data : _data)];
+    }
+    [self _finishWithHeaderInfo:headerInfo error:(headerInfo ? nil : error)];
+}
+
+- (void)_finishWithHeaderInfo:(nullable DFImageHeaderInfo *)headerInfo error:(nullable NSError *)error {
+    void (^completion)(DFImageHeaderInfo *, NSError *);
+    @synchronized(self) {
+        completion = _completion;
+        _completion = nil;
+        _data = nil;
+    }
+    if (completion) {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            completion(headerInfo, error);
+        });
+    }
+}
+
+- (void)cancelImageFetching {
+    @synchronized(self) {
+        _completion = nil;
+        _data = nil;
+    }
+    [self.operation cancelImageFetching];
+}
+
+- (void)setImageFetchingPriority:(DFImageRequestPriority)priority {
+    [self.operation setImageFetchingPriority:priority];
+}
+
+@end
+
+
 #pragma mark - DFImageManager
 
 static inline void DFDispatchAsync(dispatch_block_t block) {
     ([NSThread isMainThread]) ? block() : dispatch_async(dispatch_get_main_queue(), block);
 }
 
-@interface DFImageManager () <_DFImageTaskManaging, DFImageManagerLoaderDelegate>
+/*! Returns the shared error with a given code, the errors are immutable and the tasks are cancelled often (e.g. when scrolling fast).
+ */
+static NSError *_DFImageManagerError(NSInteger code) {
+    static NSError *cancelledError;
+    static NSError *unknownError;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        cancelledError = [NSError errorWithDomain:DFImageManagerErrorDomain code:DFImageManagerErrorCancelled userInfo:nil];
+        unknownError = [NSError errorWithDomain:DFImageManagerErrorDomain code:DFImageManagerErrorUnknown userInfo:nil];
+    });
+    return code == DFImageManagerErrorCancelled ? cancelledError : unknownError;
+}
+
+@interface DFImageManager () <_DFImageTaskManaging, DFImageManagerLoaderDelegate, DFImagePrefetchJobManaging>
 
 @property (nonnull, nonatomic, readonly) DFImageManagerLoader *imageLoader;
+@property (nonnull, nonatomic, readonly) DFImageManagerBudget *budget;
 @property (nonnull, nonatomic, readonly) NSMutableSet /* _DFImageTask */ *executingTasks;
+@property (nonnull, nonatomic, readonly) NSMutableArray /* _DFImageTask */ *pendingTasks;
 @property (nonnull, nonatomic, readonly) NSMutableDictionary /* _DFImageCacheKey : _DFImageTask */ *preheatingTasks;
+@property (nonnull, nonatomic, readonly) NSMutableSet /* DFImagePrefetchJob */ *prefetchJobs;
+@property (nonnull, nonatomic, readonly) NSMutableDictionary /* _DFImageCacheKey : NSMutableArray<_DFImageTask> */ *revalidatedTasks;
 @property (nonnull, nonatomic, readonly) NSRecursiveLock *recursiveLock;
+@property (nullable, nonatomic, readonly) DFImageWarmStartSnapshot *warmStartSnapshot;
+@property (nullable, nonatomic, readonly) dispatch_queue_t warmStartQueue;
 
 @end
 
 @implementation DFImageManager {
+    DFImageManagerStatistics *_statistics;
     NSInteger _preheatingTaskCounter;
     BOOL _invalidated;
     BOOL _needsToExecutePreheatingTasks;
@@ -125,11 +377,33 @@ DF_INIT_UNAVAILABLE_IMPL
         _imageLoader.delegate = self;
         _preheatingTasks = [NSMutableDictionary new];
         _executingTasks = [NSMutableSet new];
+        _pendingTasks = [NSMutableArray new];
+        _prefetchJobs = [NSMutableSet new];
+        _revalidatedTasks = [NSMutableDictionary new];
+        _statistics = [DFImageManagerStatistics new];
         _recursiveLock = [NSRecursiveLock new];
+        _budget = _configuration.budget;
+        if (!_budget) {
+            _budget = [DFImageManagerBudget new];
+            _budget.maximumConcurrentPreheatingRequests = _configuration.maximumConcurrentPreheatingRequests;
+        }
+        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(_budgetDidReleaseRequest:) name:DFImageManagerBudgetDidReleaseRequestNotification object:_budget];
+        if (_configuration.warmStartDirectoryURL) {
+            _warmStartSnapshot = [[DFImageWarmStartSnapshot alloc] initWithDirectoryURL:_configuration.warmStartDirectoryURL countLimit:_configuration.warmStartImageCountLimit];
+            _warmStartQueue = dispatch_queue_create("DFImageManager::WarmStartQueue", dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0));
+#if TARGET_OS_IOS && !TARGET_OS_WATCH
+            [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(_applicationDidEnterBackground:) name:UIApplicationDidEnterBackgroundNotification object:nil];
+#endif
+            [self loadWarmStartSnapshotWithCompletion:nil];
+        }
     }
     return self;
 }
 
+- (void)dealloc {
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+}
+
 - (void)_performBlock:(__attribute__((noescape)) void (^__nonnull)(void))block {
     [_recursiveLock lock];
     if (!_invalidated) {
@@ -159,7 +433,7 @@ DF_INIT_UNAVAILABLE_IMPL
     NSMutableSet *tasks = [NSMutableSet new];
     NSMutableSet *preheatingTasks = [NSMutableSet new];
     [self _performBlock:^{
-        for (_DFImageTask *task in _executingTasks) {
+        for (_DFImageTask *task in [_executingTasks.allObjects arrayByAddingObjectsFromArray:_pendingTasks]) {
             [(task.preheating ? preheatingTasks : tasks) addObject:task];
         }
         [preheatingTasks addObjectsFromArray:_preheatingTasks.allValues];
@@ -172,8 +446,12 @@ DF_INIT_UNAVAILABLE_IMPL
 - (void)invalidateAndCancel {
     [self _performBlock:^{
         [_preheatingTasks removeAllObjects];
+        [_revalidatedTasks removeAllObjects];
+        for (DFImagePrefetchJob *job in _prefetchJobs.allObjects) {
+            [job cancel];
+        }
         _imageLoader.delegate = nil;
-        for (_DFImageTask *task in _executingTasks.allObjects) {
+        for (_DFImageTask *task in [_executingTasks.allObjects arrayByAddingObjectsFromArray:_pendingTasks]) {
             [self _setState:DFImageTaskStateCancelled forTask:task];
         }
         if ([_configuration.fetcher respondsToSelector:@selector(invalidate)]) {
@@ -185,6 +463,9 @@ DF_INIT_UNAVAILABLE_IMPL
 
 - (void)removeAllCachedImages {
     [_configuration.cache removeAllObjects];
+    [_configuration.dataCache removeAllData];
+    [_imageLoader removeAllDecodedImages];
+    [_imageLoader removeAllFailures];
     if ([_configuration.fetcher respondsToSelector:@selector(removeAllCachedImages)]) {
         [_configuration.fetcher removeAllCachedImages];
     }
@@ -193,12 +474,15 @@ DF_INIT_UNAVAILABLE_IMPL
 #pragma mark <DFImageManaging> (Preheating)
 
 - (void)startPreheatingImagesForRequests:(nonnull NSArray *)requests {
+    [_configuration.traceRecorder recordStartPreheatingForRequests:requests];
     [self _performBlock:^{
         for (DFImageRequest *request in requests) {
             id<NSCopying> key = [_imageLoader preheatingKeyForRequest:request];
             if (!_preheatingTasks[key]) {
                 _DFImageTask *task = [[_DFImageTask alloc] initWithManager:self request:request completionHandler:nil];
+                task.cacheKey = key;
                 task.preheating = YES;
+                task.priority = DFImageRequestPriorityLow; // The visible requests overtake the preheating at every stage
                 task.tag = _preheatingTaskCounter++;
                 _preheatingTasks[key] = task;
             }
@@ -208,6 +492,7 @@ DF_INIT_UNAVAILABLE_IMPL
 }
 
 - (void)stopPreheatingImagesForRequests:(nonnull NSArray *)requests {
+    [_configuration.traceRecorder recordStopPreheatingForRequests:requests];
     [self _performBlock:^{
         for (DFImageRequest *request in requests) {
             id<NSCopying> key = [_imageLoader preheatingKeyForRequest:request];
@@ -220,6 +505,7 @@ DF_INIT_UNAVAILABLE_IMPL
 }
 
 - (void)stopPreheatingImagesForAllRequests {
+    [_configuration.traceRecorder recordStopPreheatingForAllRequests];
     [self _performBlock:^{
         for (_DFImageTask *task in _preheatingTasks.allValues) {
             [self _setState:DFImageTaskStateCancelled forTask:task];
@@ -242,24 +528,376 @@ DF_INIT_UNAVAILABLE_IMPL
 
 - (void)_executePreheatingTasksIfNeeded {
     _needsToExecutePreheatingTasks = NO;
-    NSUInteger executingTaskCount = _executingTasks.count;
-    if (executingTaskCount < _configuration.maximumConcurrentPreheatingRequests && _preheatingTasks.count) {
-        for (_DFImageTask *task in [_preheatingTasks.allValues sortedArrayUsingDescriptors:@[[NSSortDescriptor sortDescriptorWithKey:@"tag" ascending:YES]]]) {
-            if (executingTaskCount >= _configuration.maximumConcurrentPreheatingRequests) {
-                break;
+    if (_pendingTasks.count || !_preheatingTasks.count) {
+        return;
+    }
+    for (_DFImageTask *task in [_preheatingTasks.allValues sortedArrayUsingDescriptors:@[[NSSortDescriptor sortDescriptorWithKey:@"tag" ascending:YES]]]) {
+        if (task.state != DFImageTaskStateSuspended) {
+            continue;
+        }
+        if (![_budget reserveRequestForPreheating:YES]) {
+            break;
+        }
+        [self _setState:DFImageTaskStateRunning forTask:task];
+        if (![_executingTasks containsObject:task]) { // Completed from the memory cache
+            [_budget releaseRequest];
+        }
+    }
+}
+
+- (void)_budgetDidReleaseRequest:(NSNotification *)notification {
+    // The notification might be posted by another manager that holds its lock, execute asynchronously to avoid deadlocks.
+    typeof(self) __weak weakSelf = self;
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [weakSelf _performBlock:^{
+            [weakSelf _executePendingTasksIfNeeded];
+        }];
+    });
+}
+
+/*! Starts the tasks that are waiting for the slots in the budget, the tasks with higher priority are started first.
+ */
+- (void)_executePendingTasksIfNeeded {
+    while (_pendingTasks.count) {
+        _DFImageTask *nextTask;
+        for (_DFImageTask *task in _pendingTasks) {
+            if (!nextTask || task.priority > nextTask.priority) {
+                nextTask = task;
+            }
+        }
+        if (![_budget reserveRequestForPreheating:NO]) {
+            return;
+        }
+        [_pendingTasks removeObjectIdenticalTo:nextTask];
+        [_executingTasks addObject:nextTask];
+        [self _startLoadingForTask:nextTask];
+    }
+    if (_preheatingTasks.count) {
+        [self _setNeedsExecutePreheatingTasks];
+    }
+}
+
+#pragma mark Prefetch Jobs
+
+- (nonnull DFImagePrefetchJob *)prefetchJobWithRequests:(nonnull NSArray<DFImageRequest *> *)requests {
+    NSParameterAssert(requests);
+    return [[DFImagePrefetchJob alloc] initWithRequests:requests manager:self];
+}
+
+/*! Returns YES if there are any executing or pending tasks started by the clients (not preheating, prefetching or revalidation tasks).
+ */
+- (BOOL)_hasInteractiveTasks {
+    for (_DFImageTask *task in [_executingTasks.allObjects arrayByAddingObjectsFromArray:_pendingTasks]) {
+        if (!task.preheating && !task.prefetching && !task.revalidating) {
+            return YES;
+        }
+    }
+    return NO;
+}
+
+- (BOOL)prefetchJobShouldYield:(nonnull DFImagePrefetchJob *)job {
+    BOOL __block shouldYield = NO;
+    [self _performBlock:^{
+        shouldYield = [self _hasInteractiveTasks];
+    }];
+    return shouldYield;
+}
+
+- (nonnull DFImageTask *)prefetchJob:(nonnull DFImagePrefetchJob *)job imageTaskForRequest:(nonnull DFImageRequest *)request completion:(nonnull DFImageTaskCompletion)completion {
+    _DFImageTask *task = [[_DFImageTask alloc] initWithManager:self request:request completionHandler:completion];
+    task.prefetching = YES;
+    task.priority = DFImageRequestPriorityLow;
+    return task;
+}
+
+- (nonnull DFImageTask *)prefetchJob:(nonnull DFImagePrefetchJob *)job dataTaskForRequest:(nonnull DFImageRequest *)request completion:(nonnull DFImageTaskCompletion)completion {
+    _DFImageTask *task = (id)[self prefetchJob:job imageTaskForRequest:request completion:completion];
+    task.fetchingDataOnly = YES;
+    return task;
+}
+
+- (void)prefetchJobDidResume:(nonnull DFImagePrefetchJob *)job {
+    [self _performBlock:^{
+        [_prefetchJobs addObject:job];
+    }];
+}
+
+- (void)prefetchJobDidFinish:(nonnull DFImagePrefetchJob *)job {
+    [_recursiveLock lock];
+    [_prefetchJobs removeObject:job]; // Jobs are removed even after invalidation
+    [_recursiveLock unlock];
+}
+
+#pragma mark Header Probing
+
+- (nonnull id<DFImageFetchingOperation>)probeHeaderInfoForRequest:(nonnull DFImageRequest *)request completion:(void (^__nonnull)(DFImageHeaderInfo *__nullable, NSError *__nullable))completion {
+    NSParameterAssert(request);
+    NSParameterAssert(completion);
+    _DFImageHeaderProbe *probe = [[_DFImageHeaderProbe alloc] initWithCompletion:completion];
+    probe.operation = [_configuration.fetcher startOperationWithRequest:request progressHandler:^(NSData *__nullable data, int64_t completedUnitCount, int64_t totalUnitCount) {
+        [probe appendData:data];
+    } completion:^(NSData *__nullable data, NSDictionary *__nullable info, NSError *__nullable error) {
+        [probe didCompleteWithData:data error:error];
+    }];
+    return probe;
+}
+
+#pragma mark Warm Start
+
+- (void)_applicationDidEnterBackground:(NSNotification *)notification {
+#if TARGET_OS_IOS && !TARGET_OS_WATCH
+    // The application might be suspended before the snapshot is written. The notification object is the application, -[UIApplication sharedApplication] is not available in app extensions.
+    UIApplication *application = [notification.object isKindOfClass:[UIApplication class]] ? notification.object : nil;
+    UIBackgroundTaskIdentifier __block taskIdentifier = [application beginBackgroundTaskWithExpirationHandler:^{
+        [application endBackgroundTask:taskIdentifier];
+        taskIdentifier = UIBackgroundTaskInvalid;
+    }];
+    [self writeWarmStartSnapshotWithCompletion:^(BOOL success) {
+        if (taskIdentifier != UIBackgroundTaskInvalid) {
+            [application endBackgroundTask:taskIdentifier];
+            taskIdentifier = UIBackgroundTaskInvalid;
+        }
+    }];
+#endif
+}
+
+- (void)writeWarmStartSnapshotWithCompletion:(void (^__nullable)(BOOL))completion {
+    DFImageWarmStartSnapshot *snapshot = _warmStartSnapshot;
+    if (!snapshot) {
+        if (completion) {
+            dispatch_async(dispatch_get_main_queue(), ^{ completion(NO); });
+        }
+        return;
+    }
+    // Only the images that are still in the memory cache are persisted, the snapshot never fetches or processes images
+    NSMutableArray *images = [NSMutableArray new];
+    NSMutableArray *requests = [NSMutableArray new];
+    for (DFImageRequest *request in [snapshot hotRequests]) {
+        UIImage *image = [_imageLoader cachedResponseForRequest:request].image;
+        if (image) {
+            [images addObject:image];
+            [requests addObject:request];
+        }
+    }
+    dispatch_async(_warmStartQueue, ^{
+        BOOL success = [snapshot writeImages:images forRequests:requests];
+        if (completion) {
+            dispatch_async(dispatch_get_main_queue(), ^{ completion(success); });
+        }
+    });
+}
+
+- (void)loadWarmStartSnapshotWithCompletion:(void (^__nullable)(NSUInteger))completion {
+    DFImageWarmStartSnapshot *snapshot = _warmStartSnapshot;
+    if (!snapshot) {
+        if (completion) {
+            dispatch_async(dispatch_get_main_queue(), ^{ completion(0); });
+        }
+        return;
+    }
+    DFImageManagerLoader *imageLoader = _imageLoader;
+    dispatch_async(_warmStartQueue, ^{
+        NSUInteger __block imageCount = 0;
+        [snapshot enumerateImagesUsingBlock:^(DFImageRequest *request, UIImage *image, BOOL *stop) {
+            if ([imageLoader cachedResponseForRequest:request]) {
+                return; // Already loaded by the image task
             }
-            if (task.state == DFImageTaskStateSuspended) {
-                [self _setState:DFImageTaskStateRunning forTask:task];
-                executingTaskCount++;
+            [imageLoader storeImage:([UIImage df_decompressedImage:image scale:1.f] ?: image) info:nil forRequest:request];
+            // Restored images stay in the working set even if the application is sent to background before they are used
+            [snapshot recordUseOfRequest:request key:[imageLoader preheatingKeyForRequest:request]];
+            imageCount++;
+        }];
+        if (completion) {
+            dispatch_async(dispatch_get_main_queue(), ^{ completion(imageCount); });
+        }
+    });
+}
+
+#pragma mark Statistics
+
+- (nonnull DFImageManagerStatistics *)statistics {
+    DFImageManagerStatistics *statistics = [DFImageManagerStatistics new];
+    [_recursiveLock lock];
+    memcpy(statistics->_loadCounts, _statistics->_loadCounts, sizeof(_statistics->_loadCounts));
+    memcpy(statistics->_totalLatencies, _statistics->_totalLatencies, sizeof(_statistics->_totalLatencies));
+    statistics->_cancelledFetchCount = _statistics->_cancelledFetchCount;
+    statistics->_wastedByteCount = _statistics->_wastedByteCount;
+    statistics->_keptAliveFetchCount = _statistics->_keptAliveFetchCount;
+    statistics->_reattachedFetchCount = _statistics->_reattachedFetchCount;
+    [_recursiveLock unlock];
+    return statistics;
+}
+
+- (void)resetStatistics {
+    [_recursiveLock lock];
+    _statistics = [DFImageManagerStatistics new];
+    [_recursiveLock unlock];
+}
+
+#pragma mark Preview
+
+/*! Loads the low-quality preview of the image (see allowsPreview option). The BlurHash is decoded locally, the preview resource is loaded by the receiver using a separate image task which is cancelled when the task is finished.
+ */
+- (void)_loadPreviewForTask:(nonnull _DFImageTask *)task {
+    DFImageRequest *request = task.request;
+    DFImageRequestOptions *options = request.options;
+    id<DFImagePreviewProviding> provider = _configuration.previewProvider;
+    id resource = options.previewResource;
+    if (!resource && [provider respondsToSelector:@selector(previewResourceForRequest:)]) {
+        resource = [provider previewResourceForRequest:request];
+    }
+    NSString *blurHash = options.previewBlurHash;
+    if (!blurHash && [provider respondsToSelector:@selector(previewBlurHashForRequest:)]) {
+        blurHash = [provider previewBlurHashForRequest:request];
+    }
+    typeof(self) __weak weakSelf = self;
+    if (resource) {
+        DFMutableImageRequestOptions *builder = [DFMutableImageRequestOptions new];
+        builder.priority = task.priority;
+        builder.allowsNetworkAccess = options.allowsNetworkAccess;
+        builder.allowsClipping = options.allowsClipping;
+        DFImageRequest *previewRequest = [DFImageRequest requestWithResource:resource targetSize:request.targetSize contentMode:request.contentMode options:builder.options];
+        if ([self canHandleRequest:previewRequest]) {
+            _DFImageTask *previewTask = [[_DFImageTask alloc] initWithManager:self request:previewRequest completionHandler:^(UIImage *image, NSError *error, DFImageResponse *response, DFImageTask *previewTask) {
+                if (image) {
+                    [weakSelf _task:task didLoadPreview:image placeholder:NO];
+                }
+            }];
+            task.previewTask = previewTask;
+            [self _setState:DFImageTaskStateRunning forTask:previewTask];
+        }
+    }
+    if (blurHash) {
+        void (^decode)(void) = ^{
+            // The preview is blurry by nature, small bitmap is enough
+            UIImage *image = [UIImage df_imageWithBlurHash:blurHash size:CGSizeMake(32.f, 32.f)];
+            if (image) {
+                [weakSelf _task:task didLoadPreview:image placeholder:YES];
             }
+        };
+        _configuration.processingQueue ? [_configuration.processingQueue addOperationWithBlock:decode] : decode();
+    }
+}
+
+/*! Delivers the preview to the progressive image handler unless the task is finished. The placeholder (BlurHash) is only delivered if no other images were delivered yet.
+ */
+- (void)_task:(nonnull _DFImageTask *)task didLoadPreview:(nonnull UIImage *)image placeholder:(BOOL)placeholder {
+    DFDispatchAsync(^{
+        if (task.state != DFImageTaskStateRunning || (placeholder && task.timeToFirstImage > 0.0)) {
+            return;
         }
+        [self _task:task didReceiveProgressiveImage:image];
+    });
+}
+
+#pragma mark Revalidation
+
+/*! Returns YES if the revalidated response has the same content as the cached one. The responses are compared using the validators, or using the Last-Modified and Content-Length header fields when there are no validators. Sets comparable to NO if the responses have nothing to compare.
+ */
+static BOOL _DFIsContentOfResponseUnchanged(NSDictionary *__nullable cachedInfo, NSDictionary *__nullable info, BOOL *__nonnull comparable) {
+    id cachedValidator = cachedInfo[DFImageInfoValidatorKey];
+    id validator = info[DFImageInfoValidatorKey];
+    if (cachedValidator && validator) {
+        *comparable = YES;
+        return [cachedValidator isEqual:validator];
     }
+    NSDictionary *cachedHeaderFields = cachedInfo[DFImageInfoHTTPHeaderFieldsKey];
+    NSDictionary *headerFields = info[DFImageInfoHTTPHeaderFieldsKey];
+    if (cachedHeaderFields[@"Last-Modified"] && headerFields[@"Last-Modified"]) {
+        *comparable = YES;
+        id cachedLength = cachedHeaderFields[@"Content-Length"];
+        id length = headerFields[@"Content-Length"];
+        return [cachedHeaderFields[@"Last-Modified"] isEqual:headerFields[@"Last-Modified"]] && (!cachedLength || !length || [cachedLength isEqual:length]);
+    }
+    *comparable = NO;
+    return NO;
+}
+
+/*! Starts the background revalidation of the expired cached response (see DFImageRequestCachePolicyReturnStaleWhileRevalidate). The revalidations of the same cached image are deduplicated, the revalidation handlers of all the tasks that returned the stale image are called when the content changes.
+ */
+- (void)_revalidateCachedResponse:(nonnull DFCachedImageResponse *)cachedResponse forTask:(nonnull _DFImageTask *)task {
+    id<NSCopying> key = [self _cacheKeyForTask:task];
+    NSMutableArray *tasks = _revalidatedTasks[key];
+    if (tasks) {
+        [tasks addObject:task];
+        return;
+    }
+    _revalidatedTasks[key] = [NSMutableArray arrayWithObject:task];
+
+    DFImageRequest *request = task.request;
+    DFMutableImageRequestOptions *builder = [DFMutableImageRequestOptions new];
+    builder.priority = DFImageRequestPriorityLow;
+    builder.allowsNetworkAccess = request.options.allowsNetworkAccess;
+    builder.allowsClipping = request.options.allowsClipping;
+    builder.expirationAge = request.options.expirationAge;
+    builder.memoryCachePolicy = DFImageRequestCachePolicyReloadIgnoringCache;
+    NSMutableDictionary *userInfo = [NSMutableDictionary dictionaryWithDictionary:request.options.userInfo];
+    userInfo[DFImageRequestRevalidationInfoKey] = cachedResponse.info ?: @{};
+    builder.userInfo = userInfo;
+    DFImageRequest *revalidationRequest = [DFImageRequest requestWithResource:request.resource targetSize:request.targetSize contentMode:request.contentMode options:builder.options];
+
+    typeof(self) __weak weakSelf = self;
+    _DFImageTask *revalidationTask = [[_DFImageTask alloc] initWithManager:self request:revalidationRequest completionHandler:^(UIImage *image, NSError *error, DFImageResponse *response, DFImageTask *revalidationTask) {
+        [weakSelf _didRevalidateCachedResponse:cachedResponse key:key request:request image:image response:response error:error];
+    }];
+    revalidationTask.revalidating = YES;
+    [self _setState:DFImageTaskStateRunning forTask:revalidationTask];
+}
+
+- (void)_didRevalidateCachedResponse:(nonnull DFCachedImageResponse *)cachedResponse key:(nonnull id<NSCopying>)key request:(nonnull DFImageRequest *)request image:(nullable UIImage *)image response:(nullable DFImageResponse *)response error:(nullable NSError *)error {
+    NSArray *__block tasks;
+    [self _performBlock:^{
+        tasks = [_revalidatedTasks[key] copy];
+        [_revalidatedTasks removeObjectForKey:key];
+    }];
+    if (!tasks) {
+        return;
+    }
+    BOOL comparable = NO;
+    BOOL unchanged = image && _DFIsContentOfResponseUnchanged(cachedResponse.info, response.info, &comparable);
+    BOOL notModified = [error.domain isEqualToString:DFImageManagerErrorDomain] && error.code == DFImageManagerErrorNotModified;
+    if (notModified || unchanged) {
+        // The content hasn't changed, the stale image is fresh again
+        [_imageLoader storeImage:cachedResponse.image info:cachedResponse.info forRequest:request];
+        return;
+    }
+    if (!image || !comparable) {
+        return; // Keep the stale image if the revalidation failed, the image that can't be compared only replaces it in the cache
+    }
+    for (_DFImageTask *task in tasks) {
+        void (^handler)(UIImage *, DFImageResponse *) = task.revalidationHandler;
+        if (handler) {
+            handler(image, response);
+        }
+    }
+}
+
+/*! Returns the memory cache key of the task's request, the key is created once per task.
+ */
+- (nonnull id<NSCopying>)_cacheKeyForTask:(nonnull _DFImageTask *)task {
+    if (!task.cacheKey) {
+        task.cacheKey = [_imageLoader preheatingKeyForRequest:task.request];
+    }
+    return task.cacheKey;
 }
 
 - (void)_imageTaskDidComplete:(_DFImageTask *)task {
-    if (_preheatingTasks.count && (task.preheating || !task.error)) {
-        [_preheatingTasks removeObjectForKey:[_imageLoader preheatingKeyForRequest:task.request]];
+    if (_preheatingTasks.count && (task.preheating || (!task.error && !task.prefetching))) { // Prefetched images are not stored in the memory cache
+        [_preheatingTasks removeObjectForKey:[self _cacheKeyForTask:task]];
+    }
+}
+
+/*! Prefetching tasks don't store the images in the memory cache so that they don't evict the images used by the interactive tasks.
+ */
+- (void)_startLoadingForTask:(nonnull _DFImageTask *)task {
+    DFImageLoaderTaskOptions options = DFImageLoaderTaskOptionsNone;
+    if (task.prefetching) {
+        options |= DFImageLoaderTaskOptionSkipMemoryCache;
     }
+    if (task.fetchingDataOnly) {
+        options |= DFImageLoaderTaskOptionFetchDataOnly;
+    }
+    [_imageLoader startLoadingForImageTask:task cacheKey:[self _cacheKeyForTask:task] options:options];
 }
 
 #pragma mark FSM (DFImageTaskState)
@@ -280,25 +918,65 @@ DF_INIT_UNAVAILABLE_IMPL
 
 - (void)_enterActionForState:(DFImageTaskState)state task:(nonnull _DFImageTask *)task {
     if (state == DFImageTaskStateRunning) {
-        DFCachedImageResponse *response = [_imageLoader cachedResponseForRequest:task.request];
+        task.resumeTime = CACurrentMediaTime();
+        DFCachedImageResponse *response = task.fetchingDataOnly ? nil : [_imageLoader cachedResponseForRequest:task.request key:[self _cacheKeyForTask:task]];
         if (response) { // fast path
+            BOOL stale = task.request.options.memoryCachePolicy == DFImageRequestCachePolicyReturnStaleWhileRevalidate && response.isExpired;
             task.image = response.image;
-            task.response = [[DFImageResponse alloc] initWithInfo:response.info isFastResponse:YES];
+            [task setResponseWithInfo:response.info isFastResponse:YES isStale:stale fetchedByteCount:0];
+            [_statistics _recordLoadFromSource:DFImageSourceMemoryCache latency:(CACurrentMediaTime() - task.resumeTime)];
+            if (stale) {
+                [self _revalidateCachedResponse:response forTask:task];
+            }
             [self _setState:DFImageTaskStateCompleted forTask:task];
         } else {
-            [_executingTasks addObject:task];
-            [_imageLoader startLoadingForImageTask:task];
+            if (task.request.options.allowsPreview && task.progressiveImageHandler && !task.preheating) {
+                [self _loadPreviewForTask:task];
+            }
+            if (task.preheating || (!_pendingTasks.count && [_budget reserveRequestForPreheating:NO])) {
+                // Preheating tasks reserve the slots before they are resumed
+                [_executingTasks addObject:task];
+                [self _startLoadingForTask:task];
+            } else {
+                [_pendingTasks addObject:task];
+            }
         }
     }
     if (state == DFImageTaskStateCompleted || state == DFImageTaskStateCancelled) {
-        [_executingTasks removeObject:task];
+        if (task.previewTask) {
+            [self _setState:DFImageTaskStateCancelled forTask:task.previewTask];
+            task.previewTask = nil;
+        }
+        if (task.image && task.timeToFirstImage == 0.0) {
+            task.timeToFirstImage = CACurrentMediaTime() - task.resumeTime;
+        }
+        if ([_executingTasks containsObject:task]) {
+            [_executingTasks removeObject:task];
+            [_budget releaseRequest];
+        } else {
+            [_pendingTasks removeObjectIdenticalTo:task];
+        }
         [self _setNeedsExecutePreheatingTasks];
+        if (!task.preheating && !task.prefetching && !task.revalidating && _prefetchJobs.count && ![self _hasInteractiveTasks]) {
+            NSArray *jobs = _prefetchJobs.allObjects;
+            dispatch_async(dispatch_get_main_queue(), ^{ // The jobs are resumed outside of the state transition
+                for (DFImagePrefetchJob *job in jobs) {
+                    [job setNeedsExecute];
+                }
+            });
+        }
         
         if (state == DFImageTaskStateCancelled) {
-            task.error = [NSError errorWithDomain:DFImageManagerErrorDomain code:DFImageManagerErrorCancelled userInfo:nil];
+            task.error = _DFImageManagerError(DFImageManagerErrorCancelled);
+        }
+        if (state == DFImageTaskStateCompleted && (!task.image && !task.error && !task.fetchingDataOnly)) {
+            task.error = _DFImageManagerError(DFImageManagerErrorUnknown);
         }
-        if (state == DFImageTaskStateCompleted && (!task.image && !task.error)) {
-            task.error = [NSError errorWithDomain:DFImageManagerErrorDomain code:DFImageManagerErrorUnknown userInfo:nil];
+        if (state == DFImageTaskStateCompleted && !task.preheating && !task.revalidating) {
+            [_configuration.traceRecorder recordCompletionForTask:task];
+            if (task.image && !task.prefetching) {
+                [_warmStartSnapshot recordUseOfRequest:task.request key:[self _cacheKeyForTask:task]];
+            }
         }
         DFDispatchAsync(^{
             DFImageTaskCompletion completion = task.completionHandler;
@@ -325,20 +1003,48 @@ DF_INIT_UNAVAILABLE_IMPL
     });
 }
 
-- (void)imageLoader:(nonnull DFImageManagerLoader *)imageLoader imageTask:(nonnull DFImageTask *)task didReceiveProgressiveImage:(nonnull UIImage *)image {
+- (void)imageLoader:(nonnull DFImageManagerLoader *)imageLoader imageTask:(nonnull _DFImageTask *)task didReceiveProgressiveImage:(nonnull UIImage *)image {
     dispatch_async(dispatch_get_main_queue(), ^{
-        void (^handler)(UIImage *) = task.progressiveImageHandler;
-        if (handler) {
-            handler(image);
+        [self _task:task didReceiveProgressiveImage:image];
+    });
+}
+
+- (void)imageLoader:(nonnull DFImageManagerLoader *)imageLoader imageTask:(nonnull _DFImageTask *)task didReceiveHeaderInfo:(nonnull DFImageHeaderInfo *)headerInfo {
+    if (!task.headerInfoHandler) {
+        return;
+    }
+    dispatch_async(dispatch_get_main_queue(), ^{
+        void (^handler)(DFImageHeaderInfo *) = task.headerInfoHandler;
+        if (handler && task.state == DFImageTaskStateRunning) {
+            handler(headerInfo);
         }
     });
 }
 
-- (void)imageLoader:(nonnull DFImageManagerLoader *)imageLoader imageTask:(nonnull _DFImageTask *)task didCompleteWithImage:(nullable UIImage *)image info:(nullable NSDictionary *)info error:(nullable NSError *)error {
+- (void)imageLoader:(nonnull DFImageManagerLoader *)imageLoader didRecordOrphanedFetchEvent:(DFImageLoaderOrphanedFetchEvent)event byteCount:(int64_t)byteCount {
+    [self _performBlock:^{
+        [_statistics _recordOrphanedFetchEvent:event byteCount:byteCount];
+    }];
+}
+
+- (void)_task:(nonnull _DFImageTask *)task didReceiveProgressiveImage:(nonnull UIImage *)image {
+    void (^handler)(UIImage *) = task.progressiveImageHandler;
+    if (handler) {
+        if (task.timeToFirstImage == 0.0) {
+            task.timeToFirstImage = CACurrentMediaTime() - task.resumeTime;
+        }
+        handler(image);
+    }
+}
+
+- (void)imageLoader:(nonnull DFImageManagerLoader *)imageLoader imageTask:(nonnull _DFImageTask *)task didCompleteWithImage:(nullable UIImage *)image info:(nullable NSDictionary *)info error:(nullable NSError *)error source:(DFImageSource)source fetchedByteCount:(int64_t)fetchedByteCount latency:(NSTimeInterval)latency {
     task.image = image;
-    task.response = [[DFImageResponse alloc] initWithInfo:info isFastResponse:NO];
+    [task setResponseWithInfo:info isFastResponse:NO isStale:NO fetchedByteCount:fetchedByteCount];
     task.error = error;
     [self _performBlock:^{
+        if (image && task.state == DFImageTaskStateRunning) {
+            [_statistics _recordLoadFromSource:source latency:latency];
+        }
         [self _setState:DFImageTaskStateCompleted forTask:task];
     }];
 }
@@ -347,18 +1053,27 @@ DF_INIT_UNAVAILABLE_IMPL
 
 - (void)resumeManagedTask:(nonnull _DFImageTask *)task {
     [self _performBlock:^{
+        if (task.state == DFImageTaskStateSuspended) {
+            [_configuration.traceRecorder recordRequestForTask:task];
+        }
         [self _setState:DFImageTaskStateRunning forTask:task];
     }];
 }
 
 - (void)cancelManagedTask:(nonnull _DFImageTask *)task {
     [self _performBlock:^{
+        if (task.state == DFImageTaskStateRunning || task.state == DFImageTaskStateSuspended) {
+            [_configuration.traceRecorder recordCancelForTask:task];
+        }
         [self _setState:DFImageTaskStateCancelled forTask:task];
     }];
 }
 
 - (void)managedTaskDidChangePriority:(nonnull _DFImageTask *)task {
     [self _performBlock:^{
+        if (task.state == DFImageTaskStateRunning) {
+            [_configuration.traceRecorder recordPriorityChangeForTask:task];
+        }
         [_imageLoader updateLoadingPriorityForImageTask:task];
     }];
 }
@@ -0,0 +1,36 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import <Foundation/Foundation.h>
+
+/*! Posted when the budget has a free slot for the image task.
+ */
+extern NSString *__nonnull const DFImageManagerBudgetDidReleaseRequestNotification;
+
+/*! The DFImageManagerBudget limits the number of image tasks that are allowed to execute concurrently across all the image managers that share it (see DFImageManagerConfiguration). Image managers composed by DFCompositeImageManager should share a single budget (along with the processing and decoding queues and the memory cache of the configuration) so that the composition doesn't oversubscribe the system.
+ @note Thread safe.
+ */
+@interface DFImageManagerBudget : NSObject
+
+/*! Maximum number of image tasks (including preheating tasks) that are allowed to execute concurrently. Tasks that exceed the limit are started when the slots become available, tasks with higher priority are started first. Default value is NSUIntegerMax.
+ */
+@property (atomic) NSUInteger maximumConcurrentRequests;
+
+/*! Preheating tasks are only started when the number of executing image tasks is less than the given value. Default value is 2.
+ */
+@property (atomic) NSUInteger maximumConcurrentPreheatingRequests;
+
+/*! Returns the number of currently executing image tasks.
+ */
+@property (nonatomic, readonly) NSUInteger executingRequestCount;
+
+/*! Reserves a slot for the image task. Returns NO if the budget is exhausted.
+ */
+- (BOOL)reserveRequestForPreheating:(BOOL)preheating;
+
+/*! Releases the slot reserved for the image task and posts DFImageManagerBudgetDidReleaseRequestNotification.
+ */
+- (void)releaseRequest;
+
+@end
@@ -0,0 +1,53 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import "DFImageManagerBudget.h"
+
+NSString *const DFImageManagerBudgetDidReleaseRequestNotification = @"DFImageManagerBudgetDidReleaseRequestNotification";
+
+@implementation DFImageManagerBudget {
+    NSLock *_lock;
+    NSUInteger _executingRequestCount;
+}
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _lock = [NSLock new];
+        _maximumConcurrentRequests = NSUIntegerMax;
+        _maximumConcurrentPreheatingRequests = 2;
+    }
+    return self;
+}
+
+- (NSUInteger)executingRequestCount {
+    [_lock lock];
+    NSUInteger count = _executingRequestCount;
+    [_lock unlock];
+    return count;
+}
+
+- (BOOL)reserveRequestForPreheating:(BOOL)preheating {
+    NSUInteger limit = self.maximumConcurrentRequests;
+    if (preheating) {
+        limit = MIN(limit, self.maximumConcurrentPreheatingRequests);
+    }
+    [_lock lock];
+    BOOL reserved = _executingRequestCount < limit;
+    if (reserved) {
+        _executingRequestCount++;
+    }
+    [_lock unlock];
+    return reserved;
+}
+
+- (void)releaseRequest {
+    [_lock lock];
+    if (_executingRequestCount > 0) {
+        _executingRequestCount--;
+    }
+    [_lock unlock];
+    [[NSNotificationCenter defaultCenter] postNotificationName:DFImageManagerBudgetDidReleaseRequestNotification object:self];
+}
+
+@end
@@ -8,6 +8,10 @@
 @protocol DFImageFetching;
 @protocol DFImageDecoding;
 @protocol DFImageProcessing;
+@protocol DFImagePreviewProviding;
+@class DFImageDataCache;
+@class DFImageManagerBudget;
+@class DFImageTraceRecorder;
 
 /*! An DFImageManagerConfiguration object defines the behaviour and policies to use when retrieving images using DFImageManager object.
  */
@@ -29,19 +33,72 @@
  */
 @property (nullable, nonatomic) NSOperationQueue *processingQueue;
 
+/*! Operation queue used for decoding image data (see DFImageDecoding protocol). Default queue executes one operation at a time.
+ */
+@property (nullable, nonatomic) NSOperationQueue *decodingQueue;
+
 /*! Memory cache that stores processed images.
   @note It's a good idea to implement DFImageProcessing and DFImageCaching in that same object.
  */
 @property (nullable, nonatomic) id<DFImageCaching> cache;
 
-/*! Maximum number of preheating requests that are allowed to execute concurrently.
+/*! The memory cache of the encoded image data (see DFImageDataCache) that the image manager consults before starting the fetch. When the processed image is evicted from the memory cache it can be rebuilt with just a decode. Default value is nil.
+ @note The data is shared by the requests that are equivalent in terms of fetching (see -[DFImageFetching isRequestFetchEquivalent:toRequest:]).
+ */
+@property (nullable, nonatomic) DFImageDataCache *dataCache;
+
+/*! Maximum number of preheating requests that are allowed to execute concurrently. Ignored when the budget is set.
  */
 @property (nonatomic) NSUInteger maximumConcurrentPreheatingRequests;
 
+/*! The budget that limits the number of concurrently executing image tasks. Image managers that are created with the same budget share it. If the budget is nil the image manager creates its own budget using maximumConcurrentPreheatingRequests. Default value is nil.
+ @note Image managers that share the budget should also share the decoding queue, the processing queue and the memory cache so that all of the resources are limited globally.
+ */
+@property (nullable, nonatomic) DFImageManagerBudget *budget;
+
 /*! The load progress threshold at which received data is decoded. Default value is 0.15, which means that the received data will be decoded each time next 15% of total bytes is received.
  */
 @property (nonatomic) float progressiveImageDecodingThreshold;
 
+/*! The object that provides the low-quality previews for the requests that allow previews but don't specify them in their options. Default value is nil.
+ */
+@property (nullable, nonatomic) id<DFImagePreviewProviding> previewProvider;
+
+/*! The recorder that records the requests made by the image manager into a trace that can be replayed later (see DFImageTraceReplayer). Default value is nil.
+ */
+@property (nullable, nonatomic) DFImageTraceRecorder *traceRecorder;
+
+/*! The directory where the image manager keeps the snapshot of the hot working set of the memory cache: the processed images for the most frequently and recently used requests. The snapshot is written when the application enters background, and is loaded into the memory cache asynchronously when the image manager is created, so that the first screen doesn't have to fetch, decode and process the same images again. Default value is nil (warm start is disabled).
+ @note Image managers must not share the directory. Only the requests with resources that conform to NSCoding protocol are persisted.
+ */
+@property (nullable, nonatomic) NSURL *warmStartDirectoryURL;
+
+/*! Maximum number of images in the warm start snapshot. Default value is 30.
+ */
+@property (nonatomic) NSUInteger warmStartImageCountLimit;
+
+/*! Maximum total cost (in bytes) of the recently decoded images that the image manager keeps before processing, so that the variants of the same image requested within a short window (e.g. a thumbnail and a full-size image) are decoded only once. Default value is 16 MB. Set to 0 to disable the decoded image cache.
+ @note The images are shared by the requests that are equivalent in terms of fetching (see -[DFImageFetching isRequestFetchEquivalent:toRequest:]). Only the images decoded at the full size are stored, the images decoded from the embedded thumbnails are not.
+ */
+@property (nonatomic) NSUInteger decodedImageCacheCostLimit;
+
+/*! Maximum amount of time the decoded image is kept (see decodedImageCacheCostLimit). Default value is 5.0 seconds.
+ */
+@property (nonatomic) NSTimeInterval decodedImageCacheMaximumAge;
+
+/*! Maximum number of the recent fetch failures that the image manager keeps (negative cache). The requests for the resources that have recently failed (e.g. 404 Not Found) and for the hosts that keep failing fail fast with the cached error instead of starting the fetch. The failures are kept for the amount of time that depends on the error and respects the Retry-After header. Default value is 100. Set to 0 to disable the negative cache.
+ @note The failures are shared by the requests that are equivalent in terms of fetching (see -[DFImageFetching isRequestFetchEquivalent:toRequest:]). Requests with DFImageRequestCachePolicyReloadIgnoringCache memory cache policy ignore the negative cache.
+ */
+@property (nonatomic) NSUInteger failureCacheCountLimit;
+
+/*! When all of the tasks that wait for the fetch are cancelled, the fetch that has already received this fraction of the data (or all of the data, which is being decoded) keeps running at low priority instead of being cancelled. The fetched image is stored in the caches, and the task with an equivalent request that is started later (e.g. when the user scrolls back) is attached to the running fetch. Default value is 0.75. Set to a value greater than 1.0 to disable.
+ */
+@property (nonatomic) float orphanedFetchProgressThreshold;
+
+/*! The amount of time the fetch that didn't reach orphanedFetchProgressThreshold (or which length is unknown) keeps running at low priority after all of its tasks are cancelled, so that the task that comes back shortly is attached to it. Default value is 0.25 seconds. Set to 0 to cancel such fetches immediately.
+ */
+@property (nonatomic) NSTimeInterval orphanedFetchGracePeriod;
+
 /*! Initializes DFImageManagerConfiguration instance with default parameters.
  */
 - (nullable instancetype)init;
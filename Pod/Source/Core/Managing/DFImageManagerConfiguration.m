@@ -13,8 +13,16 @@
         _decoder = [DFImageDecoder new];
         _processingQueue = [NSOperationQueue new];
         _processingQueue.maxConcurrentOperationCount = 2;
+        _decodingQueue = [NSOperationQueue new];
+        _decodingQueue.maxConcurrentOperationCount = 1; // Serial queue
         _maximumConcurrentPreheatingRequests = 2;
         _progressiveImageDecodingThreshold = 0.15f;
+        _warmStartImageCountLimit = 30;
+        _decodedImageCacheCostLimit = 16 * 1024 * 1024;
+        _decodedImageCacheMaximumAge = 5.0;
+        _failureCacheCountLimit = 100;
+        _orphanedFetchProgressThreshold = 0.75f;
+        _orphanedFetchGracePeriod = 0.25;
     }
     return self;
 }
@@ -32,10 +40,22 @@
     copy.fetcher = self.fetcher;
     copy.decoder = self.decoder;
     copy.cache = self.cache;
+    copy.dataCache = self.dataCache;
     copy.processor = self.processor;
     copy.processingQueue = self.processingQueue;
+    copy.decodingQueue = self.decodingQueue;
     copy.maximumConcurrentPreheatingRequests = self.maximumConcurrentPreheatingRequests;
+    copy.budget = self.budget;
     copy.progressiveImageDecodingThreshold = self.progressiveImageDecodingThreshold;
+    copy.previewProvider = self.previewProvider;
+    copy.traceRecorder = self.traceRecorder;
+    copy.warmStartDirectoryURL = self.warmStartDirectoryURL;
+    copy.warmStartImageCountLimit = self.warmStartImageCountLimit;
+    copy.decodedImageCacheCostLimit = self.decodedImageCacheCostLimit;
+    copy.decodedImageCacheMaximumAge = self.decodedImageCacheMaximumAge;
+    copy.failureCacheCountLimit = self.failureCacheCountLimit;
+    copy.orphanedFetchProgressThreshold = self.orphanedFetchProgressThreshold;
+    copy.orphanedFetchGracePeriod = self.orphanedFetchGracePeriod;
     return copy;
 }
 
@@ -0,0 +1,96 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import "DFImageManagerDefines.h"
+#import <Foundation/Foundation.h>
+
+@class DFImageRequest;
+
+/*! Constants for determining the current state of a prefetch job.
+ */
+typedef NS_ENUM(NSUInteger, DFImagePrefetchJobState) {
+    DFImagePrefetchJobStateSuspended = 0,
+    DFImagePrefetchJobStateRunning,
+    DFImagePrefetchJobStatePaused,
+    DFImagePrefetchJobStateCancelled,
+    DFImagePrefetchJobStateCompleted
+};
+
+/*! The prefetch job loads a large number of images (for example, a whole album for offline use) in background. Unlike preheating, the job reports its progress, limits the total number of fetched bytes, and can be paused and resumed.
+
+ The job yields to the interactive image tasks: it doesn't start new requests while the image manager that created the job has any other image tasks (excluding preheating tasks), and its requests are executed with low priority. The images loaded by the job are not stored in the memory cache, so that they don't evict the images that are on screen.
+ @note Use -[DFImageManager prefetchJobWithRequests:] to create the job. The job is retained by the image manager until it is completed or cancelled.
+ @note The handlers are called on the main thread. The methods can be called from any thread.
+ */
+@interface DFImagePrefetchJob : NSObject
+
+/*! The requests that the job was created with.
+ */
+@property (nonnull, nonatomic, copy, readonly) NSArray<DFImageRequest *> *requests;
+
+/*! The current state of the job.
+ */
+@property (atomic, readonly) DFImagePrefetchJobState state;
+
+/*! Maximum number of requests that the job executes concurrently. Default value is 2.
+ */
+@property (atomic) NSUInteger maximumConcurrentRequests;
+
+/*! Maximum number of bytes that the job is allowed to receive from the network (see fetchedByteCount). The job stops starting new requests and completes once the limit is reached. Default value is 0 (no limit).
+ */
+@property (atomic) int64_t byteCountLimit;
+
+/*! If YES the job only fetches the image data which is stored in the data cache of the image manager and in the cache of the fetcher (for example, DFDiskCache of DFURLImageFetcher), the data is not decoded or processed. The fetches are shared with the image tasks for the equivalent requests and go through the failure cache. Default value is NO.
+ */
+@property (atomic) BOOL fetchesDataOnly;
+
+/*! If YES the job doesn't start new requests while the low power mode is enabled. Default value is YES.
+ */
+@property (atomic) BOOL pausesInLowPowerMode;
+
+/*! Number of requests that finished successfully.
+ */
+@property (atomic, readonly) NSUInteger completedRequestCount;
+
+/*! Number of requests that failed.
+ */
+@property (atomic, readonly) NSUInteger failedRequestCount;
+
+/*! Number of bytes received from the network by the job. The data found in the data cache of the image manager or in the cache of the fetcher is not counted (see fetchedByteCount property of DFImageResponse).
+ */
+@property (atomic, readonly) int64_t fetchedByteCount;
+
+/*! YES if the job was completed because it had reached the byteCountLimit.
+ */
+@property (atomic, readonly, getter=isByteCountLimitReached) BOOL byteCountLimitReached;
+
+/*! A progress object monitoring the number of finished requests. The job can be cancelled, paused and resumed using the progress object.
+ */
+@property (nonnull, nonatomic, readonly) NSProgress *progress;
+
+/*! A block which is called each time the request finishes.
+ */
+@property (nullable, atomic, copy) void (^progressHandler)(DFImagePrefetchJob *__nonnull job);
+
+/*! A block which is called when the job is either cancelled or completed.
+ */
+@property (nullable, atomic, copy) void (^completionHandler)(DFImagePrefetchJob *__nonnull job);
+
+/*! Unavailable initializer, please use -[DFImageManager prefetchJobWithRequests:].
+ */
+- (nullable instancetype)init NS_UNAVAILABLE;
+
+/*! Starts the job or resumes the paused job.
+ */
+- (void)resume;
+
+/*! Pauses the job. The requests that are currently executing are cancelled and are restarted when the job is resumed.
+ */
+- (void)pause;
+
+/*! Cancels the job.
+ */
+- (void)cancel;
+
+@end
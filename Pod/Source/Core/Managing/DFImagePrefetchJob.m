@@ -0,0 +1,231 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import "DFImagePrefetchJob.h"
+#import "DFImagePrefetchJobManaging.h"
+#import "DFImageTask.h"
+
+static inline void _DFDispatchMain(dispatch_block_t block) {
+    ([NSThread isMainThread]) ? block() : dispatch_async(dispatch_get_main_queue(), block);
+}
+
+static BOOL _DFIsLowPowerModeEnabled(void) {
+#if TARGET_OS_IOS && !TARGET_OS_WATCH
+    NSProcessInfo *processInfo = [NSProcessInfo processInfo];
+    return [processInfo respondsToSelector:@selector(isLowPowerModeEnabled)] && processInfo.isLowPowerModeEnabled;
+#else
+    return NO;
+#endif
+}
+
+/*! The request that is currently executed by the job.
+ */
+@interface _DFImagePrefetchItem : NSObject
+
+@property (nonnull, nonatomic, readonly) DFImageRequest *request;
+@property (nullable, nonatomic) DFImageTask *task;
+
+@end
+
+@implementation _DFImagePrefetchItem
+
+- (instancetype)initWithRequest:(DFImageRequest *)request {
+    if (self = [super init]) {
+        _request = request;
+    }
+    return self;
+}
+
+- (void)cancel {
+    [_task cancel];
+}
+
+@end
+
+
+@interface DFImagePrefetchJob ()
+
+@property (atomic) DFImagePrefetchJobState state;
+@property (atomic) NSUInteger completedRequestCount;
+@property (atomic) NSUInteger failedRequestCount;
+@property (atomic) int64_t fetchedByteCount;
+@property (atomic, getter=isByteCountLimitReached) BOOL byteCountLimitReached;
+
+@end
+
+/*! The job is always executed on the main thread.
+ */
+@implementation DFImagePrefetchJob {
+    id<DFImagePrefetchJobManaging> __weak _manager;
+    NSMutableArray<DFImageRequest *> *_remainingRequests;
+    NSMutableArray<_DFImagePrefetchItem *> *_executingItems;
+    BOOL _isStartingRequests;
+}
+
+DF_INIT_UNAVAILABLE_IMPL
+
+- (nonnull instancetype)initWithRequests:(nonnull NSArray<DFImageRequest *> *)requests manager:(nonnull id<DFImagePrefetchJobManaging>)manager {
+    if (self = [super init]) {
+        _requests = [requests copy];
+        _manager = manager;
+        _remainingRequests = [_requests mutableCopy];
+        _executingItems = [NSMutableArray new];
+        _maximumConcurrentRequests = 2;
+        _pausesInLowPowerMode = YES;
+        _progress = [NSProgress progressWithTotalUnitCount:_requests.count];
+        _progress.cancellable = YES;
+        _progress.pausable = YES;
+        typeof(self) __weak weakSelf = self;
+        _progress.cancellationHandler = ^{ [weakSelf cancel]; };
+        _progress.pausingHandler = ^{ [weakSelf pause]; };
+        _progress.resumingHandler = ^{ [weakSelf resume]; };
+#if TARGET_OS_IOS && !TARGET_OS_WATCH
+        if (&NSProcessInfoPowerStateDidChangeNotification != NULL) {
+            [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(setNeedsExecute) name:NSProcessInfoPowerStateDidChangeNotification object:nil];
+        }
+#endif
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+}
+
+- (void)resume {
+    _DFDispatchMain(^{
+        if (self.state != DFImagePrefetchJobStateSuspended && self.state != DFImagePrefetchJobStatePaused) {
+            return;
+        }
+        id<DFImagePrefetchJobManaging> manager = _manager;
+        if (!manager) {
+            [self _finishWithState:DFImagePrefetchJobStateCancelled];
+            return;
+        }
+        self.state = DFImagePrefetchJobStateRunning;
+        [manager prefetchJobDidResume:self];
+        [self _executeIfNeeded];
+    });
+}
+
+- (void)pause {
+    _DFDispatchMain(^{
+        if (self.state != DFImagePrefetchJobStateRunning) {
+            return;
+        }
+        self.state = DFImagePrefetchJobStatePaused;
+        // Cancelled requests are executed again when the job is resumed, the order is preserved
+        NSArray *items = [_executingItems copy];
+        [_executingItems removeAllObjects];
+        for (_DFImagePrefetchItem *item in items.reverseObjectEnumerator) {
+            [_remainingRequests insertObject:item.request atIndex:0];
+            [item cancel];
+        }
+    });
+}
+
+- (void)cancel {
+    _DFDispatchMain(^{
+        if (self.state == DFImagePrefetchJobStateCancelled || self.state == DFImagePrefetchJobStateCompleted) {
+            return;
+        }
+        NSArray *items = [_executingItems copy];
+        [_executingItems removeAllObjects];
+        [_remainingRequests removeAllObjects];
+        for (_DFImagePrefetchItem *item in items) {
+            [item cancel];
+        }
+        [self _finishWithState:DFImagePrefetchJobStateCancelled];
+    });
+}
+
+- (void)setNeedsExecute {
+    _DFDispatchMain(^{
+        [self _executeIfNeeded];
+    });
+}
+
+#pragma mark Execution
+
+- (void)_executeIfNeeded {
+    if (self.state != DFImagePrefetchJobStateRunning || _isStartingRequests) {
+        return; // Requests that finish synchronously (memory cache hits) are handled by the outer call
+    }
+    _isStartingRequests = YES;
+    [self _startRequestsIfPossible];
+    _isStartingRequests = NO;
+    if (self.state == DFImagePrefetchJobStateRunning && !_remainingRequests.count && !_executingItems.count) {
+        [self _finishWithState:DFImagePrefetchJobStateCompleted];
+    }
+}
+
+- (void)_startRequestsIfPossible {
+    if (self.pausesInLowPowerMode && _DFIsLowPowerModeEnabled()) {
+        return; // The job is executed again when the power state changes
+    }
+    id<DFImagePrefetchJobManaging> manager = _manager;
+    if (!manager) {
+        [self cancel];
+        return;
+    }
+    if ([manager prefetchJobShouldYield:self]) {
+        return; // The job is executed again when the last interactive task is finished
+    }
+    NSUInteger maximumConcurrentRequests = MAX(self.maximumConcurrentRequests, 1);
+    while (_executingItems.count < maximumConcurrentRequests && _remainingRequests.count && self.state == DFImagePrefetchJobStateRunning) {
+        int64_t byteCountLimit = self.byteCountLimit;
+        if (byteCountLimit > 0 && self.fetchedByteCount >= byteCountLimit) {
+            self.byteCountLimitReached = YES;
+            [_remainingRequests removeAllObjects];
+            return;
+        }
+        DFImageRequest *request = _remainingRequests.firstObject;
+        [_remainingRequests removeObjectAtIndex:0];
+        [self _startItem:[[_DFImagePrefetchItem alloc] initWithRequest:request] manager:manager];
+    }
+}
+
+- (void)_startItem:(nonnull _DFImagePrefetchItem *)item manager:(nonnull id<DFImagePrefetchJobManaging>)manager {
+    [_executingItems addObject:item];
+    // The item is retained by the job while it's executing
+    _DFImagePrefetchItem *__weak weakItem = item;
+    DFImageTaskCompletion completion = ^(UIImage *image, NSError *error, DFImageResponse *response, DFImageTask *task) {
+        [self _item:weakItem didFinishWithByteCount:response.fetchedByteCount failed:(error != nil)];
+    };
+    DFImageTask *task = self.fetchesDataOnly ? [manager prefetchJob:self dataTaskForRequest:item.request completion:completion] : [manager prefetchJob:self imageTaskForRequest:item.request completion:completion];
+    item.task = task;
+    [task resume];
+}
+
+- (void)_item:(nullable _DFImagePrefetchItem *)item didFinishWithByteCount:(int64_t)byteCount failed:(BOOL)failed {
+    if (!item || [_executingItems indexOfObjectIdenticalTo:item] == NSNotFound) {
+        return; // The item was cancelled by the job
+    }
+    [_executingItems removeObjectIdenticalTo:item];
+    self.fetchedByteCount += byteCount;
+    if (failed) {
+        self.failedRequestCount++;
+    } else {
+        self.completedRequestCount++;
+    }
+    _progress.completedUnitCount = self.completedRequestCount + self.failedRequestCount;
+    void (^progressHandler)(DFImagePrefetchJob *) = self.progressHandler;
+    if (progressHandler) {
+        progressHandler(self);
+    }
+    [self _executeIfNeeded];
+}
+
+- (void)_finishWithState:(DFImagePrefetchJobState)state {
+    self.state = state;
+    [_manager prefetchJobDidFinish:self];
+    void (^completionHandler)(DFImagePrefetchJob *) = self.completionHandler;
+    self.progressHandler = nil;
+    self.completionHandler = nil;
+    if (completionHandler) {
+        completionHandler(self);
+    }
+}
+
+@end
@@ -0,0 +1,117 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import "DFImageManagerDefines.h"
+#import <Foundation/Foundation.h>
+#import <UIKit/UIKit.h>
+
+@class DFImageRequest;
+@class DFImageTask;
+
+/*! Types of the events recorded by DFImageTraceRecorder.
+ */
+typedef NS_ENUM(uint8_t, DFImageTraceEventType) {
+    /*! The image task was resumed. */
+    DFImageTraceEventTypeRequest = 1,
+    /*! The image task was cancelled. */
+    DFImageTraceEventTypeCancel,
+    /*! The priority of the image task was changed. */
+    DFImageTraceEventTypePriority,
+    /*! The image task was completed. */
+    DFImageTraceEventTypeCompletion,
+    /*! The image manager was asked to start preheating the image. */
+    DFImageTraceEventTypeStartPreheating,
+    /*! The image manager was asked to stop preheating the image. */
+    DFImageTraceEventTypeStopPreheating,
+    /*! The image manager was asked to stop preheating all images. */
+    DFImageTraceEventTypeStopPreheatingAll,
+    /*! The image data was fetched and decoded. */
+    DFImageTraceEventTypeFetch
+};
+
+/*! The event read from the trace.
+ */
+@interface DFImageTraceEvent : NSObject
+
+/*! The type of the event.
+ */
+@property (nonatomic, readonly) DFImageTraceEventType type;
+
+/*! The time interval in seconds between the start of the recording and the event.
+ */
+@property (nonatomic, readonly) NSTimeInterval timestamp;
+
+/*! Identifies the image task within the trace (request, cancel, priority and completion events).
+ */
+@property (nonatomic, readonly) NSUInteger taskIdentifier;
+
+/*! The recorded request. The resource of the request is a string that identifies the original resource (absoluteString for URLs). Nil for the events that don't have requests.
+ */
+@property (nullable, nonatomic, readonly) DFImageRequest *request;
+
+/*! The priority of the image task (priority events).
+ */
+@property (nonatomic, readonly) DFImageRequestPriority priority;
+
+/*! YES if the image task was completed from the memory cache (completion events).
+ */
+@property (nonatomic, readonly, getter=isFastResponse) BOOL fastResponse;
+
+/*! YES if the image task or the fetch failed (completion and fetch events).
+ */
+@property (nonatomic, readonly, getter=isFailed) BOOL failed;
+
+/*! The number of fetched bytes (fetch events).
+ */
+@property (nonatomic, readonly) int64_t byteCount;
+
+/*! The time it took to fetch the data (fetch events).
+ */
+@property (nonatomic, readonly) NSTimeInterval latency;
+
+/*! The size of the decoded image in pixels (fetch events).
+ */
+@property (nonatomic, readonly) CGSize imageSize;
+
+/*! Returns the events read from the trace data, or nil if the data is not a valid trace.
+ */
++ (nullable NSArray<DFImageTraceEvent *> *)eventsWithTraceData:(nonnull NSData *)data;
+
+@end
+
+
+/*! The DFImageTraceRecorder records the requests, priority changes, cancels, preheating calls and the fetches made by the image manager into a compact binary trace. The trace can be replayed later using DFImageTraceReplayer.
+ @note To start recording set the traceRecorder property of the DFImageManagerConfiguration. The events are buffered in memory and written to the file in background.
+ @note Thread safe.
+ */
+@interface DFImageTraceRecorder : NSObject
+
+/*! The URL of the trace file.
+ */
+@property (nonnull, nonatomic, readonly) NSURL *fileURL;
+
+/*! Initializes the recorder with the URL of the trace file. Existing file is replaced.
+ */
+- (nonnull instancetype)initWithFileURL:(nonnull NSURL *)fileURL NS_DESIGNATED_INITIALIZER;
+
+/*! Unavailable initializer, please use designated initializer.
+ */
+- (nullable instancetype)init NS_UNAVAILABLE;
+
+/*! Synchronously writes all buffered events to the trace file.
+ */
+- (void)flush;
+
+/*! Recording methods, called by the image manager.
+ */
+- (void)recordRequestForTask:(nonnull DFImageTask *)task;
+- (void)recordCancelForTask:(nonnull DFImageTask *)task;
+- (void)recordPriorityChangeForTask:(nonnull DFImageTask *)task;
+- (void)recordCompletionForTask:(nonnull DFImageTask *)task;
+- (void)recordStartPreheatingForRequests:(nonnull NSArray<DFImageRequest *> *)requests;
+- (void)recordStopPreheatingForRequests:(nonnull NSArray<DFImageRequest *> *)requests;
+- (void)recordStopPreheatingForAllRequests;
+- (void)recordFetchForRequest:(nonnull DFImageRequest *)request byteCount:(int64_t)byteCount latency:(NSTimeInterval)latency imageSize:(CGSize)imageSize failed:(BOOL)failed;
+
+@end
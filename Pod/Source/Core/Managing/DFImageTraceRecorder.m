@@ -0,0 +1,407 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import "DFImageRequest.h"
+#import "DFImageRequestOptions.h"
+#import "DFImageResponse.h"
+#import "DFImageTask.h"
+#import "DFImageTraceRecorder.h"
+
+/* Trace format:
+ - header: "DFIT" magic followed by the uint8 version
+ - events: uint8 type, varint time in microseconds since the previous event, event payload
+ Resources are written once (resource definition event) and then referenced by varint identifiers. Varints are unsigned LEB128.
+ */
+static const uint8_t _kDFImageTraceMagic[4] = { 'D', 'F', 'I', 'T' };
+static const uint8_t _kDFImageTraceVersion = 1;
+static const uint8_t _kDFImageTraceResourceDefinition = 0;
+
+static const NSUInteger _kDFImageTraceBufferFlushThreshold = 32 * 1024;
+
+typedef NS_OPTIONS(uint8_t, _DFImageTraceRequestFlags) {
+    _DFImageTraceRequestFlagAllowsClipping = 1 << 0,
+    _DFImageTraceRequestFlagAllowsProgressiveImage = 1 << 1,
+    _DFImageTraceRequestFlagAllowsNetworkAccess = 1 << 2,
+    _DFImageTraceRequestFlagReloadIgnoringCache = 1 << 3
+};
+
+static void _DFImageTraceWriteVarint(NSMutableData *data, uint64_t value) {
+    uint8_t bytes[10];
+    NSUInteger length = 0;
+    do {
+        uint8_t byte = value & 0x7f;
+        value >>= 7;
+        bytes[length++] = value ? (byte | 0x80) : byte;
+    } while (value);
+    [data appendBytes:bytes length:length];
+}
+
+static void _DFImageTraceWriteByte(NSMutableData *data, uint8_t byte) {
+    [data appendBytes:&byte length:1];
+}
+
+/*! Reads trace data sequentially. All reads fail once the reader reaches the end of the data.
+ */
+typedef struct {
+    const uint8_t *bytes;
+    NSUInteger length;
+    NSUInteger offset;
+    BOOL failed;
+} _DFImageTraceReader;
+
+static uint64_t _DFImageTraceReadVarint(_DFImageTraceReader *reader) {
+    uint64_t value = 0;
+    for (NSUInteger shift = 0; shift < 64; shift += 7) {
+        if (reader->offset >= reader->length) {
+            break;
+        }
+        uint8_t byte = reader->bytes[reader->offset++];
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return value;
+        }
+    }
+    reader->failed = YES;
+    return 0;
+}
+
+static uint8_t _DFImageTraceReadByte(_DFImageTraceReader *reader) {
+    if (reader->offset >= reader->length) {
+        reader->failed = YES;
+        return 0;
+    }
+    return reader->bytes[reader->offset++];
+}
+
+static NSString *_DFImageTraceResourceKey(id resource) {
+    if ([resource isKindOfClass:[NSURL class]]) {
+        return [(NSURL *)resource absoluteString];
+    }
+    if ([resource isKindOfClass:[NSString class]]) {
+        return resource;
+    }
+    return [resource description];
+}
+
+
+#pragma mark - DFImageTraceEvent
+
+@interface DFImageTraceEvent ()
+
+@property (nonatomic) DFImageTraceEventType type;
+@property (nonatomic) NSTimeInterval timestamp;
+@property (nonatomic) NSUInteger taskIdentifier;
+@property (nullable, nonatomic) DFImageRequest *request;
+@property (nonatomic) DFImageRequestPriority priority;
+@property (nonatomic) BOOL fastResponse;
+@property (nonatomic) BOOL failed;
+@property (nonatomic) int64_t byteCount;
+@property (nonatomic) NSTimeInterval latency;
+@property (nonatomic) CGSize imageSize;
+
+@end
+
+@implementation DFImageTraceEvent
+
++ (nullable NSArray<DFImageTraceEvent *> *)eventsWithTraceData:(nonnull NSData *)data {
+    _DFImageTraceReader reader = { .bytes = data.bytes, .length = data.length };
+    if (data.length < 5 || memcmp(reader.bytes, _kDFImageTraceMagic, 4) != 0 || reader.bytes[4] != _kDFImageTraceVersion) {
+        return nil;
+    }
+    reader.offset = 5;
+    NSMutableArray *events = [NSMutableArray new];
+    NSMutableDictionary<NSNumber *, NSString *> *resources = [NSMutableDictionary new];
+    uint64_t time = 0;
+    while (reader.offset < reader.length && !reader.failed) {
+        uint8_t type = _DFImageTraceReadByte(&reader);
+        time += _DFImageTraceReadVarint(&reader);
+        if (type == _kDFImageTraceResourceDefinition) {
+            uint64_t identifier = _DFImageTraceReadVarint(&reader);
+            uint64_t length = _DFImageTraceReadVarint(&reader);
+            if (reader.failed || length > reader.length - reader.offset) {
+                return nil;
+            }
+            resources[@(identifier)] = [[NSString alloc] initWithBytes:reader.bytes + reader.offset length:(NSUInteger)length encoding:NSUTF8StringEncoding] ?: @"";
+            reader.offset += (NSUInteger)length;
+            continue;
+        }
+        DFImageTraceEvent *event = [DFImageTraceEvent new];
+        event.type = type;
+        event.timestamp = time / 1000000.0;
+        switch (type) {
+            case DFImageTraceEventTypeRequest:
+                event.taskIdentifier = (NSUInteger)_DFImageTraceReadVarint(&reader);
+                event.request = [self _readRequest:&reader resources:resources];
+                break;
+            case DFImageTraceEventTypeCancel:
+                event.taskIdentifier = (NSUInteger)_DFImageTraceReadVarint(&reader);
+                break;
+            case DFImageTraceEventTypePriority:
+                event.taskIdentifier = (NSUInteger)_DFImageTraceReadVarint(&reader);
+                event.priority = _DFImageTraceReadByte(&reader);
+                break;
+            case DFImageTraceEventTypeCompletion: {
+                event.taskIdentifier = (NSUInteger)_DFImageTraceReadVarint(&reader);
+                uint8_t flags = _DFImageTraceReadByte(&reader);
+                event.fastResponse = (flags & 1) != 0;
+                event.failed = (flags & 2) != 0;
+            } break;
+            case DFImageTraceEventTypeStartPreheating:
+            case DFImageTraceEventTypeStopPreheating:
+                event.request = [self _readRequest:&reader resources:resources];
+                break;
+            case DFImageTraceEventTypeStopPreheatingAll:
+                break;
+            case DFImageTraceEventTypeFetch:
+                event.request = [self _readRequest:&reader resources:resources];
+                event.byteCount = (int64_t)_DFImageTraceReadVarint(&reader);
+                event.latency = _DFImageTraceReadVarint(&reader) / 1000000.0;
+                event.imageSize = CGSizeMake(_DFImageTraceReadVarint(&reader), _DFImageTraceReadVarint(&reader));
+                event.failed = _DFImageTraceReadByte(&reader) != 0;
+                break;
+            default:
+                return nil;
+        }
+        if (reader.failed) {
+            return nil;
+        }
+        [events addObject:event];
+    }
+    return reader.failed ? nil : events;
+}
+
++ (nullable DFImageRequest *)_readRequest:(_DFImageTraceReader *)reader resources:(NSDictionary<NSNumber *, NSString *> *)resources {
+    NSString *resource = resources[@(_DFImageTraceReadVarint(reader))];
+    uint64_t width = _DFImageTraceReadVarint(reader);
+    uint64_t height = _DFImageTraceReadVarint(reader);
+    uint8_t contentMode = _DFImageTraceReadByte(reader);
+    uint8_t priority = _DFImageTraceReadByte(reader);
+    uint8_t flags = _DFImageTraceReadByte(reader);
+    if (reader->failed || !resource) {
+        reader->failed = YES;
+        return nil;
+    }
+    DFMutableImageRequestOptions *options = [DFMutableImageRequestOptions new];
+    options.priority = priority;
+    options.allowsClipping = (flags & _DFImageTraceRequestFlagAllowsClipping) != 0;
+    options.allowsProgressiveImage = (flags & _DFImageTraceRequestFlagAllowsProgressiveImage) != 0;
+    options.allowsNetworkAccess = (flags & _DFImageTraceRequestFlagAllowsNetworkAccess) != 0;
+    options.memoryCachePolicy = (flags & _DFImageTraceRequestFlagReloadIgnoringCache) ? DFImageRequestCachePolicyReloadIgnoringCache : DFImageRequestCachePolicyDefault;
+    CGSize targetSize = (width && height) ? CGSizeMake(width, height) : DFImageMaximumSize;
+    return [DFImageRequest requestWithResource:resource targetSize:targetSize contentMode:contentMode options:options.options];
+}
+
+@end
+
+
+#pragma mark - DFImageTraceRecorder
+
+@implementation DFImageTraceRecorder {
+    NSMutableData *_buffer;
+    NSLock *_lock;
+    CFAbsoluteTime _lastEventTime;
+    NSMapTable<DFImageTask *, NSNumber *> *_taskIdentifiers;
+    NSUInteger _nextTaskIdentifier;
+    NSMutableDictionary<NSString *, NSNumber *> *_resourceIdentifiers;
+    NSFileHandle *_fileHandle;
+    dispatch_queue_t _queue;
+}
+
+DF_INIT_UNAVAILABLE_IMPL
+
+- (void)dealloc {
+    [self flush];
+    [_fileHandle closeFile];
+}
+
+- (nonnull instancetype)initWithFileURL:(nonnull NSURL *)fileURL {
+    if (self = [super init]) {
+        _fileURL = fileURL;
+        [[NSFileManager defaultManager] createFileAtPath:fileURL.path contents:nil attributes:nil];
+        _fileHandle = [NSFileHandle fileHandleForWritingAtPath:fileURL.path];
+        _buffer = [NSMutableData new];
+        [_buffer appendBytes:_kDFImageTraceMagic length:4];
+        _DFImageTraceWriteByte(_buffer, _kDFImageTraceVersion);
+        _lock = [NSLock new];
+        _lastEventTime = CFAbsoluteTimeGetCurrent();
+        _taskIdentifiers = [NSMapTable weakToStrongObjectsMapTable];
+        _resourceIdentifiers = [NSMutableDictionary new];
+        _queue = dispatch_queue_create("DFImageTraceRecorder::queue", DISPATCH_QUEUE_SERIAL);
+    }
+    return self;
+}
+
+#pragma mark Recording
+
+- (void)recordRequestForTask:(nonnull DFImageTask *)task {
+    DFImageRequest *request = task.request;
+    DFImageRequestPriority priority = task.priority;
+    [self _recordEventWithType:DFImageTraceEventTypeRequest requests:@[request] payload:^(NSMutableData *buffer, NSArray<NSNumber *> *resources) {
+        _DFImageTraceWriteVarint(buffer, [self _identifierForTask:task]);
+        [self _writeRequest:request priority:priority resource:resources.firstObject toBuffer:buffer];
+    }];
+}
+
+- (void)recordCancelForTask:(nonnull DFImageTask *)task {
+    [self _recordEventWithType:DFImageTraceEventTypeCancel requests:nil payload:^(NSMutableData *buffer, NSArray<NSNumber *> *resources) {
+        _DFImageTraceWriteVarint(buffer, [self _identifierForTask:task]);
+    }];
+}
+
+- (void)recordPriorityChangeForTask:(nonnull DFImageTask *)task {
+    DFImageRequestPriority priority = task.priority;
+    [self _recordEventWithType:DFImageTraceEventTypePriority requests:nil payload:^(NSMutableData *buffer, NSArray<NSNumber *> *resources) {
+        _DFImageTraceWriteVarint(buffer, [self _identifierForTask:task]);
+        _DFImageTraceWriteByte(buffer, (uint8_t)priority);
+    }];
+}
+
+- (void)recordCompletionForTask:(nonnull DFImageTask *)task {
+    uint8_t flags = (task.response.isFastResponse ? 1 : 0) | (task.error ? 2 : 0);
+    [self _recordEventWithType:DFImageTraceEventTypeCompletion requests:nil payload:^(NSMutableData *buffer, NSArray<NSNumber *> *resources) {
+        _DFImageTraceWriteVarint(buffer, [self _identifierForTask:task]);
+        _DFImageTraceWriteByte(buffer, flags);
+    }];
+}
+
+- (void)recordStartPreheatingForRequests:(nonnull NSArray<DFImageRequest *> *)requests {
+    for (DFImageRequest *request in requests) {
+        [self _recordEventWithType:DFImageTraceEventTypeStartPreheating requests:@[request] payload:^(NSMutableData *buffer, NSArray<NSNumber *> *resources) {
+            [self _writeRequest:request resource:resources.firstObject toBuffer:buffer];
+        }];
+    }
+}
+
+- (void)recordStopPreheatingForRequests:(nonnull NSArray<DFImageRequest *> *)requests {
+    for (DFImageRequest *request in requests) {
+        [self _recordEventWithType:DFImageTraceEventTypeStopPreheating requests:@[request] payload:^(NSMutableData *buffer, NSArray<NSNumber *> *resources) {
+            [self _writeRequest:request resource:resources.firstObject toBuffer:buffer];
+        }];
+    }
+}
+
+- (void)recordStopPreheatingForAllRequests {
+    [self _recordEventWithType:DFImageTraceEventTypeStopPreheatingAll requests:nil payload:nil];
+}
+
+- (void)recordFetchForRequest:(nonnull DFImageRequest *)request byteCount:(int64_t)byteCount latency:(NSTimeInterval)latency imageSize:(CGSize)imageSize failed:(BOOL)failed {
+    [self _recordEventWithType:DFImageTraceEventTypeFetch requests:@[request] payload:^(NSMutableData *buffer, NSArray<NSNumber *> *resources) {
+        [self _writeRequest:request resource:resources.firstObject toBuffer:buffer];
+        _DFImageTraceWriteVarint(buffer, (uint64_t)MAX(0, byteCount));
+        _DFImageTraceWriteVarint(buffer, (uint64_t)MAX(0, latency * 1000000.0));
+        _DFImageTraceWriteVarint(buffer, (uint64_t)MAX(0, imageSize.width));
+        _DFImageTraceWriteVarint(buffer, (uint64_t)MAX(0, imageSize.height));
+        _DFImageTraceWriteByte(buffer, failed ? 1 : 0);
+    }];
+}
+
+#pragma mark Encoding
+
+/*! Writes the resource definitions (if needed) followed by the event. Must be called without holding the lock.
+ */
+- (void)_recordEventWithType:(DFImageTraceEventType)type requests:(nullable NSArray<DFImageRequest *> *)requests payload:(void (^__nullable)(NSMutableData *buffer, NSArray<NSNumber *> *resources))payload {
+    [_lock lock];
+    NSMutableArray *resources = [NSMutableArray new];
+    for (DFImageRequest *request in requests) {
+        [resources addObject:@([self _identifierForResource:request.resource])];
+    }
+    [self _writeEventHeaderWithType:type];
+    if (payload) {
+        payload(_buffer, resources);
+    }
+    if (_buffer.length >= _kDFImageTraceBufferFlushThreshold) {
+        [self _writeBufferSynchronously:NO];
+    }
+    [_lock unlock];
+}
+
+- (void)_writeEventHeaderWithType:(uint8_t)type {
+    CFAbsoluteTime time = CFAbsoluteTimeGetCurrent();
+    _DFImageTraceWriteByte(_buffer, type);
+    _DFImageTraceWriteVarint(_buffer, (uint64_t)MAX(0, (time - _lastEventTime) * 1000000.0));
+    _lastEventTime = MAX(time, _lastEventTime);
+}
+
+- (NSUInteger)_identifierForResource:(id)resource {
+    NSString *key = _DFImageTraceResourceKey(resource);
+    NSNumber *identifier = _resourceIdentifiers[key];
+    if (!identifier) {
+        identifier = @(_resourceIdentifiers.count);
+        _resourceIdentifiers[key] = identifier;
+        NSData *bytes = [key dataUsingEncoding:NSUTF8StringEncoding];
+        [self _writeEventHeaderWithType:_kDFImageTraceResourceDefinition];
+        _DFImageTraceWriteVarint(_buffer, identifier.unsignedIntegerValue);
+        _DFImageTraceWriteVarint(_buffer, bytes.length);
+        [_buffer appendData:bytes];
+    }
+    return identifier.unsignedIntegerValue;
+}
+
+- (NSUInteger)_identifierForTask:(DFImageTask *)task {
+    NSNumber *identifier = [_taskIdentifiers objectForKey:task];
+    if (!identifier) {
+        identifier = @(_nextTaskIdentifier++);
+        [_taskIdentifiers setObject:identifier forKey:task];
+    }
+    return identifier.unsignedIntegerValue;
+}
+
+- (void)_writeRequest:(DFImageRequest *)request resource:(NSNumber *)resource toBuffer:(NSMutableData *)buffer {
+    [self _writeRequest:request priority:request.options.priority resource:resource toBuffer:buffer];
+}
+
+/*! The priority of the task might differ from the priority of the request when it is changed before the task is resumed.
+ */
+- (void)_writeRequest:(DFImageRequest *)request priority:(DFImageRequestPriority)priority resource:(NSNumber *)resource toBuffer:(NSMutableData *)buffer {
+    _DFImageTraceWriteVarint(buffer, resource.unsignedIntegerValue);
+    BOOL isMaximumSize = CGSizeEqualToSize(request.targetSize, DFImageMaximumSize);
+    _DFImageTraceWriteVarint(buffer, isMaximumSize ? 0 : (uint64_t)MAX(0, round(request.targetSize.width)));
+    _DFImageTraceWriteVarint(buffer, isMaximumSize ? 0 : (uint64_t)MAX(0, round(request.targetSize.height)));
+    _DFImageTraceWriteByte(buffer, (uint8_t)request.contentMode);
+    DFImageRequestOptions *options = request.options;
+    _DFImageTraceWriteByte(buffer, (uint8_t)priority);
+    _DFImageTraceRequestFlags flags = 0;
+    if (options.allowsClipping) {
+        flags |= _DFImageTraceRequestFlagAllowsClipping;
+    }
+    if (options.allowsProgressiveImage) {
+        flags |= _DFImageTraceRequestFlagAllowsProgressiveImage;
+    }
+    if (options.allowsNetworkAccess) {
+        flags |= _DFImageTraceRequestFlagAllowsNetworkAccess;
+    }
+    if (options.memoryCachePolicy == DFImageRequestCachePolicyReloadIgnoringCache) {
+        flags |= _DFImageTraceRequestFlagReloadIgnoringCache;
+    }
+    _DFImageTraceWriteByte(buffer, flags);
+}
+
+#pragma mark Writing
+
+- (void)flush {
+    [_lock lock];
+    [self _writeBufferSynchronously:YES];
+    [_lock unlock];
+}
+
+- (void)_writeBufferSynchronously:(BOOL)synchronously {
+    NSData *data = _buffer;
+    _buffer = [NSMutableData new];
+    NSFileHandle *fileHandle = _fileHandle;
+    dispatch_block_t write = ^{
+        if (data.length) {
+            [fileHandle writeData:data];
+        }
+    };
+    if (synchronously) {
+        dispatch_sync(_queue, write);
+        dispatch_sync(_queue, ^{
+            [fileHandle synchronizeFile];
+        });
+    } else {
+        dispatch_async(_queue, write);
+    }
+}
+
+@end
@@ -0,0 +1,107 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import "DFImageFetching.h"
+#import "DFImageTraceRecorder.h"
+#import <Foundation/Foundation.h>
+
+@protocol DFImageManaging;
+
+/*! The results of the trace replay.
+ */
+@interface DFImageTraceReplayStatistics : NSObject
+
+/*! Number of the image tasks that were started.
+ */
+@property (nonatomic, readonly) NSUInteger requestCount;
+
+/*! Number of the image tasks that completed with an image.
+ */
+@property (nonatomic, readonly) NSUInteger completedCount;
+
+/*! Number of the image tasks that were cancelled.
+ */
+@property (nonatomic, readonly) NSUInteger cancelledCount;
+
+/*! Number of the image tasks that failed.
+ */
+@property (nonatomic, readonly) NSUInteger failedCount;
+
+/*! Number of the image tasks that were completed from the memory cache.
+ */
+@property (nonatomic, readonly) NSUInteger memoryCacheHitCount;
+
+/*! Number of the fetches made by the trace fetcher, including preheating.
+ */
+@property (nonatomic, readonly) NSUInteger fetchCount;
+
+/*! Number of bytes fetched by the trace fetcher, including preheating.
+ */
+@property (nonatomic, readonly) int64_t fetchedByteCount;
+
+/*! The average time between the start and the completion of the image tasks that completed with an image.
+ */
+@property (nonatomic, readonly) NSTimeInterval averageLatency;
+
+@end
+
+
+/*! The stand-in fetcher that serves the resources from the trace. It returns the data of the recorded size with a placeholder image of the recorded dimensions after the recorded latency. Resources that were never fetched when the trace was recorded are served with an average size and latency.
+ @note The resources of the requests must be strings created by DFImageTraceEvent.
+ */
+@interface DFImageTraceFetcher : NSObject <DFImageFetching>
+
+/*! The speed of the replay. Latencies are divided by the speed, 0 means that data is returned immediately. Default value is 1.0.
+ */
+@property (nonatomic) double speed;
+
+/*! Returns the number of fetches started by the receiver.
+ */
+@property (nonatomic, readonly) NSUInteger fetchCount;
+
+/*! Returns the number of bytes returned by the receiver.
+ */
+@property (nonatomic, readonly) int64_t fetchedByteCount;
+
+/*! Initializes the fetcher with the fetch events from the trace.
+ */
+- (nonnull instancetype)initWithEvents:(nonnull NSArray<DFImageTraceEvent *> *)events NS_DESIGNATED_INITIALIZER;
+
+/*! Unavailable initializer, please use designated initializer.
+ */
+- (nullable instancetype)init NS_UNAVAILABLE;
+
+@end
+
+
+/*! The DFImageTraceReplayer feeds the trace recorded by DFImageTraceRecorder through the image manager preserving the recorded timing, so that different cache policies and schedulers can be compared offline using a realistic load.
+ @note Use the fetcher of the replayer to create the image manager.
+ */
+@interface DFImageTraceReplayer : NSObject
+
+/*! The events of the trace.
+ */
+@property (nonnull, nonatomic, readonly) NSArray<DFImageTraceEvent *> *events;
+
+/*! The fetcher that serves the resources from the trace.
+ */
+@property (nonnull, nonatomic, readonly) DFImageTraceFetcher *fetcher;
+
+/*! The speed of the replay, the time intervals between the events and the fetch latencies are divided by the speed. 0 means that the events are replayed without delays. Default value is 1.0.
+ */
+@property (nonatomic) double speed;
+
+/*! Initializes the replayer with the trace data. Returns nil if the data is not a valid trace.
+ */
+- (nullable instancetype)initWithData:(nonnull NSData *)data NS_DESIGNATED_INITIALIZER;
+
+/*! Unavailable initializer, please use designated initializer.
+ */
+- (nullable instancetype)init NS_UNAVAILABLE;
+
+/*! Replays the trace using a given image manager. The completion handler is called on the main thread when all events are replayed and all started image tasks are finished.
+ */
+- (void)replayWithManager:(nonnull id<DFImageManaging>)manager completion:(void (^__nullable)(DFImageTraceReplayStatistics *__nonnull statistics))completion;
+
+@end
@@ -0,0 +1,344 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import "DFImageFetchingOperation.h"
+#import "DFImageManaging.h"
+#import "DFImageRequest.h"
+#import "DFImageResponse.h"
+#import "DFImageTask.h"
+#import "DFImageTraceReplayer.h"
+
+static inline NSTimeInterval _DFTraceInterval(NSTimeInterval interval, double speed) {
+    return speed > 0.0 ? interval / speed : 0.0;
+}
+
+#pragma mark - DFImageTraceReplayStatistics
+
+@interface DFImageTraceReplayStatistics ()
+
+@property (nonatomic) NSUInteger requestCount;
+@property (nonatomic) NSUInteger completedCount;
+@property (nonatomic) NSUInteger cancelledCount;
+@property (nonatomic) NSUInteger failedCount;
+@property (nonatomic) NSUInteger memoryCacheHitCount;
+@property (nonatomic) NSUInteger fetchCount;
+@property (nonatomic) int64_t fetchedByteCount;
+@property (nonatomic) NSTimeInterval averageLatency;
+
+@end
+
+@implementation DFImageTraceReplayStatistics
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@ %p> { requests = %lu, completed = %lu, cancelled = %lu, failed = %lu, memory cache hits = %lu, fetches = %lu, fetched bytes = %lld, average latency = %.3fs }", [self class], self, (unsigned long)self.requestCount, (unsigned long)self.completedCount, (unsigned long)self.cancelledCount, (unsigned long)self.failedCount, (unsigned long)self.memoryCacheHitCount, (unsigned long)self.fetchCount, self.fetchedByteCount, self.averageLatency];
+}
+
+@end
+
+#pragma mark - DFImageTraceFetcher
+
+@interface _DFImageTraceFetchOperation : NSObject <DFImageFetchingOperation>
+
+@property (atomic, getter=isCancelled) BOOL cancelled;
+
+@end
+
+@implementation _DFImageTraceFetchOperation
+
+- (void)cancelImageFetching {
+    self.cancelled = YES;
+}
+
+- (void)setImageFetchingPriority:(DFImageRequestPriority)priority {
+    // Do nothing, the data is delivered after a fixed delay
+}
+
+@end
+
+
+@implementation DFImageTraceFetcher {
+    NSDictionary<NSString *, DFImageTraceEvent *> *_fetchEvents;
+    int64_t _averageByteCount;
+    NSTimeInterval _averageLatency;
+    CGSize _averageImageSize;
+    NSCache *_imageData;
+    NSLock *_lock;
+    NSUInteger _fetchCount;
+    int64_t _fetchedByteCount;
+}
+
+DF_INIT_UNAVAILABLE_IMPL
+
+- (instancetype)initWithEvents:(NSArray<DFImageTraceEvent *> *)events {
+    if (self = [super init]) {
+        _speed = 1.0;
+        _imageData = [NSCache new];
+        _lock = [NSLock new];
+
+        NSMutableDictionary *fetchEvents = [NSMutableDictionary new];
+        int64_t totalByteCount = 0;
+        NSTimeInterval totalLatency = 0.0;
+        CGFloat totalWidth = 0.0, totalHeight = 0.0;
+        NSUInteger succeededCount = 0;
+        for (DFImageTraceEvent *event in events) {
+            if (event.type != DFImageTraceEventTypeFetch || !event.request) {
+                continue;
+            }
+            fetchEvents[event.request.resource] = event;
+            if (!event.failed) {
+                totalByteCount += event.byteCount;
+                totalLatency += event.latency;
+                totalWidth += event.imageSize.width;
+                totalHeight += event.imageSize.height;
+                succeededCount++;
+            }
+        }
+        _fetchEvents = [fetchEvents copy];
+        if (succeededCount > 0) {
+            _averageByteCount = totalByteCount / (int64_t)succeededCount;
+            _averageLatency = totalLatency / succeededCount;
+            _averageImageSize = CGSizeMake(round(totalWidth / succeededCount), round(totalHeight / succeededCount));
+        } else {
+            _averageImageSize = CGSizeMake(1.f, 1.f);
+        }
+    }
+    return self;
+}
+
+- (NSUInteger)fetchCount {
+    [_lock lock];
+    NSUInteger fetchCount = _fetchCount;
+    [_lock unlock];
+    return fetchCount;
+}
+
+- (int64_t)fetchedByteCount {
+    [_lock lock];
+    int64_t fetchedByteCount = _fetchedByteCount;
+    [_lock unlock];
+    return fetchedByteCount;
+}
+
+#pragma mark <DFImageFetching>
+
+- (BOOL)canHandleRequest:(DFImageRequest *)request {
+    return [request.resource isKindOfClass:[NSString class]];
+}
+
+- (BOOL)isRequestFetchEquivalent:(DFImageRequest *)request1 toRequest:(DFImageRequest *)request2 {
+    return [request1.resource isEqualToString:request2.resource];
+}
+
+- (BOOL)isRequestCacheEquivalent:(DFImageRequest *)request1 toRequest:(DFImageRequest *)request2 {
+    return [request1.resource isEqualToString:request2.resource];
+}
+
+- (id<DFImageFetchingOperation>)startOperationWithRequest:(DFImageRequest *)request progressHandler:(DFImageFetchingProgressHandler)progressHandler completion:(DFImageFetchingCompletionHandler)completion {
+    DFImageTraceEvent *event = _fetchEvents[request.resource];
+    BOOL failed = event.failed;
+    int64_t byteCount = event ? event.byteCount : _averageByteCount;
+    NSTimeInterval latency = event ? event.latency : _averageLatency;
+    CGSize imageSize = (event && event.imageSize.width > 0.f && event.imageSize.height > 0.f) ? event.imageSize : _averageImageSize;
+
+    [_lock lock];
+    _fetchCount++;
+    [_lock unlock];
+
+    _DFImageTraceFetchOperation *operation = [_DFImageTraceFetchOperation new];
+    dispatch_time_t time = dispatch_time(DISPATCH_TIME_NOW, (int64_t)(_DFTraceInterval(latency, self.speed) * NSEC_PER_SEC));
+    dispatch_after(time, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        if (operation.isCancelled) {
+            return;
+        }
+        if (failed) {
+            if (completion) {
+                completion(nil, nil, [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorUnknown userInfo:nil]);
+            }
+            return;
+        }
+        NSData *data = [self _dataWithImageSize:imageSize byteCount:byteCount];
+        [_lock lock];
+        _fetchedByteCount += data.length;
+        [_lock unlock];
+        if (progressHandler) {
+            progressHandler(data, data.length, data.length);
+        }
+        if (completion) {
+            completion(data, nil, nil);
+        }
+    });
+    return operation;
+}
+
+/*! Returns the data of a placeholder JPEG image with a given size padded with zeros to a given byte count. The decoders ignore the bytes after the end of the image.
+ */
+- (nullable NSData *)_dataWithImageSize:(CGSize)imageSize byteCount:(int64_t)byteCount {
+    NSValue *key = [NSValue valueWithCGSize:imageSize];
+    NSData *imageData = [_imageData objectForKey:key];
+    if (!imageData) {
+        UIGraphicsBeginImageContextWithOptions(imageSize, YES, 1.f);
+        [[UIColor grayColor] setFill];
+        UIRectFill(CGRectMake(0.f, 0.f, imageSize.width, imageSize.height));
+        UIImage *image = UIGraphicsGetImageFromCurrentImageContext();
+        UIGraphicsEndImageContext();
+        imageData = UIImageJPEGRepresentation(image, 0.5f);
+        if (!imageData) {
+            return nil;
+        }
+        [_imageData setObject:imageData forKey:key cost:imageData.length];
+    }
+    if (byteCount <= (int64_t)imageData.length) {
+        return imageData;
+    }
+    NSMutableData *data = [imageData mutableCopy];
+    [data setLength:(NSUInteger)byteCount];
+    return data;
+}
+
+@end
+
+#pragma mark - DFImageTraceReplayer
+
+@implementation DFImageTraceReplayer {
+    id<DFImageManaging> _manager;
+    void (^_completion)(DFImageTraceReplayStatistics *);
+    NSUInteger _nextEventIndex;
+    NSTimeInterval _startTime;
+    NSMutableDictionary<NSNumber *, DFImageTask *> *_tasks;
+    NSMapTable<DFImageTask *, NSNumber *> *_resumeTimes;
+    NSUInteger _runningTaskCount;
+    NSTimeInterval _totalLatency;
+    DFImageTraceReplayStatistics *_statistics;
+}
+
+DF_INIT_UNAVAILABLE_IMPL
+
+- (instancetype)initWithData:(NSData *)data {
+    NSArray *events = [DFImageTraceEvent eventsWithTraceData:data];
+    if (!events) {
+        return nil;
+    }
+    if (self = [super init]) {
+        _events = events;
+        _fetcher = [[DFImageTraceFetcher alloc] initWithEvents:events];
+        _speed = 1.0;
+    }
+    return self;
+}
+
+- (void)setSpeed:(double)speed {
+    _speed = speed;
+    _fetcher.speed = speed;
+}
+
+- (void)replayWithManager:(id<DFImageManaging>)manager completion:(void (^)(DFImageTraceReplayStatistics *))completion {
+    dispatch_async(dispatch_get_main_queue(), ^{
+        NSAssert(!_manager, @"Replay is already in progress");
+        _manager = manager;
+        _completion = [completion copy];
+        _nextEventIndex = 0;
+        _tasks = [NSMutableDictionary new];
+        _resumeTimes = [NSMapTable strongToStrongObjectsMapTable];
+        _runningTaskCount = 0;
+        _totalLatency = 0.0;
+        _statistics = [DFImageTraceReplayStatistics new];
+        _statistics.fetchCount = _fetcher.fetchCount;
+        _statistics.fetchedByteCount = _fetcher.fetchedByteCount;
+        _startTime = CACurrentMediaTime();
+        [self _performDueEvents];
+    });
+}
+
+/*! Events are performed one by one on the main thread to preserve the order of the events with equal timestamps.
+ */
+- (void)_performDueEvents {
+    while (_nextEventIndex < _events.count) {
+        DFImageTraceEvent *event = _events[_nextEventIndex];
+        NSTimeInterval delay = _startTime + _DFTraceInterval(event.timestamp, _speed) - CACurrentMediaTime();
+        if (delay > 0.0) {
+            dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+                [self _performDueEvents];
+            });
+            return;
+        }
+        _nextEventIndex++;
+        [self _performEvent:event];
+    }
+    [self _finishIfNeeded];
+}
+
+- (void)_performEvent:(DFImageTraceEvent *)event {
+    switch (event.type) {
+        case DFImageTraceEventTypeRequest: {
+            DFImageTraceReplayer *__weak weakSelf = self;
+            DFImageTask *task = [_manager imageTaskForRequest:event.request completion:^(UIImage *image, NSError *error, DFImageResponse *response, DFImageTask *task) {
+                [weakSelf _didCompleteTask:task image:image error:error response:response];
+            }];
+            _tasks[@(event.taskIdentifier)] = task;
+            [_resumeTimes setObject:@(CACurrentMediaTime()) forKey:task];
+            _runningTaskCount++;
+            _statistics.requestCount++;
+            [task resume];
+        } break;
+        case DFImageTraceEventTypeCancel:
+            [_tasks[@(event.taskIdentifier)] cancel];
+            break;
+        case DFImageTraceEventTypePriority:
+            _tasks[@(event.taskIdentifier)].priority = event.priority;
+            break;
+        case DFImageTraceEventTypeStartPreheating:
+            [_manager startPreheatingImagesForRequests:@[event.request]];
+            break;
+        case DFImageTraceEventTypeStopPreheating:
+            [_manager stopPreheatingImagesForRequests:@[event.request]];
+            break;
+        case DFImageTraceEventTypeStopPreheatingAll:
+            [_manager stopPreheatingImagesForAllRequests];
+            break;
+        default: // Completions and fetches are the results of the replay
+            break;
+    }
+}
+
+- (void)_didCompleteTask:(DFImageTask *)task image:(UIImage *)image error:(NSError *)error response:(DFImageResponse *)response {
+    NSNumber *resumeTime = [_resumeTimes objectForKey:task];
+    if (!resumeTime) {
+        return;
+    }
+    [_resumeTimes removeObjectForKey:task];
+    _runningTaskCount--;
+    if (image) {
+        _statistics.completedCount++;
+        _totalLatency += CACurrentMediaTime() - resumeTime.doubleValue;
+        if (response.isFastResponse) {
+            _statistics.memoryCacheHitCount++;
+        }
+    } else if ([error.domain isEqualToString:DFImageManagerErrorDomain] && error.code == DFImageManagerErrorCancelled) {
+        _statistics.cancelledCount++;
+    } else {
+        _statistics.failedCount++;
+    }
+    [self _finishIfNeeded];
+}
+
+- (void)_finishIfNeeded {
+    if (_nextEventIndex < _events.count || _runningTaskCount > 0 || !_manager) {
+        return;
+    }
+    DFImageTraceReplayStatistics *statistics = _statistics;
+    statistics.fetchCount = _fetcher.fetchCount - statistics.fetchCount;
+    statistics.fetchedByteCount = _fetcher.fetchedByteCount - statistics.fetchedByteCount;
+    statistics.averageLatency = statistics.completedCount > 0 ? _totalLatency / statistics.completedCount : 0.0;
+    void (^completion)(DFImageTraceReplayStatistics *) = _completion;
+    _manager = nil;
+    _completion = nil;
+    _tasks = nil;
+    _resumeTimes = nil;
+    _statistics = nil;
+    if (completion) {
+        completion(statistics);
+    }
+}
+
+@end
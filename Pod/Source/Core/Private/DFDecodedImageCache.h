@@ -0,0 +1,39 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import <Foundation/Foundation.h>
+#import <UIKit/UIKit.h>
+
+/*! Short-lived cache of the decoded but not yet processed images. Lets a single decode feed all the variants of the same image (e.g. different target sizes) that are requested within a short window.
+
+ The images are evicted in the order in which they were stored, either when they become older than maximumAge or when the total cost exceeds costLimit.
+ @note Thread safe.
+ */
+@interface DFDecodedImageCache : NSObject
+
+/*! Maximum total cost of the images (see -[UIImage df_memoryCost]).
+ */
+@property (nonatomic, readonly) NSUInteger costLimit;
+
+/*! Maximum amount of time the image is kept after it was stored.
+ */
+@property (nonatomic, readonly) NSTimeInterval maximumAge;
+
+/*! Returns the total cost of the images in the cache.
+ */
+@property (nonatomic, readonly) NSUInteger totalCost;
+
+- (nonnull instancetype)initWithCostLimit:(NSUInteger)costLimit maximumAge:(NSTimeInterval)maximumAge NS_DESIGNATED_INITIALIZER;
+
+- (nullable instancetype)init NS_UNAVAILABLE;
+
+/*! Returns the image for a given key along with the info returned by the fetcher when the data was fetched.
+ */
+- (nullable UIImage *)imageForKey:(nonnull id<NSCopying>)key info:(NSDictionary *__nullable *__nullable)info;
+
+- (void)storeImage:(nonnull UIImage *)image info:(nullable NSDictionary *)info forKey:(nonnull id<NSCopying>)key;
+
+- (void)removeAllImages;
+
+@end
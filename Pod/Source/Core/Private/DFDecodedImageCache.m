@@ -0,0 +1,138 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import "DFDecodedImageCache.h"
+#import "DFImageManagerDefines.h"
+#import "UIImage+DFImageUtilities.h"
+
+@interface _DFDecodedImageCacheEntry : NSObject
+
+@property (nonnull, nonatomic) id key;
+@property (nonnull, nonatomic) UIImage *image;
+@property (nullable, nonatomic) NSDictionary *info;
+@property (nonatomic) NSUInteger cost;
+@property (nonatomic) CFAbsoluteTime expirationDate;
+
+@end
+
+@implementation _DFDecodedImageCacheEntry
+@end
+
+
+@implementation DFDecodedImageCache {
+    NSMutableDictionary<id<NSCopying>, _DFDecodedImageCacheEntry *> *_entries;
+    NSMutableArray<_DFDecodedImageCacheEntry *> *_queue; // Oldest entries first
+    BOOL _isSweepScheduled;
+    NSLock *_lock;
+}
+
+DF_INIT_UNAVAILABLE_IMPL
+
+- (nonnull instancetype)initWithCostLimit:(NSUInteger)costLimit maximumAge:(NSTimeInterval)maximumAge {
+    if (self = [super init]) {
+        _costLimit = costLimit;
+        _maximumAge = maximumAge;
+        _entries = [NSMutableDictionary new];
+        _queue = [NSMutableArray new];
+        _lock = [NSLock new];
+#if TARGET_OS_IOS && !TARGET_OS_WATCH
+        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(removeAllImages) name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
+#endif
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+}
+
+- (nullable UIImage *)imageForKey:(nonnull id<NSCopying>)key info:(NSDictionary *__nullable *__nullable)info {
+    [_lock lock];
+    [self _removeExpiredEntries];
+    _DFDecodedImageCacheEntry *entry = _entries[key];
+    [_lock unlock];
+    if (info) {
+        *info = entry.info;
+    }
+    return entry.image;
+}
+
+- (void)storeImage:(nonnull UIImage *)image info:(nullable NSDictionary *)info forKey:(nonnull id<NSCopying>)key {
+    NSUInteger cost = [image df_memoryCost];
+    if (cost > _costLimit) {
+        return;
+    }
+    _DFDecodedImageCacheEntry *entry = [_DFDecodedImageCacheEntry new];
+    entry.key = key;
+    entry.image = image;
+    entry.info = info;
+    entry.cost = cost;
+    entry.expirationDate = CFAbsoluteTimeGetCurrent() + _maximumAge;
+    [_lock lock];
+    [self _removeEntry:_entries[key]];
+    _entries[key] = entry;
+    [_queue addObject:entry];
+    _totalCost += cost;
+    [self _removeExpiredEntries];
+    while (_totalCost > _costLimit && _queue.count) {
+        [self _removeEntry:_queue.firstObject];
+    }
+    [self _scheduleSweepIfNeeded];
+    [_lock unlock];
+}
+
+- (NSUInteger)totalCost {
+    [_lock lock];
+    NSUInteger totalCost = _totalCost;
+    [_lock unlock];
+    return totalCost;
+}
+
+- (void)removeAllImages {
+    [_lock lock];
+    [_entries removeAllObjects];
+    [_queue removeAllObjects];
+    _totalCost = 0;
+    [_lock unlock];
+}
+
+- (void)_removeEntry:(nullable _DFDecodedImageCacheEntry *)entry {
+    if (!entry) {
+        return;
+    }
+    [_queue removeObjectIdenticalTo:entry];
+    [_entries removeObjectForKey:entry.key];
+    _totalCost -= entry.cost;
+}
+
+- (void)_removeExpiredEntries {
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    while (_queue.count && _queue.firstObject.expirationDate <= now) {
+        [self _removeEntry:_queue.firstObject];
+    }
+}
+
+/*! The images are large, they shouldn't outlive maximumAge even if the cache is not accessed.
+ */
+- (void)_scheduleSweepIfNeeded {
+    if (_isSweepScheduled || !_queue.count) {
+        return;
+    }
+    _isSweepScheduled = YES;
+    NSTimeInterval delay = MAX(_queue.firstObject.expirationDate - CFAbsoluteTimeGetCurrent(), 0.0);
+    typeof(self) __weak weakSelf = self;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0), ^{
+        [weakSelf _sweep];
+    });
+}
+
+- (void)_sweep {
+    [_lock lock];
+    _isSweepScheduled = NO;
+    [self _removeExpiredEntries];
+    [self _scheduleSweepIfNeeded];
+    [_lock unlock];
+}
+
+@end
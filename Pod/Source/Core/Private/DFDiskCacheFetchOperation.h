@@ -0,0 +1,51 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import "DFImageFetching.h"
+#import "DFImageFetchingOperation.h"
+#import <Foundation/Foundation.h>
+
+@class DFDiskCache;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*! Returns the disk cache key for a given URL request or nil if the response to the request shouldn't be cached.
+ */
+extern NSString *__nullable DFDiskCacheKeyForURLRequest(NSURLRequest *URLRequest);
+
+/*! Returns YES if the cached data can be returned for a given URL request based on its cache policy.
+ */
+extern BOOL DFDiskCacheCanReturnDataForURLRequest(NSURLRequest *URLRequest);
+
+/*! Returns YES if the cached data must be fresh to be returned for a given URL request (NSURLRequestUseProtocolCachePolicy), otherwise any cached data is returned.
+ */
+extern BOOL DFDiskCacheRequiresFreshDataForURLRequest(NSURLRequest *URLRequest);
+
+/*! Returns NO if the response must not be stored in the disk cache (Cache-Control: no-store).
+ */
+extern BOOL DFDiskCacheCanStoreResponse(NSURLResponse *__nullable response);
+
+/*! Returns the info that is stored in the disk cache along with the data of the response, the info includes the date when the response was stored.
+ */
+extern NSDictionary *DFDiskCacheInfoForStoring(NSDictionary *__nullable info);
+
+/*! Returns the URL request that revalidates the stale cached data using the validator from its info (If-None-Match or If-Modified-Since).
+ */
+extern NSURLRequest *DFDiskCacheConditionalURLRequest(NSURLRequest *URLRequest, NSDictionary *__nullable staleInfo);
+
+/*! Returns the info for a given response (DFImageInfoValidatorKey, DFImageInfoHTTPHeaderFieldsKey). The info is returned by the fetchers and is stored in the disk cache along with the data.
+ */
+extern NSDictionary *__nullable DFImageInfoForURLResponse(NSURLResponse *__nullable response);
+
+/*! Fetch operation that reads data from the disk cache in background without touching the URL loading system. Falls back to the operation created by the fallback block if the data can't be read, or if the data is stale (see Cache-Control and Expires header fields in DFImageInfoHTTPHeaderFieldsKey) and the operation requires fresh data. The fallback block is given the info of the stale data, so that the fallback operation can revalidate it (see DFDiskCacheConditionalURLRequest), and the completion to call. If the fallback operation fails with DFImageManagerErrorNotModified the stale data is stored again with the updated info and returned. The info of the data returned from the disk cache has DFImageInfoFetchedByteCountKey set to 0. The completion is called with NSURLErrorCancelled error if the operation is cancelled before the fallback operation is started, or if the fallback block returns nil.
+ */
+@interface DFDiskCacheFetchOperation : NSObject <DFImageFetchingOperation>
+
+/*! Creates and starts the operation.
+ */
++ (instancetype)startOperationWithDiskCache:(DFDiskCache *)diskCache key:(NSString *)key requiresFreshData:(BOOL)requiresFreshData progressHandler:(nullable DFImageFetchingProgressHandler)progressHandler completion:(nullable DFImageFetchingCompletionHandler)completion fallback:(id<DFImageFetchingOperation> __nullable (^)(NSDictionary *__nullable staleInfo, DFImageFetchingCompletionHandler __nullable completion))fallback;
+
+@end
+
+NS_ASSUME_NONNULL_END
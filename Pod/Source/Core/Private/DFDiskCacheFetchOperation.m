@@ -0,0 +1,287 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import "DFDiskCache.h"
+#import "DFDiskCacheFetchOperation.h"
+#import "DFImageManagerDefines.h"
+
+/*! The key in the stored info, the value is the date when the response was stored. The key is removed from the info returned by the operation.
+ */
+static NSString *const _DFDiskCacheStorageDateKey = @"DFDiskCacheStorageDate";
+
+/*! The fraction of the time since the last modification for which the response without explicit freshness lifetime is considered fresh (heuristic freshness, RFC 7234).
+ */
+static const double _DFHeuristicFreshnessFraction = 0.1;
+
+static NSDate *_DFDateFromHTTPDate(id value) {
+    if (![value isKindOfClass:[NSString class]]) {
+        return nil;
+    }
+    static NSDateFormatter *formatter;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        formatter = [NSDateFormatter new];
+        formatter.locale = [NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"];
+        formatter.timeZone = [NSTimeZone timeZoneWithAbbreviation:@"GMT"];
+        formatter.dateFormat = @"EEE, dd MMM yyyy HH:mm:ss zzz";
+    });
+    @synchronized(formatter) {
+        return [formatter dateFromString:value];
+    }
+}
+
+/*! Returns the lowercased directives of the Cache-Control header field.
+ */
+static NSArray<NSString *> *_DFCacheControlDirectives(id cacheControl) {
+    if (![cacheControl isKindOfClass:[NSString class]]) {
+        return @[];
+    }
+    NSMutableArray *directives = [NSMutableArray new];
+    for (NSString *directive in [[cacheControl lowercaseString] componentsSeparatedByString:@","]) {
+        [directives addObject:[directive stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]]];
+    }
+    return directives;
+}
+
+/*! Returns YES if the data with a given stored info can be returned without revalidation. The data that was stored without the response (e.g. by the client of the disk cache) is always fresh.
+ */
+static BOOL _DFIsCachedResponseFresh(NSDictionary *info) {
+    NSDate *storageDate = info[_DFDiskCacheStorageDateKey];
+    if (![storageDate isKindOfClass:[NSDate class]]) {
+        return YES;
+    }
+    NSDictionary *headerFields = info[DFImageInfoHTTPHeaderFieldsKey];
+    if (![headerFields isKindOfClass:[NSDictionary class]]) {
+        headerFields = nil;
+    }
+    NSDate *date = _DFDateFromHTTPDate(headerFields[@"Date"]);
+    if (!date || [date compare:storageDate] == NSOrderedDescending) {
+        date = storageDate; // The clock of the server is ahead, the age is counted from the time the response was stored
+    }
+    NSTimeInterval lifetime = 0.0;
+    BOOL hasLifetime = NO;
+    for (NSString *directive in _DFCacheControlDirectives(headerFields[@"Cache-Control"])) {
+        if ([directive isEqualToString:@"no-cache"]) {
+            return NO;
+        }
+        if ([directive hasPrefix:@"max-age="]) {
+            lifetime = [[directive substringFromIndex:@"max-age=".length] doubleValue];
+            hasLifetime = YES;
+        }
+    }
+    if (!hasLifetime && headerFields[@"Expires"]) {
+        NSDate *expires = _DFDateFromHTTPDate(headerFields[@"Expires"]);
+        lifetime = expires ? [expires timeIntervalSinceDate:date] : 0.0; // Invalid dates (e.g. "0") mean that the response has already expired
+        hasLifetime = YES;
+    }
+    if (!hasLifetime) {
+        NSDate *lastModified = _DFDateFromHTTPDate(headerFields[@"Last-Modified"]);
+        lifetime = lastModified ? MAX([date timeIntervalSinceDate:lastModified], 0.0) * _DFHeuristicFreshnessFraction : 0.0;
+    }
+    return -[date timeIntervalSinceNow] < lifetime;
+}
+
+/*! Returns the info without the keys that are private to the disk cache.
+ */
+static NSDictionary *_DFPublicInfo(NSDictionary *info) {
+    if (!info[_DFDiskCacheStorageDateKey]) {
+        return info;
+    }
+    NSMutableDictionary *publicInfo = [info mutableCopy];
+    [publicInfo removeObjectForKey:_DFDiskCacheStorageDateKey];
+    return publicInfo.count ? [publicInfo copy] : nil;
+}
+
+/*! Returns the info of the data returned from the disk cache, nothing was received from the network.
+ */
+static NSDictionary *_DFInfoForCachedData(NSDictionary *info) {
+    NSMutableDictionary *cachedInfo = [NSMutableDictionary dictionaryWithDictionary:info];
+    cachedInfo[DFImageInfoFetchedByteCountKey] = @0;
+    return [cachedInfo copy];
+}
+
+/*! Returns the info of the stale data updated with the info of the response that has revalidated it (e.g. 304 Not Modified updates the Date, Cache-Control and Expires header fields).
+ */
+static NSDictionary *_DFInfoByUpdatingStaleInfo(NSDictionary *staleInfo, NSDictionary *info) {
+    NSMutableDictionary *updatedInfo = [NSMutableDictionary dictionaryWithDictionary:staleInfo];
+    NSMutableDictionary *headerFields = [NSMutableDictionary dictionaryWithDictionary:staleInfo[DFImageInfoHTTPHeaderFieldsKey]];
+    [headerFields addEntriesFromDictionary:info[DFImageInfoHTTPHeaderFieldsKey]];
+    if (headerFields.count) {
+        updatedInfo[DFImageInfoHTTPHeaderFieldsKey] = [headerFields copy];
+    }
+    if (info[DFImageInfoValidatorKey]) {
+        updatedInfo[DFImageInfoValidatorKey] = info[DFImageInfoValidatorKey];
+    }
+    return updatedInfo.count ? [updatedInfo copy] : nil;
+}
+
+NSString *DFDiskCacheKeyForURLRequest(NSURLRequest *URLRequest) {
+    return [URLRequest.URL.scheme hasPrefix:@"http"] ? URLRequest.URL.absoluteString : nil;
+}
+
+BOOL DFDiskCacheCanReturnDataForURLRequest(NSURLRequest *URLRequest) {
+    switch (URLRequest.cachePolicy) {
+        case NSURLRequestReloadIgnoringLocalCacheData:
+        case NSURLRequestReloadIgnoringLocalAndRemoteCacheData:
+        case NSURLRequestReloadRevalidatingCacheData:
+            return NO;
+        default:
+            return YES;
+    }
+}
+
+BOOL DFDiskCacheRequiresFreshDataForURLRequest(NSURLRequest *URLRequest) {
+    return URLRequest.cachePolicy == NSURLRequestUseProtocolCachePolicy;
+}
+
+BOOL DFDiskCacheCanStoreResponse(NSURLResponse *response) {
+    if (![response isKindOfClass:[NSHTTPURLResponse class]]) {
+        return YES;
+    }
+    NSDictionary *allHeaderFields = ((NSHTTPURLResponse *)response).allHeaderFields;
+    for (NSString *key in allHeaderFields) {
+        if ([key caseInsensitiveCompare:@"Cache-Control"] == NSOrderedSame) {
+            return ![_DFCacheControlDirectives(allHeaderFields[key]) containsObject:@"no-store"];
+        }
+    }
+    return YES;
+}
+
+NSDictionary *DFDiskCacheInfoForStoring(NSDictionary *info) {
+    NSMutableDictionary *storedInfo = [NSMutableDictionary dictionaryWithDictionary:info];
+    storedInfo[_DFDiskCacheStorageDateKey] = [NSDate date];
+    [storedInfo removeObjectForKey:DFImageInfoFetchedByteCountKey];
+    return [storedInfo copy];
+}
+
+NSURLRequest *DFDiskCacheConditionalURLRequest(NSURLRequest *URLRequest, NSDictionary *staleInfo) {
+    NSString *validator = staleInfo[DFImageInfoValidatorKey];
+    if (![validator isKindOfClass:[NSString class]] || [URLRequest valueForHTTPHeaderField:@"If-None-Match"] || [URLRequest valueForHTTPHeaderField:@"If-Modified-Since"]) {
+        return URLRequest;
+    }
+    NSMutableURLRequest *conditionalURLRequest = [URLRequest mutableCopy];
+    // Entity tags are always quoted, otherwise the validator is the last modification date
+    BOOL isEntityTag = [validator hasPrefix:@"\""] || [validator hasPrefix:@"W/"];
+    [conditionalURLRequest setValue:validator forHTTPHeaderField:(isEntityTag ? @"If-None-Match" : @"If-Modified-Since")];
+    return [conditionalURLRequest copy];
+}
+
+NSDictionary *DFImageInfoForURLResponse(NSURLResponse *response) {
+    if (![response isKindOfClass:[NSHTTPURLResponse class]]) {
+        return nil;
+    }
+    NSDictionary *allHeaderFields = ((NSHTTPURLResponse *)response).allHeaderFields;
+    NSMutableDictionary *headerFields = [NSMutableDictionary new];
+    for (NSString *field in @[ @"Cache-Control", @"Expires", @"Date", @"Last-Modified", @"ETag", @"Content-Length" ]) {
+        for (NSString *key in allHeaderFields) {
+            if ([key caseInsensitiveCompare:field] == NSOrderedSame && [allHeaderFields[key] isKindOfClass:[NSString class]]) {
+                headerFields[field] = allHeaderFields[key];
+                break;
+            }
+        }
+    }
+    if (!headerFields.count) {
+        return nil;
+    }
+    NSMutableDictionary *info = [NSMutableDictionary new];
+    info[DFImageInfoValidatorKey] = headerFields[@"ETag"] ?: headerFields[@"Last-Modified"];
+    info[DFImageInfoHTTPHeaderFieldsKey] = [headerFields copy];
+    return [info copy];
+}
+
+static NSError *_DFCancelledError(void) {
+    return [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCancelled userInfo:nil];
+}
+
+@implementation DFDiskCacheFetchOperation {
+    BOOL _cancelled;
+    DFImageRequestPriority _priority;
+    id<DFImageFetchingOperation> _fallbackOperation;
+}
+
++ (instancetype)startOperationWithDiskCache:(DFDiskCache *)diskCache key:(NSString *)key requiresFreshData:(BOOL)requiresFreshData progressHandler:(DFImageFetchingProgressHandler)progressHandler completion:(DFImageFetchingCompletionHandler)completion fallback:(id<DFImageFetchingOperation> (^)(NSDictionary *, DFImageFetchingCompletionHandler))fallback {
+    DFDiskCacheFetchOperation *operation = [DFDiskCacheFetchOperation new];
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        if ([operation _isCancelled]) {
+            if (completion) {
+                completion(nil, nil, _DFCancelledError());
+            }
+            return;
+        }
+        NSDictionary *info;
+        NSData *data = [diskCache dataForKey:key info:&info];
+        if (data && (!requiresFreshData || _DFIsCachedResponseFresh(info))) {
+            if (progressHandler) {
+                progressHandler(data, (int64_t)data.length, (int64_t)data.length);
+            }
+            if (completion) {
+                completion(data, _DFInfoForCachedData(_DFPublicInfo(info)), nil);
+            }
+        } else {
+            DFImageFetchingCompletionHandler fallbackCompletion = completion;
+            NSDictionary *staleInfo = data ? _DFPublicInfo(info) : nil;
+            if (data) { // The stale data is returned if it hasn't changed
+                fallbackCompletion = ^(NSData *fetchedData, NSDictionary *fetchedInfo, NSError *error) {
+                    if ([error.domain isEqualToString:DFImageManagerErrorDomain] && error.code == DFImageManagerErrorNotModified) {
+                        NSDictionary *updatedInfo = _DFInfoByUpdatingStaleInfo(staleInfo, fetchedInfo);
+                        [diskCache storeData:data info:DFDiskCacheInfoForStoring(updatedInfo) forKey:key];
+                        if (completion) {
+                            completion(data, _DFInfoForCachedData(updatedInfo), nil);
+                        }
+                    } else if (completion) {
+                        completion(fetchedData, fetchedInfo, error);
+                    }
+                };
+            }
+            id<DFImageFetchingOperation> fallbackOperation = fallback(staleInfo, fallbackCompletion);
+            if (fallbackOperation) {
+                [operation _setFallbackOperation:fallbackOperation];
+            } else if (completion) {
+                completion(nil, nil, _DFCancelledError());
+            }
+        }
+    });
+    return operation;
+}
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _priority = DFImageRequestPriorityNormal;
+    }
+    return self;
+}
+
+- (BOOL)_isCancelled {
+    @synchronized(self) {
+        return _cancelled;
+    }
+}
+
+- (void)_setFallbackOperation:(id<DFImageFetchingOperation>)operation {
+    @synchronized(self) {
+        _fallbackOperation = operation;
+        [operation setImageFetchingPriority:_priority];
+        if (_cancelled) {
+            [operation cancelImageFetching];
+        }
+    }
+}
+
+#pragma mark <DFImageFetchingOperation>
+
+- (void)cancelImageFetching {
+    @synchronized(self) {
+        _cancelled = YES;
+        [_fallbackOperation cancelImageFetching];
+    }
+}
+
+- (void)setImageFetchingPriority:(DFImageRequestPriority)priority {
+    @synchronized(self) {
+        _priority = priority;
+        [_fallbackOperation setImageFetchingPriority:priority];
+    }
+}
+
+@end
@@ -0,0 +1,36 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import <Foundation/Foundation.h>
+
+/*! Probabilistic multiset that estimates how often an element was accessed within a time window. Implemented as a count-min sketch with 4-bit saturating counters. Counters are halved each time the number of recorded accesses reaches the sample size, so that the old popularity fades away.
+ @note Not thread safe.
+ */
+@interface DFFrequencySketch : NSObject
+
+/*! Initializes the sketch that is optimized to track the given number of elements.
+ */
+- (nonnull instancetype)initWithCapacity:(NSUInteger)capacity NS_DESIGNATED_INITIALIZER;
+
+/*! Unavailable initializer, please use designated initializer.
+ */
+- (nullable instancetype)init NS_UNAVAILABLE;
+
+/*! Records an access of the element with a given hash.
+ */
+- (void)incrementHash:(NSUInteger)hash;
+
+/*! Returns the estimated number of accesses of the element with a given hash, up to 15.
+ */
+- (NSUInteger)frequencyForHash:(NSUInteger)hash;
+
+/*! Resizes the sketch to track the given number of elements keeping the recorded frequencies. When the sketch grows the counters are copied to the positions that the elements map to in the larger table, when it shrinks the counters of the elements that map to the same position are added up (saturating), so that the estimates never decrease.
+ */
+- (void)resizeToCapacity:(NSUInteger)capacity;
+
+/*! Resets all counters.
+ */
+- (void)clear;
+
+@end
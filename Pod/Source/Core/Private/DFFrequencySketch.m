@@ -0,0 +1,121 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import "DFFrequencySketch.h"
+#import "DFImageManagerDefines.h"
+
+static const NSUInteger _kDFSketchDepth = 4;
+static const uint8_t _kDFSketchMaxCount = 15;
+static const uint64_t _kDFSketchSeeds[_kDFSketchDepth] = { 0xc3a5c85c97cb3127ULL, 0xb492b66fbe98f273ULL, 0x9ae16a3b2f90404fULL, 0xcbf29ce484222325ULL };
+
+static inline uint64_t _DFSketchRehash(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+@implementation DFFrequencySketch {
+    uint8_t *_table;
+    NSUInteger _width;
+    NSUInteger _sampleSize;
+    NSUInteger _additions;
+}
+
+DF_INIT_UNAVAILABLE_IMPL
+
+- (void)dealloc {
+    free(_table);
+}
+
+static NSUInteger _DFSketchWidthForCapacity(NSUInteger capacity) {
+    NSUInteger width = 16;
+    while (width < capacity) {
+        width <<= 1;
+    }
+    return width;
+}
+
+- (nonnull instancetype)initWithCapacity:(NSUInteger)capacity {
+    if (self = [super init]) {
+        _width = _DFSketchWidthForCapacity(capacity);
+        _sampleSize = _width * 10;
+        _table = calloc(_width * _kDFSketchDepth, sizeof(uint8_t));
+    }
+    return self;
+}
+
+- (void)resizeToCapacity:(NSUInteger)capacity {
+    NSUInteger width = _DFSketchWidthForCapacity(capacity);
+    if (width == _width) {
+        return;
+    }
+    uint8_t *table = calloc(width * _kDFSketchDepth, sizeof(uint8_t));
+    if (!table) {
+        return;
+    }
+    // Both widths are powers of two, the element that maps to the column i in one table maps to the column with the same low bits in the other one
+    for (NSUInteger row = 0; row < _kDFSketchDepth; row++) {
+        if (width > _width) {
+            for (NSUInteger i = 0; i < width; i++) {
+                table[row * width + i] = _table[row * _width + (i & (_width - 1))];
+            }
+        } else {
+            for (NSUInteger i = 0; i < _width; i++) {
+                uint8_t *counter = &table[row * width + (i & (width - 1))];
+                *counter = (uint8_t)MIN(*counter + _table[row * _width + i], _kDFSketchMaxCount);
+            }
+        }
+    }
+    free(_table);
+    _table = table;
+    _additions = _additions * width / _width;
+    _width = width;
+    _sampleSize = _width * 10;
+}
+
+- (void)incrementHash:(NSUInteger)hash {
+    BOOL added = NO;
+    for (NSUInteger row = 0; row < _kDFSketchDepth; row++) {
+        uint8_t *counter = &_table[[self _indexForHash:hash row:row]];
+        if (*counter < _kDFSketchMaxCount) {
+            (*counter)++;
+            added = YES;
+        }
+    }
+    if (added && ++_additions >= _sampleSize) {
+        [self _age];
+    }
+}
+
+- (NSUInteger)frequencyForHash:(NSUInteger)hash {
+    uint8_t frequency = _kDFSketchMaxCount;
+    for (NSUInteger row = 0; row < _kDFSketchDepth; row++) {
+        frequency = MIN(frequency, _table[[self _indexForHash:hash row:row]]);
+    }
+    return frequency;
+}
+
+- (void)clear {
+    memset(_table, 0, _width * _kDFSketchDepth);
+    _additions = 0;
+}
+
+- (NSUInteger)_indexForHash:(NSUInteger)hash row:(NSUInteger)row {
+    uint64_t h = _DFSketchRehash((uint64_t)hash + _kDFSketchSeeds[row]);
+    return row * _width + (NSUInteger)(h & (_width - 1));
+}
+
+/*! Halves all counters so that the sketch adapts to the changes in popularity.
+ */
+- (void)_age {
+    for (NSUInteger i = 0; i < _width * _kDFSketchDepth; i++) {
+        _table[i] >>= 1;
+    }
+    _additions /= 2;
+}
+
+@end
@@ -0,0 +1,42 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import <Foundation/Foundation.h>
+
+/*! Bounded cache of the recent fetch failures (negative cache). Lets the image manager fail fast with the cached error instead of fetching the resource that is known to fail, e.g. each time the cell that displays it is reused.
+
+ The failures are kept for the amount of time that depends on the error (see +expirationAgeForError:). Unless the error specifies a Retry-After interval, the missing resources (404, 410) and the invalid responses are kept for 5 minutes, other client errors for 1 minute, server errors (5xx, 429) for 10 seconds and connection errors for 5 seconds.
+
+ The cache also tracks the consecutive server and connection errors for each host. The host that keeps failing is backed off: after the third failure in a row all of the requests to the host fail fast for the exponentially growing interval (up to a minute), or for the interval that the server specified in the Retry-After header.
+ @note Thread safe.
+ */
+@interface DFImageFailureCache : NSObject
+
+/*! Maximum number of the failures that the cache keeps.
+ */
+@property (nonatomic, readonly) NSUInteger countLimit;
+
+- (nonnull instancetype)initWithCountLimit:(NSUInteger)countLimit NS_DESIGNATED_INITIALIZER;
+
+- (nullable instancetype)init NS_UNAVAILABLE;
+
+/*! Returns the error for a given key, or the last error of the host of the URL if the host is backed off.
+ */
+- (nullable NSError *)errorForKey:(nonnull id<NSCopying>)key URL:(nullable NSURL *)URL;
+
+/*! Records the failure. Errors with zero expiration age (e.g. cancellation) are ignored.
+ */
+- (void)storeError:(nonnull NSError *)error forKey:(nonnull id<NSCopying>)key URL:(nullable NSURL *)URL;
+
+/*! Resets the failure count of the host of the URL.
+ */
+- (void)recordSuccessForKey:(nonnull id<NSCopying>)key URL:(nullable NSURL *)URL;
+
+- (void)removeAllFailures;
+
+/*! Returns the amount of time the failure with a given error is kept, or 0 if the failure shouldn't be cached.
+ */
++ (NSTimeInterval)expirationAgeForError:(nonnull NSError *)error;
+
+@end
@@ -0,0 +1,247 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import "DFImageFailureCache.h"
+#import "DFImageManagerDefines.h"
+#import "DFURLResponseValidating.h"
+
+static const NSUInteger _DFHostFailureThreshold = 3;
+static const NSTimeInterval _DFMaximumHostBackoff = 60.0;
+static const NSTimeInterval _DFMaximumRetryAfter = 600.0;
+
+static NSHTTPURLResponse *_DFHTTPResponseForError(NSError *error) {
+    id response = error.userInfo[DFURLErrorInfoURLResponseKey];
+    return [response isKindOfClass:[NSHTTPURLResponse class]] ? response : nil;
+}
+
+/*! Returns YES if the error says that the host is unavailable or overloaded rather than that the resource is missing. Timeouts are not host errors, a single slow resource (e.g. a large image) shouldn't back off the whole host.
+ */
+static BOOL _DFIsHostError(NSError *error) {
+    NSHTTPURLResponse *response = _DFHTTPResponseForError(error);
+    if (response) {
+        return response.statusCode == 429 || response.statusCode >= 500;
+    }
+    if ([error.domain isEqualToString:NSURLErrorDomain]) {
+        switch (error.code) {
+            case NSURLErrorCannotFindHost:
+            case NSURLErrorCannotConnectToHost:
+            case NSURLErrorDNSLookupFailed:
+                return YES;
+            default:
+                return NO;
+        }
+    }
+    return NO;
+}
+
+/*! Returns the interval from the Retry-After header (either delay in seconds or HTTP date), or 0 if there is none.
+ */
+static NSTimeInterval _DFRetryAfterForError(NSError *error) {
+    NSString *value = [_DFHTTPResponseForError(error).allHeaderFields[@"Retry-After"] description];
+    if (!value.length) {
+        return 0.0;
+    }
+    NSTimeInterval interval;
+    NSScanner *scanner = [NSScanner scannerWithString:value];
+    if ([scanner scanDouble:&interval] && scanner.isAtEnd) {
+        return MIN(MAX(interval, 0.0), _DFMaximumRetryAfter);
+    }
+    static NSDateFormatter *formatter;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        formatter = [NSDateFormatter new];
+        formatter.locale = [NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"];
+        formatter.timeZone = [NSTimeZone timeZoneWithAbbreviation:@"GMT"];
+        formatter.dateFormat = @"EEE, dd MMM yyyy HH:mm:ss zzz";
+    });
+    NSDate *date;
+    @synchronized(formatter) {
+        date = [formatter dateFromString:value];
+    }
+    return date ? MIN(MAX(date.timeIntervalSinceNow, 0.0), _DFMaximumRetryAfter) : 0.0;
+}
+
+static NSString *_DFHostForURL(NSURL *URL) {
+    return [URL.scheme hasPrefix:@"http"] ? URL.host.lowercaseString : nil;
+}
+
+
+@interface _DFImageFailureCacheEntry : NSObject
+
+@property (nonnull, nonatomic) id key;
+@property (nonnull, nonatomic) NSError *error;
+@property (nonatomic) CFAbsoluteTime expirationDate;
+
+@end
+
+@implementation _DFImageFailureCacheEntry
+@end
+
+
+@interface _DFImageHostFailures : NSObject
+
+@property (nonatomic) NSUInteger failureCount;
+@property (nullable, nonatomic) NSError *error;
+@property (nonatomic) CFAbsoluteTime backoffDate;
+
+@end
+
+@implementation _DFImageHostFailures
+@end
+
+
+@implementation DFImageFailureCache {
+    NSMutableDictionary<id<NSCopying>, _DFImageFailureCacheEntry *> *_entries;
+    NSMutableArray<_DFImageFailureCacheEntry *> *_queue; // Oldest entries first
+    NSMutableDictionary<NSString *, _DFImageHostFailures *> *_hosts;
+    NSLock *_lock;
+}
+
+DF_INIT_UNAVAILABLE_IMPL
+
+- (nonnull instancetype)initWithCountLimit:(NSUInteger)countLimit {
+    if (self = [super init]) {
+        _countLimit = countLimit;
+        _entries = [NSMutableDictionary new];
+        _queue = [NSMutableArray new];
+        _hosts = [NSMutableDictionary new];
+        _lock = [NSLock new];
+    }
+    return self;
+}
+
+- (nullable NSError *)errorForKey:(nonnull id<NSCopying>)key URL:(nullable NSURL *)URL {
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    NSString *host = _DFHostForURL(URL);
+    NSError *error;
+    [_lock lock];
+    _DFImageFailureCacheEntry *entry = _entries[key];
+    if (entry.expirationDate > now) {
+        error = entry.error;
+    } else {
+        [self _removeEntry:entry];
+    }
+    if (!error && host) {
+        _DFImageHostFailures *failures = _hosts[host];
+        if (failures.backoffDate > now) {
+            error = failures.error;
+        }
+    }
+    [_lock unlock];
+    return error;
+}
+
+- (void)storeError:(nonnull NSError *)error forKey:(nonnull id<NSCopying>)key URL:(nullable NSURL *)URL {
+    NSTimeInterval expirationAge = [DFImageFailureCache expirationAgeForError:error];
+    if (expirationAge <= 0.0) {
+        return;
+    }
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    _DFImageFailureCacheEntry *entry = [_DFImageFailureCacheEntry new];
+    entry.key = key;
+    entry.error = error;
+    entry.expirationDate = now + expirationAge;
+    NSString *host = _DFIsHostError(error) ? _DFHostForURL(URL) : nil;
+    [_lock lock];
+    [self _removeEntry:_entries[key]];
+    _entries[key] = entry;
+    [_queue addObject:entry];
+    while (_queue.count > _countLimit) {
+        [self _removeEntry:_queue.firstObject];
+    }
+    if (host) {
+        [self _recordFailureWithError:error forHost:host now:now];
+    }
+    [_lock unlock];
+}
+
+- (void)_recordFailureWithError:(nonnull NSError *)error forHost:(nonnull NSString *)host now:(CFAbsoluteTime)now {
+    _DFImageHostFailures *failures = _hosts[host];
+    if (!failures) {
+        if (_hosts.count >= _countLimit) {
+            [self _removeHostsThatAreNotBackedOff:now];
+        }
+        failures = [_DFImageHostFailures new];
+        _hosts[host] = failures;
+    }
+    failures.failureCount++;
+    failures.error = error;
+    NSTimeInterval backoff = _DFRetryAfterForError(error);
+    if (failures.failureCount >= _DFHostFailureThreshold) {
+        backoff = MAX(backoff, MIN(pow(2.0, failures.failureCount - _DFHostFailureThreshold), _DFMaximumHostBackoff));
+    }
+    if (backoff > 0.0) {
+        failures.backoffDate = MAX(failures.backoffDate, now + backoff);
+    }
+}
+
+- (void)recordSuccessForKey:(nonnull id<NSCopying>)key URL:(nullable NSURL *)URL {
+    NSString *host = _DFHostForURL(URL);
+    [_lock lock];
+    [self _removeEntry:_entries[key]];
+    if (host) {
+        [_hosts removeObjectForKey:host];
+    }
+    [_lock unlock];
+}
+
+- (void)removeAllFailures {
+    [_lock lock];
+    [_entries removeAllObjects];
+    [_queue removeAllObjects];
+    [_hosts removeAllObjects];
+    [_lock unlock];
+}
+
+- (void)_removeEntry:(nullable _DFImageFailureCacheEntry *)entry {
+    if (!entry) {
+        return;
+    }
+    [_queue removeObjectIdenticalTo:entry];
+    [_entries removeObjectForKey:entry.key];
+}
+
+- (void)_removeHostsThatAreNotBackedOff:(CFAbsoluteTime)now {
+    for (NSString *host in _hosts.allKeys) {
+        if (_hosts[host].backoffDate <= now) {
+            [_hosts removeObjectForKey:host];
+        }
+    }
+}
+
++ (NSTimeInterval)expirationAgeForError:(nonnull NSError *)error {
+    NSTimeInterval retryAfter = _DFRetryAfterForError(error);
+    if (retryAfter > 0.0) {
+        return retryAfter;
+    }
+    if ([error.domain isEqualToString:DFURLValidationErrorDomain]) {
+        NSHTTPURLResponse *response = _DFHTTPResponseForError(error);
+        if (!response || error.code == NSURLErrorCannotDecodeContentData || error.code == NSURLErrorDataLengthExceedsMaximum) {
+            return 300.0; // The resource is not an image, or is too large
+        }
+        NSInteger statusCode = response.statusCode;
+        if (statusCode == 404 || statusCode == 410) {
+            return 300.0;
+        }
+        if (statusCode == 429 || statusCode >= 500) {
+            return 10.0;
+        }
+        return 60.0;
+    }
+    if ([error.domain isEqualToString:NSURLErrorDomain]) {
+        switch (error.code) {
+            case NSURLErrorBadURL:
+            case NSURLErrorUnsupportedURL:
+            case NSURLErrorFileDoesNotExist:
+                return 300.0;
+            case NSURLErrorTimedOut:
+                return 5.0;
+            default:
+                return _DFIsHostError(error) ? 5.0 : 0.0; // Cancellation and connectivity errors are not cached
+        }
+    }
+    return 0.0;
+}
+
+@end
@@ -5,18 +5,50 @@
 #import "DFImageManagerDefines.h"
 #import <Foundation/Foundation.h>
 
+@class DFImageHeaderInfo;
 @class DFImageTask;
 @class DFImageManagerConfiguration;
 @class DFImageManagerLoader;
 
+/*! The events in the lifetime of the fetch that no longer has any tasks (orphaned fetch).
+ */
+typedef NS_ENUM(NSUInteger, DFImageLoaderOrphanedFetchEvent) {
+    /*! The fetch was cancelled, the fetched bytes are wasted. */
+    DFImageLoaderOrphanedFetchEventCancelled,
+    /*! The fetch was kept alive at low priority. */
+    DFImageLoaderOrphanedFetchEventKeptAlive,
+    /*! The new task was attached to the fetch that was kept alive. */
+    DFImageLoaderOrphanedFetchEventReattached
+};
+
+/*! The options that change how the loader executes the task.
+ */
+typedef NS_OPTIONS(NSUInteger, DFImageLoaderTaskOptions) {
+    DFImageLoaderTaskOptionsNone = 0,
+    /*! The task is completed without an image as soon as the data is fetched (or found in the data cache), the data is not decoded for the task. */
+    DFImageLoaderTaskOptionFetchDataOnly = 1 << 0,
+    /*! The image loaded for the task is not stored in the memory cache. */
+    DFImageLoaderTaskOptionSkipMemoryCache = 1 << 1
+};
+
 @protocol DFImageManagerLoaderDelegate <NSObject>
 
 - (void)imageLoader:(nonnull DFImageManagerLoader *)imageLoader imageTask:(nonnull DFImageTask *)imageTask didUpdateProgressWithCompletedUnitCount:(int64_t)completedUnitCount totalUnitCount:(int64_t)totalUnitCount;
 
-- (void)imageLoader:(nonnull DFImageManagerLoader *)imageLoader imageTask:(nonnull DFImageTask *)imageTask didCompleteWithImage:(nullable UIImage *)image info:(nullable NSDictionary *)info error:(nullable NSError *)error;
+/*! Called when the image task is completed. The source is the tier from which the image was loaded, the fetched byte count is the number of bytes received from the network for the task, the latency is the time since the loader started loading the image.
+ */
+- (void)imageLoader:(nonnull DFImageManagerLoader *)imageLoader imageTask:(nonnull DFImageTask *)imageTask didCompleteWithImage:(nullable UIImage *)image info:(nullable NSDictionary *)info error:(nullable NSError *)error source:(DFImageSource)source fetchedByteCount:(int64_t)fetchedByteCount latency:(NSTimeInterval)latency;
 
 - (void)imageLoader:(nonnull DFImageManagerLoader *)imageLoader imageTask:(nonnull DFImageTask *)imageTask didReceiveProgressiveImage:(nonnull UIImage *)image;
 
+/*! Called when the header of the image data is parsed, before the data is fully fetched.
+ */
+- (void)imageLoader:(nonnull DFImageManagerLoader *)imageLoader imageTask:(nonnull DFImageTask *)imageTask didReceiveHeaderInfo:(nonnull DFImageHeaderInfo *)headerInfo;
+
+/*! Called on the loader's queue when the fetch is orphaned or reattached. The byte count is the number of bytes fetched so far.
+ */
+- (void)imageLoader:(nonnull DFImageManagerLoader *)imageLoader didRecordOrphanedFetchEvent:(DFImageLoaderOrphanedFetchEvent)event byteCount:(int64_t)byteCount;
+
 @end
 
 /*! Private image loader:
@@ -30,7 +62,10 @@
 
 - (nonnull instancetype)initWithConfiguration:(nonnull DFImageManagerConfiguration *)configuration;
 
-- (void)startLoadingForImageTask:(nonnull DFImageTask *)imageTask;
+/*! Starts loading the image for the task.
+ @param cacheKey The key returned by -preheatingKeyForRequest: for the task's request, the loader stores the image using this key.
+ */
+- (void)startLoadingForImageTask:(nonnull DFImageTask *)imageTask cacheKey:(nonnull id<NSCopying>)cacheKey options:(DFImageLoaderTaskOptions)options;
 
 - (void)cancelLoadingForImageTask:(nonnull DFImageTask *)imageTask;
 
@@ -38,6 +73,20 @@
 
 - (nullable DFCachedImageResponse *)cachedResponseForRequest:(nonnull DFImageRequest *)request;
 
+/*! Returns the cached response using the key returned by -preheatingKeyForRequest: for the request.
+ */
+- (nullable DFCachedImageResponse *)cachedResponseForRequest:(nonnull DFImageRequest *)request key:(nonnull id<NSCopying>)key;
+
+- (void)storeImage:(nonnull UIImage *)image info:(nullable NSDictionary *)info forRequest:(nonnull DFImageRequest *)request;
+
 - (nonnull id<NSCopying>)preheatingKeyForRequest:(nonnull DFImageRequest *)request;
 
+/*! Removes the images from the decoded image cache (see decodedImageCacheCostLimit property of DFImageManagerConfiguration).
+ */
+- (void)removeAllDecodedImages;
+
+/*! Removes the recent fetch failures (see failureCacheCountLimit property of DFImageManagerConfiguration).
+ */
+- (void)removeAllFailures;
+
 @end
@@ -3,11 +3,16 @@
 // Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
 
 #import "DFCachedImageResponse.h"
+#import "DFDecodedImageCache.h"
 #import "DFImageCaching.h"
+#import "DFImageDataCache.h"
 #import "DFImageDecoder.h"
 #import "DFImageDecoding.h"
+#import "DFImageCancellationToken.h"
+#import "DFImageFailureCache.h"
 #import "DFImageFetching.h"
 #import "DFImageFetchingOperation.h"
+#import "DFImageHeaderInfo.h"
 #import "DFImageManagerConfiguration.h"
 #import "DFImageManagerDefines.h"
 #import "DFImageManagerLoader.h"
@@ -15,26 +20,94 @@
 #import "DFImageRequest.h"
 #import "DFImageRequestOptions.h"
 #import "DFImageTask.h"
+#import "DFImageTraceRecorder.h"
 #import "DFProgressiveImageDecoder.h"
 
+/*! The header is parsed from the first bytes of the data, the headers that are longer than that (e.g. JPEG with the large EXIF segment) are not reported.
+ */
+static const NSUInteger _DFMaximumHeaderLength = 64 * 1024;
+
+static inline NSURL *_DFURLForRequest(DFImageRequest *request) {
+    return [request.resource isKindOfClass:[NSURL class]] ? request.resource : nil;
+}
+
+static inline NSOperationQueuePriority _DFQueuePriorityForRequestPriority(DFImageRequestPriority priority) {
+    switch (priority) {
+        case DFImageRequestPriorityHigh: return NSOperationQueuePriorityHigh;
+        case DFImageRequestPriorityNormal: return NSOperationQueuePriorityNormal;
+        case DFImageRequestPriorityLow: return NSOperationQueuePriorityLow;
+    }
+}
+
+static inline NSQualityOfService _DFQualityOfServiceForRequestPriority(DFImageRequestPriority priority) {
+    switch (priority) {
+        case DFImageRequestPriorityHigh: return NSQualityOfServiceUserInteractive;
+        case DFImageRequestPriorityNormal: return NSQualityOfServiceUserInitiated;
+        case DFImageRequestPriorityLow: return NSQualityOfServiceUtility;
+    }
+}
+
+/*! Returns YES if the image was decoded at the full size of the image data, rather than from the embedded thumbnail (see -[DFImageDecoding imageWithData:forRequests:]). Returns NO if the size of the image data is unknown.
+ */
+static BOOL _DFIsImageDecodedAtFullSize(UIImage *image, DFImageHeaderInfo *headerInfo) {
+    if (!headerInfo) {
+        return NO;
+    }
+    // Both sizes have the orientation applied, allow a single pixel error caused by rounding
+    CGSize pixelSize = CGSizeMake(image.size.width * image.scale, image.size.height * image.scale);
+    return pixelSize.width + 1.f >= headerInfo.pixelSize.width && pixelSize.height + 1.f >= headerInfo.pixelSize.height;
+}
+
+/*! Lets the decoding and processing operations that are waiting in the queues be overtaken by the work for the visible images. QoS only affects the operations that haven't started yet.
+ */
+static void _DFOperationSetPriority(NSOperation *operation, DFImageRequestPriority priority) {
+    operation.queuePriority = _DFQueuePriorityForRequestPriority(priority);
+    operation.qualityOfService = _DFQualityOfServiceForRequestPriority(priority);
+}
+
+/*! Returns the number of bytes received from the network, the data found in the data cache or in the disk cache of the fetcher wasn't received.
+ */
+static int64_t _DFFetchedByteCount(NSData *data, NSDictionary *info, DFImageSource source) {
+    if (source != DFImageSourceFetcher) {
+        return 0;
+    }
+    NSNumber *byteCount = info[DFImageInfoFetchedByteCountKey];
+    return [byteCount isKindOfClass:[NSNumber class]] ? byteCount.longLongValue : (int64_t)data.length;
+}
+
 #pragma mark - _DFImageLoaderTask
 
 @class _DFImageLoadOperation;
 
+@class _DFImageRequestKey;
+
 @interface _DFImageLoaderTask : NSObject
 
 @property (nonnull, nonatomic, readonly) DFImageTask *imageTask;
 @property (nonnull, nonatomic, readonly) DFImageRequest *request; // dynamic
+@property (nonnull, nonatomic, readonly) _DFImageRequestKey *cacheKey;
+@property (nonatomic, readonly) DFImageLoaderTaskOptions options;
+@property (nullable, nonatomic) _DFImageRequestKey *loadKey; // Created once when the task is started
 @property (nullable, nonatomic, weak) _DFImageLoadOperation *loadOperation;
 @property (nullable, nonatomic, weak) NSOperation *processOperation;
+@property (nonnull, nonatomic, readonly) DFImageCancellationToken *processingToken; // Created lazily, cancelled when the task is cancelled
+@property (nonatomic, readonly) CFAbsoluteTime startTime;
+@property (nonatomic) DFImageSource source;
+@property (nonatomic) int64_t fetchedByteCount; // The number of bytes received from the network for the task
+@property (nonatomic, readonly) BOOL fetchesDataOnly;
+@property (nonatomic, readonly) BOOL storesImage; // NO if the task doesn't need the image in the memory cache
 
 @end
 
 @implementation _DFImageLoaderTask
 
-- (nonnull instancetype)initWithImageTask:(nonnull DFImageTask *)imageTask {
+- (nonnull instancetype)initWithImageTask:(nonnull DFImageTask *)imageTask cacheKey:(nonnull _DFImageRequestKey *)cacheKey options:(DFImageLoaderTaskOptions)options {
     if (self = [super init]) {
         _imageTask = imageTask;
+        _cacheKey = cacheKey;
+        _options = options;
+        _startTime = CFAbsoluteTimeGetCurrent();
+        _source = DFImageSourceFetcher;
     }
     return self;
 }
@@ -43,13 +116,31 @@
     return self.imageTask.request;
 }
 
+- (BOOL)fetchesDataOnly {
+    return (_options & DFImageLoaderTaskOptionFetchDataOnly) != 0;
+}
+
+- (BOOL)storesImage {
+    return (_options & (DFImageLoaderTaskOptionFetchDataOnly | DFImageLoaderTaskOptionSkipMemoryCache)) == 0;
+}
+
+- (nonnull DFImageCancellationToken *)processingToken {
+    if (!_processingToken) {
+        _processingToken = [DFImageCancellationToken new];
+    }
+    return _processingToken;
+}
+
+- (void)cancel {
+    [_processingToken cancel];
+    [_processOperation cancel];
+}
+
 @end
 
 
 #pragma mark - _DFImageRequestKey
 
-@class _DFImageRequestKey;
-
 @protocol _DFImageRequestKeyOwner <NSObject>
 
 - (BOOL)isImageRequestKey:(nonnull _DFImageRequestKey *)lhs equalToKey:(nonnull _DFImageRequestKey *)rhs;
@@ -113,6 +204,21 @@
 @property (nonatomic) int64_t totalUnitCount;
 @property (nonatomic) int64_t completedUnitCount;
 @property (nonatomic) DFProgressiveImageDecoder *progressiveImageDecoder;
+@property (nullable, nonatomic) NSArray<DFImageRequest *> *decodingRequests;
+@property (nullable, nonatomic) NSData *data; // Kept until the operation is finished, so that the image can be decoded again for the late tasks
+@property (nonatomic) BOOL isDecodingOnly; // Created for the late tasks of another operation, which records the fetch
+@property (nonatomic) CFAbsoluteTime fetchStartTime;
+@property (nonatomic) NSTimeInterval fetchDuration;
+@property (nonatomic) int64_t fetchedByteCount;
+@property (nonatomic) DFImageSource source;
+@property (nullable, nonatomic) NSMutableData *headerData;
+@property (nullable, nonatomic) DFImageHeaderInfo *headerInfo;
+@property (nonatomic) BOOL isHeaderParsingFinished;
+@property (nullable, nonatomic) _DFImageRequestKey *orphanedCacheKey; // The cache key of the last task, set while the orphaned fetch is kept alive
+@property (nonatomic) BOOL storesOrphanedImage; // NO if the last task didn't need the image in the memory cache
+@property (nonatomic) NSUInteger orphanCount;
+@property (nonnull, nonatomic, readonly) DFImageCancellationToken *cancellationToken; // Cancelled when the operation is cancelled
+@property (nullable, nonatomic, weak) NSOperation *decodeOperation;
 
 @end
 
@@ -122,17 +228,46 @@
     if (self = [super init]) {
         _key = key;
         _tasks = [NSMutableArray new];
+        _cancellationToken = [DFImageCancellationToken new];
+        _source = DFImageSourceFetcher;
     }
     return self;
 }
 
+/*! Returns YES if the data is received (the image is decoded) or if the fetch has received the given fraction of the data. The fetch with an unknown length of the data is only kept alive for the grace period.
+ */
+- (BOOL)isNearlyFinishedWithThreshold:(float)threshold {
+    if (_data) {
+        return YES;
+    }
+    if (_totalUnitCount <= 0) {
+        return NO;
+    }
+    return (double)_completedUnitCount / _totalUnitCount >= threshold;
+}
+
+/*! Returns the maximum priority of the tasks, the operation without tasks (orphaned) has low priority.
+ */
+- (DFImageRequestPriority)priority {
+    DFImageRequestPriority priority = DFImageRequestPriorityLow;
+    for (_DFImageLoaderTask *task in _tasks) {
+        priority = MAX(task.imageTask.priority, priority);
+    }
+    return priority;
+}
+
+/*! Applies the priority to the fetch and to the decoding that is shared by all of the tasks.
+ */
 - (void)updateOperationPriority {
-    if (_fetchOperation && _tasks.count) {
-        DFImageRequestPriority priority = DFImageRequestPriorityLow;
-        for (_DFImageLoaderTask *task in _tasks) {
-            priority = MAX(task.imageTask.priority, priority);
-        }
-        [_fetchOperation setImageFetchingPriority:priority];
+    DFImageRequestPriority priority = self.priority;
+    [_fetchOperation setImageFetchingPriority:priority];
+    NSOperation *decodeOperation = _decodeOperation;
+    if (decodeOperation) {
+        _DFOperationSetPriority(decodeOperation, priority);
+    }
+    if (_progressiveImageDecoder) {
+        _progressiveImageDecoder.queuePriority = _DFQueuePriorityForRequestPriority(priority);
+        _progressiveImageDecoder.qualityOfService = _DFQualityOfServiceForRequestPriority(priority);
     }
 }
 
@@ -151,6 +286,8 @@
 @property (nonnull, nonatomic, readonly) NSMutableDictionary /* _DFImageRequestKey : _DFImageLoadOperation */ *loadOperations;
 @property (nonnull, nonatomic, readonly) dispatch_queue_t queue;
 @property (nonnull, nonatomic, readonly) NSOperationQueue *decodingQueue;
+@property (nullable, nonatomic, readonly) DFDecodedImageCache *decodedImageCache;
+@property (nullable, nonatomic, readonly) DFImageFailureCache *failureCache;
 
 @end
 
@@ -163,34 +300,81 @@
         _executingTasks = [NSMutableDictionary new];
         _loadOperations = [NSMutableDictionary new];
         _queue = dispatch_queue_create([[NSString stringWithFormat:@"%@-queue-%p", [self class], self] UTF8String], DISPATCH_QUEUE_SERIAL);
-        _decodingQueue = [NSOperationQueue new];
-        _decodingQueue.maxConcurrentOperationCount = 1; // Serial queue
+        _decodingQueue = _conf.decodingQueue;
+        if (!_decodingQueue) {
+            _decodingQueue = [NSOperationQueue new];
+            _decodingQueue.maxConcurrentOperationCount = 1; // Serial queue
+        }
+        if (_conf.decodedImageCacheCostLimit > 0 && _conf.decodedImageCacheMaximumAge > 0.0) {
+            _decodedImageCache = [[DFDecodedImageCache alloc] initWithCostLimit:_conf.decodedImageCacheCostLimit maximumAge:_conf.decodedImageCacheMaximumAge];
+        }
+        if (_conf.failureCacheCountLimit > 0) {
+            _failureCache = [[DFImageFailureCache alloc] initWithCountLimit:_conf.failureCacheCountLimit];
+        }
     }
     return self;
 }
 
-- (void)startLoadingForImageTask:(nonnull DFImageTask *)imageTask {
+- (void)startLoadingForImageTask:(nonnull DFImageTask *)imageTask cacheKey:(nonnull id<NSCopying>)cacheKey options:(DFImageLoaderTaskOptions)options {
     dispatch_async(_queue, ^{
-        _DFImageLoaderTask *loaderTask = [[_DFImageLoaderTask alloc] initWithImageTask:imageTask];
+        _DFImageLoaderTask *loaderTask = [[_DFImageLoaderTask alloc] initWithImageTask:imageTask cacheKey:(_DFImageRequestKey *)cacheKey options:options];
         _executingTasks[imageTask] = loaderTask;
         [self _startLoadOperationForTask:loaderTask];
     });
 }
 
 - (void)_startLoadOperationForTask:(nonnull _DFImageLoaderTask *)task {
-    _DFImageRequestKey *key = DFImageLoadKeyCreate(task.request);
+    if (!task.loadKey) {
+        task.loadKey = DFImageLoadKeyCreate(task.request);
+    }
+    _DFImageRequestKey *key = task.loadKey;
     _DFImageLoadOperation *operation = _loadOperations[key];
+    if (operation.data && task.fetchesDataOnly) { // The data is already fetched, the image is decoded for the other tasks
+        [self _loadTask:task didFetchDataWithInfo:nil source:operation.source]; // The bytes were already counted for the other tasks
+        return;
+    }
+    if (!operation && _decodedImageCache && !task.fetchesDataOnly && task.request.options.memoryCachePolicy != DFImageRequestCachePolicyReloadIgnoringCache) {
+        NSDictionary *info;
+        UIImage *image = [_decodedImageCache imageForKey:key info:&info];
+        if (image) { // The image was recently decoded for another variant of the request
+            task.source = DFImageSourceDecodedImageCache;
+            [self _loadTask:task processImage:image info:info error:nil];
+            return;
+        }
+    }
+    if (!operation && _failureCache && task.request.options.memoryCachePolicy != DFImageRequestCachePolicyReloadIgnoringCache) {
+        NSError *error = [_failureCache errorForKey:key URL:_DFURLForRequest(task.request)];
+        if (error) { // The resource (or its host) has recently failed, don't waste a fetch on it
+            [self _loadTask:task processImage:nil info:nil error:error];
+            return;
+        }
+    }
     if (!operation) { // Couldn't find existing operation with equivalent image request
         operation = [[_DFImageLoadOperation alloc] initWithKey:key];
-        typeof(self) __weak weakSelf = self;
-        operation.fetchOperation = [_conf.fetcher startOperationWithRequest:task.request progressHandler:^(NSData *__nullable data, int64_t completedUnitCount, int64_t totalUnitCount) {
-            [weakSelf _loadOperation:operation didUpdateProgressWithData:data completedUnitCount:completedUnitCount totalUnitCount:totalUnitCount];
-        } completion:^(NSData *__nullable data, NSDictionary *__nullable info, NSError *__nullable error) {
-            [weakSelf _loadOperation:operation didCompleteWithData:data info:info error:error];
-        }];
+        operation.fetchStartTime = CFAbsoluteTimeGetCurrent();
         _loadOperations[key] = operation;
+        NSDictionary *info;
+        NSData *data = task.request.options.memoryCachePolicy != DFImageRequestCachePolicyReloadIgnoringCache ? [_conf.dataCache dataForKey:key info:&info] : nil;
+        if (data) { // The data is decoded asynchronously, the task is registered with the operation first
+            operation.source = DFImageSourceDataCache;
+            [self _loadOperation:operation didCompleteWithData:data info:info error:nil];
+        } else {
+            typeof(self) __weak weakSelf = self;
+            operation.fetchOperation = [_conf.fetcher startOperationWithRequest:task.request progressHandler:^(NSData *__nullable data, int64_t completedUnitCount, int64_t totalUnitCount) {
+                [weakSelf _loadOperation:operation didUpdateProgressWithData:data completedUnitCount:completedUnitCount totalUnitCount:totalUnitCount];
+            } completion:^(NSData *__nullable data, NSDictionary *__nullable info, NSError *__nullable error) {
+                [weakSelf _loadOperation:operation didCompleteWithData:data info:info error:error];
+            }];
+        }
     } else {
+        if (operation.orphanedCacheKey) { // The task returned to the fetch that was kept alive
+            operation.orphanedCacheKey = nil;
+            [self.delegate imageLoader:self didRecordOrphanedFetchEvent:DFImageLoaderOrphanedFetchEventReattached byteCount:operation.completedUnitCount];
+        }
         [self.delegate imageLoader:self imageTask:task.imageTask didUpdateProgressWithCompletedUnitCount:operation.completedUnitCount totalUnitCount:operation.totalUnitCount];
+        if (operation.headerInfo) {
+            [self.delegate imageLoader:self imageTask:task.imageTask didReceiveHeaderInfo:operation.headerInfo];
+        }
     }
     task.loadOperation = operation;
     [operation.tasks addObject:task];
@@ -205,6 +389,7 @@
         for (_DFImageLoaderTask *task in operation.tasks) {
             [self.delegate imageLoader:self imageTask:task.imageTask didUpdateProgressWithCompletedUnitCount:operation.completedUnitCount totalUnitCount:operation.totalUnitCount];
         }
+        [self _loadOperation:operation parseHeaderWithData:data];
         // progressive image decoding
         if (![DFImageManagerConfiguration allowsProgressiveImage]) {
             return;
@@ -218,6 +403,8 @@
             decoder = [[DFProgressiveImageDecoder alloc] initWithQueue:_decodingQueue decoder:_conf.decoder];
             decoder.threshold = _conf.progressiveImageDecodingThreshold;
             decoder.totalByteCount = totalUnitCount;
+            decoder.queuePriority = _DFQueuePriorityForRequestPriority(operation.priority);
+            decoder.qualityOfService = _DFQualityOfServiceForRequestPriority(operation.priority);
             typeof(self) __weak weakSelf = self;
             _DFImageLoadOperation *__weak weakOp = operation;
             decoder.handler = ^(UIImage *__nonnull image) {
@@ -235,18 +422,51 @@
     });
 }
 
+/*! Parses the image header as the data streams in so that the image dimensions are known long before the image is decoded.
+ */
+- (void)_loadOperation:(nonnull _DFImageLoadOperation *)operation parseHeaderWithData:(nullable NSData *)data {
+    if (operation.isHeaderParsingFinished || !data.length) {
+        return;
+    }
+    if (!operation.headerData) {
+        operation.headerData = [NSMutableData new];
+    }
+    [operation.headerData appendData:data];
+    NSData *headerData = operation.headerData;
+    DFImageHeaderInfo *headerInfo = [DFImageHeaderInfo headerInfoWithData:headerData];
+    if (headerInfo || headerData.length > _DFMaximumHeaderLength || (headerData.length >= 12 && [DFImageHeaderInfo formatForData:headerData] == DFImageFormatUnknown)) {
+        operation.isHeaderParsingFinished = YES;
+        operation.headerData = nil;
+    }
+    if (headerInfo) {
+        operation.headerInfo = headerInfo;
+        for (_DFImageLoaderTask *task in operation.tasks) {
+            [self.delegate imageLoader:self imageTask:task.imageTask didReceiveHeaderInfo:headerInfo];
+        }
+    }
+}
+
 - (void)_loadOperation:(nonnull _DFImageLoadOperation *)operation didDecodePartialImage:(nonnull UIImage *)image {
     dispatch_async(_queue, ^{
         for (_DFImageLoaderTask *task in operation.tasks) {
             if ([self _shouldProcessImage:image forRequest:task.request partial:YES]) {
                 typeof(self) __weak weakSelf = self;
                 id<DFImageProcessing> processor = _conf.processor;
-                [_conf.processingQueue addOperationWithBlock:^{
-                    UIImage *processedImage = [processor processedImage:image forRequest:task.request partial:YES];
-                    if (processedImage) {
+                DFImageCancellationToken *token = task.processingToken;
+                NSOperation *processOperation = [NSBlockOperation blockOperationWithBlock:^{
+                    if (token.isCancelled) {
+                        return;
+                    }
+                    UIImage *__block processedImage;
+                    [token performAsCurrent:^{
+                        processedImage = [processor processedImage:image forRequest:task.request partial:YES];
+                    }];
+                    if (processedImage && !token.isCancelled) {
                         [weakSelf.delegate imageLoader:weakSelf imageTask:task.imageTask didReceiveProgressiveImage:processedImage];
                     }
                 }];
+                _DFOperationSetPriority(processOperation, task.imageTask.priority);
+                [_conf.processingQueue addOperation:processOperation];
             } else {
                 [self.delegate imageLoader:self imageTask:task.imageTask didReceiveProgressiveImage:image];
             }
@@ -255,21 +475,143 @@
 }
 
 - (void)_loadOperation:(nonnull _DFImageLoadOperation *)operation didCompleteWithData:(nullable NSData *)data info:(nullable NSDictionary *)info error:(nullable NSError *)error {
-    if (error || !data.length) {
-        [self _loadOperation:operation didCompleteWithImage:nil info:info error:error];
+    dispatch_async(_queue, ^{
+        if (_conf.traceRecorder) {
+            operation.fetchDuration = CFAbsoluteTimeGetCurrent() - operation.fetchStartTime;
+        }
+        operation.fetchedByteCount = _DFFetchedByteCount(data, info, operation.source);
+        if (!error && data.length && operation.source == DFImageSourceFetcher && operation.key.request.options.memoryCachePolicy != DFImageRequestCachePolicyReloadIgnoringCache) {
+            [_conf.dataCache storeData:data info:info forKey:operation.key];
+        }
+        if (error || !data.length) {
+            [self _loadOperation:operation didCompleteWithImage:nil info:info error:error];
+            return;
+        }
+        [self _loadOperation:operation decodeData:data info:info];
+    });
+}
+
+/*! Decodes the image for the tasks of the operation. Must be called on the loader queue.
+ */
+- (void)_loadOperation:(nonnull _DFImageLoadOperation *)operation decodeData:(nonnull NSData *)data info:(nullable NSDictionary *)info {
+    DFImageCancellationToken *token = operation.cancellationToken;
+    if (token.isCancelled) {
+        return; // All of the tasks were cancelled before the data was received
     }
-    else {
-        typeof(self) __weak weakSelf = self;
-        [_decodingQueue addOperationWithBlock:^{
-            UIImage *image = [weakSelf.conf.decoder imageWithData:data partial:NO];
-            [weakSelf _loadOperation:operation didCompleteWithImage:image info:info error:error];
+    operation.fetchOperation = nil; // There is nothing left to fetch, the orphaned operation is kept until the image is decoded
+    operation.data = data;
+    NSMutableArray *dataTasks = [NSMutableArray new];
+    for (_DFImageLoaderTask *task in operation.tasks) {
+        if (task.fetchesDataOnly) {
+            [dataTasks addObject:task];
+        }
+    }
+    [operation.tasks removeObjectsInArray:dataTasks];
+    for (_DFImageLoaderTask *task in dataTasks) {
+        task.fetchedByteCount = operation.fetchedByteCount;
+        [self _loadTask:task didFetchDataWithInfo:info source:operation.source];
+    }
+    if (!operation.tasks.count && !(operation.orphanedCacheKey && operation.storesOrphanedImage)) {
+        [self _finishLoadOperationWithoutDecoding:operation]; // Nobody needs the image
+        return;
+    }
+    NSMutableArray *requests;
+    if ([_conf.decoder respondsToSelector:@selector(imageWithData:forRequests:)]) {
+        requests = [NSMutableArray new];
+        for (_DFImageLoaderTask *task in operation.tasks) {
+            [requests addObject:task.request];
+        }
+        if (!requests.count && operation.orphanedCacheKey) {
+            [requests addObject:operation.orphanedCacheKey.request];
+        }
+        operation.decodingRequests = requests;
+    }
+    DFImageHeaderInfo *headerInfo = operation.headerInfo;
+    typeof(self) __weak weakSelf = self;
+    NSOperation *decodeOperation = [NSBlockOperation blockOperationWithBlock:^{
+        UIImage *__block image;
+        [token performAsCurrent:^{
+            image = requests ? [weakSelf.conf.decoder imageWithData:data forRequests:requests] : [weakSelf.conf.decoder imageWithData:data partial:NO];
         }];
+        if (token.isCancelled) {
+            return; // The operation was cancelled while the image was decoded
+        }
+        // The image decoded for the specific requests might be a thumbnail that is not large enough for the other variants
+        BOOL isFullImage = image && (!requests || _DFIsImageDecodedAtFullSize(image, headerInfo ?: [DFImageHeaderInfo headerInfoWithData:data]));
+        if (isFullImage) {
+            [weakSelf.decodedImageCache storeImage:image info:info forKey:operation.key];
+        }
+        if (image && !isFullImage) {
+            [weakSelf _loadOperation:operation didDecodeThumbnail:image info:info];
+        } else {
+            [weakSelf _loadOperation:operation didCompleteWithImage:image info:info error:nil];
+        }
+    }];
+    _DFOperationSetPriority(decodeOperation, operation.priority);
+    operation.decodeOperation = decodeOperation;
+    [_decodingQueue addOperation:decodeOperation];
+}
+
+/*! The image was decoded for the requests of the tasks that were attached before the decoding started, it might be a thumbnail that is not large enough for the tasks that were attached later. Such tasks are moved to the new operation that decodes the data again without fetching it.
+ */
+- (void)_loadOperation:(nonnull _DFImageLoadOperation *)operation didDecodeThumbnail:(nonnull UIImage *)image info:(nullable NSDictionary *)info {
+    dispatch_async(_queue, ^{
+        NSMutableArray *lateTasks = [NSMutableArray new];
+        for (_DFImageLoaderTask *task in operation.tasks) {
+            if ([operation.decodingRequests indexOfObjectIdenticalTo:task.request] == NSNotFound) {
+                [lateTasks addObject:task];
+            }
+        }
+        if (lateTasks.count && operation.data) {
+            [operation.tasks removeObjectsInArray:lateTasks];
+            _DFImageLoadOperation *lateOperation = [[_DFImageLoadOperation alloc] initWithKey:operation.key];
+            lateOperation.source = operation.source;
+            lateOperation.isDecodingOnly = YES;
+            lateOperation.headerInfo = operation.headerInfo;
+            lateOperation.totalUnitCount = operation.totalUnitCount;
+            lateOperation.completedUnitCount = operation.completedUnitCount;
+            _loadOperations[operation.key] = lateOperation; // The original operation is about to finish
+            for (_DFImageLoaderTask *task in lateTasks) {
+                task.loadOperation = lateOperation;
+                [lateOperation.tasks addObject:task];
+            }
+            [lateOperation updateOperationPriority];
+            [self _loadOperation:lateOperation decodeData:operation.data info:info];
+        }
+        [self _loadOperation:operation didCompleteWithImage:image info:info error:nil];
+    });
+}
+
+/*! Finishes the operation which tasks only needed the data. Must be called on the loader queue.
+ */
+- (void)_finishLoadOperationWithoutDecoding:(nonnull _DFImageLoadOperation *)operation {
+    if (operation.source == DFImageSourceFetcher && !operation.isDecodingOnly) {
+        [_conf.traceRecorder recordFetchForRequest:operation.key.request byteCount:operation.fetchedByteCount latency:operation.fetchDuration imageSize:CGSizeZero failed:NO];
+        [_failureCache recordSuccessForKey:operation.key URL:_DFURLForRequest(operation.key.request)];
     }
+    operation.orphanedCacheKey = nil;
+    [self _removeImageLoadOperation:operation];
 }
 
 - (void)_loadOperation:(nonnull _DFImageLoadOperation *)operation didCompleteWithImage:(nullable UIImage *)image info:(nullable NSDictionary *)info error:(nullable NSError *)error {
     dispatch_async(_queue, ^{
+        if (image && !operation.tasks.count && operation.orphanedCacheKey && operation.storesOrphanedImage) {
+            // The fetch was kept alive after all of its tasks were cancelled, the image is there when the task returns
+            [self _storeImage:image info:info forOrphanedCacheKey:operation.orphanedCacheKey];
+            operation.orphanedCacheKey = nil;
+        }
+        if (operation.source == DFImageSourceFetcher && !operation.isDecodingOnly) {
+            CGSize imageSize = CGSizeMake(CGImageGetWidth(image.CGImage), CGImageGetHeight(image.CGImage));
+            [_conf.traceRecorder recordFetchForRequest:operation.key.request byteCount:operation.fetchedByteCount latency:operation.fetchDuration imageSize:imageSize failed:(image == nil)];
+            if (image) {
+                [_failureCache recordSuccessForKey:operation.key URL:_DFURLForRequest(operation.key.request)];
+            } else if (error) {
+                [_failureCache storeError:error forKey:operation.key URL:_DFURLForRequest(operation.key.request)];
+            }
+        }
         for (_DFImageLoaderTask *task in operation.tasks) {
+            task.source = operation.source;
+            task.fetchedByteCount = operation.isDecodingOnly ? 0 : operation.fetchedByteCount;
             [self _loadTask:task processImage:image info:info error:error];
         }
         [operation.tasks removeAllObjects];
@@ -282,25 +624,43 @@
     if (image && [self _shouldProcessImage:image forRequest:task.request partial:NO]) {
         typeof(self) __weak weakSelf = self;
         id<DFImageProcessing> processor = _conf.processor;
+        DFImageCancellationToken *token = task.processingToken;
         NSOperation *operation = [NSBlockOperation blockOperationWithBlock:^{
-            UIImage *processedImage = [weakSelf cachedResponseForRequest:task.request].image;
+            UIImage *__block processedImage = [weakSelf cachedResponseForRequest:task.request key:task.cacheKey].image;
             if (!processedImage) {
-                processedImage = [processor processedImage:image forRequest:task.request partial:NO];
-                [weakSelf _storeImage:processedImage info:info forRequest:task.request];
+                [token performAsCurrent:^{
+                    processedImage = [processor processedImage:image forRequest:task.request partial:NO];
+                }];
+                if (token.isCancelled) {
+                    return; // The task was cancelled while the image was processed
+                }
+                if (task.storesImage) {
+                    [weakSelf _storeImage:processedImage info:info forRequest:task.request key:task.cacheKey];
+                }
             }
             [weakSelf _loadTask:task didCompleteWithImage:processedImage info:info error:error];
         }];
+        _DFOperationSetPriority(operation, task.imageTask.priority);
         [_conf.processingQueue addOperation:operation];
         task.processOperation = operation;
     } else {
-        [self _storeImage:image info:info forRequest:task.request];
+        if (task.storesImage) {
+            [self _storeImage:image info:info forRequest:task.request key:task.cacheKey];
+        }
         [self _loadTask:task didCompleteWithImage:image info:info error:error];
     }
 }
 
+/*! Completes the task that only needed the data.
+ */
+- (void)_loadTask:(nonnull _DFImageLoaderTask *)task didFetchDataWithInfo:(nullable NSDictionary *)info source:(DFImageSource)source {
+    task.source = source;
+    [self _loadTask:task didCompleteWithImage:nil info:info error:nil];
+}
+
 - (void)_loadTask:(nonnull _DFImageLoaderTask *)task didCompleteWithImage:(nullable UIImage *)image info:(nullable NSDictionary *)info error:(nullable NSError *)error {
     dispatch_async(_queue, ^{
-        [self.delegate imageLoader:self imageTask:task.imageTask didCompleteWithImage:image info:info error:error];
+        [self.delegate imageLoader:self imageTask:task.imageTask didCompleteWithImage:image info:info error:error source:task.source fetchedByteCount:task.fetchedByteCount latency:(CFAbsoluteTimeGetCurrent() - task.startTime)];
         [_executingTasks removeObjectForKey:task.imageTask];
     });
 }
@@ -312,14 +672,12 @@
         if (operation) {
             [operation.tasks removeObject:loaderTask];
             if (operation.tasks.count == 0) {
-                [operation.fetchOperation cancelImageFetching];
-                operation.fetchOperation = nil;
-                [self _removeImageLoadOperation:operation];
+                [self _loadOperation:operation didBecomeOrphanedWithTask:loaderTask];
             } else {
                 [operation updateOperationPriority];
             }
         }
-        [loaderTask.processOperation cancel];
+        [loaderTask cancel];
         [_executingTasks removeObjectForKey:imageTask];
     });
 }
@@ -328,9 +686,71 @@
     dispatch_async(_queue, ^{
         _DFImageLoaderTask *loaderTask = _executingTasks[imageTask];
         [loaderTask.loadOperation updateOperationPriority];
+        NSOperation *processOperation = loaderTask.processOperation;
+        if (processOperation) {
+            _DFOperationSetPriority(processOperation, imageTask.priority);
+        }
     });
 }
 
+#pragma mark Orphaned Fetches
+
+/*! Keeps the fetch that no longer has any tasks running at low priority if it's nearly finished or for the grace period, so that the task that returns (e.g. when the user scrolls back) is attached to it instead of starting the fetch from scratch. The operation that already has the data is only kept if the decoded image can be stored in the memory cache, otherwise its queued decode is dropped.
+ */
+- (void)_loadOperation:(nonnull _DFImageLoadOperation *)operation didBecomeOrphanedWithTask:(nonnull _DFImageLoaderTask *)task {
+    BOOL storesImage = task.storesImage && _conf.cache != nil;
+    BOOL isNearlyFinished = [operation isNearlyFinishedWithThreshold:_conf.orphanedFetchProgressThreshold];
+    if ((!operation.fetchOperation && !operation.data) || (operation.data && !storesImage) || (!isNearlyFinished && _conf.orphanedFetchGracePeriod <= 0.0)) {
+        [self _cancelOrphanedLoadOperation:operation];
+        return;
+    }
+    operation.orphanedCacheKey = task.cacheKey;
+    operation.storesOrphanedImage = storesImage;
+    operation.orphanCount++;
+    [operation updateOperationPriority]; // Low priority, there are no tasks
+    [self.delegate imageLoader:self didRecordOrphanedFetchEvent:DFImageLoaderOrphanedFetchEventKeptAlive byteCount:operation.completedUnitCount];
+    if (!isNearlyFinished) {
+        NSUInteger orphanCount = operation.orphanCount;
+        typeof(self) __weak weakSelf = self;
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(_conf.orphanedFetchGracePeriod * NSEC_PER_SEC)), _queue, ^{
+            // Cancel the fetch unless it was reattached (or orphaned again), completed, or got close enough to the end
+            if (operation.orphanCount == orphanCount && operation.orphanedCacheKey && !operation.tasks.count && ![operation isNearlyFinishedWithThreshold:weakSelf.conf.orphanedFetchProgressThreshold]) {
+                [weakSelf _cancelOrphanedLoadOperation:operation];
+            }
+        });
+    }
+}
+
+- (void)_cancelOrphanedLoadOperation:(nonnull _DFImageLoadOperation *)operation {
+    if (operation.fetchOperation) {
+        [operation.fetchOperation cancelImageFetching];
+        [self.delegate imageLoader:self didRecordOrphanedFetchEvent:DFImageLoaderOrphanedFetchEventCancelled byteCount:operation.completedUnitCount];
+    }
+    // The queued decode is dropped, the decode that is already executing stops at the next check of the token
+    [operation.cancellationToken cancel];
+    [operation.decodeOperation cancel];
+    [operation.progressiveImageDecoder invalidate];
+    operation.fetchOperation = nil;
+    operation.orphanedCacheKey = nil;
+    [self _removeImageLoadOperation:operation];
+}
+
+- (void)_storeImage:(nonnull UIImage *)image info:(nullable NSDictionary *)info forOrphanedCacheKey:(nonnull _DFImageRequestKey *)cacheKey {
+    DFImageRequest *request = cacheKey.request;
+    if ([self _shouldProcessImage:image forRequest:request partial:NO]) {
+        typeof(self) __weak weakSelf = self;
+        id<DFImageProcessing> processor = _conf.processor;
+        NSOperation *operation = [NSBlockOperation blockOperationWithBlock:^{
+            UIImage *processedImage = [processor processedImage:image forRequest:request partial:NO];
+            [weakSelf _storeImage:processedImage info:info forRequest:request key:cacheKey];
+        }];
+        _DFOperationSetPriority(operation, DFImageRequestPriorityLow); // Nobody is waiting for the image
+        [_conf.processingQueue addOperation:operation];
+    } else {
+        [self _storeImage:image info:info forRequest:request key:cacheKey];
+    }
+}
+
 - (void)_removeImageLoadOperation:(nonnull _DFImageLoadOperation *)operation {
     if (_loadOperations[operation.key] == operation) {
         [_loadOperations removeObjectForKey:operation.key];
@@ -350,20 +770,46 @@
 }
 
 - (nullable DFCachedImageResponse *)cachedResponseForRequest:(nonnull DFImageRequest *)request {
-    return request.options.memoryCachePolicy != DFImageRequestCachePolicyReloadIgnoringCache ? [_conf.cache cachedImageResponseForKey:DFImageCacheKeyCreate(request)] : nil;
+    if (!_conf.cache || request.options.memoryCachePolicy == DFImageRequestCachePolicyReloadIgnoringCache) {
+        return nil;
+    }
+    return [self cachedResponseForRequest:request key:DFImageCacheKeyCreate(request)];
+}
+
+- (nullable DFCachedImageResponse *)cachedResponseForRequest:(nonnull DFImageRequest *)request key:(nonnull id<NSCopying>)key {
+    DFImageRequestCachePolicy policy = request.options.memoryCachePolicy;
+    if (policy == DFImageRequestCachePolicyReloadIgnoringCache) {
+        return nil;
+    }
+    if (policy == DFImageRequestCachePolicyReturnStaleWhileRevalidate && [_conf.cache respondsToSelector:@selector(cachedImageResponseForKey:allowsExpired:)]) {
+        return [_conf.cache cachedImageResponseForKey:key allowsExpired:YES];
+    }
+    return [_conf.cache cachedImageResponseForKey:key];
 }
 
-- (void)_storeImage:(nullable UIImage *)image info:(nullable NSDictionary *)info forRequest:(nonnull DFImageRequest *)request {
-    if (image) {
+- (void)_storeImage:(nullable UIImage *)image info:(nullable NSDictionary *)info forRequest:(nonnull DFImageRequest *)request key:(nonnull id<NSCopying>)key {
+    if (image && _conf.cache) {
         DFCachedImageResponse *cachedResponse = [[DFCachedImageResponse alloc] initWithImage:image info:info expirationDate:(CFAbsoluteTimeGetCurrent() + request.options.expirationAge)];
-        [_conf.cache storeImageResponse:cachedResponse forKey:DFImageCacheKeyCreate(request)];
+        [_conf.cache storeImageResponse:cachedResponse forKey:key];
     }
 }
 
+- (void)storeImage:(nonnull UIImage *)image info:(nullable NSDictionary *)info forRequest:(nonnull DFImageRequest *)request {
+    [self _storeImage:image info:info forRequest:request key:DFImageCacheKeyCreate(request)];
+}
+
 - (nonnull id<NSCopying>)preheatingKeyForRequest:(nonnull DFImageRequest *)request {
     return DFImageCacheKeyCreate(request);
 }
 
+- (void)removeAllDecodedImages {
+    [_decodedImageCache removeAllImages];
+}
+
+- (void)removeAllFailures {
+    [_failureCache removeAllFailures];
+}
+
 #pragma mark <_DFImageRequestKeyOwner>
 
 - (BOOL)isImageRequestKey:(nonnull _DFImageRequestKey *)lhs equalToKey:(nonnull _DFImageRequestKey *)rhs {
@@ -0,0 +1,39 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import "DFImageManaging.h"
+#import "DFImagePrefetchJob.h"
+#import <Foundation/Foundation.h>
+
+/*! The interface between the prefetch job and the image manager that executes it.
+ */
+@protocol DFImagePrefetchJobManaging <NSObject>
+
+/*! Returns YES if the manager has interactive image tasks.
+ */
+- (BOOL)prefetchJobShouldYield:(nonnull DFImagePrefetchJob *)job;
+
+/*! Returns the low priority image task which doesn't count as an interactive task.
+ */
+- (nonnull DFImageTask *)prefetchJob:(nonnull DFImagePrefetchJob *)job imageTaskForRequest:(nonnull DFImageRequest *)request completion:(nonnull DFImageTaskCompletion)completion;
+
+/*! Returns the low priority image task which completes without an image once the data is fetched, the data is not decoded.
+ */
+- (nonnull DFImageTask *)prefetchJob:(nonnull DFImagePrefetchJob *)job dataTaskForRequest:(nonnull DFImageRequest *)request completion:(nonnull DFImageTaskCompletion)completion;
+
+- (void)prefetchJobDidResume:(nonnull DFImagePrefetchJob *)job;
+- (void)prefetchJobDidFinish:(nonnull DFImagePrefetchJob *)job;
+
+@end
+
+
+@interface DFImagePrefetchJob (DFImagePrefetchJobManaging)
+
+- (nonnull instancetype)initWithRequests:(nonnull NSArray<DFImageRequest *> *)requests manager:(nonnull id<DFImagePrefetchJobManaging>)manager;
+
+/*! Called by the manager when the last interactive image task is finished.
+ */
+- (void)setNeedsExecute;
+
+@end
@@ -0,0 +1,44 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import <Foundation/Foundation.h>
+#import <UIKit/UIKit.h>
+
+@class DFImageRequest;
+
+/*! Tracks the hot working set of the image manager (the most frequently and recently used requests) and persists the processed images for those requests, so that they can be put back into the memory cache on the next launch.
+
+ The snapshot is stored in a directory that contains the manifest and the image files. The image files are written first, the manifest is replaced atomically after that, so the reader never sees a partially written snapshot. The images are stored losslessly (PNG), so that the restored images are the same as the ones that were loaded.
+ @note Only the requests with resources and user info that conform to NSCoding protocol are persisted.
+ @note Thread safe. The methods that access the disk are blocking.
+ */
+@interface DFImageWarmStartSnapshot : NSObject
+
+@property (nonnull, nonatomic, readonly) NSURL *directoryURL;
+
+/*! Maximum number of images in the snapshot.
+ */
+@property (nonatomic, readonly) NSUInteger countLimit;
+
+- (nonnull instancetype)initWithDirectoryURL:(nonnull NSURL *)directoryURL countLimit:(NSUInteger)countLimit NS_DESIGNATED_INITIALIZER;
+
+- (nullable instancetype)init NS_UNAVAILABLE;
+
+/*! Records the use of the image for a given request. Equivalent requests must have the same key.
+ */
+- (void)recordUseOfRequest:(nonnull DFImageRequest *)request key:(nonnull id<NSCopying>)key;
+
+/*! Returns the most frequently used requests (ties are broken by recency), up to the countLimit. The most valuable requests come first.
+ */
+- (nonnull NSArray<DFImageRequest *> *)hotRequests;
+
+/*! Replaces the snapshot with the given images. Returns NO if the snapshot could not be written.
+ */
+- (BOOL)writeImages:(nonnull NSArray<UIImage *> *)images forRequests:(nonnull NSArray<DFImageRequest *> *)requests;
+
+/*! Reads the images from the snapshot in the order in which they were written. The images are not decompressed.
+ */
+- (void)enumerateImagesUsingBlock:(void (^__nonnull)(DFImageRequest *__nonnull request, UIImage *__nonnull image, BOOL *__nonnull stop))block;
+
+@end
@@ -0,0 +1,238 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import "DFImageManagerDefines.h"
+#import "DFImageRequest.h"
+#import "DFImageRequestOptions.h"
+#import "DFImageWarmStartSnapshot.h"
+
+static NSString *const _DFManifestFileName = @"manifest.plist";
+static NSString *const _DFImagesDirectoryPrefix = @"images-";
+static const NSInteger _DFManifestVersion = 1;
+
+static NSString *const _DFEntryResourceKey = @"resource";
+static NSString *const _DFEntryTargetWidthKey = @"targetWidth";
+static NSString *const _DFEntryTargetHeightKey = @"targetHeight";
+static NSString *const _DFEntryContentModeKey = @"contentMode";
+static NSString *const _DFEntryAllowsClippingKey = @"allowsClipping";
+static NSString *const _DFEntryExpirationAgeKey = @"expirationAge";
+static NSString *const _DFEntryUserInfoKey = @"userInfo";
+static NSString *const _DFEntryFilePathKey = @"file";
+static NSString *const _DFEntryScaleKey = @"scale";
+
+static BOOL _DFIsArchivable(id object) {
+    if ([object isKindOfClass:[NSDictionary class]]) {
+        for (id key in (NSDictionary *)object) {
+            if (!_DFIsArchivable(key) || !_DFIsArchivable(((NSDictionary *)object)[key])) {
+                return NO;
+            }
+        }
+        return YES;
+    }
+    if ([object isKindOfClass:[NSArray class]]) {
+        for (id element in (NSArray *)object) {
+            if (!_DFIsArchivable(element)) {
+                return NO;
+            }
+        }
+        return YES;
+    }
+    return [object conformsToProtocol:@protocol(NSCoding)];
+}
+
+@interface _DFImageWarmStartUsage : NSObject
+
+@property (nonnull, nonatomic) DFImageRequest *request;
+@property (nonatomic) NSUInteger useCount;
+@property (nonatomic) CFAbsoluteTime lastUseTime;
+
+@end
+
+@implementation _DFImageWarmStartUsage
+@end
+
+
+@implementation DFImageWarmStartSnapshot {
+    NSMutableDictionary<id<NSCopying>, _DFImageWarmStartUsage *> *_usages;
+    NSUInteger _recordedUseCount;
+    NSLock *_lock;
+}
+
+DF_INIT_UNAVAILABLE_IMPL
+
+- (nonnull instancetype)initWithDirectoryURL:(nonnull NSURL *)directoryURL countLimit:(NSUInteger)countLimit {
+    NSParameterAssert(directoryURL);
+    if (self = [super init]) {
+        _directoryURL = directoryURL;
+        _countLimit = countLimit;
+        _usages = [NSMutableDictionary new];
+        _lock = [NSLock new];
+    }
+    return self;
+}
+
+#pragma mark Usage
+
+- (void)recordUseOfRequest:(nonnull DFImageRequest *)request key:(nonnull id<NSCopying>)key {
+    if (!_countLimit) {
+        return;
+    }
+    [_lock lock];
+    _DFImageWarmStartUsage *usage = _usages[key];
+    if (!usage) {
+        usage = [_DFImageWarmStartUsage new];
+        _usages[key] = usage;
+    }
+    usage.request = request;
+    usage.useCount++;
+    usage.lastUseTime = CFAbsoluteTimeGetCurrent();
+    _recordedUseCount++;
+    [self _trimUsagesIfNeeded];
+    [_lock unlock];
+}
+
+/*! Keeps the table bounded: the counts are halved periodically so that the old popularity fades away, the least valuable entries are evicted when the table grows too large.
+ */
+- (void)_trimUsagesIfNeeded {
+    if (_recordedUseCount >= _countLimit * 16) {
+        _recordedUseCount = 0;
+        for (id key in _usages.allKeys) {
+            _DFImageWarmStartUsage *usage = _usages[key];
+            usage.useCount /= 2;
+            if (!usage.useCount) {
+                [_usages removeObjectForKey:key];
+            }
+        }
+    }
+    if (_usages.count > _countLimit * 4) {
+        NSArray *keys = [self _sortedKeys];
+        [_usages removeObjectsForKeys:[keys subarrayWithRange:NSMakeRange(_countLimit * 2, keys.count - _countLimit * 2)]];
+    }
+}
+
+- (nonnull NSArray *)_sortedKeys {
+    return [_usages keysSortedByValueUsingComparator:^NSComparisonResult(_DFImageWarmStartUsage *lhs, _DFImageWarmStartUsage *rhs) {
+        if (lhs.useCount != rhs.useCount) {
+            return lhs.useCount > rhs.useCount ? NSOrderedAscending : NSOrderedDescending;
+        }
+        if (lhs.lastUseTime != rhs.lastUseTime) {
+            return lhs.lastUseTime > rhs.lastUseTime ? NSOrderedAscending : NSOrderedDescending;
+        }
+        return NSOrderedSame;
+    }];
+}
+
+- (nonnull NSArray<DFImageRequest *> *)hotRequests {
+    NSMutableArray *requests = [NSMutableArray new];
+    [_lock lock];
+    for (id key in [self _sortedKeys]) {
+        if (requests.count == _countLimit) {
+            break;
+        }
+        [requests addObject:_usages[key].request];
+    }
+    [_lock unlock];
+    return requests;
+}
+
+#pragma mark Persistence
+
+- (nonnull NSURL *)_manifestURL {
+    return [_directoryURL URLByAppendingPathComponent:_DFManifestFileName];
+}
+
+- (BOOL)writeImages:(nonnull NSArray<UIImage *> *)images forRequests:(nonnull NSArray<DFImageRequest *> *)requests {
+    NSParameterAssert(images.count == requests.count);
+    NSFileManager *fileManager = [NSFileManager new];
+    NSString *imagesDirectory = [_DFImagesDirectoryPrefix stringByAppendingString:[NSUUID UUID].UUIDString];
+    NSURL *imagesDirectoryURL = [_directoryURL URLByAppendingPathComponent:imagesDirectory isDirectory:YES];
+    if (![fileManager createDirectoryAtURL:imagesDirectoryURL withIntermediateDirectories:YES attributes:nil error:nil]) {
+        return NO;
+    }
+    NSMutableArray *entries = [NSMutableArray new];
+    for (NSUInteger i = 0; i < images.count; i++) {
+        UIImage *image = images[i];
+        DFImageRequest *request = requests[i];
+        NSDictionary *userInfo = request.options.userInfo;
+        if (!_DFIsArchivable(request.resource) || (userInfo && !_DFIsArchivable(userInfo))) {
+            continue;
+        }
+        if (image.images || !image.CGImage || [image class] != [UIImage class]) {
+            continue; // Animated images and custom image classes would lose their content
+        }
+        // The restored images are served as final images, so they are stored losslessly
+        NSData *data = UIImagePNGRepresentation(image);
+        NSString *fileName = [NSString stringWithFormat:@"%lu", (unsigned long)entries.count];
+        if (!data || ![data writeToURL:[imagesDirectoryURL URLByAppendingPathComponent:fileName] atomically:YES]) {
+            continue;
+        }
+        NSMutableDictionary *entry = [NSMutableDictionary new];
+        entry[_DFEntryResourceKey] = request.resource;
+        entry[_DFEntryTargetWidthKey] = @(request.targetSize.width);
+        entry[_DFEntryTargetHeightKey] = @(request.targetSize.height);
+        entry[_DFEntryContentModeKey] = @(request.contentMode);
+        entry[_DFEntryAllowsClippingKey] = @(request.options.allowsClipping);
+        entry[_DFEntryExpirationAgeKey] = @(request.options.expirationAge);
+        entry[_DFEntryUserInfoKey] = userInfo;
+        entry[_DFEntryFilePathKey] = [imagesDirectory stringByAppendingPathComponent:fileName];
+        entry[_DFEntryScaleKey] = @(image.scale);
+        [entries addObject:entry];
+    }
+    NSData *manifest = [NSKeyedArchiver archivedDataWithRootObject:@{ @"version" : @(_DFManifestVersion), @"entries" : entries }];
+    BOOL success = [manifest writeToURL:[self _manifestURL] atomically:YES];
+    // Remove the images that are no longer referenced by the manifest
+    for (NSURL *URL in [fileManager contentsOfDirectoryAtURL:_directoryURL includingPropertiesForKeys:nil options:0 error:nil]) {
+        NSString *name = URL.lastPathComponent;
+        if ([name hasPrefix:_DFImagesDirectoryPrefix] && (success ? ![name isEqualToString:imagesDirectory] : [name isEqualToString:imagesDirectory])) {
+            [fileManager removeItemAtURL:URL error:nil];
+        }
+    }
+    return success;
+}
+
+- (nullable NSArray<NSDictionary *> *)_readEntries {
+    NSData *data = [NSData dataWithContentsOfURL:[self _manifestURL]];
+    if (!data) {
+        return nil;
+    }
+    id manifest;
+    @try {
+        manifest = [NSKeyedUnarchiver unarchiveObjectWithData:data];
+    } @catch (NSException *exception) {
+        return nil; // The manifest is corrupted
+    }
+    if (![manifest isKindOfClass:[NSDictionary class]] || ![manifest[@"version"] isEqual:@(_DFManifestVersion)]) {
+        return nil;
+    }
+    NSArray *entries = manifest[@"entries"];
+    return [entries isKindOfClass:[NSArray class]] ? entries : nil;
+}
+
+- (void)enumerateImagesUsingBlock:(void (^__nonnull)(DFImageRequest *__nonnull, UIImage *__nonnull, BOOL *__nonnull))block {
+    BOOL stop = NO;
+    for (NSDictionary *entry in [self _readEntries]) {
+        id resource = entry[_DFEntryResourceKey];
+        NSString *filePath = entry[_DFEntryFilePathKey];
+        if (!resource || ![filePath isKindOfClass:[NSString class]]) {
+            continue;
+        }
+        NSData *data = [NSData dataWithContentsOfURL:[_directoryURL URLByAppendingPathComponent:filePath]];
+        UIImage *image = data ? [UIImage imageWithData:data scale:[entry[_DFEntryScaleKey] doubleValue] ?: 1.0] : nil;
+        if (!image) {
+            continue;
+        }
+        DFMutableImageRequestOptions *options = [DFMutableImageRequestOptions new];
+        options.allowsClipping = [entry[_DFEntryAllowsClippingKey] boolValue];
+        options.expirationAge = [entry[_DFEntryExpirationAgeKey] doubleValue];
+        options.userInfo = entry[_DFEntryUserInfoKey];
+        CGSize targetSize = CGSizeMake([entry[_DFEntryTargetWidthKey] doubleValue], [entry[_DFEntryTargetHeightKey] doubleValue]);
+        DFImageRequest *request = [DFImageRequest requestWithResource:resource targetSize:targetSize contentMode:[entry[_DFEntryContentModeKey] integerValue] options:options.options];
+        block(request, image, &stop);
+        if (stop) {
+            break;
+        }
+    }
+}
+
+@end
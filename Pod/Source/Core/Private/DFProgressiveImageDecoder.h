@@ -16,6 +16,11 @@
 @property (nonatomic) float threshold;
 @property (nonatomic) int64_t totalByteCount;
 
+/*! The priority of the decoding operations, changes are applied to the operation that is already enqueued.
+ */
+@property (nonatomic) NSOperationQueuePriority queuePriority;
+@property (nonatomic) NSQualityOfService qualityOfService;
+
 - (void)appendData:(nullable NSData *)data;
 
 /*! Resumes decoding, safe to call multiple times.
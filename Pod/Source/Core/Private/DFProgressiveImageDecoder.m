@@ -4,6 +4,7 @@
 
 #import <UIKit/UIKit.h>
 #import "DFProgressiveImageDecoder.h"
+#import "DFImageCancellationToken.h"
 #import "DFImageDecoding.h"
 
 @interface DFProgressiveImageDecoder () <NSLocking>
@@ -14,7 +15,11 @@
 @property (nonatomic) BOOL executing;
 @property (nonatomic) BOOL decoding;
 @property (nonatomic) uint64_t decodedByteCount;
+@property (nullable, nonatomic) id<DFIncrementalImageDecoding> incrementalDecoder;
+@property (nonatomic) NSUInteger incrementalByteCount;
 @property (nonnull, nonatomic, readonly) NSRecursiveLock *recursiveLock;
+@property (nonnull, nonatomic, readonly) DFImageCancellationToken *cancellationToken;
+@property (nullable, nonatomic, weak) NSOperation *operation;
 
 @end
 
@@ -26,6 +31,9 @@
         _queue = queue;
         _data = [NSMutableData new];
         _recursiveLock = [NSRecursiveLock new];
+        _cancellationToken = [DFImageCancellationToken new];
+        _queuePriority = NSOperationQueuePriorityNormal;
+        _qualityOfService = NSQualityOfServiceDefault;
     }
     return self;
 }
@@ -39,10 +47,26 @@
     [self unlock];
 }
 
+- (void)setQueuePriority:(NSOperationQueuePriority)queuePriority {
+    [self lock];
+    _queuePriority = queuePriority;
+    self.operation.queuePriority = queuePriority;
+    [self unlock];
+}
+
+- (void)setQualityOfService:(NSQualityOfService)qualityOfService {
+    [self lock];
+    _qualityOfService = qualityOfService;
+    self.operation.qualityOfService = qualityOfService;
+    [self unlock];
+}
+
 - (void)invalidate {
+    [_cancellationToken cancel]; // Stops the decoding pass that is already executing
     [self lock];
     _executing = NO;
     _data = nil;
+    _incrementalDecoder = nil;
     [self unlock];
 }
 
@@ -69,25 +93,53 @@
     }
     _decoding = YES;
     typeof(self) __weak weakSelf = self;
-    [_queue addOperationWithBlock:^{
+    NSOperation *operation = [NSBlockOperation blockOperationWithBlock:^{
         DFProgressiveImageDecoder *strongSelf = weakSelf;
         if (!strongSelf || !strongSelf.executing) {
             return;
         }
         [strongSelf lock];
-        NSData *data = [strongSelf.data copy];
+        if (!strongSelf.data) {
+            [strongSelf unlock];
+            return;
+        }
+        NSData *data = [strongSelf _dataForDecoding];
+        NSUInteger length = strongSelf.data.length;
+        id<DFIncrementalImageDecoding> incrementalDecoder = strongSelf.incrementalDecoder;
+        strongSelf.incrementalByteCount = length;
         [strongSelf unlock];
-        UIImage *image = [strongSelf.decoder imageWithData:data partial:YES];
+        DFImageCancellationToken *token = strongSelf.cancellationToken;
+        UIImage *__block image;
+        [token performAsCurrent:^{
+            image = incrementalDecoder ? [incrementalDecoder imageByAppendingData:data] : [strongSelf.decoder imageWithData:data partial:YES];
+        }];
         void (^handler)(UIImage *) = strongSelf.handler;
-        if (image && handler) {
+        if (image && handler && !token.isCancelled) {
             handler(image);
         }
         [strongSelf lock];
-        strongSelf.decodedByteCount = data.length;
+        strongSelf.decodedByteCount = length;
         strongSelf.decoding = NO;
         [self _decodeIfNeeded];
         [strongSelf unlock];
     }];
+    operation.queuePriority = _queuePriority;
+    operation.qualityOfService = _qualityOfService;
+    self.operation = operation;
+    [_queue addOperation:operation];
+}
+
+/*! Returns the data that the next decoding pass should process. If the decoder supports incremental decoding only the data that wasn't appended to the incremental decoder yet is returned, otherwise all of the received data is.
+ */
+- (nonnull NSData *)_dataForDecoding {
+    if (!_incrementalDecoder && [_decoder respondsToSelector:@selector(incrementalDecoderForData:)]) {
+        _incrementalDecoder = [_decoder incrementalDecoderForData:_data];
+        _incrementalByteCount = 0;
+    }
+    if (_incrementalDecoder) {
+        return [_data subdataWithRange:NSMakeRange(_incrementalByteCount, _data.length - _incrementalByteCount)];
+    }
+    return [_data copy];
 }
 
 #pragma mark <NSLocking>
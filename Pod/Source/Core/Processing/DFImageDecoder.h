@@ -6,6 +6,8 @@
 #import "DFImageDecoding.h"
 
 /*! Image decoder that supports multiple image formats not supported by UIImage.
+ @note When the image is decoded for the requests with small target sizes the decoder uses the embedded thumbnail (EXIF, JFIF) if it is large enough, the rest of the image is not decoded.
+ @note Images larger than 16 megapixels are decoded lazily and their bitmaps are not cached after being drawn, use DFImageProcessingRegionKey to display regions (tiles) of such images without keeping the entire bitmap in memory. The regions that are drawn at a lower resolution are decoded from the image downsampled by ImageIO. The regions that are drawn at full resolution and decoded together share a single decode of the image, otherwise each of them requires the entire image to be decoded.
  */
 @interface DFImageDecoder : NSObject <DFImageDecoding>
 
@@ -2,20 +2,182 @@
 //
 // Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
 
+#import "DFImageCancellationToken.h"
 #import "DFImageDecoder.h"
+#import "DFImageRequest.h"
+#import <ImageIO/ImageIO.h>
 
 #if TARGET_OS_WATCH
 #import <WatchKit/WatchKit.h>
 #endif
 
+static const double _kDFImageDecoderLargeImagePixelCount = 4096.0 * 4096.0;
+
+/*! Maximum relative difference between the aspect ratios of the image and its embedded thumbnail. Some cameras letterbox thumbnails, such thumbnails can't be used.
+ */
+static const double _kDFImageDecoderThumbnailAspectRatioTolerance = 0.02;
+
+static UIImageOrientation _DFImageOrientationWithEXIFOrientation(NSInteger orientation) {
+    switch (orientation) {
+        case 2: return UIImageOrientationUpMirrored;
+        case 3: return UIImageOrientationDown;
+        case 4: return UIImageOrientationDownMirrored;
+        case 5: return UIImageOrientationLeftMirrored;
+        case 6: return UIImageOrientationRight;
+        case 7: return UIImageOrientationRightMirrored;
+        case 8: return UIImageOrientationLeft;
+        default: return UIImageOrientationUp;
+    }
+}
+
 @implementation DFImageDecoder
 
 - (nullable UIImage *)imageWithData:(nonnull NSData *)data partial:(BOOL)partial {
 #if TARGET_OS_IOS && !TARGET_OS_WATCH
-    return [UIImage imageWithData:data scale:[UIScreen mainScreen].scale];
+    CGFloat scale = [UIScreen mainScreen].scale;
+#else
+    CGFloat scale = [WKInterfaceDevice currentDevice].screenScale;
+#endif
+    UIImage *image = partial ? nil : [self _largeImageWithData:data scale:scale];
+    if (!image && [DFImageCancellationToken isCurrentTokenCancelled]) {
+        return nil;
+    }
+    return image ?: [UIImage imageWithData:data scale:scale];
+}
+
+- (nullable UIImage *)imageWithData:(nonnull NSData *)data forRequests:(nonnull NSArray<DFImageRequest *> *)requests {
+#if TARGET_OS_IOS && !TARGET_OS_WATCH
+    CGFloat scale = [UIScreen mainScreen].scale;
 #else
-    return [UIImage imageWithData:data scale:[WKInterfaceDevice currentDevice].screenScale];
+    CGFloat scale = [WKInterfaceDevice currentDevice].screenScale;
 #endif
+    UIImage *thumbnail = [self _imageWithData:data regionRequests:requests scale:scale] ?: [self _embeddedThumbnailWithData:data requests:requests scale:scale];
+    if (!thumbnail && [DFImageCancellationToken isCurrentTokenCancelled]) {
+        return nil;
+    }
+    return thumbnail ?: [self imageWithData:data partial:NO];
+}
+
+/*! Returns the image for the requests that all draw the regions of the image (see DFImageProcessingRegionKey), otherwise returns nil. If the regions are drawn at a lower resolution the image is downsampled by ImageIO while it is decoded, to the largest of the scales of the regions. If multiple regions of the large image are drawn at full resolution the image is decoded once and its bitmap is shared by the regions, instead of decoding the entire image for each of them.
+ */
+- (nullable UIImage *)_imageWithData:(nonnull NSData *)data regionRequests:(nonnull NSArray<DFImageRequest *> *)requests scale:(CGFloat)scale {
+    if (!requests.count) {
+        return nil;
+    }
+    for (DFImageRequest *request in requests) {
+        if (CGRectIsNull(request.region)) {
+            return nil;
+        }
+    }
+    CGImageSourceRef source = CGImageSourceCreateWithData((__bridge CFDataRef)data, NULL);
+    if (!source) {
+        return nil;
+    }
+    NSDictionary *properties = CFBridgingRelease(CGImageSourceCopyPropertiesAtIndex(source, 0, NULL));
+    CGSize imageSize = CGSizeMake([properties[(id)kCGImagePropertyPixelWidth] doubleValue], [properties[(id)kCGImagePropertyPixelHeight] doubleValue]);
+    if (CGImageSourceGetCount(source) != 1 || imageSize.width < 1 || imageSize.height < 1) {
+        CFRelease(source);
+        return nil;
+    }
+    CGFloat decodingScale = 0.f;
+    for (DFImageRequest *request in requests) {
+        CGSize regionSize = CGSizeMake(request.region.size.width * imageSize.width, request.region.size.height * imageSize.height);
+        decodingScale = MAX(decodingScale, MIN(1.f, MIN(request.targetSize.width / regionSize.width, request.targetSize.height / regionSize.height)));
+    }
+    CGImageRef imageRef = NULL;
+    if (decodingScale > 0.f && decodingScale < 1.f) {
+        NSDictionary *options = @{ (id)kCGImageSourceCreateThumbnailFromImageAlways : @YES,
+                                   (id)kCGImageSourceThumbnailMaxPixelSize : @(ceil(MAX(imageSize.width, imageSize.height) * decodingScale)),
+                                   (id)kCGImageSourceShouldCacheImmediately : @YES };
+        imageRef = CGImageSourceCreateThumbnailAtIndex(source, 0, (__bridge CFDictionaryRef)options);
+    } else if (requests.count > 1 && imageSize.width * imageSize.height > _kDFImageDecoderLargeImagePixelCount) {
+        // The bitmap is decoded when the first region is drawn, the other regions are drawn from it
+        imageRef = CGImageSourceCreateImageAtIndex(source, 0, (__bridge CFDictionaryRef)@{ (id)kCGImageSourceShouldCache : @YES });
+    }
+    UIImage *image;
+    if (imageRef) {
+        UIImageOrientation orientation = _DFImageOrientationWithEXIFOrientation([properties[(id)kCGImagePropertyOrientation] integerValue]);
+        image = [UIImage imageWithCGImage:imageRef scale:scale orientation:orientation];
+        CGImageRelease(imageRef);
+    }
+    CFRelease(source);
+    return image;
+}
+
+/*! Returns the thumbnail embedded into the image data (EXIF, JFIF) if it is large enough for the target sizes and content modes of all of the requests, otherwise returns nil. Only the thumbnail is decoded.
+ */
+- (nullable UIImage *)_embeddedThumbnailWithData:(nonnull NSData *)data requests:(nonnull NSArray<DFImageRequest *> *)requests scale:(CGFloat)scale {
+    if (!requests.count) {
+        return nil;
+    }
+    for (DFImageRequest *request in requests) {
+        if (CGSizeEqualToSize(request.targetSize, DFImageMaximumSize) || !CGRectIsNull(request.region)) {
+            return nil;
+        }
+    }
+    CGImageSourceRef source = CGImageSourceCreateWithData((__bridge CFDataRef)data, NULL);
+    if (!source) {
+        return nil;
+    }
+    NSDictionary *properties = CFBridgingRelease(CGImageSourceCopyPropertiesAtIndex(source, 0, NULL));
+    NSDictionary *options = @{ (id)kCGImageSourceCreateThumbnailFromImageIfAbsent : @NO,
+                               (id)kCGImageSourceCreateThumbnailFromImageAlways : @NO };
+    CGImageRef thumbnailRef = CGImageSourceCreateThumbnailAtIndex(source, 0, (__bridge CFDictionaryRef)options);
+    CFRelease(source);
+    if (!thumbnailRef) {
+        return nil;
+    }
+    CGSize imageSize = CGSizeMake([properties[(id)kCGImagePropertyPixelWidth] doubleValue], [properties[(id)kCGImagePropertyPixelHeight] doubleValue]);
+    CGSize thumbnailSize = CGSizeMake(CGImageGetWidth(thumbnailRef), CGImageGetHeight(thumbnailRef));
+    UIImage *thumbnail;
+    if ([self _isThumbnailSize:thumbnailSize sufficientForImageSize:imageSize requests:requests]) {
+        UIImageOrientation orientation = _DFImageOrientationWithEXIFOrientation([properties[(id)kCGImagePropertyOrientation] integerValue]);
+        thumbnail = [UIImage imageWithCGImage:thumbnailRef scale:scale orientation:orientation];
+    }
+    CGImageRelease(thumbnailRef);
+    return thumbnail;
+}
+
+- (BOOL)_isThumbnailSize:(CGSize)thumbnailSize sufficientForImageSize:(CGSize)imageSize requests:(nonnull NSArray<DFImageRequest *> *)requests {
+    if (imageSize.width < 1 || imageSize.height < 1 || thumbnailSize.width < 1 || thumbnailSize.height < 1) {
+        return NO;
+    }
+    double imageAspectRatio = imageSize.width / imageSize.height;
+    if (fabs(thumbnailSize.width / thumbnailSize.height - imageAspectRatio) > imageAspectRatio * _kDFImageDecoderThumbnailAspectRatioTolerance) {
+        return NO;
+    }
+    for (DFImageRequest *request in requests) {
+        CGFloat scaleWidth = request.targetSize.width / imageSize.width;
+        CGFloat scaleHeight = request.targetSize.height / imageSize.height;
+        CGFloat scale = MIN(1.f, request.contentMode == DFImageContentModeAspectFill ? MAX(scaleWidth, scaleHeight) : MIN(scaleWidth, scaleHeight));
+        // Allow a single pixel error caused by rounding
+        if (thumbnailSize.width + 1.f < imageSize.width * scale || thumbnailSize.height + 1.f < imageSize.height * scale) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+/*! Returns the image if the data contains an image larger than 16 megapixels, otherwise returns nil. ImageIO doesn't cache the bitmap of such images after they are drawn, so that the regions of the image (see DFImageProcessingRegionKey) can be drawn without keeping the entire bitmap in memory. The image is decoded in full each time the region is drawn, unless the regions are decoded for the requests (see imageWithData:forRequests:).
+ */
+- (nullable UIImage *)_largeImageWithData:(nonnull NSData *)data scale:(CGFloat)scale {
+    CGImageSourceRef source = CGImageSourceCreateWithData((__bridge CFDataRef)data, NULL);
+    if (!source) {
+        return nil;
+    }
+    UIImage *image;
+    NSDictionary *properties = CFBridgingRelease(CGImageSourceCopyPropertiesAtIndex(source, 0, NULL));
+    double pixelCount = [properties[(id)kCGImagePropertyPixelWidth] doubleValue] * [properties[(id)kCGImagePropertyPixelHeight] doubleValue];
+    if (CGImageSourceGetCount(source) == 1 && pixelCount > _kDFImageDecoderLargeImagePixelCount) {
+        CGImageRef imageRef = CGImageSourceCreateImageAtIndex(source, 0, (__bridge CFDictionaryRef)@{ (id)kCGImageSourceShouldCache : @NO });
+        if (imageRef) {
+            UIImageOrientation orientation = _DFImageOrientationWithEXIFOrientation([properties[(id)kCGImagePropertyOrientation] integerValue]);
+            image = [UIImage imageWithCGImage:imageRef scale:scale orientation:orientation];
+            CGImageRelease(imageRef);
+        }
+    }
+    CFRelease(source);
+    return image;
 }
 
 @end
@@ -42,4 +204,26 @@
     return nil;
 }
 
+- (UIImage *)imageWithData:(NSData *)data forRequests:(NSArray<DFImageRequest *> *)requests {
+    for (id<DFImageDecoding> decoder in _decoders) {
+        UIImage *image = [decoder respondsToSelector:@selector(imageWithData:forRequests:)] ? [decoder imageWithData:data forRequests:requests] : [decoder imageWithData:data partial:NO];
+        if (image) {
+            return image;
+        }
+    }
+    return nil;
+}
+
+- (id<DFIncrementalImageDecoding>)incrementalDecoderForData:(NSData *)data {
+    for (id<DFImageDecoding> decoder in _decoders) {
+        if ([decoder respondsToSelector:@selector(incrementalDecoderForData:)]) {
+            id<DFIncrementalImageDecoding> incrementalDecoder = [decoder incrementalDecoderForData:data];
+            if (incrementalDecoder) {
+                return incrementalDecoder;
+            }
+        }
+    }
+    return nil;
+}
+
 @end
@@ -10,7 +10,16 @@
  */
 extern NSString *__nonnull DFImageProcessingCornerRadiusKey;
 
+/*! NSNumber with BOOL value that specifies whether opaque images can be decompressed into 16-bit bitmaps that use half as much memory at a cost of color precision. Should be put into DFImageRequestOptions userInfo dictionary.
+ */
+extern NSString *__nonnull DFImageProcessingAllowsLowPrecisionKey;
+
+/*! NSValue with CGRect value that specifies a normalized region of the image in the coordinate space of the image bitmap, where {0, 0, 1, 1} is the entire image. Only the region is drawn and scaled to fit the target size, so the processed image only keeps the bitmap of the region. DFImageDecoder decodes the image downsampled to the resolution of the regions that are drawn at a lower resolution, and shares a single decode of the image between the regions that are drawn at full resolution and are loaded together. Should be put into DFImageRequestOptions userInfo dictionary, see DFImageRequest (Tiling).
+ */
+extern NSString *__nonnull DFImageProcessingRegionKey;
+
 /*! The DFImageProcessor implements image decompression, scaling, cropping and more.
+ @note Decompressed images use the most compact bitmap format that preserves the image quality, see df_decompressedImage:scale: for more info.
  */
 @interface DFImageProcessor : NSObject <DFImageProcessing>
 
@@ -2,12 +2,15 @@
 //
 // Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
 
+#import "DFImageCancellationToken.h"
 #import "DFImageProcessor.h"
 #import "DFImageRequest.h"
 #import "DFImageRequestOptions.h"
 #import "UIImage+DFImageUtilities.h"
 
 NSString *DFImageProcessingCornerRadiusKey = @"DFImageProcessingCornerRadiusKey";
+NSString *DFImageProcessingAllowsLowPrecisionKey = @"DFImageProcessingAllowsLowPrecisionKey";
+NSString *DFImageProcessingRegionKey = @"DFImageProcessingRegionKey";
 
 @implementation DFImageProcessor
 
@@ -29,21 +32,46 @@ NSString *DFImageProcessingCornerRadiusKey = @"DFImageProcessingCornerRadiusKey"
           request1.options.allowsClipping == request2.options.allowsClipping)) {
         return NO;
     }
+    if ([request1.options.userInfo[DFImageProcessingAllowsLowPrecisionKey] boolValue] != [request2.options.userInfo[DFImageProcessingAllowsLowPrecisionKey] boolValue]) {
+        return NO;
+    }
+    if (!CGRectEqualToRect(request1.region, request2.region)) {
+        return NO;
+    }
     NSNumber *cornerRadius1 = request1.options.userInfo[DFImageProcessingCornerRadiusKey];
     NSNumber *cornerRadius2 = request2.options.userInfo[DFImageProcessingCornerRadiusKey];
     return (!cornerRadius1 && !cornerRadius2) || ((!!cornerRadius1 && !!cornerRadius2) && [cornerRadius1 isEqualToNumber:cornerRadius2]);
 }
 
 - (nullable UIImage *)processedImage:(nonnull UIImage *)image forRequest:(nonnull DFImageRequest *)request partial:(BOOL)partial {
-    if (request.contentMode == DFImageContentModeAspectFill && request.options.allowsClipping) {
-        image = [DFImageProcessor _croppedImage:image aspectFillPixelSize:request.targetSize];
+    // Decompression and rounding the corners draw the whole bitmap, the current cancellation token is checked before each of the stages
+    if ([DFImageCancellationToken isCurrentTokenCancelled]) {
+        return nil;
     }
-    CGFloat scale = [UIImage df_scaleForImage:image targetSize:request.targetSize contentMode:request.contentMode];
-    if (scale < 1.f || self.shouldDecompressImages) {
-        image = [UIImage df_decompressedImage:image scale:scale];
+    BOOL allowsLowPrecision = [request.options.userInfo[DFImageProcessingAllowsLowPrecisionKey] boolValue];
+    CGRect region = request.region;
+    if (!CGRectIsNull(region)) {
+        // Cropping doesn't decode the image, only the pixels of the region are drawn when the cropped image is decompressed. The image might be downsampled by the decoder, the region is normalized.
+        image = [UIImage df_croppedImage:image normalizedCropRect:region];
+        CGFloat scale = [UIImage df_scaleForImage:image targetSize:request.targetSize contentMode:DFImageContentModeAspectFit];
+        image = [UIImage df_decompressedImage:image scale:scale allowsLowPrecision:allowsLowPrecision];
+    } else {
+        if (request.contentMode == DFImageContentModeAspectFill && request.options.allowsClipping) {
+            image = [DFImageProcessor _croppedImage:image aspectFillPixelSize:request.targetSize];
+        }
+        CGFloat scale = [UIImage df_scaleForImage:image targetSize:request.targetSize contentMode:request.contentMode];
+        if ([DFImageCancellationToken isCurrentTokenCancelled]) {
+            return nil;
+        }
+        if (scale < 1.f || self.shouldDecompressImages) {
+            image = [UIImage df_decompressedImage:image scale:scale allowsLowPrecision:allowsLowPrecision];
+        }
     }
     NSNumber *normalizedCornerRadius = request.options.userInfo[DFImageProcessingCornerRadiusKey];
     if (normalizedCornerRadius) {
+        if ([DFImageCancellationToken isCurrentTokenCancelled]) {
+            return nil;
+        }
         CGFloat cornerRadius = normalizedCornerRadius.floatValue * MIN(image.size.width, image.size.height);
         image = [UIImage df_imageWithImage:image cornerRadius:cornerRadius];
     }
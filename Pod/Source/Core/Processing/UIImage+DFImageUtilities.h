@@ -14,13 +14,35 @@
 + (CGFloat)df_scaleForImage:(nullable UIImage *)image targetSize:(CGSize)targetSize contentMode:(DFImageContentMode)contentMode;
 
 /*! Returns scaled decompressed image with a given image. Image decompression and scaling is made in a single step.
+ @note The bitmap format is chosen based on the image. Opaque images are decompressed into bitmaps without alpha channel (kCGImageAlphaNoneSkipFirst) which don't require blending, opaque grayscale images are decompressed into 8-bit grayscale bitmaps which use four times less memory. Other images are decompressed into 32-bit premultiplied bitmaps.
  */
 + (nullable UIImage *)df_decompressedImage:(nullable UIImage *)image scale:(CGFloat)scale;
 
+/*! Returns scaled decompressed image with a given image. If allowsLowPrecision is YES opaque color images are decompressed into 16-bit bitmaps (5 bits per component) which use two times less memory at a cost of color precision.
+ */
++ (nullable UIImage *)df_decompressedImage:(nullable UIImage *)image scale:(CGFloat)scale allowsLowPrecision:(BOOL)allowsLowPrecision;
+
+/*! Returns YES if the image doesn't have an alpha channel.
+ */
++ (BOOL)df_isOpaqueImage:(nullable UIImage *)image;
+
+/*! Returns YES if the image uses monochrome color space.
+ */
++ (BOOL)df_isGrayscaleImage:(nullable UIImage *)image;
+
+/*! Returns the amount of memory in bytes occupied by the image bitmap. Subclasses that allocate additional memory (for example, animated images that buffer frames) should override this method.
+ */
+- (NSUInteger)df_memoryCost;
+
 /*! Returns image cropped to a given normalized crop rect.
  */
 + (nullable UIImage *)df_croppedImage:(nullable UIImage *)image normalizedCropRect:(CGRect)cropRect;
 
+/*! Returns the image decoded from a BlurHash string (a compact representation of the placeholder for the image). The image is meant to be used as a low-quality preview, small sizes (e.g. 32x32 pixels) are sufficient because the image is blurry by nature. Returns nil if the string is invalid.
+ @param size The size of the image in pixels.
+ */
++ (nullable UIImage *)df_imageWithBlurHash:(nonnull NSString *)blurHash size:(CGSize)size;
+
 /*! Returns image by drawing rounded corners.
  @param cornerRadius corner radius in points.
  */
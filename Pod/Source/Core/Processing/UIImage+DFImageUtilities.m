@@ -4,6 +4,75 @@
 
 #import "UIImage+DFImageUtilities.h"
 
+typedef NS_ENUM(NSInteger, _DFBitmapFormat) {
+    _DFBitmapFormatRGBA32, // 32 bpp, premultiplied alpha
+    _DFBitmapFormatRGB32, // 32 bpp, no alpha
+    _DFBitmapFormatRGB16, // 16 bpp, 5 bpc, no alpha
+    _DFBitmapFormatGray8 // 8 bpp, no alpha
+};
+
+static CGContextRef _DFCreateBitmapContext(CGSize size, _DFBitmapFormat format) {
+    size_t bitsPerComponent = 8;
+    CGBitmapInfo bitmapInfo;
+    CGColorSpaceRef colorSpaceRef;
+    switch (format) {
+        case _DFBitmapFormatRGBA32:
+            bitmapInfo = kCGBitmapByteOrder32Host | kCGImageAlphaPremultipliedFirst;
+            colorSpaceRef = CGColorSpaceCreateDeviceRGB();
+            break;
+        case _DFBitmapFormatRGB32:
+            bitmapInfo = kCGBitmapByteOrder32Host | kCGImageAlphaNoneSkipFirst;
+            colorSpaceRef = CGColorSpaceCreateDeviceRGB();
+            break;
+        case _DFBitmapFormatRGB16:
+            bitsPerComponent = 5;
+            bitmapInfo = kCGBitmapByteOrder16Host | kCGImageAlphaNoneSkipFirst;
+            colorSpaceRef = CGColorSpaceCreateDeviceRGB();
+            break;
+        case _DFBitmapFormatGray8:
+            bitmapInfo = kCGBitmapByteOrderDefault | kCGImageAlphaNone;
+            colorSpaceRef = CGColorSpaceCreateDeviceGray();
+            break;
+    }
+    CGContextRef contextRef = CGBitmapContextCreate(NULL, (size_t)size.width, (size_t)size.height, bitsPerComponent, 0, colorSpaceRef, bitmapInfo);
+    if (colorSpaceRef) {
+        CGColorSpaceRelease(colorSpaceRef);
+    }
+    return contextRef;
+}
+
+#pragma mark - BlurHash
+
+static const char *_DFBlurHashCharacters = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz#$%*+,-.:;=?@[]^_{|}~";
+
+/*! Decodes base83 value from the given range of the string, returns -1 if the string contains invalid characters.
+ */
+static NSInteger _DFBlurHashDecode83(const char *string, NSUInteger location, NSUInteger length) {
+    NSInteger value = 0;
+    for (NSUInteger i = location; i < location + length; i++) {
+        const char *character = strchr(_DFBlurHashCharacters, string[i]);
+        if (!character || string[i] == '\0') {
+            return -1;
+        }
+        value = value * 83 + (character - _DFBlurHashCharacters);
+    }
+    return value;
+}
+
+static inline float _DFBlurHashSRGBToLinear(NSInteger value) {
+    float v = value / 255.f;
+    return v <= 0.04045f ? v / 12.92f : powf((v + 0.055f) / 1.055f, 2.4f);
+}
+
+static inline uint32_t _DFBlurHashLinearToSRGB(float value) {
+    float v = MAX(0.f, MIN(1.f, value));
+    return (uint32_t)(v <= 0.0031308f ? v * 12.92f * 255.f + 0.5f : (1.055f * powf(v, 1.f / 2.4f) - 0.055f) * 255.f + 0.5f);
+}
+
+static inline float _DFBlurHashSignPow(float value, float exp) {
+    return copysignf(powf(fabsf(value), exp), value);
+}
+
 @implementation UIImage (DFImageUtilities)
 
 + (CGFloat)df_scaleForImage:(nullable UIImage *)image targetSize:(CGSize)targetSize contentMode:(DFImageContentMode)contentMode {
@@ -14,6 +83,10 @@
 }
 
 + (UIImage *)df_decompressedImage:(UIImage *)image scale:(CGFloat)scale {
+    return [self df_decompressedImage:image scale:scale allowsLowPrecision:NO];
+}
+
++ (UIImage *)df_decompressedImage:(UIImage *)image scale:(CGFloat)scale allowsLowPrecision:(BOOL)allowsLowPrecision {
     if (!image) {
         return nil;
     }
@@ -26,10 +99,17 @@
         imageSize = CGSizeMake(imageSize.width * scale, imageSize.height * scale);
     }
 
-    CGColorSpaceRef colorSpaceRef = CGColorSpaceCreateDeviceRGB();
-    CGContextRef contextRef = CGBitmapContextCreate(NULL, (size_t)imageSize.width, (size_t)imageSize.height, CGImageGetBitsPerComponent(imageRef), 0, colorSpaceRef, (kCGBitmapByteOrderDefault | kCGImageAlphaPremultipliedFirst));
-    if (colorSpaceRef) {
-        CGColorSpaceRelease(colorSpaceRef);
+    CGContextRef contextRef = NULL;
+    BOOL opaque = [self df_isOpaqueImage:image];
+    if (opaque && [self df_isGrayscaleImage:image]) {
+        contextRef = _DFCreateBitmapContext(imageSize, _DFBitmapFormatGray8);
+    } else if (opaque && allowsLowPrecision) {
+        contextRef = _DFCreateBitmapContext(imageSize, _DFBitmapFormatRGB16);
+    } else if (opaque) {
+        contextRef = _DFCreateBitmapContext(imageSize, _DFBitmapFormatRGB32);
+    }
+    if (!contextRef) { // Fallback to the format that is always supported
+        contextRef = _DFCreateBitmapContext(imageSize, _DFBitmapFormatRGBA32);
     }
     if (!contextRef) {
         return image;
@@ -45,12 +125,36 @@
     return decompressedImage;
 }
 
++ (BOOL)df_isOpaqueImage:(UIImage *)image {
+    if (!image.CGImage) {
+        return NO;
+    }
+    CGImageAlphaInfo alphaInfo = CGImageGetAlphaInfo(image.CGImage);
+    return (alphaInfo == kCGImageAlphaNone ||
+            alphaInfo == kCGImageAlphaNoneSkipFirst ||
+            alphaInfo == kCGImageAlphaNoneSkipLast);
+}
+
++ (BOOL)df_isGrayscaleImage:(UIImage *)image {
+    if (!image.CGImage) {
+        return NO;
+    }
+    return CGColorSpaceGetModel(CGImageGetColorSpace(image.CGImage)) == kCGColorSpaceModelMonochrome;
+}
+
+- (NSUInteger)df_memoryCost {
+    CGImageRef image = self.CGImage;
+    return (CGImageGetWidth(image) * CGImageGetHeight(image) * CGImageGetBitsPerPixel(image)) / 8;
+}
+
 + (UIImage *)df_croppedImage:(UIImage *)image normalizedCropRect:(CGRect)cropRect {
     CGSize imageSize = CGSizeMake(CGImageGetWidth(image.CGImage), CGImageGetHeight(image.CGImage));
-    CGRect imageCropRect = CGRectMake((CGFloat)floor(cropRect.origin.x * imageSize.width),
-                                      (CGFloat)floor(cropRect.origin.y * imageSize.height),
-                                      (CGFloat)floor(cropRect.size.width * imageSize.width),
-                                      (CGFloat)floor(cropRect.size.height * imageSize.height));
+    // Edges are rounded so that adjacent crop rects (e.g. tiles) don't overlap or leave gaps
+    CGFloat minX = (CGFloat)round(CGRectGetMinX(cropRect) * imageSize.width);
+    CGFloat minY = (CGFloat)round(CGRectGetMinY(cropRect) * imageSize.height);
+    CGFloat maxX = (CGFloat)round(CGRectGetMaxX(cropRect) * imageSize.width);
+    CGFloat maxY = (CGFloat)round(CGRectGetMaxY(cropRect) * imageSize.height);
+    CGRect imageCropRect = CGRectMake(minX, minY, maxX - minX, maxY - minY);
     CGImageRef croppedImageRef = CGImageCreateWithImageInRect([image CGImage], imageCropRect);
     UIImage *croppedImage = [UIImage imageWithCGImage:croppedImageRef scale:image.scale orientation:image.imageOrientation];
     if (croppedImageRef) {
@@ -59,6 +163,74 @@
     return croppedImage;
 }
 
++ (UIImage *)df_imageWithBlurHash:(NSString *)blurHash size:(CGSize)size {
+    const char *hash = blurHash.UTF8String;
+    NSUInteger length = hash ? strlen(hash) : 0;
+    size_t width = (size_t)size.width, height = (size_t)size.height;
+    if (length < 6 || !width || !height) {
+        return nil;
+    }
+    NSInteger sizeFlag = _DFBlurHashDecode83(hash, 0, 1);
+    NSInteger numX = (sizeFlag % 9) + 1, numY = (sizeFlag / 9) + 1;
+    NSInteger quantisedMaximumValue = _DFBlurHashDecode83(hash, 1, 1);
+    if (sizeFlag < 0 || quantisedMaximumValue < 0 || length != (NSUInteger)(4 + 2 * numX * numY)) {
+        return nil;
+    }
+    float maximumValue = (quantisedMaximumValue + 1) / 166.f;
+    float colors[81][3];
+    for (NSInteger i = 0; i < numX * numY; i++) {
+        if (i == 0) {
+            NSInteger value = _DFBlurHashDecode83(hash, 2, 4);
+            if (value < 0) {
+                return nil;
+            }
+            colors[i][0] = _DFBlurHashSRGBToLinear(value >> 16);
+            colors[i][1] = _DFBlurHashSRGBToLinear((value >> 8) & 255);
+            colors[i][2] = _DFBlurHashSRGBToLinear(value & 255);
+        } else {
+            NSInteger value = _DFBlurHashDecode83(hash, (NSUInteger)(4 + i * 2), 2);
+            if (value < 0) {
+                return nil;
+            }
+            colors[i][0] = _DFBlurHashSignPow(((value / (19 * 19)) - 9.f) / 9.f, 2.f) * maximumValue;
+            colors[i][1] = _DFBlurHashSignPow((((value / 19) % 19) - 9.f) / 9.f, 2.f) * maximumValue;
+            colors[i][2] = _DFBlurHashSignPow(((value % 19) - 9.f) / 9.f, 2.f) * maximumValue;
+        }
+    }
+    CGContextRef contextRef = _DFCreateBitmapContext(CGSizeMake(width, height), _DFBitmapFormatRGB32);
+    if (!contextRef) {
+        return nil;
+    }
+    uint8_t *data = CGBitmapContextGetData(contextRef);
+    size_t bytesPerRow = CGBitmapContextGetBytesPerRow(contextRef);
+    for (size_t y = 0; y < height; y++) {
+        uint32_t *row = (uint32_t *)(data + y * bytesPerRow);
+        for (size_t x = 0; x < width; x++) {
+            float r = 0.f, g = 0.f, b = 0.f;
+            for (NSInteger j = 0; j < numY; j++) {
+                float basisY = cosf((float)M_PI * y * j / height);
+                for (NSInteger i = 0; i < numX; i++) {
+                    float basis = cosf((float)M_PI * x * i / width) * basisY;
+                    float *color = colors[i + j * numX];
+                    r += color[0] * basis;
+                    g += color[1] * basis;
+                    b += color[2] * basis;
+                }
+            }
+            // 32-bit host order, alpha skipped first (xRGB)
+            row[x] = (_DFBlurHashLinearToSRGB(r) << 16) | (_DFBlurHashLinearToSRGB(g) << 8) | _DFBlurHashLinearToSRGB(b);
+        }
+    }
+    CGImageRef imageRef = CGBitmapContextCreateImage(contextRef);
+    CGContextRelease(contextRef);
+    if (!imageRef) {
+        return nil;
+    }
+    UIImage *image = [UIImage imageWithCGImage:imageRef];
+    CGImageRelease(imageRef);
+    return image;
+}
+
 + (UIImage *)df_imageWithImage:(UIImage *)image cornerRadius:(CGFloat)cornerRadius {
     UIGraphicsBeginImageContextWithOptions(image.size, NO, 0);
     [[UIBezierPath bezierPathWithRoundedRect:(CGRect){CGPointZero, image.size} cornerRadius:cornerRadius] addClip];
@@ -23,4 +23,10 @@
  */
 - (void)removeAllObjects;
 
+@optional
+
+/*! Returns cached image response associated with a given key. If allowsExpired is YES the expired response is returned instead of being removed. Required to support DFImageRequestCachePolicyReturnStaleWhileRevalidate.
+ */
+- (nullable DFCachedImageResponse *)cachedImageResponseForKey:(nullable id<NSCopying>)key allowsExpired:(BOOL)allowsExpired;
+
 @end
@@ -5,7 +5,21 @@
 #import <UIKit/UIKit.h>
 #import <Foundation/Foundation.h>
 
+@class DFImageRequest;
+
+/*! Decodes the image data as it arrives, keeping the decoding state between the calls, so that the data that was already decoded doesn't have to be decoded again.
+ */
+@protocol DFIncrementalImageDecoding <NSObject>
+
+/*! Appends the next chunk of the image data and returns the image decoded so far. Returns nil if there is not enough data to produce an image.
+ */
+- (nullable UIImage *)imageByAppendingData:(nonnull NSData *)data;
+
+@end
+
+
 /*! Defines methods for image decoding.
+ @note The image manager decodes the data with the current DFImageCancellationToken, which is cancelled when there are no more tasks waiting for the image. Decoders that do a lot of work might check the token and return nil early.
  */
 @protocol DFImageDecoding <NSObject>
 
@@ -13,4 +27,16 @@
  */
 - (nullable UIImage *)imageWithData:(nonnull NSData *)data partial:(BOOL)partial;
 
+@optional
+
+/*! Returns the incremental decoder for the image that starts with the given data. The decoder is used for progressive decoding instead of decoding all of the received data each time new data arrives. Returns nil if the decoder doesn't support the format of the data or if there is not enough data to detect the format yet.
+ @note The decoder doesn't receive the initial data, it should be appended by the caller.
+ */
+- (nullable id<DFIncrementalImageDecoding>)incrementalDecoderForData:(nonnull NSData *)data;
+
+/*! Creates and returns an image object that uses the specified image data and that is going to be processed for the given requests. The decoder might use this information to decode less data, for example, an embedded thumbnail that is large enough for the target sizes of all requests.
+ @note This method is used instead of imageWithData:partial: to decode the complete image data when implemented.
+ */
+- (nullable UIImage *)imageWithData:(nonnull NSData *)data forRequests:(nonnull NSArray<DFImageRequest *> *)requests;
+
 @end
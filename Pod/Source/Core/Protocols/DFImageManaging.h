@@ -44,6 +44,7 @@ typedef void (^DFImageTaskCompletion)(UIImage *__nullable image, NSError *__null
  @note When you call this method, DFImageManager starts to fetch image data and cache images for the given requests. At any time afterward, you can create image tasks with equivalent requests.
  @note DFImageManager caches images with the exact target size, content mode, and options you specify in this method. If you later request an image with, for example, a different target size than you passed when calling this method, DFImageManager might have to generate a new image but would still be able to use cached image data.
  @note If this method is called twice with the same requests the second call would have no effect (unless first requests are completed).
+ @note Preheating is executed with low priority regardless of the priority in the options of the requests.
  */
 - (void)startPreheatingImagesForRequests:(nonnull NSArray<DFImageRequest *> *)requests;
 
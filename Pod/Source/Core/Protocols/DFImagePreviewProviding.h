@@ -0,0 +1,23 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import <Foundation/Foundation.h>
+
+@class DFImageRequest;
+
+/*! The DFImagePreviewProviding protocol maps image requests to the low-quality previews of the images for the requests that allow previews but don't specify them in their options (see allowsPreview property of DFImageRequestOptions).
+ */
+@protocol DFImagePreviewProviding <NSObject>
+
+@optional
+
+/*! Returns the resource of the low-resolution preview of the image (for example, the sibling URL of the thumbnail), or nil if there is no preview.
+ */
+- (nullable id)previewResourceForRequest:(nonnull DFImageRequest *)request;
+
+/*! Returns the BlurHash string of the image, or nil if there is none.
+ */
+- (nullable NSString *)previewBlurHashForRequest:(nonnull DFImageRequest *)request;
+
+@end
@@ -18,6 +18,7 @@
 
 /*! Returns processed image for a given request.
  @param partial If YES then image is a progressively decoded partial image data.
+ @note The image is processed with the current DFImageCancellationToken, which is cancelled when the task is cancelled. Processors might check the token between the processing stages and return nil early.
  */
 - (nullable UIImage *)processedImage:(nonnull UIImage *)image forRequest:(nonnull DFImageRequest *)request partial:(BOOL)partial;
 
@@ -0,0 +1,34 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import <Foundation/Foundation.h>
+
+/*! The token that signals that the result of the decoding or processing work is no longer needed, e.g. because all of the tasks that wait for the image were cancelled.
+
+ DFImageManager makes the token current (see -performAsCurrent:) while it decodes and processes images. Decoders (see DFImageDecoding) and processors (see DFImageProcessing) check the current token between the stages of the work that they perform and return nil early once the token is cancelled.
+ @note Thread safe.
+ */
+@interface DFImageCancellationToken : NSObject
+
+/*! Returns YES if the token was cancelled.
+ */
+@property (atomic, readonly, getter=isCancelled) BOOL cancelled;
+
+/*! Cancels the token. Cancellation is cooperative: the work that is already executing stops at the next check of the token.
+ */
+- (void)cancel;
+
+/*! Makes the receiver the current token of the current thread for the duration of the block.
+ */
+- (void)performAsCurrent:(__attribute__((noescape)) void (^__nonnull)(void))block;
+
+/*! Returns the current token of the current thread, or nil if there is none.
+ */
++ (nullable DFImageCancellationToken *)currentToken;
+
+/*! Returns YES if the current token of the current thread is cancelled.
+ */
++ (BOOL)isCurrentTokenCancelled;
+
+@end
@@ -0,0 +1,38 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import "DFImageCancellationToken.h"
+
+/*! The token is retained by the caller of -performAsCurrent: while it is current.
+ */
+static __thread __unsafe_unretained DFImageCancellationToken *_DFCurrentToken;
+
+@interface DFImageCancellationToken ()
+
+@property (atomic, readwrite, getter=isCancelled) BOOL cancelled;
+
+@end
+
+@implementation DFImageCancellationToken
+
+- (void)cancel {
+    self.cancelled = YES;
+}
+
+- (void)performAsCurrent:(__attribute__((noescape)) void (^__nonnull)(void))block {
+    DFImageCancellationToken *previousToken = _DFCurrentToken;
+    _DFCurrentToken = self;
+    block();
+    _DFCurrentToken = previousToken;
+}
+
++ (nullable DFImageCancellationToken *)currentToken {
+    return _DFCurrentToken;
+}
+
++ (BOOL)isCurrentTokenCancelled {
+    return _DFCurrentToken.isCancelled;
+}
+
+@end
@@ -0,0 +1,55 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import <Foundation/Foundation.h>
+#import <UIKit/UIKit.h>
+
+/*! Constants for the formats of the image data.
+ */
+typedef NS_ENUM(NSUInteger, DFImageFormat) {
+    DFImageFormatUnknown = 0,
+    DFImageFormatJPEG,
+    DFImageFormatPNG,
+    DFImageFormatGIF,
+    DFImageFormatWebP
+};
+
+/*! The DFImageHeaderInfo describes the image using only the header of its data (the first bytes of the data, typically less than a few KB), so that the image dimensions are known before the image is downloaded and decoded.
+ @note Supports JPEG, PNG, GIF and WebP formats.
+ */
+@interface DFImageHeaderInfo : NSObject
+
+/*! The format of the image data.
+ */
+@property (nonatomic, readonly) DFImageFormat format;
+
+/*! The size of the image in pixels with the orientation applied, the width and height are swapped for the images that are rotated by 90 degrees.
+ */
+@property (nonatomic, readonly) CGSize pixelSize;
+
+/*! The orientation of the image (EXIF orientation of JPEG images).
+ */
+@property (nonatomic, readonly) UIImageOrientation orientation;
+
+/*! Returns YES for progressive JPEG and interlaced PNG images.
+ */
+@property (nonatomic, readonly, getter=isProgressive) BOOL progressive;
+
+/*! Returns YES for animated PNG, GIF (with the loop extension) and WebP images.
+ */
+@property (nonatomic, readonly, getter=isAnimated) BOOL animated;
+
+/*! Parses the header of the image data. Returns nil if the format is not supported or if the data doesn't contain the whole header yet.
+ */
++ (nullable instancetype)headerInfoWithData:(nonnull NSData *)data;
+
+/*! Returns the format of the image data using its signature, DFImageFormatUnknown if the format is not supported or if the data is shorter than the signature (12 bytes).
+ */
++ (DFImageFormat)formatForData:(nonnull NSData *)data;
+
+/*! Unavailable initializer, please use +headerInfoWithData:.
+ */
+- (nullable instancetype)init NS_UNAVAILABLE;
+
+@end
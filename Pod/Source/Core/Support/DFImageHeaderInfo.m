@@ -0,0 +1,250 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import "DFImageHeaderInfo.h"
+#import "DFImageManagerDefines.h"
+
+typedef struct {
+    DFImageFormat format;
+    NSUInteger width;
+    NSUInteger height;
+    NSInteger EXIFOrientation;
+    BOOL progressive;
+    BOOL animated;
+} _DFImageHeader;
+
+static inline uint16_t _DFRead16(const uint8_t *bytes, BOOL littleEndian) {
+    return littleEndian ? (uint16_t)(bytes[0] | bytes[1] << 8) : (uint16_t)(bytes[0] << 8 | bytes[1]);
+}
+
+static inline uint32_t _DFRead32(const uint8_t *bytes, BOOL littleEndian) {
+    return littleEndian ? ((uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24) : ((uint32_t)bytes[0] << 24 | (uint32_t)bytes[1] << 16 | (uint32_t)bytes[2] << 8 | (uint32_t)bytes[3]);
+}
+
+static DFImageFormat _DFImageFormat(const uint8_t *bytes, NSUInteger length) {
+    if (length < 12) {
+        return DFImageFormatUnknown;
+    }
+    if (bytes[0] == 0xFF && bytes[1] == 0xD8 && bytes[2] == 0xFF) {
+        return DFImageFormatJPEG;
+    }
+    if (memcmp(bytes, "\x89PNG\r\n\x1A\n", 8) == 0) {
+        return DFImageFormatPNG;
+    }
+    if (memcmp(bytes, "GIF87a", 6) == 0 || memcmp(bytes, "GIF89a", 6) == 0) {
+        return DFImageFormatGIF;
+    }
+    if (memcmp(bytes, "RIFF", 4) == 0 && memcmp(bytes + 8, "WEBP", 4) == 0) {
+        return DFImageFormatWebP;
+    }
+    return DFImageFormatUnknown;
+}
+
+#pragma mark JPEG
+
+/*! Returns the orientation from the APP1 segment that contains EXIF data, or 1 (up) if there is none.
+ */
+static NSInteger _DFEXIFOrientation(const uint8_t *bytes, NSUInteger length) {
+    if (length < 14 || memcmp(bytes, "Exif\0\0", 6) != 0) {
+        return 1;
+    }
+    const uint8_t *TIFF = bytes + 6;
+    NSUInteger TIFFLength = length - 6;
+    BOOL littleEndian = TIFF[0] == 'I' && TIFF[1] == 'I';
+    if (!littleEndian && !(TIFF[0] == 'M' && TIFF[1] == 'M')) {
+        return 1;
+    }
+    NSUInteger offset = _DFRead32(TIFF + 4, littleEndian);
+    if (offset + 2 > TIFFLength) {
+        return 1;
+    }
+    NSUInteger count = _DFRead16(TIFF + offset, littleEndian);
+    for (NSUInteger i = 0; i < count; i++) {
+        NSUInteger entry = offset + 2 + i * 12;
+        if (entry + 12 > TIFFLength) {
+            break;
+        }
+        if (_DFRead16(TIFF + entry, littleEndian) == 0x0112) {
+            NSInteger orientation = _DFRead16(TIFF + entry + 8, littleEndian);
+            return (orientation >= 1 && orientation <= 8) ? orientation : 1;
+        }
+    }
+    return 1;
+}
+
+static BOOL _DFParseJPEGHeader(const uint8_t *bytes, NSUInteger length, _DFImageHeader *header) {
+    NSUInteger position = 2;
+    while (position + 4 <= length) {
+        if (bytes[position] != 0xFF) {
+            return NO;
+        }
+        uint8_t marker = bytes[position + 1];
+        if (marker == 0xFF) { // Fill byte
+            position++;
+            continue;
+        }
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD8)) { // Markers without a payload
+            position += 2;
+            continue;
+        }
+        if (marker == 0xD9 || marker == 0xDA) { // No frame header before the image data
+            return NO;
+        }
+        NSUInteger segmentLength = _DFRead16(bytes + position + 2, NO);
+        if (segmentLength < 2) {
+            return NO;
+        }
+        // Start of frame, except DHT (C4), JPG (C8) and DAC (CC) markers
+        if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+            if (position + 9 > length) {
+                return NO;
+            }
+            header->height = _DFRead16(bytes + position + 5, NO);
+            header->width = _DFRead16(bytes + position + 7, NO);
+            header->progressive = marker == 0xC2 || marker == 0xC6 || marker == 0xCA || marker == 0xCE;
+            return YES;
+        }
+        if (marker == 0xE1 && position + 2 + segmentLength <= length) {
+            header->EXIFOrientation = _DFEXIFOrientation(bytes + position + 4, segmentLength - 2);
+        }
+        position += 2 + segmentLength;
+    }
+    return NO;
+}
+
+#pragma mark PNG
+
+static BOOL _DFParsePNGHeader(const uint8_t *bytes, NSUInteger length, _DFImageHeader *header) {
+    // Signature (8), IHDR length (4) and type (4), width (4), height (4), bit depth, color type, compression, filter, interlace, CRC (4)
+    if (length < 33 || memcmp(bytes + 12, "IHDR", 4) != 0) {
+        return NO;
+    }
+    header->width = _DFRead32(bytes + 16, NO);
+    header->height = _DFRead32(bytes + 20, NO);
+    header->progressive = bytes[28] == 1;
+    // Animated PNG has the animation control chunk before the first image data chunk
+    NSUInteger position = 33;
+    while (position + 8 <= length) {
+        const uint8_t *type = bytes + position + 4;
+        if (memcmp(type, "acTL", 4) == 0) {
+            header->animated = YES;
+            return YES;
+        }
+        if (memcmp(type, "IDAT", 4) == 0) {
+            return YES;
+        }
+        position += 12 + (NSUInteger)_DFRead32(bytes + position, NO);
+    }
+    return NO;
+}
+
+#pragma mark GIF
+
+static BOOL _DFParseGIFHeader(const uint8_t *bytes, NSUInteger length, _DFImageHeader *header) {
+    if (length < 13) {
+        return NO;
+    }
+    header->width = _DFRead16(bytes + 6, YES);
+    header->height = _DFRead16(bytes + 8, YES);
+    uint8_t flags = bytes[10];
+    NSUInteger position = 13 + ((flags & 0x80) ? 3 * (1 << ((flags & 0x07) + 1)) : 0); // Global color table
+    // Animated GIF has the loop (NETSCAPE2.0) extension before the first image descriptor
+    while (position < length) {
+        if (bytes[position] == 0x2C) { // Image descriptor
+            return YES;
+        }
+        if (bytes[position] != 0x21 || position + 2 > length) { // Not an extension
+            return NO;
+        }
+        if (bytes[position + 1] == 0xFF && position + 14 <= length && bytes[position + 2] == 11 && memcmp(bytes + position + 3, "NETSCAPE2.0", 11) == 0) {
+            header->animated = YES;
+            return YES;
+        }
+        position += 2;
+        while (position < length && bytes[position] != 0) { // Skip data sub-blocks
+            position += 1 + bytes[position];
+        }
+        position++; // Block terminator
+    }
+    return NO;
+}
+
+#pragma mark WebP
+
+static BOOL _DFParseWebPHeader(const uint8_t *bytes, NSUInteger length, _DFImageHeader *header) {
+    if (length < 30) {
+        return NO;
+    }
+    const uint8_t *chunk = bytes + 12;
+    if (memcmp(chunk, "VP8 ", 4) == 0) { // Lossy
+        if (bytes[23] != 0x9D || bytes[24] != 0x01 || bytes[25] != 0x2A) {
+            return NO;
+        }
+        header->width = _DFRead16(bytes + 26, YES) & 0x3FFF;
+        header->height = _DFRead16(bytes + 28, YES) & 0x3FFF;
+        return YES;
+    }
+    if (memcmp(chunk, "VP8L", 4) == 0) { // Lossless
+        if (bytes[20] != 0x2F) {
+            return NO;
+        }
+        uint32_t bits = _DFRead32(bytes + 21, YES);
+        header->width = (bits & 0x3FFF) + 1;
+        header->height = ((bits >> 14) & 0x3FFF) + 1;
+        return YES;
+    }
+    if (memcmp(chunk, "VP8X", 4) == 0) { // Extended
+        header->animated = (bytes[20] & 0x02) != 0;
+        header->width = 1 + (bytes[24] | bytes[25] << 8 | bytes[26] << 16);
+        header->height = 1 + (bytes[27] | bytes[28] << 8 | bytes[29] << 16);
+        return YES;
+    }
+    return NO;
+}
+
+
+@implementation DFImageHeaderInfo
+
+DF_INIT_UNAVAILABLE_IMPL
+
+- (nonnull instancetype)_initWithHeader:(_DFImageHeader)header {
+    if (self = [super init]) {
+        static const UIImageOrientation orientations[] = { UIImageOrientationUp, UIImageOrientationUp, UIImageOrientationUpMirrored, UIImageOrientationDown, UIImageOrientationDownMirrored, UIImageOrientationLeftMirrored, UIImageOrientationRight, UIImageOrientationRightMirrored, UIImageOrientationLeft };
+        _format = header.format;
+        _orientation = orientations[header.EXIFOrientation];
+        BOOL isRotated = header.EXIFOrientation >= 5;
+        _pixelSize = isRotated ? CGSizeMake(header.height, header.width) : CGSizeMake(header.width, header.height);
+        _progressive = header.progressive;
+        _animated = header.animated;
+    }
+    return self;
+}
+
++ (nullable instancetype)headerInfoWithData:(nonnull NSData *)data {
+    const uint8_t *bytes = data.bytes;
+    NSUInteger length = data.length;
+    _DFImageHeader header = { .format = _DFImageFormat(bytes, length), .EXIFOrientation = 1 };
+    BOOL success = NO;
+    switch (header.format) {
+        case DFImageFormatJPEG: success = _DFParseJPEGHeader(bytes, length, &header); break;
+        case DFImageFormatPNG: success = _DFParsePNGHeader(bytes, length, &header); break;
+        case DFImageFormatGIF: success = _DFParseGIFHeader(bytes, length, &header); break;
+        case DFImageFormatWebP: success = _DFParseWebPHeader(bytes, length, &header); break;
+        case DFImageFormatUnknown: break;
+    }
+    if (!success || !header.width || !header.height) {
+        return nil;
+    }
+    return [[DFImageHeaderInfo alloc] _initWithHeader:header];
+}
+
++ (DFImageFormat)formatForData:(nonnull NSData *)data {
+    return _DFImageFormat(data.bytes, data.length);
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@ %p> { format = %lu, pixelSize = %@, orientation = %li, progressive = %i, animated = %i }", [self class], self, (unsigned long)_format, NSStringFromCGSize(_pixelSize), (long)_orientation, _progressive, _animated];
+}
+
+@end
@@ -30,7 +30,11 @@ typedef NS_ENUM(NSInteger, DFImageRequestCachePolicy) {
     
     /* Specifies that the image should loaded from the originating source. No existing cache data should be used to satisfy the request.
      */
-    DFImageRequestCachePolicyReloadIgnoringCache
+    DFImageRequestCachePolicyReloadIgnoringCache,
+    
+    /*! Allows memory cache lookup. Expired cached image is returned as a stale fast response (see isStale property of DFImageResponse) instead of being reloaded, and the image manager revalidates it in background (see revalidationHandler property of DFImageTask).
+     */
+    DFImageRequestCachePolicyReturnStaleWhileRevalidate
 };
 
 /*! Image request priority.
@@ -41,6 +45,26 @@ typedef NS_ENUM(NSInteger, DFImageRequestPriority) {
     DFImageRequestPriorityHigh
 };
 
+/*! The tier from which the image manager has loaded the image.
+ */
+typedef NS_ENUM(NSUInteger, DFImageSource) {
+    /*! The processed image from the memory cache (DFImageCaching).
+     */
+    DFImageSourceMemoryCache,
+    
+    /*! The recently decoded image (see decodedImageCacheCostLimit property of DFImageManagerConfiguration), only processing was required.
+     */
+    DFImageSourceDecodedImageCache,
+    
+    /*! The encoded data from the data cache (DFImageDataCache), the image was decoded and processed.
+     */
+    DFImageSourceDataCache,
+    
+    /*! The data fetched by the fetcher (from the disk cache or from the network).
+     */
+    DFImageSourceFetcher
+};
+
 /*! The error domain for DFImageManager.
  */
 extern NSString *__nonnull const DFImageManagerErrorDomain;
@@ -53,6 +77,26 @@ static const NSInteger DFImageManagerErrorCancelled = -1;
  */
 static const NSInteger DFImageManagerErrorUnknown = -2;
 
+/*! Returned by the fetcher when the image that is being revalidated hasn't changed (for example, when the server responds with 304 Not Modified).
+ */
+static const NSInteger DFImageManagerErrorNotModified = -3;
+
+/*! The key in the info dictionary returned by the fetcher. The value is the string that identifies the version of the fetched data, for example, HTTP entity tag or last modification date. The image manager uses it to check whether the content of the revalidated image has changed.
+ */
+extern NSString *__nonnull const DFImageInfoValidatorKey;
+
+/*! The key in the info dictionary returned by the fetcher. The value is the dictionary with the freshness and validation header fields of the HTTP response (Cache-Control, Expires, Date, Last-Modified, ETag, Content-Length). The fetchers that implement the disk cache return the header fields of the original response for the cached data.
+ */
+extern NSString *__nonnull const DFImageInfoHTTPHeaderFieldsKey;
+
+/*! The key in the info dictionary returned by the fetcher. The value is the NSNumber with the number of bytes that the fetcher has received from the network. The fetchers that implement the disk cache return 0 for the data read from the disk cache. If the key is missing all of the fetched data is considered received from the network.
+ */
+extern NSString *__nonnull const DFImageInfoFetchedByteCountKey;
+
+/*! The key in the userInfo of the options of the revalidation request. The value is the info dictionary of the stale cached response (or an empty dictionary). Fetchers that support conditional requests can use it to load the data only if it has changed, and should fail with DFImageManagerErrorNotModified error otherwise.
+ */
+extern NSString *__nonnull const DFImageRequestRevalidationInfoKey;
+
 #define DF_INIT_UNAVAILABLE_IMPL \
 - (nullable instancetype)init { \
     [NSException raise:NSInternalInconsistencyException format:@"Please use designated initialzier"]; \
@@ -7,3 +7,11 @@
 CGSize const DFImageMaximumSize = { FLT_MAX, FLT_MAX };
 
 NSString *const DFImageManagerErrorDomain = @"DFImageManagerErrorDomain";
+
+NSString *const DFImageInfoValidatorKey = @"DFImageInfoValidatorKey";
+
+NSString *const DFImageInfoHTTPHeaderFieldsKey = @"DFImageInfoHTTPHeaderFieldsKey";
+
+NSString *const DFImageInfoFetchedByteCountKey = @"DFImageInfoFetchedByteCountKey";
+
+NSString *const DFImageRequestRevalidationInfoKey = @"DFImageRequestRevalidationInfoKey";
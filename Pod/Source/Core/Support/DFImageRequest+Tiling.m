@@ -0,0 +1,54 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import "DFImageProcessor.h"
+#import "DFImageRequest.h"
+#import "DFImageRequestOptions.h"
+
+static DFImageRequestOptions *_DFImageRequestOptionsWithRegion(DFImageRequestOptions *options, CGRect region) {
+    DFMutableImageRequestOptions *builder = options ? [[DFMutableImageRequestOptions alloc] initWithOptions:options] : [DFMutableImageRequestOptions new];
+    NSMutableDictionary *userInfo = [NSMutableDictionary dictionaryWithDictionary:builder.userInfo];
+    userInfo[DFImageProcessingRegionKey] = [NSValue valueWithCGRect:region];
+    builder.userInfo = userInfo;
+    return builder.options;
+}
+
+@implementation DFImageRequest (Tiling)
+
++ (nonnull instancetype)requestWithResource:(nonnull id)resource region:(CGRect)region targetSize:(CGSize)targetSize options:(nullable DFImageRequestOptions *)options {
+    return [[[self class] alloc] initWithResource:resource targetSize:targetSize contentMode:DFImageContentModeAspectFit options:_DFImageRequestOptionsWithRegion(options, region)];
+}
+
++ (nonnull NSArray<DFImageRequest *> *)tileRequestsWithResource:(nonnull id)resource imageSize:(CGSize)imageSize tileSize:(CGSize)tileSize scale:(CGFloat)scale rect:(CGRect)rect options:(nullable DFImageRequestOptions *)options {
+    NSMutableArray *requests = [NSMutableArray new];
+    if (imageSize.width <= 0 || imageSize.height <= 0 || tileSize.width <= 0 || tileSize.height <= 0 || scale <= 0) {
+        return requests;
+    }
+    // Size of the tile in the coordinate space of the full resolution image
+    CGSize regionSize = CGSizeMake(ceil(tileSize.width / scale), ceil(tileSize.height / scale));
+    rect = CGRectIntersection(rect, (CGRect){CGPointZero, imageSize});
+    if (CGRectIsEmpty(rect)) {
+        return requests;
+    }
+    NSInteger firstColumn = (NSInteger)floor(CGRectGetMinX(rect) / regionSize.width);
+    NSInteger lastColumn = (NSInteger)floor((CGRectGetMaxX(rect) - 1) / regionSize.width);
+    NSInteger firstRow = (NSInteger)floor(CGRectGetMinY(rect) / regionSize.height);
+    NSInteger lastRow = (NSInteger)floor((CGRectGetMaxY(rect) - 1) / regionSize.height);
+    for (NSInteger row = firstRow; row <= lastRow; row++) {
+        for (NSInteger column = firstColumn; column <= lastColumn; column++) {
+            CGRect tileRect = CGRectIntersection(CGRectMake(column * regionSize.width, row * regionSize.height, regionSize.width, regionSize.height), (CGRect){CGPointZero, imageSize});
+            CGRect region = CGRectMake(tileRect.origin.x / imageSize.width, tileRect.origin.y / imageSize.height, tileRect.size.width / imageSize.width, tileRect.size.height / imageSize.height);
+            CGSize targetSize = CGSizeMake(ceil(tileRect.size.width * scale), ceil(tileRect.size.height * scale));
+            [requests addObject:[self requestWithResource:resource region:region targetSize:targetSize options:options]];
+        }
+    }
+    return requests;
+}
+
+- (CGRect)region {
+    NSValue *region = self.options.userInfo[DFImageProcessingRegionKey];
+    return region ? region.CGRectValue : CGRectNull;
+}
+
+@end
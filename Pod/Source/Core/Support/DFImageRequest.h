@@ -48,3 +48,25 @@
 - (nullable instancetype)init NS_UNAVAILABLE;
 
 @end
+
+
+@interface DFImageRequest (Tiling)
+
+/*! Returns the request for a region of the image. Only the region is drawn and scaled to fit the target size, the image is still decoded in full for each region (see DFImageProcessingRegionKey). Each region is cached separately, while the image data is loaded once for all of the regions of the same image.
+ @param region The normalized rect in the coordinate space of the image bitmap, {0, 0, 1, 1} is the entire image. See DFImageProcessingRegionKey.
+ */
++ (nonnull instancetype)requestWithResource:(nonnull id)resource region:(CGRect)region targetSize:(CGSize)targetSize options:(nullable DFImageRequestOptions *)options;
+
+/*! Returns the requests for the tiles of the image that intersect a given rect. The image is divided into tiles that have a given size in pixels when scaled with a given scale, which allows implementing a zoomable viewer for very large images that only keeps the bitmaps of the visible tiles in memory. Decoding each tile takes as much memory and time as decoding the entire image.
+ @param imageSize The size of the image in pixels.
+ @param tileSize The size of the tiles in pixels.
+ @param scale The level of detail of the tiles, 1.0 for full resolution tiles.
+ @param rect The rect in the coordinate space of the full resolution image.
+ */
++ (nonnull NSArray<DFImageRequest *> *)tileRequestsWithResource:(nonnull id)resource imageSize:(CGSize)imageSize tileSize:(CGSize)tileSize scale:(CGFloat)scale rect:(CGRect)rect options:(nullable DFImageRequestOptions *)options;
+
+/*! Returns the normalized region of the image, or CGRectNull if the request is for the entire image.
+ */
+@property (nonatomic, readonly) CGRect region;
+
+@end
@@ -5,6 +5,12 @@
 #import "DFImageRequest.h"
 #import "DFImageRequestOptions.h"
 
+@interface DFImageRequestOptions (DFSharedDefaultOptions)
+
++ (nonnull DFImageRequestOptions *)_sharedDefaultOptions;
+
+@end
+
 @implementation DFImageRequest
 
 DF_INIT_UNAVAILABLE_IMPL
@@ -14,7 +20,7 @@ DF_INIT_UNAVAILABLE_IMPL
         _resource = resource;
         _targetSize = targetSize;
         _contentMode = contentMode;
-        _options = options ?: [DFImageRequestOptions new];
+        _options = options ?: [DFImageRequestOptions _sharedDefaultOptions];
     }
     return self;
 }
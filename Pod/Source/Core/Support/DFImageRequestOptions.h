@@ -26,6 +26,18 @@
  */
 @property (nonatomic, readonly) BOOL allowsProgressiveImage;
 
+/*! If YES the image manager first delivers a low-quality preview of the image to the progressive image handler of the task and then loads the full image. The preview is resolved using previewResource and previewBlurHash or, if those are nil, using the preview provider of the image manager configuration.
+ */
+@property (nonatomic, readonly) BOOL allowsPreview;
+
+/*! The resource of the low-resolution preview of the image (for example, the URL of the thumbnail). The preview is loaded by the same image manager.
+ */
+@property (nullable, nonatomic, readonly) id previewResource;
+
+/*! The BlurHash string of the image which is decoded locally into a blurred preview.
+ */
+@property (nullable, nonatomic, readonly) NSString *previewBlurHash;
+
 /*! The request cache policy used for memory caching.
  */
 @property (nonatomic, readonly) DFImageRequestCachePolicy memoryCachePolicy;
@@ -59,6 +71,10 @@
  */
 - (nonnull instancetype)init NS_DESIGNATED_INITIALIZER;
 
+/*! Initializes DFMutableImageRequestOptions with all of the values of the given options.
+ */
+- (nonnull instancetype)initWithOptions:(nonnull DFImageRequestOptions *)options;
+
 /*! Image request priority. Default value is DFImageRequestPriorityNormal.
  */
 @property (nonatomic) DFImageRequestPriority priority;
@@ -75,6 +91,18 @@
  */
 @property (nonatomic) BOOL allowsProgressiveImage;
 
+/*! If YES the image manager first delivers a low-quality preview of the image to the progressive image handler of the task and then loads the full image. Default value is NO.
+ */
+@property (nonatomic) BOOL allowsPreview;
+
+/*! The resource of the low-resolution preview of the image (for example, the URL of the thumbnail). Default value is nil.
+ */
+@property (nullable, nonatomic) id previewResource;
+
+/*! The BlurHash string of the image which is decoded locally into a blurred preview. Default value is nil.
+ */
+@property (nullable, copy, nonatomic) NSString *previewBlurHash;
+
 /*! The request cache policy used for memory caching. Default value is DFImageRequestCachePolicyDefault.
  */
 @property (nonatomic) DFImageRequestCachePolicy memoryCachePolicy;
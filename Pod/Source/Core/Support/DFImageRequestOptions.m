@@ -16,6 +16,9 @@
         _allowsNetworkAccess = builder.allowsNetworkAccess;
         _allowsClipping = builder.allowsClipping;
         _allowsProgressiveImage = builder.allowsProgressiveImage;
+        _allowsPreview = builder.allowsPreview;
+        _previewResource = builder.previewResource;
+        _previewBlurHash = [builder.previewBlurHash copy];
         _memoryCachePolicy = builder.memoryCachePolicy;
         _expirationAge = builder.expirationAge;
         _userInfo = builder.userInfo;
@@ -23,6 +26,40 @@
     return self;
 }
 
+/*! Returns the shared instance for the requests created without options, so that each request doesn't allocate a builder and the options. The instance is rebuilt when the default options are changed.
+ */
++ (nonnull DFImageRequestOptions *)_sharedDefaultOptions {
+    static DFImageRequestOptions *sharedOptions;
+    static NSLock *lock;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        lock = [NSLock new];
+    });
+    DFMutableImageRequestOptions *defaults = [DFMutableImageRequestOptions defaultOptions];
+    [lock lock];
+    if (!sharedOptions || ![sharedOptions _isEqualToDefaults:defaults]) {
+        sharedOptions = [DFImageRequestOptions new];
+    }
+    DFImageRequestOptions *options = sharedOptions;
+    [lock unlock];
+    return options;
+}
+
+/*! Compares all of the options, each of them is copied by DFMutableImageRequestOptions from the default options.
+ */
+- (BOOL)_isEqualToDefaults:(nonnull DFMutableImageRequestOptions *)defaults {
+    return (_priority == defaults.priority &&
+            _allowsNetworkAccess == defaults.allowsNetworkAccess &&
+            _allowsClipping == defaults.allowsClipping &&
+            _allowsProgressiveImage == defaults.allowsProgressiveImage &&
+            _allowsPreview == defaults.allowsPreview &&
+            (_previewResource == defaults.previewResource || [_previewResource isEqual:defaults.previewResource]) &&
+            (_previewBlurHash == defaults.previewBlurHash || [_previewBlurHash isEqualToString:defaults.previewBlurHash]) &&
+            _memoryCachePolicy == defaults.memoryCachePolicy &&
+            _expirationAge == defaults.expirationAge &&
+            (_userInfo == defaults.userInfo || [_userInfo isEqualToDictionary:defaults.userInfo]));
+}
+
 @end
 
 
@@ -50,6 +87,9 @@ static DFMutableImageRequestOptions *_defaultOptions;
             _allowsNetworkAccess = defaults.allowsNetworkAccess;
             _allowsClipping = defaults.allowsClipping;
             _allowsProgressiveImage = defaults.allowsProgressiveImage;
+            _allowsPreview = defaults.allowsPreview;
+            _previewResource = defaults.previewResource;
+            _previewBlurHash = [defaults.previewBlurHash copy];
             _memoryCachePolicy = defaults.memoryCachePolicy;
             _expirationAge = defaults.expirationAge;
             _userInfo = [defaults.userInfo copy];
@@ -58,6 +98,22 @@ static DFMutableImageRequestOptions *_defaultOptions;
     return self;
 }
 
+- (nonnull instancetype)initWithOptions:(nonnull DFImageRequestOptions *)options {
+    if (self = [self init]) {
+        _priority = options.priority;
+        _allowsNetworkAccess = options.allowsNetworkAccess;
+        _allowsClipping = options.allowsClipping;
+        _allowsProgressiveImage = options.allowsProgressiveImage;
+        _allowsPreview = options.allowsPreview;
+        _previewResource = options.previewResource;
+        _previewBlurHash = [options.previewBlurHash copy];
+        _memoryCachePolicy = options.memoryCachePolicy;
+        _expirationAge = options.expirationAge;
+        _userInfo = [options.userInfo copy];
+    }
+    return self;
+}
+
 - (DFImageRequestOptions * __nonnull)options {
     return [[DFImageRequestOptions alloc] initWithBuilder:self];
 }
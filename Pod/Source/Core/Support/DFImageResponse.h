@@ -13,12 +13,28 @@
  */
 @property (nonatomic, readonly) BOOL isFastResponse;
 
+/*! Returns YES if the response contains the expired image from the memory cache, which is being revalidated in background (see DFImageRequestCachePolicyReturnStaleWhileRevalidate).
+ */
+@property (nonatomic, readonly) BOOL isStale;
+
 /*! Returns the metadata associated with the load.
  */
 @property (nullable, nonatomic, readonly) NSDictionary *info;
 
+/*! Returns the number of bytes received from the network for the load, 0 if the data was found in one of the caches (see DFImageInfoFetchedByteCountKey).
+ */
+@property (nonatomic, readonly) int64_t fetchedByteCount;
+
 /*! Initializes response with a given parameters.
  */
 - (nonnull instancetype)initWithInfo:(nullable NSDictionary *)info isFastResponse:(BOOL)isFastResponse;
 
+/*! Initializes response with a given parameters.
+ */
+- (nonnull instancetype)initWithInfo:(nullable NSDictionary *)info isFastResponse:(BOOL)isFastResponse isStale:(BOOL)isStale;
+
+/*! Initializes response with a given parameters.
+ */
+- (nonnull instancetype)initWithInfo:(nullable NSDictionary *)info isFastResponse:(BOOL)isFastResponse isStale:(BOOL)isStale fetchedByteCount:(int64_t)fetchedByteCount;
+
 @end
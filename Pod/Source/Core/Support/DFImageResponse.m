@@ -7,9 +7,19 @@
 @implementation DFImageResponse
 
 - (nonnull instancetype)initWithInfo:(nullable NSDictionary *)info isFastResponse:(BOOL)isFastResponse {
+    return [self initWithInfo:info isFastResponse:isFastResponse isStale:NO];
+}
+
+- (nonnull instancetype)initWithInfo:(nullable NSDictionary *)info isFastResponse:(BOOL)isFastResponse isStale:(BOOL)isStale {
+    return [self initWithInfo:info isFastResponse:isFastResponse isStale:isStale fetchedByteCount:0];
+}
+
+- (nonnull instancetype)initWithInfo:(nullable NSDictionary *)info isFastResponse:(BOOL)isFastResponse isStale:(BOOL)isStale fetchedByteCount:(int64_t)fetchedByteCount {
     if (self = [super init]) {
         _info = info;
         _isFastResponse = isFastResponse;
+        _isStale = isStale;
+        _fetchedByteCount = fetchedByteCount;
     }
     return self;
 }
@@ -5,6 +5,7 @@
 #import "DFImageManagerDefines.h"
 #import <Foundation/Foundation.h>
 
+@class DFImageHeaderInfo;
 @class DFImageRequest;
 @class DFImageResponse;
 
@@ -37,6 +38,10 @@ typedef NS_ENUM(NSUInteger, DFImageTaskState) {
  */
 @property (nullable, atomic, readonly) DFImageResponse *response;
 
+/*! The time interval between resuming the task and delivering the first image to the client, which might be the preview, the progressive image or the final image. Zero if no images were delivered yet.
+ */
+@property (atomic, readonly) NSTimeInterval timeToFirstImage;
+
 /*! A progress object monitoring the task progress. Progress is created lazily.
  @note Progress object can be used to cancel image task.
  */
@@ -54,10 +59,18 @@ typedef NS_ENUM(NSUInteger, DFImageTaskState) {
  */
 @property (nullable, atomic, copy) void (^completionHandler)(UIImage *__nullable image, NSError *__nullable error, DFImageResponse *__nullable response, DFImageTask *__nonnull imageTask);
 
-/*! Progressive image handler which gets called on the main thread when partial image data is decoded.
+/*! Progressive image handler which gets called on the main thread when partial image data is decoded, or when the low-quality preview of the image is loaded (see allowsPreview property of DFImageRequestOptions).
  */
 @property (nullable, atomic, copy) void (^progressiveImageHandler)(UIImage *__nonnull image);
 
+/*! A block which is called on the main thread when the task has completed with a stale image (see isStale property of DFImageResponse) and the revalidation has loaded the image with a different content. The content is compared using the validators (see DFImageInfoValidatorKey), or the Last-Modified and Content-Length header fields (see DFImageInfoHTTPHeaderFieldsKey). Not called if the image hasn't changed or if the responses have nothing to compare.
+ */
+@property (nullable, atomic, copy) void (^revalidationHandler)(UIImage *__nonnull image, DFImageResponse *__nonnull response);
+
+/*! A block which is called on the main thread when the header of the image data is parsed (usually within the first few KB of the data), so that the dimensions of the image are known before it is downloaded and decoded. Only called for the images that are fetched.
+ */
+@property (nullable, atomic, copy) void (^headerInfoHandler)(DFImageHeaderInfo *__nonnull headerInfo);
+
 /*! Resumes the task.
  */
 - (nonnull DFImageTask *)resume;
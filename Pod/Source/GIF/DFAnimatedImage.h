@@ -2,19 +2,42 @@
 //
 // Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
 
+#import "DFAnimatedImageFrameBuffer.h"
 #import <UIKit/UIKit.h>
 #import <FLAnimatedImage/FLAnimatedImage.h>
 
 /*! The DFAnimatedImage subclasses UIImage and represents a poster image for the underlying animated image. It can be used anywhere where a regular `UIImage` can be used.
+ @note Frames are decoded lazily by the frame buffer, the poster image is the first frame. The memory cost of the image (df_memoryCost) includes the maximum size of the buffered frames.
  */
 @interface DFAnimatedImage : UIImage
 
-/* The animated image that the receiver was initialized with. An `FLAnimatedImage`'s job is to deliver frames in a highly performant way and works in conjunction with `FLAnimatedImageView`.
+/*! The frame buffer that decodes the frames of the animated image.
  */
-@property (nonnull, nonatomic, readonly) FLAnimatedImage *animatedImage;
+@property (nonnull, nonatomic, readonly) DFAnimatedImageFrameBuffer *frameBuffer;
+
+/* The animated image created with the same data. An `FLAnimatedImage`'s job is to deliver frames in a highly performant way and works in conjunction with `FLAnimatedImageView`.
+ @note The animated image is created lazily. It always decodes frames at original size, use frameBuffer when possible. Returns nil if the frames are not decoded using ImageIO (e.g. animated WebP).
+ */
+@property (nullable, nonatomic, readonly) FLAnimatedImage *animatedImage;
+
+/*! Creates the animated image with a given data. Frames are downsampled so that their width and height don't exceed the maximum pixel size, 0 means that the frames are decoded at original size.
+ */
++ (nullable instancetype)animatedImageWithData:(nonnull NSData *)data maxPixelSize:(CGFloat)maxPixelSize;
+
+/*! Creates the animated image with frames provided by a given frame source, e.g. an animated WebP image. Frames are downsampled so that their width and height don't exceed the maximum pixel size.
+ */
++ (nullable instancetype)animatedImageWithFrameSource:(nonnull id<DFAnimatedImageFrameSource>)frameSource maxPixelSize:(CGFloat)maxPixelSize;
+
+/*! Initializes the DFAnimatedImage with a frame buffer and poster image.
+ */
+- (nonnull instancetype)initWithFrameBuffer:(nonnull DFAnimatedImageFrameBuffer *)frameBuffer posterImage:(nonnull CGImageRef)posterImage posterImageScale:(CGFloat)posterImageScale posterImageOrientation:(UIImageOrientation)posterImageOrientation NS_DESIGNATED_INITIALIZER;
 
 /*! Initializes the DFAnimatedImage with an instance of FLAnimatedImage class and poster image.
  */
-- (nonnull instancetype)initWithAnimatedImage:(nonnull FLAnimatedImage *)animatedImage posterImage:(nonnull CGImageRef)posterImage posterImageScale:(CGFloat)posterImageScale posterImageOrientation:(UIImageOrientation)posterImageOrientation NS_DESIGNATED_INITIALIZER;
+- (nullable instancetype)initWithAnimatedImage:(nonnull FLAnimatedImage *)animatedImage posterImage:(nonnull CGImageRef)posterImage posterImageScale:(CGFloat)posterImageScale posterImageOrientation:(UIImageOrientation)posterImageOrientation;
+
+/*! Returns the animated image created with the same frame source with frames downsampled to a given maximum pixel size.
+ */
+- (nullable DFAnimatedImage *)animatedImageWithMaxPixelSize:(CGFloat)maxPixelSize;
 
 @end
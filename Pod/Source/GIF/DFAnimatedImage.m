@@ -3,14 +3,59 @@
 // Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
 
 #import "DFAnimatedImage.h"
+#import "UIImage+DFImageUtilities.h"
 
-@implementation DFAnimatedImage
+@implementation DFAnimatedImage {
+    FLAnimatedImage *_animatedImage;
+}
 
-- (instancetype)initWithAnimatedImage:(FLAnimatedImage *)animatedImage posterImage:(CGImageRef)posterImage posterImageScale:(CGFloat)posterImageScale posterImageOrientation:(UIImageOrientation)posterImageOrientation {
++ (nullable instancetype)animatedImageWithData:(nonnull NSData *)data maxPixelSize:(CGFloat)maxPixelSize {
+    DFImageIOFrameSource *frameSource = [[DFImageIOFrameSource alloc] initWithData:data];
+    return frameSource ? [self animatedImageWithFrameSource:frameSource maxPixelSize:maxPixelSize] : nil;
+}
+
++ (nullable instancetype)animatedImageWithFrameSource:(nonnull id<DFAnimatedImageFrameSource>)frameSource maxPixelSize:(CGFloat)maxPixelSize {
+    DFAnimatedImageFrameBuffer *frameBuffer = [[DFAnimatedImageFrameBuffer alloc] initWithFrameSource:frameSource maxPixelSize:maxPixelSize];
+    UIImage *posterImage = [frameBuffer decodeFrameAtIndex:0];
+    if (!posterImage.CGImage) {
+        return nil;
+    }
+    return [[DFAnimatedImage alloc] initWithFrameBuffer:frameBuffer posterImage:posterImage.CGImage posterImageScale:1.f posterImageOrientation:UIImageOrientationUp];
+}
+
+- (instancetype)initWithFrameBuffer:(DFAnimatedImageFrameBuffer *)frameBuffer posterImage:(CGImageRef)posterImage posterImageScale:(CGFloat)posterImageScale posterImageOrientation:(UIImageOrientation)posterImageOrientation {
     if (self = [super initWithCGImage:posterImage scale:posterImageScale orientation:posterImageOrientation]) {
+        _frameBuffer = frameBuffer;
+    }
+    return self;
+}
+
+- (instancetype)initWithAnimatedImage:(FLAnimatedImage *)animatedImage posterImage:(CGImageRef)posterImage posterImageScale:(CGFloat)posterImageScale posterImageOrientation:(UIImageOrientation)posterImageOrientation {
+    DFAnimatedImageFrameBuffer *frameBuffer = [[DFAnimatedImageFrameBuffer alloc] initWithData:animatedImage.data maxPixelSize:0];
+    if (!frameBuffer) {
+        return nil;
+    }
+    if (self = [self initWithFrameBuffer:frameBuffer posterImage:posterImage posterImageScale:posterImageScale posterImageOrientation:posterImageOrientation]) {
         _animatedImage = animatedImage;
     }
     return self;
 }
 
+- (FLAnimatedImage *)animatedImage {
+    @synchronized(self) {
+        if (!_animatedImage && [_frameBuffer.frameSource isKindOfClass:[DFImageIOFrameSource class]]) {
+            _animatedImage = [FLAnimatedImage animatedImageWithGIFData:_frameBuffer.data];
+        }
+        return _animatedImage;
+    }
+}
+
+- (nullable DFAnimatedImage *)animatedImageWithMaxPixelSize:(CGFloat)maxPixelSize {
+    return [DFAnimatedImage animatedImageWithFrameSource:_frameBuffer.frameSource maxPixelSize:maxPixelSize];
+}
+
+- (NSUInteger)df_memoryCost {
+    return [super df_memoryCost] + _frameBuffer.maximumBufferSize;
+}
+
 @end
@@ -5,6 +5,8 @@
 #import <UIKit/UIKit.h>
 #import "DFImageDecoding.h"
 
+/*! Decodes GIF data into DFAnimatedImage objects. Only the poster image is decoded, the rest of the frames are decoded lazily by the DFAnimatedImageFrameBuffer.
+ */
 @interface DFAnimatedImageDecoder : NSObject <DFImageDecoding>
 
 @end
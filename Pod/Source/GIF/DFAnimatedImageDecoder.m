@@ -8,19 +8,12 @@
 @implementation DFAnimatedImageDecoder
 
 - (UIImage *)imageWithData:(NSData *)data partial:(BOOL)partial {
-    if (![self _isGIFData:data]) {
+    // Partial GIF data doesn't contain all the frames, let other decoders display the poster image
+    if (partial || ![self _isGIFData:data]) {
         return nil;
     }
-    FLAnimatedImage *animatedImage = [FLAnimatedImage animatedImageWithGIFData:data];
-    if (!animatedImage) {
-        return nil;
-    }
-    UIImage *posterImage = animatedImage.posterImage;
-    CGImageRef posterImageRef = posterImage.CGImage;
-    if (!posterImageRef) {
-        return nil;
-    }
-    return [[DFAnimatedImage alloc] initWithAnimatedImage:animatedImage posterImage:posterImageRef posterImageScale:posterImage.scale posterImageOrientation:posterImage.imageOrientation];
+    // Only the poster image is decoded, the rest of the frames are decoded lazily
+    return [DFAnimatedImage animatedImageWithData:data maxPixelSize:0];
 }
 
 /*! See https://en.wikipedia.org/wiki/List_of_file_signatures
@@ -0,0 +1,83 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import "DFAnimatedImageFrameSource.h"
+#import <UIKit/UIKit.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*! The DFAnimatedImageFrameBuffer decodes frames of the animated image lazily from the compressed data using the frame source. Each frame is downsampled to the maximum pixel size during decoding.
+ @note The buffer keeps a small window of upcoming frames (a ring buffer) for each consumer (e.g. the view that displays the image), the union of the windows is limited by the bufferSizeLimit. Frames are decoded in background. Frames are shared by all the consumers that display the same animated image.
+ @note Thread safe.
+ */
+@interface DFAnimatedImageFrameBuffer : NSObject
+
+/*! The frame source that the frame buffer was initialized with.
+ */
+@property (nonatomic, readonly) id<DFAnimatedImageFrameSource> frameSource;
+
+/*! The compressed image data.
+ */
+@property (nonatomic, readonly) NSData *data;
+
+/*! The maximum width or height of the decoded frames in pixels. 0 means that the frames are decoded at original size.
+ */
+@property (nonatomic, readonly) CGFloat maxPixelSize;
+
+/*! The number of frames in the image.
+ */
+@property (nonatomic, readonly) NSUInteger frameCount;
+
+/*! The number of times to repeat the animation, 0 means that the animation is repeated forever.
+ */
+@property (nonatomic, readonly) NSUInteger loopCount;
+
+/*! The maximum size of the buffered frames in bytes. Default value is 4 Mb. At least one frame is always buffered.
+ */
+@property (nonatomic) NSUInteger bufferSizeLimit;
+
+/*! Returns the maximum amount of memory in bytes that the buffered frames might occupy.
+ */
+@property (nonatomic, readonly) NSUInteger maximumBufferSize;
+
+/*! Initializes the frame buffer with the frame source and the maximum pixel size of the frames. Returns nil if the frame source doesn't have any frames.
+ */
+- (nullable instancetype)initWithFrameSource:(id<DFAnimatedImageFrameSource>)frameSource maxPixelSize:(CGFloat)maxPixelSize NS_DESIGNATED_INITIALIZER;
+
+/*! Initializes the frame buffer with the image data that is decoded using ImageIO and the maximum pixel size of the frames. Returns nil if the data doesn't contain an animated image.
+ */
+- (nullable instancetype)initWithData:(NSData *)data maxPixelSize:(CGFloat)maxPixelSize;
+
+/*! Unavailable initializer, please use designated initializer.
+ */
+- (nullable instancetype)init NS_UNAVAILABLE;
+
+/*! Returns the duration of the frame at a given index.
+ */
+- (NSTimeInterval)durationAtIndex:(NSUInteger)index;
+
+/*! Returns the frame at a given index if it is already decoded, otherwise returns nil. Moves the buffer window of the given consumer so that it starts with the given index and schedules decoding of the frames in the window.
+ @note The buffer doesn't retain the consumer, the window is removed when the consumer is deallocated.
+ */
+- (nullable UIImage *)frameAtIndex:(NSUInteger)index consumer:(id)consumer;
+
+/*! Returns the frame at a given index using the buffer itself as a consumer (see frameAtIndex:consumer:).
+ */
+- (nullable UIImage *)frameAtIndex:(NSUInteger)index;
+
+/*! Removes the buffer window of the given consumer, the frames that are no longer in any window are removed.
+ */
+- (void)removeConsumer:(id)consumer;
+
+/*! Decodes the frame at a given index synchronously, doesn't buffer the frame.
+ */
+- (nullable UIImage *)decodeFrameAtIndex:(NSUInteger)index;
+
+/*! Removes all buffered frames.
+ */
+- (void)purgeFrames;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,209 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import "DFAnimatedImageFrameBuffer.h"
+#import "DFImageManagerDefines.h"
+
+@implementation DFAnimatedImageFrameBuffer {
+    NSUInteger _frameSize;
+    NSMutableDictionary /* NSNumber : UIImage */ *_frames;
+    NSMutableIndexSet *_failedIndexes;
+    NSMapTable /* consumer : NSNumber */ *_windows; // Start index of the window of each consumer
+    BOOL _decoding;
+    dispatch_queue_t _queue;
+    NSLock *_lock;
+}
+
+DF_INIT_UNAVAILABLE_IMPL
+
+- (void)dealloc {
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+}
+
+- (nullable instancetype)initWithData:(NSData *)data maxPixelSize:(CGFloat)maxPixelSize {
+    DFImageIOFrameSource *frameSource = [[DFImageIOFrameSource alloc] initWithData:data];
+    if (!frameSource) {
+        return nil;
+    }
+    return [self initWithFrameSource:frameSource maxPixelSize:maxPixelSize];
+}
+
+- (nullable instancetype)initWithFrameSource:(id<DFAnimatedImageFrameSource>)frameSource maxPixelSize:(CGFloat)maxPixelSize {
+    if (self = [super init]) {
+        _frameSource = frameSource;
+        _maxPixelSize = maxPixelSize;
+        _frameCount = frameSource.frameCount;
+        if (_frameCount < 1) {
+            return nil;
+        }
+        _bufferSizeLimit = 1024 * 1024 * 4;
+        _frames = [NSMutableDictionary new];
+        _failedIndexes = [NSMutableIndexSet new];
+        _windows = [NSMapTable weakToStrongObjectsMapTable];
+        _queue = dispatch_queue_create("DFAnimatedImageFrameBuffer::queue", DISPATCH_QUEUE_SERIAL);
+        _lock = [NSLock new];
+#if TARGET_OS_IOS && !TARGET_OS_WATCH
+        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(purgeFrames) name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
+#endif
+    }
+    return self;
+}
+
+- (NSData *)data {
+    return _frameSource.data;
+}
+
+- (NSUInteger)loopCount {
+    return _frameSource.loopCount;
+}
+
+- (NSTimeInterval)durationAtIndex:(NSUInteger)index {
+    return [_frameSource durationAtIndex:index];
+}
+
+- (NSUInteger)maximumBufferSize {
+    [_lock lock];
+    NSUInteger maximumBufferSize = _frameSize * [self _bufferCapacity];
+    [_lock unlock];
+    return maximumBufferSize;
+}
+
+#pragma mark Frames
+
+- (nullable UIImage *)decodeFrameAtIndex:(NSUInteger)index {
+    if (index >= _frameCount) {
+        return nil;
+    }
+    UIImage *frame = [_frameSource frameAtIndex:index maxPixelSize:_maxPixelSize];
+    if (!frame.CGImage) {
+        return nil;
+    }
+    [_lock lock];
+    if (!_frameSize) {
+        _frameSize = CGImageGetBytesPerRow(frame.CGImage) * CGImageGetHeight(frame.CGImage);
+    }
+    [_lock unlock];
+    return frame;
+}
+
+- (nullable UIImage *)frameAtIndex:(NSUInteger)index {
+    return [self frameAtIndex:index consumer:self];
+}
+
+- (nullable UIImage *)frameAtIndex:(NSUInteger)index consumer:(id)consumer {
+    if (index >= _frameCount || !consumer) {
+        return nil;
+    }
+    [_lock lock];
+    UIImage *frame = _frames[@(index)];
+    [_windows setObject:@(index) forKey:consumer];
+    [self _removeFramesOutsideOfWindows];
+    if (!_decoding && [self _nextMissingIndex] != NSNotFound) {
+        _decoding = YES;
+        dispatch_async(_queue, ^{
+            [self _decodeFrames];
+        });
+    }
+    [_lock unlock];
+    return frame;
+}
+
+- (void)removeConsumer:(id)consumer {
+    if (!consumer) {
+        return;
+    }
+    [_lock lock];
+    [_windows removeObjectForKey:consumer];
+    [self _removeFramesOutsideOfWindows];
+    [_lock unlock];
+}
+
+- (void)purgeFrames {
+    [_lock lock];
+    [_frames removeAllObjects];
+    [_lock unlock];
+}
+
+/*! Decodes missing frames in the buffer window one by one until the window is filled.
+ */
+- (void)_decodeFrames {
+    while (YES) {
+        [_lock lock];
+        NSUInteger index = [self _nextMissingIndex];
+        if (index == NSNotFound) {
+            _decoding = NO;
+            [_lock unlock];
+            return;
+        }
+        [_lock unlock];
+        UIImage *frame = [self decodeFrameAtIndex:index];
+        [_lock lock];
+        if (!frame) {
+            [_failedIndexes addIndex:index];
+        } else if ([self _isIndexInWindow:index]) {
+            _frames[@(index)] = frame;
+        }
+        [_lock unlock];
+    }
+}
+
+- (NSUInteger)_bufferCapacity {
+    if (!_frameSize) {
+        return 1;
+    }
+    return MAX(1, MIN(_frameCount, _bufferSizeLimit / _frameSize));
+}
+
+/*! Returns the start indexes of the windows of the consumers that are still alive.
+ */
+- (NSArray<NSNumber *> *)_windowStarts {
+    NSMutableArray *starts = [NSMutableArray new];
+    for (id consumer in _windows) {
+        [starts addObject:[_windows objectForKey:consumer]];
+    }
+    return starts;
+}
+
+/*! The buffer capacity is split between the windows, so that the union of the windows fits the bufferSizeLimit. Each window has at least one frame.
+ */
+- (NSUInteger)_windowCapacityForWindowCount:(NSUInteger)windowCount {
+    return MAX(1, [self _bufferCapacity] / MAX(1, windowCount));
+}
+
+- (BOOL)_isIndexInWindow:(NSUInteger)index {
+    NSArray *starts = [self _windowStarts];
+    NSUInteger capacity = [self _windowCapacityForWindowCount:starts.count];
+    for (NSNumber *start in starts) {
+        if ((index + _frameCount - start.unsignedIntegerValue) % _frameCount < capacity) {
+            return YES;
+        }
+    }
+    return NO;
+}
+
+- (void)_removeFramesOutsideOfWindows {
+    for (NSNumber *bufferedIndex in [_frames allKeys]) {
+        if (![self _isIndexInWindow:bufferedIndex.unsignedIntegerValue]) {
+            [_frames removeObjectForKey:bufferedIndex];
+        }
+    }
+}
+
+/*! Returns the next missing frame, the frames closest to the start of each window go first.
+ */
+- (NSUInteger)_nextMissingIndex {
+    NSArray *starts = [self _windowStarts];
+    NSUInteger capacity = [self _windowCapacityForWindowCount:starts.count];
+    for (NSUInteger offset = 0; offset < capacity; offset++) {
+        for (NSNumber *start in starts) {
+            NSUInteger index = (start.unsignedIntegerValue + offset) % _frameCount;
+            if (!_frames[@(index)] && ![_failedIndexes containsIndex:index]) {
+                return index;
+            }
+        }
+    }
+    return NSNotFound;
+}
+
+@end
@@ -0,0 +1,51 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import <UIKit/UIKit.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*! Provides the frames of the animated image to the DFAnimatedImageFrameBuffer.
+ @note The frame source might be shared by multiple frame buffers and must be thread safe.
+ */
+@protocol DFAnimatedImageFrameSource <NSObject>
+
+/*! The compressed image data.
+ */
+@property (nonatomic, readonly) NSData *data;
+
+/*! The number of frames in the image.
+ */
+@property (nonatomic, readonly) NSUInteger frameCount;
+
+/*! The number of times to repeat the animation, 0 means that the animation is repeated forever.
+ */
+@property (nonatomic, readonly) NSUInteger loopCount;
+
+/*! Returns the duration of the frame at a given index.
+ */
+- (NSTimeInterval)durationAtIndex:(NSUInteger)index;
+
+/*! Returns the decoded frame at a given index downsampled so that its width and height don't exceed the maximum pixel size, 0 means that the frame is decoded at original size. The returned image must be ready to be displayed without any additional conversion.
+ */
+- (nullable UIImage *)frameAtIndex:(NSUInteger)index maxPixelSize:(CGFloat)maxPixelSize;
+
+@end
+
+
+/*! The frame source that decodes frames using ImageIO (GIF, APNG).
+ */
+@interface DFImageIOFrameSource : NSObject <DFAnimatedImageFrameSource>
+
+/*! Initializes the frame source with the image data. Returns nil if the data can't be decoded by ImageIO.
+ */
+- (nullable instancetype)initWithData:(NSData *)data NS_DESIGNATED_INITIALIZER;
+
+/*! Unavailable initializer, please use designated initializer.
+ */
+- (nullable instancetype)init NS_UNAVAILABLE;
+
+@end
+
+NS_ASSUME_NONNULL_END
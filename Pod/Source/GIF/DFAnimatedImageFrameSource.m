@@ -0,0 +1,88 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
+
+#import "DFAnimatedImageFrameSource.h"
+#import "DFImageManagerDefines.h"
+#import "UIImage+DFImageUtilities.h"
+#import <ImageIO/ImageIO.h>
+
+static const NSTimeInterval _kDFAnimatedImageMinimumFrameDuration = 0.02;
+static const NSTimeInterval _kDFAnimatedImageDefaultFrameDuration = 0.1;
+
+@implementation DFImageIOFrameSource {
+    CGImageSourceRef _source;
+    NSArray<NSNumber *> *_durations;
+}
+
+@synthesize data = _data;
+@synthesize frameCount = _frameCount;
+@synthesize loopCount = _loopCount;
+
+DF_INIT_UNAVAILABLE_IMPL
+
+- (void)dealloc {
+    if (_source) {
+        CFRelease(_source);
+    }
+}
+
+- (nullable instancetype)initWithData:(NSData *)data {
+    if (self = [super init]) {
+        _data = data;
+        _source = CGImageSourceCreateWithData((__bridge CFDataRef)data, NULL);
+        if (!_source) {
+            return nil;
+        }
+        _frameCount = CGImageSourceGetCount(_source);
+        if (_frameCount < 1) {
+            return nil;
+        }
+        _loopCount = [self _loopCount];
+        _durations = [self _durations];
+    }
+    return self;
+}
+
+- (NSUInteger)_loopCount {
+    NSDictionary *properties = CFBridgingRelease(CGImageSourceCopyProperties(_source, NULL));
+    return [properties[(id)kCGImagePropertyGIFDictionary][(id)kCGImagePropertyGIFLoopCount] unsignedIntegerValue];
+}
+
+- (NSArray *)_durations {
+    NSMutableArray *durations = [NSMutableArray arrayWithCapacity:_frameCount];
+    for (NSUInteger i = 0; i < _frameCount; i++) {
+        NSDictionary *properties = CFBridgingRelease(CGImageSourceCopyPropertiesAtIndex(_source, i, NULL));
+        NSDictionary *GIFProperties = properties[(id)kCGImagePropertyGIFDictionary];
+        NSNumber *duration = GIFProperties[(id)kCGImagePropertyGIFUnclampedDelayTime] ?: GIFProperties[(id)kCGImagePropertyGIFDelayTime];
+        // Follow the browsers which treat very short durations as a default one
+        [durations addObject:@(duration.doubleValue < _kDFAnimatedImageMinimumFrameDuration ? _kDFAnimatedImageDefaultFrameDuration : duration.doubleValue)];
+    }
+    return durations;
+}
+
+- (NSTimeInterval)durationAtIndex:(NSUInteger)index {
+    return index < _durations.count ? _durations[index].doubleValue : _kDFAnimatedImageDefaultFrameDuration;
+}
+
+- (nullable UIImage *)frameAtIndex:(NSUInteger)index maxPixelSize:(CGFloat)maxPixelSize {
+    if (index >= _frameCount) {
+        return nil;
+    }
+    CGImageRef imageRef;
+    if (maxPixelSize > 0) {
+        NSDictionary *options = @{ (id)kCGImageSourceCreateThumbnailFromImageAlways : @YES,
+                                   (id)kCGImageSourceThumbnailMaxPixelSize : @(maxPixelSize) };
+        imageRef = CGImageSourceCreateThumbnailAtIndex(_source, index, (__bridge CFDictionaryRef)options);
+    } else {
+        imageRef = CGImageSourceCreateImageAtIndex(_source, index, NULL);
+    }
+    if (!imageRef) {
+        return nil;
+    }
+    UIImage *frame = [UIImage df_decompressedImage:[UIImage imageWithCGImage:imageRef] scale:1.f];
+    CGImageRelease(imageRef);
+    return frame;
+}
+
+@end
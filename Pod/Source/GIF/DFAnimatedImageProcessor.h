@@ -5,7 +5,7 @@
 #import <Foundation/Foundation.h>
 #import "DFImageProcessing.h"
 
-/*! Prevents processing of animated images.
+/*! Prevents regular processing of animated images. Instead, animated images are downsampled to the target size of the request: frames of the processed image are decoded lazily at the required size.
  */
 @interface DFAnimatedImageProcessor : NSObject <DFImageProcessing>
 
@@ -5,6 +5,8 @@
 #import "DFAnimatedImage.h"
 #import "DFAnimatedImageProcessor.h"
 #import "DFImageManagerDefines.h"
+#import "DFImageRequest.h"
+#import "UIImage+DFImageUtilities.h"
 
 @implementation DFAnimatedImageProcessor {
     id<DFImageProcessing> _processor;
@@ -25,7 +27,7 @@ DF_INIT_UNAVAILABLE_IMPL
 
 - (BOOL)shouldProcessImage:(UIImage *)image forRequest:(DFImageRequest *)request partial:(BOOL)partial {
     if ([image isKindOfClass:[DFAnimatedImage class]]) {
-        return NO;
+        return !partial && [DFAnimatedImageProcessor _maxPixelSizeForImage:image request:request] > 0;
     }
     if ([_processor respondsToSelector:@selector(shouldProcessImage:forRequest:partial:)]) {
         return [_processor shouldProcessImage:image forRequest:request partial:partial];
@@ -34,7 +36,24 @@ DF_INIT_UNAVAILABLE_IMPL
 }
 
 - (UIImage *)processedImage:(UIImage *)image forRequest:(DFImageRequest *)request partial:(BOOL)partial {
+    if ([image isKindOfClass:[DFAnimatedImage class]]) {
+        CGFloat maxPixelSize = [DFAnimatedImageProcessor _maxPixelSizeForImage:image request:request];
+        return maxPixelSize > 0 ? ([(DFAnimatedImage *)image animatedImageWithMaxPixelSize:maxPixelSize] ?: image) : image;
+    }
     return [_processor processedImage:image forRequest:request partial:partial];
 }
 
+/*! Returns the maximum pixel size of the frames required to display the image with a given request, or 0 if the image doesn't need to be downsampled.
+ */
++ (CGFloat)_maxPixelSizeForImage:(nonnull UIImage *)image request:(nonnull DFImageRequest *)request {
+    if (CGSizeEqualToSize(request.targetSize, DFImageMaximumSize)) {
+        return 0;
+    }
+    CGFloat scale = [UIImage df_scaleForImage:image targetSize:request.targetSize contentMode:request.contentMode];
+    if (scale >= 1.f) {
+        return 0;
+    }
+    return (CGFloat)ceil(MAX(CGImageGetWidth(image.CGImage), CGImageGetHeight(image.CGImage)) * scale);
+}
+
 @end
@@ -5,14 +5,14 @@
 #import "DFImageView.h"
 #import <FLAnimatedImage/FLAnimatedImage.h>
 
-/*! The DFAnimatedImageView uses FLAnimatedImageView to enable animated GIF playback. 
+/*! The DFAnimatedImageView enables animated GIF playback. Frames are provided by the DFAnimatedImageFrameBuffer of the DFAnimatedImage, which decodes them lazily at the size required by the request. Image views that display the same image share the decoded frames.
  @note The playback is enabled by default and can be disabled using allowsGIFPlayback property.
  */
 @interface DFAnimatedImageView : DFImageView
 
-/*! Inner animated image view used for GIF playback.
+/*! Animated image view that was previously used for GIF playback. It's no longer part of the view hierarchy.
  */
-@property (nonnull, nonatomic, readonly) FLAnimatedImageView *animatedImageView;
+@property (nonnull, nonatomic, readonly) FLAnimatedImageView *animatedImageView DEPRECATED_MSG_ATTRIBUTE("DFAnimatedImageView uses DFAnimatedImageFrameBuffer for GIF playback");
 
 /*! If the value is YES the receiver will start a GIF playback as soon as the image is displayed. Default value is YES.
  */
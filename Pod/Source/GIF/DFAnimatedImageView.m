@@ -7,45 +7,77 @@
 #import "DFImageResponse.h"
 #import "DFImageTask.h"
 
-@implementation DFAnimatedImageView
+/*! Breaks the retain cycle between CADisplayLink and its target.
+ */
+@interface _DFDisplayLinkTarget : NSObject
+
+@property (nullable, nonatomic, weak) DFAnimatedImageView *view;
+
+@end
+
+@interface DFAnimatedImageView (_DFDisplayLinkTarget)
+
+- (void)_displayDidRefresh:(nonnull CADisplayLink *)displayLink;
+
+@end
+
+@implementation _DFDisplayLinkTarget
+
+- (void)displayDidRefresh:(CADisplayLink *)displayLink {
+    [self.view _displayDidRefresh:displayLink];
+}
+
+@end
+
+
+@implementation DFAnimatedImageView {
+    DFAnimatedImage *_playingImage;
+    UIImage *_currentFrame;
+    NSUInteger _currentFrameIndex;
+    NSUInteger _loopCount;
+    NSTimeInterval _accumulator;
+    CADisplayLink *_displayLink;
+    FLAnimatedImageView *_animatedImageView;
+}
+
+- (void)dealloc {
+    [_displayLink invalidate];
+}
 
 - (instancetype)initWithFrame:(CGRect)frame {
     if (self = [super initWithFrame:frame]) {
-        [self _createUI];
+        _allowsGIFPlayback = YES;
     }
     return self;
 }
 
 - (instancetype)initWithCoder:(NSCoder *)decoder {
     if (self = [super initWithCoder:decoder]) {
-        [self _createUI];
+        _allowsGIFPlayback = YES;
     }
     return self;
 }
 
-- (void)_createUI {
-    _allowsGIFPlayback = YES;
-    _animatedImageView = [[FLAnimatedImageView alloc] initWithFrame:self.bounds];
-    _animatedImageView.autoresizingMask = UIViewAutoresizingFlexibleWidth | UIViewAutoresizingFlexibleHeight;
-    [self addSubview:_animatedImageView];
+- (FLAnimatedImageView *)animatedImageView {
+    if (!_animatedImageView) {
+        _animatedImageView = [FLAnimatedImageView new];
+    }
+    return _animatedImageView;
 }
 
 - (void)displayImage:(nullable UIImage *)image {
-    if (!image) {
-        self.image = nil;
-        self.animatedImageView.animatedImage = nil;
-        return;
-    }
-    if (self.allowsGIFPlayback && [image isKindOfClass:[DFAnimatedImage class]]) {
-        self.animatedImageView.animatedImage = ((DFAnimatedImage *)image).animatedImage;
-    } else {
-        self.image = image;
+    [self _stopPlayback];
+    self.image = image;
+    if (self.allowsGIFPlayback && [image isKindOfClass:[DFAnimatedImage class]] && ((DFAnimatedImage *)image).frameBuffer.frameCount > 1) {
+        _playingImage = (DFAnimatedImage *)image;
+        [_playingImage.frameBuffer frameAtIndex:1 consumer:self]; // Start decoding upcoming frames
+        [self _updatePlayback];
     }
 }
 
 - (void)prepareForReuse {
     [super prepareForReuse];
-    self.animatedImageView.animatedImage = nil;
+    [self _stopPlayback];
 }
 
 - (void)didCompleteImageTask:(DFImageTask *)task withImage:(UIImage *)image {
@@ -56,7 +88,7 @@
             animation.keyPath = @"opacity";
             animation.fromValue = @0.f;
             animation.toValue = @1.f;
-            animation.duration = 0.25f;
+            animation.duration = self.fadeDuration;
             animation;
         }) forKey:@"opacity"];
     } else {
@@ -64,4 +96,74 @@
     }
 }
 
+#pragma mark Playback
+
+- (void)didMoveToWindow {
+    [super didMoveToWindow];
+    [self _updatePlayback];
+}
+
+- (void)setHidden:(BOOL)hidden {
+    [super setHidden:hidden];
+    [self _updatePlayback];
+}
+
+- (void)_updatePlayback {
+    BOOL shouldPlay = _playingImage && self.window && !self.hidden;
+    if (shouldPlay && !_displayLink) {
+        _DFDisplayLinkTarget *target = [_DFDisplayLinkTarget new];
+        target.view = self;
+        _displayLink = [CADisplayLink displayLinkWithTarget:target selector:@selector(displayDidRefresh:)];
+        [_displayLink addToRunLoop:[NSRunLoop mainRunLoop] forMode:NSRunLoopCommonModes];
+    }
+    _displayLink.paused = !shouldPlay;
+}
+
+- (void)_stopPlayback {
+    [_playingImage.frameBuffer removeConsumer:self];
+    [_displayLink invalidate];
+    _displayLink = nil;
+    _playingImage = nil;
+    _currentFrame = nil;
+    _currentFrameIndex = 0;
+    _loopCount = 0;
+    _accumulator = 0;
+}
+
+- (void)_displayDidRefresh:(nonnull CADisplayLink *)displayLink {
+    DFAnimatedImageFrameBuffer *frameBuffer = _playingImage.frameBuffer;
+    if (!frameBuffer) {
+        return;
+    }
+    NSTimeInterval duration = [frameBuffer durationAtIndex:_currentFrameIndex];
+    // Don't skip frames when the next frame isn't decoded in time
+    _accumulator = MIN(_accumulator + displayLink.duration, duration);
+    if (_accumulator < duration) {
+        return;
+    }
+    NSUInteger nextFrameIndex = (_currentFrameIndex + 1) % frameBuffer.frameCount;
+    UIImage *nextFrame = [frameBuffer frameAtIndex:nextFrameIndex consumer:self];
+    if (!nextFrame) {
+        return;
+    }
+    _accumulator -= duration;
+    _currentFrameIndex = nextFrameIndex;
+    _currentFrame = nextFrame;
+    [self.layer setNeedsDisplay];
+    if (nextFrameIndex == frameBuffer.frameCount - 1 && frameBuffer.loopCount > 0 && ++_loopCount >= frameBuffer.loopCount) {
+        [frameBuffer removeConsumer:self];
+        [_displayLink invalidate];
+        _displayLink = nil;
+        _playingImage = nil;
+    }
+}
+
+- (void)displayLayer:(CALayer *)layer {
+    if (_currentFrame) {
+        layer.contents = (__bridge id)_currentFrame.CGImage;
+    } else if ([UIImageView instancesRespondToSelector:@selector(displayLayer:)]) {
+        [super displayLayer:layer];
+    }
+}
+
 @end
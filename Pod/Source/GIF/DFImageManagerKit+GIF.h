@@ -4,5 +4,7 @@
 
 #import "DFAnimatedImage.h"
 #import "DFAnimatedImageDecoder.h"
+#import "DFAnimatedImageFrameBuffer.h"
+#import "DFAnimatedImageFrameSource.h"
 #import "DFAnimatedImageProcessor.h"
 #import "DFAnimatedImageView.h"
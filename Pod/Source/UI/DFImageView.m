@@ -2,6 +2,7 @@
 //
 // Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
 
+#import "DFImageCache.h"
 #import "DFImageManager.h"
 #import "DFImageManagerDefines.h"
 #import "DFImageManaging.h"
@@ -16,6 +17,7 @@
 
 - (void)dealloc {
     [self _cancelFetching];
+    [DFImageCache endDisplayingImage:self.image];
 }
 
 - (nonnull instancetype)initWithFrame:(CGRect)frame {
@@ -46,9 +48,19 @@
     [self.layer removeAllAnimations];
 }
 
+- (void)setImage:(nullable UIImage *)image {
+    UIImage *previousImage = self.image;
+    [super setImage:image];
+    if (previousImage != image) {
+        [DFImageCache endDisplayingImage:previousImage];
+        [DFImageCache beginDisplayingImage:image];
+    }
+}
+
 - (void)_cancelFetching {
     _imageTask.completionHandler = nil;
     _imageTask.progressiveImageHandler = nil;
+    _imageTask.revalidationHandler = nil;
     [_imageTask cancel];
     _imageTask = nil;
 }
@@ -73,6 +85,9 @@
     task.progressiveImageHandler = ^(UIImage *__nonnull image){
         weakSelf.image = image;
     };
+    task.revalidationHandler = ^(UIImage *__nonnull image, DFImageResponse *__nonnull response){
+        weakSelf.image = image;
+    };
     _imageTask = task;
     [task resume];
 }
@@ -2,22 +2,339 @@
 //
 // Copyright (c) 2015 Alexander Grebenyuk (github.com/kean).
 
+#import "DFImageCancellationToken.h"
 #import "DFWebPImageDecoder.h"
 #import <libwebp/webp/decode.h>
+#import <libwebp/webp/demux.h>
 
-@implementation DFWebPImageDecoder
+#if DF_SUBSPEC_GIF_ENABLED
+#import "DFImageManagerKit+GIF.h"
+#endif
+
+/*! Rows of the decoded images are aligned the same way Core Animation aligns its own backing stores, so that the images can be displayed without copying.
+ */
+static const size_t _kDFWebPBytesPerRowAlignment = 64;
+
+/*! The still image is decoded in chunks of the data of this size when the decoding can be cancelled.
+ */
+static const size_t _kDFWebPCancellableChunkSize = 64 * 1024;
+
+static const NSTimeInterval _kDFWebPMinimumFrameDuration = 0.02;
+static const NSTimeInterval _kDFWebPDefaultFrameDuration = 0.1;
 
-static void FreeImageData(void *info, const void *data, size_t size) {
+static inline size_t _DFWebPBytesPerRow(size_t width) {
+    return (width * 4 + _kDFWebPBytesPerRowAlignment - 1) / _kDFWebPBytesPerRowAlignment * _kDFWebPBytesPerRowAlignment;
+}
+
+static void _DFWebPFreeImageData(void *info, const void *data, size_t size) {
     free((void *)data);
 }
 
-- (UIImage *)imageWithData:(NSData *)data partial:(BOOL)partial {
-    if (partial) {
+/*! Creates an image from the buffer with 32-bit BGRA pixels (native little-endian ARGB). The image takes the ownership of the buffer.
+ */
+static UIImage *_DFWebPCreateImage(uint8_t *buffer, size_t width, size_t height, size_t bytesPerRow, BOOL opaque) {
+    CGDataProviderRef providerRef = CGDataProviderCreateWithData(NULL, buffer, bytesPerRow * height, _DFWebPFreeImageData);
+    if (!providerRef) {
+        free(buffer);
+        return nil;
+    }
+    CGColorSpaceRef colorSpaceRef = CGColorSpaceCreateDeviceRGB();
+    CGBitmapInfo bitmapInfo = kCGBitmapByteOrder32Little | (opaque ? kCGImageAlphaNoneSkipFirst : kCGImageAlphaPremultipliedFirst);
+    CGImageRef imageRef = CGImageCreate(width, height, 8, 32, bytesPerRow, colorSpaceRef, bitmapInfo, providerRef, NULL, NO, kCGRenderingIntentDefault);
+    if (colorSpaceRef) {
+        CGColorSpaceRelease(colorSpaceRef);
+    }
+    CGDataProviderRelease(providerRef);
+    if (!imageRef) {
+        return nil;
+    }
+    UIImage *image = [[UIImage alloc] initWithCGImage:imageRef];
+    CGImageRelease(imageRef);
+    return image;
+}
+
+/*! Configures the decoder to write premultiplied BGRA pixels into the zeroed buffer with aligned rows. The buffer is owned by the caller.
+ */
+static BOOL _DFWebPConfigureOutput(WebPDecoderConfig *config) {
+    size_t width = (size_t)config->input.width;
+    size_t height = (size_t)config->input.height;
+    size_t bytesPerRow = _DFWebPBytesPerRow(width);
+    uint8_t *buffer = calloc(bytesPerRow * height, 1);
+    if (!buffer) {
+        return NO;
+    }
+    config->output.colorspace = config->input.has_alpha ? MODE_bgrA : MODE_BGRA;
+    config->output.is_external_memory = 1;
+    config->output.u.RGBA.rgba = buffer;
+    config->output.u.RGBA.stride = (int)bytesPerRow;
+    config->output.u.RGBA.size = bytesPerRow * height;
+    return YES;
+}
+
+/*! Creates an image from the canvas of the animation decoder (premultiplied BGRA, tightly packed rows) downsampled to the maximum pixel size.
+ */
+static UIImage *_DFWebPCreateImageWithCanvas(const uint8_t *canvas, size_t canvasWidth, size_t canvasHeight, CGFloat maxPixelSize) {
+    CGFloat scale = 1.f;
+    if (maxPixelSize > 0 && MAX(canvasWidth, canvasHeight) > maxPixelSize) {
+        scale = maxPixelSize / MAX(canvasWidth, canvasHeight);
+    }
+    size_t width = MAX(1, (size_t)round(canvasWidth * scale));
+    size_t height = MAX(1, (size_t)round(canvasHeight * scale));
+    size_t bytesPerRow = _DFWebPBytesPerRow(width);
+    uint8_t *buffer = calloc(bytesPerRow * height, 1);
+    if (!buffer) {
+        return nil;
+    }
+    if (width == canvasWidth && height == canvasHeight) {
+        for (size_t row = 0; row < height; row++) {
+            memcpy(buffer + row * bytesPerRow, canvas + row * canvasWidth * 4, canvasWidth * 4);
+        }
+    } else {
+        CGColorSpaceRef colorSpaceRef = CGColorSpaceCreateDeviceRGB();
+        CGBitmapInfo bitmapInfo = kCGBitmapByteOrder32Little | kCGImageAlphaPremultipliedFirst;
+        CGDataProviderRef providerRef = CGDataProviderCreateWithData(NULL, canvas, canvasWidth * 4 * canvasHeight, NULL);
+        CGImageRef canvasRef = CGImageCreate(canvasWidth, canvasHeight, 8, 32, canvasWidth * 4, colorSpaceRef, bitmapInfo, providerRef, NULL, NO, kCGRenderingIntentDefault);
+        CGContextRef contextRef = CGBitmapContextCreate(buffer, width, height, 8, bytesPerRow, colorSpaceRef, bitmapInfo);
+        if (contextRef && canvasRef) {
+            CGContextSetInterpolationQuality(contextRef, kCGInterpolationHigh);
+            CGContextDrawImage(contextRef, CGRectMake(0, 0, width, height), canvasRef);
+        }
+        if (contextRef) {
+            CGContextRelease(contextRef);
+        }
+        if (canvasRef) {
+            CGImageRelease(canvasRef);
+        }
+        if (providerRef) {
+            CGDataProviderRelease(providerRef);
+        }
+        if (colorSpaceRef) {
+            CGColorSpaceRelease(colorSpaceRef);
+        }
+    }
+    return _DFWebPCreateImage(buffer, width, height, bytesPerRow, NO);
+}
+
+/*! Decodes the whole data with WebPIDecoder chunk by chunk, checks the token between the chunks. The output buffer stays owned by the caller.
+ */
+static VP8StatusCode _DFWebPDecodeCancellable(NSData *data, WebPDecoderConfig *config, DFImageCancellationToken *token) {
+    WebPIDecoder *decoder = WebPIDecode(NULL, 0, config);
+    if (!decoder) {
+        return VP8_STATUS_OUT_OF_MEMORY;
+    }
+    VP8StatusCode status = VP8_STATUS_SUSPENDED;
+    size_t length = 0;
+    while (status == VP8_STATUS_SUSPENDED && length < data.length) {
+        if (token.isCancelled) {
+            break;
+        }
+        length = MIN(length + _kDFWebPCancellableChunkSize, data.length);
+        status = WebPIUpdate(decoder, data.bytes, length);
+    }
+    WebPIDelete(decoder);
+    return status;
+}
+
+static WebPAnimDecoder *_DFWebPCreateAnimationDecoder(NSData *data) {
+    WebPAnimDecoderOptions options;
+    if (!WebPAnimDecoderOptionsInit(&options)) {
+        return NULL;
+    }
+    options.color_mode = MODE_bgrA;
+    options.use_threads = 0;
+    WebPData webPData = { .bytes = data.bytes, .size = data.length };
+    return WebPAnimDecoderNew(&webPData, &options);
+}
+
+
+#pragma mark - _DFWebPIncrementalDecoder
+
+/*! Decodes still WebP images using WebPIDecoder. Rows that are not decoded yet are transparent.
+ */
+@interface _DFWebPIncrementalDecoder : NSObject <DFIncrementalImageDecoding>
+
+@end
+
+@implementation _DFWebPIncrementalDecoder {
+    WebPDecoderConfig _config;
+    WebPIDecoder *_decoder;
+    NSMutableData *_header;
+    BOOL _failed;
+}
+
+- (void)dealloc {
+    if (_decoder) {
+        WebPIDelete(_decoder);
+        free(_config.output.u.RGBA.rgba);
+    }
+}
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _header = [NSMutableData new];
+        _failed = !WebPInitDecoderConfig(&_config);
+    }
+    return self;
+}
+
+- (nullable UIImage *)imageByAppendingData:(nonnull NSData *)data {
+    if (_failed) {
+        return nil;
+    }
+    if (!_decoder) {
+        // Data is accumulated until there are enough bytes to read the dimensions of the image
+        [_header appendData:data];
+        VP8StatusCode status = WebPGetFeatures(_header.bytes, _header.length, &_config.input);
+        if (status == VP8_STATUS_NOT_ENOUGH_DATA) {
+            return nil;
+        }
+        if (status != VP8_STATUS_OK || _config.input.has_animation || !_DFWebPConfigureOutput(&_config)) {
+            _failed = YES;
+            return nil;
+        }
+        _decoder = WebPINewDecoder(&_config.output);
+        if (!_decoder) {
+            free(_config.output.u.RGBA.rgba);
+            _failed = YES;
+            return nil;
+        }
+        data = _header;
+        _header = nil;
+    }
+    VP8StatusCode status = WebPIAppend(_decoder, data.bytes, data.length);
+    if (status != VP8_STATUS_OK && status != VP8_STATUS_SUSPENDED) {
+        _failed = YES;
+        return nil;
+    }
+    int lastRow = 0, width = 0, height = 0, stride = 0;
+    uint8_t *pixels = WebPIDecGetRGB(_decoder, &lastRow, &width, &height, &stride);
+    if (!pixels || lastRow <= 0) {
         return nil;
     }
+    // The decoder keeps writing into its buffer, the image gets a snapshot of the decoded rows
+    size_t size = (size_t)stride * (size_t)height;
+    uint8_t *buffer = calloc(size, 1);
+    if (!buffer) {
+        return nil;
+    }
+    memcpy(buffer, pixels, (size_t)stride * (size_t)lastRow);
+    return _DFWebPCreateImage(buffer, (size_t)width, (size_t)height, (size_t)stride, NO);
+}
+
+@end
+
+
+#if DF_SUBSPEC_GIF_ENABLED
+
+#pragma mark - _DFWebPFrameSource
+
+/*! Decodes frames of the animated WebP image using WebPAnimDecoder. Frames are composed on the canvas sequentially, the decoder is rewound when the frames are requested out of order.
+ */
+@interface _DFWebPFrameSource : NSObject <DFAnimatedImageFrameSource>
+
+- (nullable instancetype)initWithData:(nonnull NSData *)data;
+
+@end
+
+@implementation _DFWebPFrameSource {
+    WebPAnimDecoder *_decoder;
+    size_t _canvasWidth;
+    size_t _canvasHeight;
+    NSArray<NSNumber *> *_durations;
+    NSUInteger _nextIndex;
+    NSLock *_lock;
+}
+
+@synthesize data = _data;
+@synthesize frameCount = _frameCount;
+@synthesize loopCount = _loopCount;
+
+- (void)dealloc {
+    if (_decoder) {
+        WebPAnimDecoderDelete(_decoder);
+    }
+}
+
+- (nullable instancetype)initWithData:(nonnull NSData *)data {
+    if (self = [super init]) {
+        _data = data;
+        _decoder = _DFWebPCreateAnimationDecoder(data);
+        WebPAnimInfo info;
+        if (!_decoder || !WebPAnimDecoderGetInfo(_decoder, &info) || info.frame_count < 1) {
+            return nil;
+        }
+        _canvasWidth = info.canvas_width;
+        _canvasHeight = info.canvas_height;
+        _frameCount = info.frame_count;
+        _loopCount = info.loop_count;
+        _durations = [self _durations];
+        _lock = [NSLock new];
+    }
+    return self;
+}
+
+- (NSArray *)_durations {
+    NSMutableArray *durations = [NSMutableArray arrayWithCapacity:_frameCount];
+    const WebPDemuxer *demuxer = WebPAnimDecoderGetDemuxer(_decoder);
+    for (NSUInteger i = 0; i < _frameCount; i++) {
+        NSTimeInterval duration = 0;
+        WebPIterator iterator;
+        if (WebPDemuxGetFrame(demuxer, (int)i + 1, &iterator)) {
+            duration = iterator.duration / 1000.0;
+            WebPDemuxReleaseIterator(&iterator);
+        }
+        // Follow the browsers which treat very short durations as a default one
+        [durations addObject:@(duration < _kDFWebPMinimumFrameDuration ? _kDFWebPDefaultFrameDuration : duration)];
+    }
+    return durations;
+}
+
+- (NSTimeInterval)durationAtIndex:(NSUInteger)index {
+    return index < _durations.count ? _durations[index].doubleValue : _kDFWebPDefaultFrameDuration;
+}
+
+- (nullable UIImage *)frameAtIndex:(NSUInteger)index maxPixelSize:(CGFloat)maxPixelSize {
+    if (index >= _frameCount) {
+        return nil;
+    }
+    [_lock lock];
+    if (index < _nextIndex) {
+        WebPAnimDecoderReset(_decoder);
+        _nextIndex = 0;
+    }
+    uint8_t *canvas = NULL;
+    int timestamp = 0;
+    while (_nextIndex <= index) {
+        if (!WebPAnimDecoderGetNext(_decoder, &canvas, &timestamp)) {
+            WebPAnimDecoderReset(_decoder);
+            _nextIndex = 0;
+            canvas = NULL;
+            break;
+        }
+        _nextIndex++;
+    }
+    // The canvas is owned by the decoder and is only valid until the next frame is decoded
+    UIImage *frame = canvas ? _DFWebPCreateImageWithCanvas(canvas, _canvasWidth, _canvasHeight, maxPixelSize) : nil;
+    [_lock unlock];
+    return frame;
+}
+
+@end
+
+#endif
+
+
+#pragma mark - DFWebPImageDecoder
+
+@implementation DFWebPImageDecoder
+
+- (UIImage *)imageWithData:(NSData *)data partial:(BOOL)partial {
     if (![self _isWebPData:data]) {
         return nil;
     }
+    if (partial) {
+        return [[_DFWebPIncrementalDecoder new] imageByAppendingData:data];
+    }
     WebPDecoderConfig config;
     if (!WebPInitDecoderConfig(&config)) {
         return nil;
@@ -25,29 +342,46 @@ static void FreeImageData(void *info, const void *data, size_t size) {
     if (WebPGetFeatures(data.bytes, data.length, &config.input) != VP8_STATUS_OK) {
         return nil;
     }
-    config.output.colorspace = config.input.has_alpha ? MODE_rgbA : MODE_RGB;
-    if (WebPDecode(data.bytes, data.length, &config) != VP8_STATUS_OK) {
+    if (config.input.has_animation) {
+        return [self _animatedImageWithData:data];
+    }
+    if (!_DFWebPConfigureOutput(&config)) {
         return nil;
     }
-    size_t width = (size_t)(config.options.use_scaling ? config.options.scaled_width : config.input.width);
-    size_t height = (size_t)(config.options.use_scaling ? config.options.scaled_height : config.input.height);
-    
-    CGDataProviderRef providerRef = CGDataProviderCreateWithData(NULL, config.output.u.RGBA.rgba, config.output.u.RGBA.size, FreeImageData);
-    CGColorSpaceRef colorSpaceRef = CGColorSpaceCreateDeviceRGB();
-    CGBitmapInfo bitmapInfo = config.input.has_alpha ? kCGBitmapByteOrder32Big | kCGImageAlphaPremultipliedLast : 0;
-    size_t components = config.input.has_alpha ? 4 : 3;
-    CGImageRef imageRef = CGImageCreate(width, height, 8, components * 8, components * width, colorSpaceRef, bitmapInfo, providerRef, NULL, NO, kCGRenderingIntentDefault);
-    if (colorSpaceRef) {
-        CGColorSpaceRelease(colorSpaceRef);
+    DFImageCancellationToken *token = [DFImageCancellationToken currentToken];
+    VP8StatusCode status = token ? _DFWebPDecodeCancellable(data, &config, token) : WebPDecode(data.bytes, data.length, &config);
+    if (status != VP8_STATUS_OK) {
+        free(config.output.u.RGBA.rgba);
+        return nil;
     }
-    if (providerRef) {
-        CGDataProviderRelease(providerRef);
+    return _DFWebPCreateImage(config.output.u.RGBA.rgba, (size_t)config.input.width, (size_t)config.input.height, (size_t)config.output.u.RGBA.stride, !config.input.has_alpha);
+}
+
+- (nullable id<DFIncrementalImageDecoding>)incrementalDecoderForData:(nonnull NSData *)data {
+    return [self _isWebPData:data] ? [_DFWebPIncrementalDecoder new] : nil;
+}
+
+/*! Returns the animated image when the GIF subspec is available, otherwise returns the first frame.
+ */
+- (nullable UIImage *)_animatedImageWithData:(NSData *)data {
+#if DF_SUBSPEC_GIF_ENABLED
+    _DFWebPFrameSource *frameSource = [[_DFWebPFrameSource alloc] initWithData:data];
+    return frameSource ? [DFAnimatedImage animatedImageWithFrameSource:frameSource maxPixelSize:0] : nil;
+#else
+    WebPAnimDecoder *decoder = _DFWebPCreateAnimationDecoder(data);
+    if (!decoder) {
+        return nil;
     }
-    UIImage *image = [[UIImage alloc] initWithCGImage:imageRef];
-    if (imageRef) {
-        CGImageRelease(imageRef);
+    UIImage *image;
+    WebPAnimInfo info;
+    uint8_t *canvas = NULL;
+    int timestamp = 0;
+    if (WebPAnimDecoderGetInfo(decoder, &info) && WebPAnimDecoderGetNext(decoder, &canvas, &timestamp)) {
+        image = _DFWebPCreateImageWithCanvas(canvas, info.canvas_width, info.canvas_height, 0);
     }
+    WebPAnimDecoderDelete(decoder);
     return image;
+#endif
 }
 
 - (BOOL)_isWebPData:(NSData *)data {